@@ -0,0 +1,136 @@
+#include "core/ThreadPool.hpp"
+#include "renderer/FrustumCuller.hpp"
+
+// libs
+#include <glm/glm.hpp>
+
+// std
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <limits>
+#include <random>
+#include <vector>
+
+// Times the FrustumCuller kernels, with and without the thread pool, after checking that they all return the same
+// objects as the single threaded scalar kernel. Exits with a failure on a mismatch
+
+namespace
+{
+using Kernel = renderer::FrustumCuller::Kernel;
+
+constexpr std::array<size_t, 3> OBJECT_COUNTS = {10'000, 100'000, 1'000'000};
+constexpr std::array<Kernel, 3> KERNELS = {Kernel::eScalar, Kernel::eSse, Kernel::eAvx2};
+// Objects culled per configuration, spread over as many repetitions as needed. At least MIN_REPETITIONS
+constexpr size_t OBJECTS_PER_CONFIGURATION = 50'000'000;
+constexpr size_t MIN_REPETITIONS = 5;
+constexpr float SCENE_HALF_SIZE = 100.f;
+constexpr float MIN_RADIUS = 0.5f;
+constexpr float MAX_RADIUS = 2.f;
+constexpr float HALF_FOV = 0.5f;   // radians
+constexpr float NEAR_PLANE = 0.1f;
+
+const char* kernelName(Kernel kernel) noexcept
+{
+    switch (kernel) {
+        case Kernel::eScalar: return "scalar";
+        case Kernel::eSse: return "sse";
+        case Kernel::eAvx2: return "avx2";
+        default: return "unknown";
+    }
+}
+
+// Camera at the origin looking down -z, without a far plane like utils::frustumPlanes
+std::array<glm::vec4, 5> frustumPlanes() noexcept
+{
+    float slope = std::tan(HALF_FOV);
+    auto normalized = [](const glm::vec4& plane) { return plane / glm::length(glm::vec3(plane)); };
+    return {normalized({1.f, 0.f, -slope, 0.f}),
+            normalized({-1.f, 0.f, -slope, 0.f}),
+            normalized({0.f, 1.f, -slope, 0.f}),
+            normalized({0.f, -1.f, -slope, 0.f}),
+            glm::vec4(0.f, 0.f, -1.f, -NEAR_PLANE)};
+}
+
+// Random spheres in a cube around the camera, each with a random box inside it
+void fill(renderer::FrustumCuller& culler, size_t count, std::mt19937& random)
+{
+    std::uniform_real_distribution<float> position(-SCENE_HALF_SIZE, SCENE_HALF_SIZE);
+    std::uniform_real_distribution<float> radius(MIN_RADIUS, MAX_RADIUS);
+    std::uniform_real_distribution<float> unit(0.f, 1.f);
+
+    culler.clear();
+    culler.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        glm::vec3 center(position(random), position(random), position(random));
+        float r = radius(random);
+        glm::vec3 halfExtent = glm::vec3(unit(random), unit(random), unit(random)) * (r / std::sqrt(3.f));
+        culler.add(center, r, center - halfExtent, center + halfExtent);
+    }
+}
+
+// Fastest of the repetitions, the least disturbed by the rest of the system, in milliseconds
+double timeCull(const renderer::FrustumCuller& culler,
+                const std::array<glm::vec4, 5>& planes,
+                core::ThreadPool* threadPool,
+                std::vector<uint32_t>& visible)
+{
+    size_t repetitions = std::max(MIN_REPETITIONS, OBJECTS_PER_CONFIGURATION / culler.size());
+    double fastest = std::numeric_limits<double>::max();
+    for (size_t i = 0; i < repetitions; ++i) {
+        auto start = std::chrono::steady_clock::now();
+        culler.cull(planes, visible, threadPool);
+        auto end = std::chrono::steady_clock::now();
+        fastest = std::min(fastest, std::chrono::duration<double, std::milli>(end - start).count());
+    }
+    return fastest;
+}
+}   // namespace
+
+int main()
+{
+#ifndef NDEBUG
+    std::printf("Assertions are enabled, timings are only meaningful in a Release build\n");
+#endif
+
+    core::ThreadPool threadPool;
+    std::mt19937 random(42);
+    const auto planes = frustumPlanes();
+    renderer::FrustumCuller culler;
+    std::vector<uint32_t> expected;
+    std::vector<uint32_t> visible;
+
+    std::printf("%zu worker threads\n", threadPool.numThreads());
+    std::printf("%10s %8s %10s %12s %12s\n", "objects", "kernel", "visible", "1 thread ms", "pool ms");
+    for (size_t count : OBJECT_COUNTS) {
+        fill(culler, count, random);
+        culler.setKernel(Kernel::eScalar);
+        culler.cull(planes, expected);
+
+        for (Kernel kernel : KERNELS) {
+            culler.setKernel(kernel);
+            if (culler.kernel() != kernel) {
+                std::printf("%10zu %8s %10s\n", count, kernelName(kernel), "unsupported");
+                continue;
+            }
+
+            double singleThreaded = timeCull(culler, planes, nullptr, visible);
+            if (visible != expected) {
+                std::printf("%s kernel mismatch on %zu objects\n", kernelName(kernel), count);
+                return EXIT_FAILURE;
+            }
+            double pooled = timeCull(culler, planes, &threadPool, visible);
+            if (visible != expected) {
+                std::printf("%s kernel mismatch on %zu objects with the thread pool\n", kernelName(kernel), count);
+                return EXIT_FAILURE;
+            }
+
+            std::printf("%10zu %8s %10zu %12.3f %12.3f\n", count, kernelName(kernel), visible.size(), singleThreaded,
+                        pooled);
+        }
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,29 @@
+# Writes a header with the SPIR-V words of a shader as a constexpr array, so the executable does not need the .spv
+# files. Run with cmake -DSPIRV=<file.spv> -DNAME=<array name> -DOUTPUT=<header> -P EmbedSpirv.cmake
+
+file(READ "${SPIRV}" HEX HEX)
+string(LENGTH "${HEX}" HEX_LENGTH)
+math(EXPR REMAINDER "${HEX_LENGTH} % 8")
+if (HEX_LENGTH EQUAL 0 OR NOT REMAINDER EQUAL 0)
+    message(FATAL_ERROR "${SPIRV} is not SPIR-V, its size is not a multiple of 4 bytes")
+endif()
+
+# glslangValidator writes the words little endian
+string(REGEX REPLACE "(..)(..)(..)(..)" "    0x\\4\\3\\2\\1,\n" WORDS "${HEX}")
+string(TOUPPER "${NAME}" GUARD)
+
+file(WRITE "${OUTPUT}.tmp"
+     "// Generated from ${SPIRV}, do not edit\n"
+     "#ifndef SHADERS_${GUARD}_HPP\n"
+     "#define SHADERS_${GUARD}_HPP\n\n"
+     "// std\n"
+     "#include <cstdint>\n\n"
+     "namespace shaders\n{\n\n"
+     "alignas(4) inline constexpr uint32_t ${NAME}[] = {\n"
+     "${WORDS}"
+     "};\n\n"
+     "}   // namespace shaders\n\n"
+     "#endif\n")
+# Keeps the timestamp when nothing changed, so the sources including it are not rebuilt
+file(COPY_FILE "${OUTPUT}.tmp" "${OUTPUT}" ONLY_IF_DIFFERENT)
+file(REMOVE "${OUTPUT}.tmp")
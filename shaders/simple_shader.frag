@@ -1,5 +1,9 @@
 #version 450
 
+// Specialized at pipeline creation, the unused branches are compiled out
+layout(constant_id = 0) const bool USE_TEXTURE = true;
+layout(constant_id = 1) const bool USE_VERTEX_COLOR = false;
+
 layout(set = 1, binding = 0) uniform sampler2D texSampler;
 
 layout(location = 0) in vec3 fragColor;
@@ -9,5 +13,9 @@ layout(location = 0) out vec4 outColor;
 
 void main()
 {
-    outColor = texture(texSampler, fragTexCoord);
+    vec4 color = USE_TEXTURE ? texture(texSampler, fragTexCoord) : vec4(1.0);
+    if (USE_VERTEX_COLOR) {
+        color.rgb *= fragColor;
+    }
+    outColor = color;
 }
@@ -2,22 +2,30 @@
 
 layout(set = 0, binding = 0) uniform UniformBufferObject
 {
-    mat4 model;
     mat4 view;
     mat4 proj;
 }
 ubo;
 
-layout(location = 0) in vec2 inPosition;
+// Per draw, no descriptor or buffer update needed
+layout(push_constant) uniform DrawPushConstants
+{
+    mat4 model;
+}
+draw;
+
+layout(location = 0) in vec3 inPosition;
 layout(location = 1) in vec3 inColor;
 layout(location = 2) in vec2 inTexCoord;
+// Per instance, locations 3 to 6
+layout(location = 3) in mat4 instanceModel;
 
 layout(location = 0) out vec3 fragColor;
 layout(location = 1) out vec2 fragTexCoord;
 
 void main()
 {
-    gl_Position = ubo.proj * ubo.view * ubo.model * vec4(inPosition, 0.0, 1.0);
+    gl_Position = ubo.proj * ubo.view * draw.model * instanceModel * vec4(inPosition, 1.0);
     fragColor = inColor;
     fragTexCoord = inTexCoord;
 }
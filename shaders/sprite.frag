@@ -0,0 +1,16 @@
+#version 450
+
+// Same layout as the texture set of the simple shader, so the streamed textures' descriptors are shared
+layout(set = 0, binding = 0) uniform sampler2D spriteTexture;
+
+layout(location = 0) in vec4 fragColor;
+layout(location = 1) in vec2 fragTexCoord;
+
+layout(location = 0) out vec4 outColor;
+
+void main()
+{
+    vec4 color = texture(spriteTexture, fragTexCoord) * fragColor;
+    // The pipeline blends premultiplied alpha
+    outColor = vec4(color.rgb * color.a, color.a);
+}
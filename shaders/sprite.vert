@@ -0,0 +1,30 @@
+#version 450
+
+// Pixels to clip space, per frame
+layout(push_constant) uniform SpritePushConstants
+{
+    mat4 viewProj;
+}
+sprite;
+
+// Per instance, see SpriteInstance. There is no vertex buffer, the corners of the quad come from the vertex index
+layout(location = 0) in vec4 instanceRect;       // center and size, in pixels
+layout(location = 1) in vec4 instanceUvRect;     // min and size
+layout(location = 2) in vec2 instanceRotation;   // cosine and sine
+layout(location = 3) in uint instanceColor;      // RGBA8, straight alpha
+
+layout(location = 0) out vec4 fragColor;
+layout(location = 1) out vec2 fragTexCoord;
+
+void main()
+{
+    // Drawn as a triangle strip of the corners (0, 0), (1, 0), (0, 1), (1, 1)
+    vec2 corner = vec2(gl_VertexIndex & 1, gl_VertexIndex >> 1);
+    vec2 offset = (corner - 0.5) * instanceRect.zw;
+    vec2 rotated = vec2(offset.x * instanceRotation.x - offset.y * instanceRotation.y,
+                        offset.x * instanceRotation.y + offset.y * instanceRotation.x);
+
+    gl_Position = sprite.viewProj * vec4(instanceRect.xy + rotated, 0.0, 1.0);
+    fragColor = unpackUnorm4x8(instanceColor);
+    fragTexCoord = instanceUvRect.xy + corner * instanceUvRect.zw;
+}
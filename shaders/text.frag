@@ -0,0 +1,21 @@
+#version 450
+
+// A glyph page of the text renderer, same layout as the sprite texture set
+layout(set = 0, binding = 0) uniform sampler2D glyphTexture;
+
+layout(location = 0) in vec4 fragColor;
+layout(location = 1) in vec2 fragTexCoord;
+
+layout(location = 0) out vec4 outColor;
+
+void main()
+{
+    // The signed distance field is 0.5 on the outline, antialiased over about a pixel at any scale
+    float field = texture(glyphTexture, fragTexCoord).r;
+    float width = max(fwidth(field), 1e-4);
+    float coverage = smoothstep(0.5 - width, 0.5 + width, field);
+
+    // The pipeline blends premultiplied alpha
+    float alpha = fragColor.a * coverage;
+    outColor = vec4(fragColor.rgb * alpha, alpha);
+}
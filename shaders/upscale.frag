@@ -0,0 +1,19 @@
+#version 450
+
+// The scene rendered at a lower resolution, sampled bilinearly with clamped edges
+layout(set = 0, binding = 0) uniform sampler2D sceneColor;
+
+// The scene only covers the top left region of sceneColor, see UpscalePushConstants
+layout(push_constant) uniform Region {
+    vec2 uvScale;
+    vec2 uvMax;
+} region;
+
+layout(location = 0) in vec2 fragTexCoord;
+
+layout(location = 0) out vec4 outColor;
+
+void main()
+{
+    outColor = texture(sceneColor, min(fragTexCoord * region.uvScale, region.uvMax));
+}
@@ -0,0 +1,11 @@
+#version 450
+
+layout(location = 0) out vec2 fragTexCoord;
+
+void main()
+{
+    // A single triangle covering the screen, drawn without a vertex buffer: (0, 0), (2, 0) and (0, 2) in texture
+    // coordinates
+    fragTexCoord = vec2((gl_VertexIndex << 1) & 2, gl_VertexIndex & 2);
+    gl_Position = vec4(fragTexCoord * 2.0 - 1.0, 0.0, 1.0);
+}
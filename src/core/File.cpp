@@ -0,0 +1,25 @@
+#include "File.hpp"
+
+// std
+#include <fstream>
+
+namespace core
+{
+
+std::vector<char> readFile(const std::filesystem::path& path)
+{
+    std::ifstream file;
+    file.exceptions(std::ifstream::badbit | std::ifstream::failbit);
+    file.open(path, std::ios::ate | std::ios::binary);
+
+    std::streampos fileSize = file.tellg();
+    std::vector<char> buffer(static_cast<size_t>(fileSize));
+
+    file.seekg(0);
+    file.read(buffer.data(), fileSize);
+    file.close();
+
+    return buffer;
+}
+
+}   // namespace core
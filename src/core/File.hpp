@@ -0,0 +1,16 @@
+#ifndef CORE_FILE_HPP
+#define CORE_FILE_HPP
+
+// std
+#include <filesystem>
+#include <vector>
+
+namespace core
+{
+
+// The whole file, throws std::ios_base::failure if it cannot be read
+std::vector<char> readFile(const std::filesystem::path& path);
+
+}   // namespace core
+
+#endif
@@ -0,0 +1,101 @@
+#include "FileWatcher.hpp"
+
+// std
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
+#include <system_error>
+#include <utility>
+
+// posix
+#include <sys/inotify.h>
+#include <unistd.h>
+
+namespace core
+{
+
+FileWatcher::FileWatcher(FileWatcher&& rhs) noexcept
+    : m_fd(std::exchange(rhs.m_fd, -1))
+    , m_directories(std::move(rhs.m_directories))
+    , m_watchedFiles(std::move(rhs.m_watchedFiles))
+{}
+
+FileWatcher& FileWatcher::operator=(FileWatcher&& rhs) noexcept
+{
+    if (this != &rhs) {
+        std::swap(m_fd, rhs.m_fd);
+        std::swap(m_directories, rhs.m_directories);
+        std::swap(m_watchedFiles, rhs.m_watchedFiles);
+    }
+    return *this;
+}
+
+FileWatcher::~FileWatcher() noexcept
+{
+    if (m_fd >= 0) {
+        close(m_fd);
+    }
+}
+
+void FileWatcher::watch(const std::filesystem::path& path)
+{
+    if (m_fd < 0) {
+        m_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (m_fd < 0) {
+            throw std::system_error(errno, std::generic_category(), "inotify_init1");
+        }
+    }
+
+    std::filesystem::path canonicalPath = std::filesystem::weakly_canonical(path);
+    std::filesystem::path directory = canonicalPath.parent_path();
+    // Watching the same directory twice returns the same descriptor
+    int wd = inotify_add_watch(m_fd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+    if (wd < 0) {
+        throw std::system_error(errno, std::generic_category(), "inotify_add_watch " + directory.string());
+    }
+
+    m_directories.insert_or_assign(wd, std::move(directory));
+    m_watchedFiles.insert_or_assign(canonicalPath.string(), path);
+}
+
+std::vector<std::filesystem::path> FileWatcher::poll()
+{
+    std::vector<std::filesystem::path> changed;
+    if (m_fd < 0) {
+        return changed;
+    }
+
+    alignas(inotify_event) char buffer[4096];
+    while (true) {
+        ssize_t length = read(m_fd, buffer, sizeof(buffer));
+        if (length < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EAGAIN) {
+                break;
+            }
+            throw std::system_error(errno, std::generic_category(), "inotify read");
+        }
+
+        for (size_t offset = 0; offset < static_cast<size_t>(length);) {
+            inotify_event event;
+            std::memcpy(&event, buffer + offset, sizeof(event));
+            const char* name = buffer + offset + sizeof(event);
+            offset += sizeof(event) + event.len;
+
+            auto directory = m_directories.find(event.wd);
+            if (event.len == 0 || directory == m_directories.end()) {
+                continue;
+            }
+            auto file = m_watchedFiles.find((directory->second / name).string());
+            if (file != m_watchedFiles.end() && std::ranges::find(changed, file->second) == changed.end()) {
+                changed.push_back(file->second);
+            }
+        }
+    }
+    return changed;
+}
+
+}   // namespace core
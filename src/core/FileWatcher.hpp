@@ -0,0 +1,43 @@
+#ifndef CORE_FILE_WATCHER_HPP
+#define CORE_FILE_WATCHER_HPP
+
+// std
+#include <filesystem>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace core
+{
+
+// Reports modified files with inotify, without blocking. Directories are watched rather than files, so files
+// replaced by a rename, as most editors and compilers do, are still reported
+class FileWatcher
+{
+public:
+    FileWatcher() noexcept = default;
+
+    FileWatcher(const FileWatcher&) = delete;
+    FileWatcher& operator=(const FileWatcher&) = delete;
+
+    FileWatcher(FileWatcher&&) noexcept;
+    FileWatcher& operator=(FileWatcher&&) noexcept;
+
+    ~FileWatcher() noexcept;
+
+public:
+    // The file does not need to exist yet, but its directory does
+    void watch(const std::filesystem::path& path);
+
+    // Watched files written or replaced since the last call, as given to watch. Each file is reported once per call
+    std::vector<std::filesystem::path> poll();
+
+private:
+    int m_fd = -1;
+    std::unordered_map<int, std::filesystem::path> m_directories;            // by watch descriptor, canonical
+    std::unordered_map<std::string, std::filesystem::path> m_watchedFiles;   // by canonical path
+};
+
+}   // namespace core
+
+#endif
@@ -0,0 +1,31 @@
+#ifndef CORE_HASH_HPP
+#define CORE_HASH_HPP
+
+// std
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+namespace core
+{
+
+inline constexpr uint64_t FNV1A_64_OFFSET_BASIS = 0xcbf29ce484222325ull;
+
+// FNV-1a, not cryptographic. Used for content and state hashing
+inline uint64_t fnv1a64(std::span<const std::byte> bytes, uint64_t hash = FNV1A_64_OFFSET_BASIS) noexcept
+{
+    for (std::byte b : bytes) {
+        hash ^= static_cast<uint64_t>(b);
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
+
+inline uint64_t hashCombine(uint64_t seed, uint64_t value) noexcept
+{
+    return seed ^ (value + 0x9e3779b97f4a7c15ull + (seed << 6) + (seed >> 2));
+}
+
+}   // namespace core
+
+#endif
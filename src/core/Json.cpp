@@ -0,0 +1,355 @@
+#include "Json.hpp"
+
+// std
+#include <charconv>
+#include <format>
+#include <stdexcept>
+
+namespace core
+{
+
+namespace
+{
+constexpr uint32_t MAX_DEPTH = 256;
+
+void appendUtf8(std::string& out, uint32_t codepoint)
+{
+    if (codepoint < 0x80) {
+        out.push_back(static_cast<char>(codepoint));
+    } else if (codepoint < 0x800) {
+        out.push_back(static_cast<char>(0xc0 | (codepoint >> 6)));
+        out.push_back(static_cast<char>(0x80 | (codepoint & 0x3f)));
+    } else if (codepoint < 0x10000) {
+        out.push_back(static_cast<char>(0xe0 | (codepoint >> 12)));
+        out.push_back(static_cast<char>(0x80 | ((codepoint >> 6) & 0x3f)));
+        out.push_back(static_cast<char>(0x80 | (codepoint & 0x3f)));
+    } else {
+        out.push_back(static_cast<char>(0xf0 | (codepoint >> 18)));
+        out.push_back(static_cast<char>(0x80 | ((codepoint >> 12) & 0x3f)));
+        out.push_back(static_cast<char>(0x80 | ((codepoint >> 6) & 0x3f)));
+        out.push_back(static_cast<char>(0x80 | (codepoint & 0x3f)));
+    }
+}
+}   // namespace
+
+class JsonValue::Parser
+{
+public:
+    explicit Parser(std::string_view text) noexcept
+        : m_text(text)
+    {}
+
+    JsonValue parseDocument()
+    {
+        JsonValue value = parseValue(0);
+        skipWhitespace();
+        if (m_pos != m_text.size()) {
+            fail("unexpected trailing characters");
+        }
+        return value;
+    }
+
+private:
+    [[noreturn]] void fail(std::string_view reason) const
+    {
+        throw std::runtime_error(std::format("JSON parse error at offset {}: {}", m_pos, reason));
+    }
+
+    void skipWhitespace() noexcept
+    {
+        while (m_pos < m_text.size() &&
+               (m_text[m_pos] == ' ' || m_text[m_pos] == '\t' || m_text[m_pos] == '\n' || m_text[m_pos] == '\r')) {
+            ++m_pos;
+        }
+    }
+
+    char peek() const noexcept { return m_pos < m_text.size() ? m_text[m_pos] : '\0'; }
+
+    void expect(char c)
+    {
+        if (peek() != c) {
+            fail(std::format("expected '{}'", c));
+        }
+        ++m_pos;
+    }
+
+    void expectLiteral(std::string_view literal)
+    {
+        if (m_text.substr(m_pos, literal.size()) != literal) {
+            fail("invalid literal");
+        }
+        m_pos += literal.size();
+    }
+
+    JsonValue parseValue(uint32_t depth)
+    {
+        if (depth > MAX_DEPTH) {
+            fail("maximum nesting depth exceeded");
+        }
+
+        skipWhitespace();
+        JsonValue value;
+        switch (peek()) {
+            case '{': parseObject(value, depth); break;
+            case '[': parseArray(value, depth); break;
+            case '"':
+                value.m_type = Type::STRING;
+                value.m_string = parseString();
+                break;
+            case 't':
+                expectLiteral("true");
+                value.m_type = Type::BOOLEAN;
+                value.m_boolean = true;
+                break;
+            case 'f':
+                expectLiteral("false");
+                value.m_type = Type::BOOLEAN;
+                value.m_boolean = false;
+                break;
+            case 'n':
+                expectLiteral("null");
+                value.m_type = Type::NUL;
+                break;
+            default:
+                value.m_type = Type::NUMBER;
+                value.m_number = parseNumber();
+                break;
+        }
+        return value;
+    }
+
+    void parseObject(JsonValue& value, uint32_t depth)
+    {
+        value.m_type = Type::OBJECT;
+        expect('{');
+        skipWhitespace();
+        if (peek() == '}') {
+            ++m_pos;
+            return;
+        }
+
+        while (true) {
+            skipWhitespace();
+            value.m_keys.push_back(parseString());
+            skipWhitespace();
+            expect(':');
+            value.m_values.push_back(parseValue(depth + 1));
+            skipWhitespace();
+            if (peek() == ',') {
+                ++m_pos;
+                continue;
+            }
+            expect('}');
+            return;
+        }
+    }
+
+    void parseArray(JsonValue& value, uint32_t depth)
+    {
+        value.m_type = Type::ARRAY;
+        expect('[');
+        skipWhitespace();
+        if (peek() == ']') {
+            ++m_pos;
+            return;
+        }
+
+        while (true) {
+            value.m_values.push_back(parseValue(depth + 1));
+            skipWhitespace();
+            if (peek() == ',') {
+                ++m_pos;
+                continue;
+            }
+            expect(']');
+            return;
+        }
+    }
+
+    uint32_t parseHex4()
+    {
+        if (m_pos + 4 > m_text.size()) {
+            fail("truncated unicode escape");
+        }
+
+        uint32_t value = 0;
+        for (size_t i = 0; i < 4; ++i) {
+            char c = m_text[m_pos++];
+            value <<= 4;
+            if (c >= '0' && c <= '9') {
+                value |= static_cast<uint32_t>(c - '0');
+            } else if (c >= 'a' && c <= 'f') {
+                value |= static_cast<uint32_t>(c - 'a' + 10);
+            } else if (c >= 'A' && c <= 'F') {
+                value |= static_cast<uint32_t>(c - 'A' + 10);
+            } else {
+                fail("invalid unicode escape");
+            }
+        }
+        return value;
+    }
+
+    std::string parseString()
+    {
+        expect('"');
+        std::string out;
+        while (true) {
+            if (m_pos >= m_text.size()) {
+                fail("unterminated string");
+            }
+
+            char c = m_text[m_pos++];
+            if (c == '"') {
+                return out;
+            }
+            if (c != '\\') {
+                out.push_back(c);
+                continue;
+            }
+
+            if (m_pos >= m_text.size()) {
+                fail("unterminated escape sequence");
+            }
+            char escaped = m_text[m_pos++];
+            switch (escaped) {
+                case '"': out.push_back('"'); break;
+                case '\\': out.push_back('\\'); break;
+                case '/': out.push_back('/'); break;
+                case 'b': out.push_back('\b'); break;
+                case 'f': out.push_back('\f'); break;
+                case 'n': out.push_back('\n'); break;
+                case 'r': out.push_back('\r'); break;
+                case 't': out.push_back('\t'); break;
+                case 'u': {
+                    uint32_t codepoint = parseHex4();
+                    if (codepoint >= 0xdc00 && codepoint <= 0xdfff) {
+                        fail("unpaired low surrogate");
+                    }
+                    // UTF-16 surrogate pair
+                    if (codepoint >= 0xd800 && codepoint <= 0xdbff) {
+                        if (m_text.substr(m_pos, 2) != "\\u") {
+                            fail("unpaired high surrogate");
+                        }
+                        m_pos += 2;
+                        uint32_t low = parseHex4();
+                        if (low < 0xdc00 || low > 0xdfff) {
+                            fail("high surrogate not followed by a low surrogate");
+                        }
+                        codepoint = 0x10000 + ((codepoint - 0xd800) << 10) + (low - 0xdc00);
+                    }
+                    appendUtf8(out, codepoint);
+                    break;
+                }
+                default: fail("invalid escape sequence");
+            }
+        }
+    }
+
+    double parseNumber()
+    {
+        size_t begin = m_pos;
+        while (m_pos < m_text.size()) {
+            char c = m_text[m_pos];
+            if ((c >= '0' && c <= '9') || c == '-' || c == '+' || c == '.' || c == 'e' || c == 'E') {
+                ++m_pos;
+            } else {
+                break;
+            }
+        }
+
+        if (begin == m_pos) {
+            fail("unexpected character");
+        }
+
+        // Unlike strtod, independent of the locale's decimal separator
+        double value = 0.;
+        auto [end, error] = std::from_chars(m_text.data() + begin, m_text.data() + m_pos, value);
+        if (error != std::errc() || end != m_text.data() + m_pos) {
+            fail("invalid number");
+        }
+        return value;
+    }
+
+private:
+    std::string_view m_text;
+    size_t m_pos = 0;
+};
+
+JsonValue JsonValue::parse(std::string_view text)
+{
+    return Parser(text).parseDocument();
+}
+
+bool JsonValue::boolean() const
+{
+    if (m_type != Type::BOOLEAN) {
+        throw std::runtime_error("JSON value is not a boolean");
+    }
+    return m_boolean;
+}
+
+double JsonValue::number() const
+{
+    if (m_type != Type::NUMBER) {
+        throw std::runtime_error("JSON value is not a number");
+    }
+    return m_number;
+}
+
+const std::string& JsonValue::string() const
+{
+    if (m_type != Type::STRING) {
+        throw std::runtime_error("JSON value is not a string");
+    }
+    return m_string;
+}
+
+size_t JsonValue::size() const noexcept
+{
+    return m_type == Type::ARRAY || m_type == Type::OBJECT ? m_values.size() : 0;
+}
+
+const JsonValue& JsonValue::operator[](size_t index) const
+{
+    if (m_type != Type::ARRAY || index >= m_values.size()) {
+        throw std::runtime_error(std::format("JSON array index {} out of range", index));
+    }
+    return m_values[index];
+}
+
+const JsonValue* JsonValue::find(std::string_view key) const noexcept
+{
+    if (m_type != Type::OBJECT) {
+        return nullptr;
+    }
+
+    for (size_t i = 0; i < m_keys.size(); ++i) {
+        if (m_keys[i] == key) {
+            return &m_values[i];
+        }
+    }
+    return nullptr;
+}
+
+const JsonValue& JsonValue::at(std::string_view key) const
+{
+    const JsonValue* value = find(key);
+    if (!value) {
+        throw std::runtime_error(std::format("JSON object has no member \"{}\"", key));
+    }
+    return *value;
+}
+
+double JsonValue::numberOr(std::string_view key, double defaultValue) const
+{
+    const JsonValue* value = find(key);
+    return value ? value->number() : defaultValue;
+}
+
+std::string JsonValue::stringOr(std::string_view key, std::string_view defaultValue) const
+{
+    const JsonValue* value = find(key);
+    return value ? value->string() : std::string(defaultValue);
+}
+
+}   // namespace core
@@ -0,0 +1,84 @@
+#ifndef CORE_JSON_HPP
+#define CORE_JSON_HPP
+
+// std
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace core
+{
+
+// Minimal read-only JSON document, enough for asset formats such as glTF.
+// Parsing errors throw std::runtime_error.
+class JsonValue
+{
+public:
+    enum class Type : uint8_t {
+        NUL,
+        BOOLEAN,
+        NUMBER,
+        STRING,
+        ARRAY,
+        OBJECT,
+    };
+
+    JsonValue() noexcept = default;
+
+    JsonValue(const JsonValue&) = default;
+    JsonValue& operator=(const JsonValue&) = default;
+
+    JsonValue(JsonValue&&) noexcept = default;
+    JsonValue& operator=(JsonValue&&) noexcept = default;
+
+    ~JsonValue() noexcept = default;
+
+    static JsonValue parse(std::string_view text);
+
+public:
+    Type type() const noexcept { return m_type; }
+    bool isNull() const noexcept { return m_type == Type::NUL; }
+    bool isObject() const noexcept { return m_type == Type::OBJECT; }
+    bool isArray() const noexcept { return m_type == Type::ARRAY; }
+
+    // Throw std::runtime_error if the type does not match
+    bool boolean() const;
+    double number() const;
+    const std::string& string() const;
+
+    // Number of elements of an array or members of an object, 0 otherwise
+    size_t size() const noexcept;
+
+    // Array element
+    const JsonValue& operator[](size_t index) const;
+
+    // Object member, nullptr if missing or if this is not an object
+    const JsonValue* find(std::string_view key) const noexcept;
+    // Object member, throws std::runtime_error if missing
+    const JsonValue& at(std::string_view key) const;
+
+    bool contains(std::string_view key) const noexcept { return find(key) != nullptr; }
+
+    // Convenience accessors for optional members
+    double numberOr(std::string_view key, double defaultValue) const;
+    std::string stringOr(std::string_view key, std::string_view defaultValue) const;
+
+    const std::vector<std::string>& keys() const noexcept { return m_keys; }
+    const std::vector<JsonValue>& values() const noexcept { return m_values; }
+
+private:
+    class Parser;
+
+    Type m_type = Type::NUL;
+    bool m_boolean = false;
+    double m_number = 0.0;
+    std::string m_string;
+    std::vector<std::string> m_keys;   // object member names, same order as m_values
+    std::vector<JsonValue> m_values;   // array elements or object member values
+};
+
+}   // namespace core
+
+#endif
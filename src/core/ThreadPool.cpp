@@ -0,0 +1,106 @@
+#include "ThreadPool.hpp"
+
+// std
+#include <algorithm>
+#include <exception>
+
+namespace core
+{
+
+ThreadPool::ThreadPool(size_t numThreads)
+{
+    if (numThreads == 0) {
+        size_t hardwareThreads = std::thread::hardware_concurrency();
+        numThreads = std::max<size_t>(hardwareThreads, 2) - 1;
+    }
+
+    m_workers.reserve(numThreads);
+    for (size_t i = 0; i < numThreads; ++i) {
+        m_workers.emplace_back(&ThreadPool::workerLoop, this);
+    }
+}
+
+ThreadPool::~ThreadPool() noexcept
+{
+    {
+        std::lock_guard lock(m_mutex);
+        m_stopping = true;
+    }
+    m_condition.notify_all();
+
+    for (auto& worker : m_workers) {
+        worker.join();
+    }
+}
+
+void ThreadPool::parallelFor(size_t count, const std::function<void(size_t)>& fn)
+{
+    if (count == 0) {
+        return;
+    }
+
+    size_t numChunks = std::min(count, m_workers.size() + 1);
+    size_t chunkSize = (count + numChunks - 1) / numChunks;
+    auto runChunk = [&fn, count, chunkSize](size_t chunk) {
+        size_t end = std::min(count, (chunk + 1) * chunkSize);
+        for (size_t i = chunk * chunkSize; i < end; ++i) {
+            fn(i);
+        }
+    };
+
+    std::vector<std::future<void>> futures;
+    futures.reserve(numChunks - 1);
+    for (size_t chunk = 1; chunk < numChunks; ++chunk) {
+        futures.push_back(submit([&runChunk, chunk]() { runChunk(chunk); }));
+    }
+
+    // The calling thread takes the first chunk instead of idling. Every future is waited on before rethrowing, as
+    // the jobs reference this stack frame
+    std::exception_ptr exception;
+    try {
+        runChunk(0);
+    } catch (...) {
+        exception = std::current_exception();
+    }
+    for (auto& future : futures) {
+        try {
+            future.get();
+        } catch (...) {
+            if (!exception) {
+                exception = std::current_exception();
+            }
+        }
+    }
+
+    if (exception) {
+        std::rethrow_exception(exception);
+    }
+}
+
+void ThreadPool::enqueue(std::function<void()>&& job)
+{
+    {
+        std::lock_guard lock(m_mutex);
+        m_jobs.push(std::move(job));
+    }
+    m_condition.notify_one();
+}
+
+void ThreadPool::workerLoop()
+{
+    while (true) {
+        std::function<void()> job;
+        {
+            std::unique_lock lock(m_mutex);
+            m_condition.wait(lock, [this]() { return m_stopping || !m_jobs.empty(); });
+            if (m_jobs.empty()) {
+                return;
+            }
+            job = std::move(m_jobs.front());
+            m_jobs.pop();
+        }
+        job();
+    }
+}
+
+}   // namespace core
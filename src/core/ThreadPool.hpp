@@ -0,0 +1,74 @@
+#ifndef CORE_THREAD_POOL_HPP
+#define CORE_THREAD_POOL_HPP
+
+// std
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace core
+{
+
+// Fixed size pool of worker threads consuming a FIFO of jobs. Not movable, hold it in a std::unique_ptr
+class ThreadPool
+{
+public:
+    // 0 uses one worker per hardware thread, minus the calling thread
+    explicit ThreadPool(size_t numThreads = 0);
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    ThreadPool(ThreadPool&&) = delete;
+    ThreadPool& operator=(ThreadPool&&) = delete;
+
+    // Finishes the queued jobs before joining
+    ~ThreadPool() noexcept;
+
+public:
+    template <typename F>
+    std::future<std::invoke_result_t<F>> submit(F&& job)
+    {
+        using Result = std::invoke_result_t<F>;
+        auto task = std::make_shared<std::packaged_task<Result()>>(std::forward<F>(job));
+        std::future<Result> future = task->get_future();
+        enqueue([task]() { (*task)(); });
+        return future;
+    }
+
+    // Calls fn(i) for every i in [0, count), split in contiguous chunks across the workers and the calling thread.
+    // Blocks until done, and rethrows the first exception. Must not be called from a worker
+    void parallelFor(size_t count, const std::function<void(size_t)>& fn);
+
+    size_t numThreads() const noexcept { return m_workers.size(); }
+
+private:
+    void enqueue(std::function<void()>&& job);
+    void workerLoop();
+
+private:
+    std::vector<std::thread> m_workers;
+    std::queue<std::function<void()>> m_jobs;
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+    bool m_stopping = false;
+};
+
+// For polling jobs from a frame loop
+template <typename T>
+bool isReady(const std::future<T>& future)
+{
+    return future.valid() && future.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+}
+
+}   // namespace core
+
+#endif
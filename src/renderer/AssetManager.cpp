@@ -0,0 +1,170 @@
+#include "AssetManager.hpp"
+
+#include "DeletionQueue.hpp"
+#include "core/File.hpp"
+#include "core/Hash.hpp"
+
+// std
+#include <algorithm>
+#include <cassert>
+#include <format>
+#include <utility>
+
+namespace renderer
+{
+
+AssetManager::AssetManager(vk::DeviceSize unusedBudget) noexcept
+    : m_unusedBudget(unusedBudget)
+{}
+
+TextureHandle AssetManager::loadTexture(const std::filesystem::path& path, vk::Format format, TextureStreamer& streamer)
+{
+    std::string key = pathKey(path);
+    if (TextureHandle handle = findTexture(key, format); handle != INVALID_TEXTURE_HANDLE) {
+        auto& entry = m_textures.at(handle);
+        if (entry.references++ == 0) {
+            m_lru.erase(entry.lruIt);
+            m_unusedBytes -= entry.size;
+        }
+        ++m_stats.hits;
+        return handle;
+    }
+
+    std::vector<char> bytes = core::readFile(path);
+    std::string contentKey = contentKeyOf(bytes, format);
+    TextureHandle handle = INVALID_TEXTURE_HANDLE;
+    auto content = m_texturesByContent.find(contentKey);
+    if (content != m_texturesByContent.end() && std::ranges::equal(content->second.bytes, bytes)) {
+        handle = streamer.share(content->second.handle);
+        ++m_stats.hits;
+    } else {
+        handle = streamer.add(TextureStreamer::decode(bytes, format, path));
+        ++m_stats.misses;
+        if (content == m_texturesByContent.end()) {
+            m_texturesByContent.emplace(contentKey, ContentEntry {.bytes = std::move(bytes), .handle = handle});
+        } else {
+            // Same hash, different bytes: not shared
+            contentKey.clear();
+        }
+    }
+
+    m_texturesByPath[key].push_back(handle);
+    m_textures.emplace(handle,
+                       TextureEntry {.path = std::move(key),
+                                     .format = format,
+                                     .contentKey = std::move(contentKey),
+                                     .size = streamer.size(handle),
+                                     .references = 1,
+                                     .lruIt = {}});
+    return handle;
+}
+
+void AssetManager::releaseTexture(TextureHandle handle)
+{
+    auto& entry = m_textures.at(handle);
+    assert(entry.references > 0);
+    if (--entry.references == 0) {
+        entry.lruIt = m_lru.insert(m_lru.end(), handle);
+        m_unusedBytes += entry.size;
+    }
+}
+
+std::vector<TextureHandle> AssetManager::textures(const std::filesystem::path& path) const
+{
+    auto it = m_texturesByPath.find(pathKey(path));
+    return it != m_texturesByPath.end() ? it->second : std::vector<TextureHandle> {};
+}
+
+void AssetManager::reloadTexture(const std::filesystem::path& path,
+                                 TextureHandle handle,
+                                 TextureStreamer::DecodedTexture&& decoded,
+                                 size_t frame,
+                                 DeletionQueue& deletionQueue,
+                                 TextureStreamer& streamer)
+{
+    // The handle may have been evicted, and given to another file, while the new content was decoded
+    auto it = m_textures.find(handle);
+    if (it == m_textures.end() || it->second.path != pathKey(path)) {
+        return;
+    }
+
+    // Only this path changed: other paths that shared its content keep the previous version, and later loads of the
+    // previous content share their texture
+    forgetContent(handle);
+    streamer.reload(handle, std::move(decoded), frame, deletionQueue);
+
+    auto& entry = it->second;
+    if (entry.references == 0) {
+        m_unusedBytes -= entry.size;
+        m_unusedBytes += streamer.size(handle);
+    }
+    entry.size = streamer.size(handle);
+}
+
+void AssetManager::collect(size_t frame, DeletionQueue& deletionQueue, TextureStreamer& streamer)
+{
+    while (m_unusedBytes > m_unusedBudget) {
+        TextureHandle handle = m_lru.front();
+        m_lru.pop_front();
+        forgetContent(handle);
+
+        auto it = m_textures.find(handle);
+        m_unusedBytes -= it->second.size;
+        std::erase(m_texturesByPath[it->second.path], handle);
+        if (m_texturesByPath[it->second.path].empty()) {
+            m_texturesByPath.erase(it->second.path);
+        }
+        m_textures.erase(it);
+
+        streamer.remove(handle, frame, deletionQueue);
+        ++m_stats.evictions;
+    }
+}
+
+std::string AssetManager::pathKey(const std::filesystem::path& path)
+{
+    return std::filesystem::weakly_canonical(path).string();
+}
+
+std::string AssetManager::contentKeyOf(std::span<const char> bytes, vk::Format format)
+{
+    return std::format("{:016x}-{}-{}",
+                       core::fnv1a64(std::as_bytes(bytes)),
+                       bytes.size(),
+                       static_cast<uint32_t>(format));
+}
+
+TextureHandle AssetManager::findTexture(const std::string& path, vk::Format format) const
+{
+    auto it = m_texturesByPath.find(path);
+    if (it == m_texturesByPath.end()) {
+        return INVALID_TEXTURE_HANDLE;
+    }
+    auto handle = std::ranges::find_if(it->second, [&](TextureHandle h) { return m_textures.at(h).format == format; });
+    return handle != it->second.end() ? *handle : INVALID_TEXTURE_HANDLE;
+}
+
+void AssetManager::forgetContent(TextureHandle handle)
+{
+    auto& entry = m_textures.at(handle);
+    if (entry.contentKey.empty()) {
+        return;
+    }
+
+    auto content = m_texturesByContent.find(entry.contentKey);
+    assert(content != m_texturesByContent.end());
+    if (content->second.handle == handle) {
+        // Later loads of the content share another texture that has it, if any is left
+        auto other = std::ranges::find_if(m_textures, [&](const auto& texture) {
+            return texture.first != handle && texture.second.contentKey == entry.contentKey;
+        });
+        if (other != m_textures.end()) {
+            content->second.handle = other->first;
+        } else {
+            m_texturesByContent.erase(content);
+        }
+    }
+    entry.contentKey.clear();
+}
+
+}   // namespace renderer
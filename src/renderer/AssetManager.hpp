@@ -0,0 +1,102 @@
+#ifndef RENDERER_ASSET_MANAGER_HPP
+#define RENDERER_ASSET_MANAGER_HPP
+
+#include "TextureStreamer.hpp"
+
+// libs
+#include <vulkan/vulkan.hpp>
+
+// std
+#include <cstddef>
+#include <filesystem>
+#include <list>
+#include <span>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace renderer
+{
+class DeletionQueue;
+
+struct AssetCacheStats {
+    size_t hits = 0;
+    size_t misses = 0;
+    size_t evictions = 0;
+};
+
+// Deduplicates texture loads by path and format, and by content and format for identical files under different
+// paths. Content hits are verified byte for byte, so a hash collision only costs a separate texture.
+// Textures are reference counted: released ones are kept in a LRU list, and removed from the TextureStreamer once
+// their total size exceeds the budget. A texture shared by several paths counts once per path.
+class AssetManager
+{
+public:
+    AssetManager() noexcept = default;
+    explicit AssetManager(vk::DeviceSize unusedBudget) noexcept;
+
+    AssetManager(const AssetManager&) = delete;
+    AssetManager& operator=(const AssetManager&) = delete;
+
+    AssetManager(AssetManager&&) noexcept = default;
+    AssetManager& operator=(AssetManager&&) noexcept = default;
+
+    ~AssetManager() noexcept = default;
+
+public:
+    // Each load must be paired with a releaseTexture of the returned handle
+    TextureHandle loadTexture(const std::filesystem::path& path, vk::Format format, TextureStreamer& streamer);
+    void releaseTexture(TextureHandle handle);
+
+    // Handles loaded from the file, in any format
+    std::vector<TextureHandle> textures(const std::filesystem::path& path) const;
+
+    // New content of the file the handle was loaded from, other files that had the same content are unaffected.
+    // Ignored if the handle was evicted since
+    void reloadTexture(const std::filesystem::path& path,
+                       TextureHandle handle,
+                       TextureStreamer::DecodedTexture&& decoded,
+                       size_t frame,
+                       DeletionQueue& deletionQueue,
+                       TextureStreamer& streamer);
+
+    // Should be called once per frame
+    void collect(size_t frame, DeletionQueue& deletionQueue, TextureStreamer& streamer);
+
+    const AssetCacheStats& textureStats() const noexcept { return m_stats; }
+
+private:
+    struct TextureEntry {
+        std::string path;         // canonical
+        vk::Format format;
+        std::string contentKey;   // empty if the content is not shared, see m_texturesByContent
+        vk::DeviceSize size;
+        uint32_t references;
+        std::list<TextureHandle>::iterator lruIt;   // valid if unreferenced
+    };
+
+    struct ContentEntry {
+        std::vector<char> bytes;   // encoded file, compared on hash hits
+        TextureHandle handle;
+    };
+
+    static std::string pathKey(const std::filesystem::path& path);
+    static std::string contentKeyOf(std::span<const char> bytes, vk::Format format);
+
+    TextureHandle findTexture(const std::string& path, vk::Format format) const;
+    // The content of the handle stops being shared with new loads
+    void forgetContent(TextureHandle handle);
+
+private:
+    std::unordered_map<TextureHandle, TextureEntry> m_textures;
+    std::unordered_map<std::string, std::vector<TextureHandle>> m_texturesByPath;
+    std::unordered_map<std::string, ContentEntry> m_texturesByContent;
+    std::list<TextureHandle> m_lru;   // unreferenced textures, least recently used first
+    vk::DeviceSize m_unusedBudget = 0;
+    vk::DeviceSize m_unusedBytes = 0;
+    AssetCacheStats m_stats;
+};
+
+}   // namespace renderer
+
+#endif
@@ -0,0 +1,70 @@
+#include "ComputePipelineBuilder.hpp"
+
+#include "Utils.hpp"
+#include "core/Logger.hpp"
+
+// libs
+#include <vulkan/vulkan_to_string.hpp>
+
+// std
+#include <utility>
+
+namespace renderer
+{
+
+ComputePipelineBuilder::ComputePipelineBuilder(vk::Device device) noexcept
+    : m_device(device)
+{}
+
+void ComputePipelineBuilder::setShader(std::span<const uint32_t> shaderCode)
+{
+    m_shaderModule = utils::createUniqueShaderModule(m_device, shaderCode);
+}
+
+void ComputePipelineBuilder::setPipelineLayout(vk::PipelineLayout layout) noexcept
+{
+    m_pipelineLayout = layout;
+}
+
+void ComputePipelineBuilder::setPipelineCache(vk::PipelineCache cache) noexcept
+{
+    m_pipelineCache = cache;
+}
+
+void ComputePipelineBuilder::setSpecializationConstants(const SpecializationConstants& constants)
+{
+    m_specializationConstants = constants;
+}
+
+vk::UniquePipeline ComputePipelineBuilder::build()
+{
+    vk::SpecializationInfo specializationInfo = m_specializationConstants.info();
+
+    vk::PipelineShaderStageCreateInfo shaderStageInfo {
+        .sType = vk::StructureType::ePipelineShaderStageCreateInfo,
+        .pNext = nullptr,
+        .flags = {},
+        .stage = vk::ShaderStageFlagBits::eCompute,
+        .module = *m_shaderModule,
+        .pName = "main",
+        .pSpecializationInfo = m_specializationConstants.empty() ? nullptr : &specializationInfo};
+
+    vk::ComputePipelineCreateInfo pipelineCreateInfo {.sType = vk::StructureType::eComputePipelineCreateInfo,
+                                                      .pNext = nullptr,
+                                                      .flags = {},
+                                                      .stage = shaderStageInfo,
+                                                      .layout = m_pipelineLayout,
+                                                      .basePipelineHandle = nullptr,
+                                                      .basePipelineIndex = -1};
+
+    auto res = m_device.createComputePipelineUnique(m_pipelineCache, pipelineCreateInfo);
+
+    if (res.result != vk::Result::eSuccess) {
+        FATAL_FMT("Compute pipeline failed with result {}\n", vk::to_string(res.result));
+        assert(0);
+        return vk::UniquePipeline();
+    }
+    return std::move(res.value);
+}
+
+}   // namespace renderer
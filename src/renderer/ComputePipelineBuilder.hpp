@@ -0,0 +1,52 @@
+#ifndef RENDERER_COMPUTE_PIPELINE_BUILDER_HPP
+#define RENDERER_COMPUTE_PIPELINE_BUILDER_HPP
+
+#include "SpecializationConstants.hpp"
+
+// libs
+#include <vulkan/vulkan.hpp>
+
+// std
+#include <cstdint>
+#include <span>
+
+namespace renderer
+{
+
+class ComputePipelineBuilder
+{
+public:
+    ComputePipelineBuilder() = delete;
+    explicit ComputePipelineBuilder(vk::Device device) noexcept;
+
+    ComputePipelineBuilder(const ComputePipelineBuilder&) = delete;
+    ComputePipelineBuilder& operator=(const ComputePipelineBuilder&) = delete;
+
+    ComputePipelineBuilder(ComputePipelineBuilder&&) = delete;
+    ComputePipelineBuilder& operator=(ComputePipelineBuilder&&) = delete;
+
+    ~ComputePipelineBuilder() noexcept = default;
+
+public:
+    void setShader(std::span<const uint32_t> shaderCode);
+
+    void setPipelineLayout(vk::PipelineLayout layout) noexcept;
+
+    // Optional, shared between builders and threads
+    void setPipelineCache(vk::PipelineCache cache) noexcept;
+
+    void setSpecializationConstants(const SpecializationConstants& constants);
+
+    vk::UniquePipeline build();
+
+private:
+    vk::Device m_device;   // not owned
+    SpecializationConstants m_specializationConstants;
+    vk::UniqueShaderModule m_shaderModule;
+    vk::PipelineLayout m_pipelineLayout;   // not owned
+    vk::PipelineCache m_pipelineCache;     // not owned
+};
+
+}   // namespace renderer
+
+#endif
@@ -0,0 +1,18 @@
+#include "DeletionQueue.hpp"
+
+namespace renderer
+{
+
+void DeletionQueue::collect(size_t completedFrame) noexcept
+{
+    while (!m_entries.empty() && m_entries.front().frame <= completedFrame) {
+        m_entries.pop_front();
+    }
+}
+
+void DeletionQueue::flush() noexcept
+{
+    m_entries.clear();
+}
+
+}   // namespace renderer
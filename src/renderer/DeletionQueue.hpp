@@ -0,0 +1,58 @@
+#ifndef RENDERER_DELETION_QUEUE_HPP
+#define RENDERER_DELETION_QUEUE_HPP
+
+// std
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+namespace renderer
+{
+
+// Keeps GPU resources alive until the frames that may still reference them have finished executing.
+// Any movable RAII object (vk::Unique*, AllocatedBuffer, std::shared_ptr<const Allocated2DImage>...) can be retired.
+class DeletionQueue
+{
+public:
+    DeletionQueue() noexcept = default;
+
+    DeletionQueue(const DeletionQueue&) = delete;
+    DeletionQueue& operator=(const DeletionQueue&) = delete;
+
+    DeletionQueue(DeletionQueue&&) noexcept = default;
+    DeletionQueue& operator=(DeletionQueue&&) noexcept = default;
+
+    ~DeletionQueue() noexcept = default;
+
+public:
+    // The resource is destroyed once collect is called with a completedFrame >= frame
+    template <typename T>
+    void retire(size_t frame, T&& resource)
+    {
+        using ResourceType = std::remove_cvref_t<T>;
+        m_entries.push_back({frame, std::make_shared<ResourceType>(std::forward<T>(resource))});
+    }
+
+    // Destroys every resource retired on a frame <= completedFrame
+    void collect(size_t completedFrame) noexcept;
+
+    // Destroys everything. The caller must ensure the device is idle
+    void flush() noexcept;
+
+    bool empty() const noexcept { return m_entries.empty(); }
+
+private:
+    struct Entry {
+        size_t frame;
+        std::shared_ptr<void> resource;
+    };
+
+    // Sorted by frame, as resources are always retired on the current frame
+    std::deque<Entry> m_entries;
+};
+
+}   // namespace renderer
+
+#endif
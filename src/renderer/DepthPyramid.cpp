@@ -0,0 +1,351 @@
+#include "DepthPyramid.hpp"
+
+#include "DeletionQueue.hpp"
+#include "PushConstants.hpp"
+#include "core/Logger.hpp"
+
+// std
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <iterator>
+#include <utility>
+
+namespace renderer
+{
+
+namespace
+{
+// As declared by depth_reduce.comp
+constexpr uint32_t REDUCE_WORKGROUP_SIZE = 8;
+constexpr uint32_t INPUT_LEVEL_BINDING = 0;
+constexpr uint32_t OUTPUT_LEVEL_BINDING = 1;
+
+constexpr vk::Format PYRAMID_FORMAT = vk::Format::eR32Sfloat;
+// The far plane of reverse-Z
+constexpr float PYRAMID_CLEAR_DEPTH = 0.f;
+
+vk::Extent2D levelExtent(const vk::Extent2D& extent, uint32_t level) noexcept
+{
+    return {std::max(extent.width >> level, 1u), std::max(extent.height >> level, 1u)};
+}
+
+// Level 0 of the pyramid of a depth buffer region
+vk::Extent2D baseExtent(const vk::Extent2D& depthExtent) noexcept
+{
+    return {std::bit_floor(depthExtent.width), std::bit_floor(depthExtent.height)};
+}
+
+uint32_t levelCountOf(const vk::Extent2D& extent) noexcept
+{
+    return static_cast<uint32_t>(std::bit_width(std::max(extent.width, extent.height)));
+}
+
+void imageBarrier(vk::CommandBuffer commandBuffer,
+                  vk::Image image,
+                  uint32_t baseLevel,
+                  uint32_t levelCount,
+                  vk::PipelineStageFlags2 srcStageMask,
+                  vk::AccessFlags2 srcAccessMask,
+                  vk::PipelineStageFlags2 dstStageMask,
+                  vk::AccessFlags2 dstAccessMask,
+                  vk::ImageLayout oldLayout)
+{
+    vk::ImageMemoryBarrier2 barrier {
+        .sType = vk::StructureType::eImageMemoryBarrier2,
+        .pNext = nullptr,
+        .srcStageMask = srcStageMask,
+        .srcAccessMask = srcAccessMask,
+        .dstStageMask = dstStageMask,
+        .dstAccessMask = dstAccessMask,
+        .oldLayout = oldLayout,
+        .newLayout = vk::ImageLayout::eGeneral,
+        .srcQueueFamilyIndex = vk::QueueFamilyIgnored,
+        .dstQueueFamilyIndex = vk::QueueFamilyIgnored,
+        .image = image,
+        .subresourceRange = {.aspectMask = vk::ImageAspectFlagBits::eColor,
+                             .baseMipLevel = baseLevel,
+                             .levelCount = levelCount,
+                             .baseArrayLayer = 0,
+                             .layerCount = 1}
+    };
+
+    vk::DependencyInfo dependencyInfo {.sType = vk::StructureType::eDependencyInfo,
+                                       .pNext = nullptr,
+                                       .dependencyFlags = {},
+                                       .memoryBarrierCount = 0,
+                                       .pMemoryBarriers = nullptr,
+                                       .bufferMemoryBarrierCount = 0,
+                                       .pBufferMemoryBarriers = nullptr,
+                                       .imageMemoryBarrierCount = 1,
+                                       .pImageMemoryBarriers = &barrier};
+
+    commandBuffer.pipelineBarrier2(dependencyInfo);
+}
+}   // namespace
+
+DepthPyramid::DepthPyramid(vk::Device device,
+                           VmaAllocator allocator,
+                           vk::DescriptorSetLayout reduceSetLayout,
+                           uint32_t framesInFlight)
+    : m_device(device)
+    , m_allocator(allocator)
+    , m_reduceSetLayout(reduceSetLayout)
+    , m_framesInFlight(framesInFlight)
+{
+    // Only read with texelFetch, which ignores filtering
+    vk::SamplerCreateInfo samplerCreateInfo {.sType = vk::StructureType::eSamplerCreateInfo,
+                                             .pNext = nullptr,
+                                             .flags = {},
+                                             .magFilter = vk::Filter::eNearest,
+                                             .minFilter = vk::Filter::eNearest,
+                                             .mipmapMode = vk::SamplerMipmapMode::eNearest,
+                                             .addressModeU = vk::SamplerAddressMode::eClampToEdge,
+                                             .addressModeV = vk::SamplerAddressMode::eClampToEdge,
+                                             .addressModeW = vk::SamplerAddressMode::eClampToEdge,
+                                             .mipLodBias = 0.f,
+                                             .anisotropyEnable = vk::False,
+                                             .maxAnisotropy = 1.f,
+                                             .compareEnable = vk::False,
+                                             .compareOp = vk::CompareOp::eAlways,
+                                             .minLod = 0.f,
+                                             .maxLod = vk::LodClampNone,
+                                             .borderColor = vk::BorderColor::eFloatTransparentBlack,
+                                             .unnormalizedCoordinates = vk::False};
+
+    m_sampler = m_device.createSamplerUnique(samplerCreateInfo);
+}
+
+bool DepthPyramid::resize(const vk::Extent2D& maxDepthExtent, size_t frame, DeletionQueue& deletionQueue)
+{
+    if (m_imageView && m_maxDepthExtent == maxDepthExtent) {
+        return false;
+    }
+
+    if (m_imageView) {
+        deletionQueue.retire(frame, std::move(m_descriptorPool));
+        deletionQueue.retire(frame, std::move(m_levelViews));
+        deletionQueue.retire(frame, std::move(m_imageView));
+        deletionQueue.retire(frame, std::move(m_image));
+        m_levelViews.clear();
+        m_descriptorSets.clear();
+    }
+
+    m_maxDepthExtent = maxDepthExtent;
+    m_depthViews.assign(m_framesInFlight, nullptr);
+    vk::Extent2D extent = baseExtent(maxDepthExtent);
+    uint32_t levelCount = levelCountOf(extent);
+    setDepthExtent(maxDepthExtent);
+
+    m_image = Allocated2DImage(m_allocator,
+                               PYRAMID_FORMAT,
+                               extent,
+                               levelCount,
+                               vk::ImageTiling::eOptimal,
+                               vk::ImageUsageFlagBits::eStorage | vk::ImageUsageFlagBits::eSampled |
+                                   vk::ImageUsageFlagBits::eTransferDst,
+                               VMA_ALLOCATION_CREATE_DEDICATED_MEMORY_BIT,
+                               VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE);
+
+    vk::ImageViewCreateInfo imageViewCreateInfo {
+        .sType = vk::StructureType::eImageViewCreateInfo,
+        .pNext = nullptr,
+        .flags = {},
+        .image = m_image.image(),
+        .viewType = vk::ImageViewType::e2D,
+        .format = PYRAMID_FORMAT,
+        .components = {vk::ComponentSwizzle::eIdentity,
+                  vk::ComponentSwizzle::eIdentity,
+                  vk::ComponentSwizzle::eIdentity,
+                  vk::ComponentSwizzle::eIdentity},
+        .subresourceRange = {.aspectMask = vk::ImageAspectFlagBits::eColor,
+                  .baseMipLevel = 0,
+                  .levelCount = levelCount,
+                  .baseArrayLayer = 0,
+                  .layerCount = 1}
+    };
+    m_imageView = m_device.createImageViewUnique(imageViewCreateInfo);
+
+    // Storage image views cannot cover several levels
+    imageViewCreateInfo.subresourceRange.levelCount = 1;
+    for (uint32_t level = 0; level < levelCount; ++level) {
+        imageViewCreateInfo.subresourceRange.baseMipLevel = level;
+        m_levelViews.push_back(m_device.createImageViewUnique(imageViewCreateInfo));
+    }
+
+    uint32_t setCount = m_framesInFlight + levelCount - 1;
+    vk::DescriptorPoolSize poolSizes[] {
+        {.type = vk::DescriptorType::eCombinedImageSampler, .descriptorCount = setCount},
+        {        .type = vk::DescriptorType::eStorageImage, .descriptorCount = setCount}
+    };
+
+    vk::DescriptorPoolCreateInfo poolCreateInfo {.sType = vk::StructureType::eDescriptorPoolCreateInfo,
+                                                 .pNext = nullptr,
+                                                 .flags = {},
+                                                 .maxSets = setCount,
+                                                 .poolSizeCount = std::size(poolSizes),
+                                                 .pPoolSizes = poolSizes};
+
+    m_descriptorPool = m_device.createDescriptorPoolUnique(poolCreateInfo);
+
+    std::vector<vk::DescriptorSetLayout> setLayouts(setCount, m_reduceSetLayout);
+    vk::DescriptorSetAllocateInfo allocateInfo {.sType = vk::StructureType::eDescriptorSetAllocateInfo,
+                                                .pNext = nullptr,
+                                                .descriptorPool = *m_descriptorPool,
+                                                .descriptorSetCount = setCount,
+                                                .pSetLayouts = setLayouts.data()};
+    m_descriptorSets = m_device.allocateDescriptorSets(allocateInfo);
+
+    // Each level reads the previous one, level 0 the depth buffer of its frame once it is set
+    std::vector<vk::DescriptorImageInfo> imageInfos;
+    imageInfos.reserve(2 * setCount);
+    std::vector<vk::WriteDescriptorSet> descriptorWrites;
+    descriptorWrites.reserve(2 * setCount);
+    for (uint32_t set = 0; set < setCount; ++set) {
+        uint32_t level = set < m_framesInFlight ? 0 : set - m_framesInFlight + 1;
+        if (level > 0) {
+            imageInfos.push_back({.sampler = *m_sampler,
+                                  .imageView = *m_levelViews[level - 1],
+                                  .imageLayout = vk::ImageLayout::eGeneral});
+            descriptorWrites.push_back({.sType = vk::StructureType::eWriteDescriptorSet,
+                                        .pNext = nullptr,
+                                        .dstSet = m_descriptorSets[set],
+                                        .dstBinding = INPUT_LEVEL_BINDING,
+                                        .dstArrayElement = 0,
+                                        .descriptorCount = 1,
+                                        .descriptorType = vk::DescriptorType::eCombinedImageSampler,
+                                        .pImageInfo = &imageInfos.back(),
+                                        .pBufferInfo = nullptr,
+                                        .pTexelBufferView = nullptr});
+        }
+
+        imageInfos.push_back(
+            {.sampler = nullptr, .imageView = *m_levelViews[level], .imageLayout = vk::ImageLayout::eGeneral});
+        descriptorWrites.push_back({.sType = vk::StructureType::eWriteDescriptorSet,
+                                    .pNext = nullptr,
+                                    .dstSet = m_descriptorSets[set],
+                                    .dstBinding = OUTPUT_LEVEL_BINDING,
+                                    .dstArrayElement = 0,
+                                    .descriptorCount = 1,
+                                    .descriptorType = vk::DescriptorType::eStorageImage,
+                                    .pImageInfo = &imageInfos.back(),
+                                    .pBufferInfo = nullptr,
+                                    .pTexelBufferView = nullptr});
+    }
+    m_device.updateDescriptorSets(descriptorWrites, nullptr);
+
+    DEBUG_FMT("Created {}x{} depth pyramid of {} levels\n", extent.width, extent.height, levelCount);
+    return true;
+}
+
+void DepthPyramid::setDepthExtent(const vk::Extent2D& depthExtent) noexcept
+{
+    assert(depthExtent.width <= m_maxDepthExtent.width && depthExtent.height <= m_maxDepthExtent.height);
+    m_depthExtent = depthExtent;
+    m_extent = baseExtent(depthExtent);
+    m_levelCount = levelCountOf(m_extent);
+}
+
+void DepthPyramid::setDepthView(vk::ImageView depthView, size_t frame)
+{
+    assert(m_imageView);
+    // The frame's previous use of the descriptor completed, drawFrame waited for its fence
+    vk::ImageView& frameDepthView = m_depthViews[frame % m_framesInFlight];
+    if (depthView == frameDepthView) {
+        return;
+    }
+
+    frameDepthView = depthView;
+    vk::DescriptorImageInfo imageInfo {.sampler = *m_sampler,
+                                       .imageView = depthView,
+                                       .imageLayout = vk::ImageLayout::eShaderReadOnlyOptimal};
+    vk::WriteDescriptorSet descriptorWrite {.sType = vk::StructureType::eWriteDescriptorSet,
+                                           .pNext = nullptr,
+                                           .dstSet = descriptorSet(0, frame),
+                                           .dstBinding = INPUT_LEVEL_BINDING,
+                                           .dstArrayElement = 0,
+                                           .descriptorCount = 1,
+                                           .descriptorType = vk::DescriptorType::eCombinedImageSampler,
+                                           .pImageInfo = &imageInfo,
+                                           .pBufferInfo = nullptr,
+                                           .pTexelBufferView = nullptr};
+    m_device.updateDescriptorSets(descriptorWrite, nullptr);
+}
+
+void DepthPyramid::clear(vk::CommandBuffer commandBuffer) const
+{
+    imageBarrier(commandBuffer,
+                 m_image.image(),
+                 0,
+                 imageLevelCount(),
+                 vk::PipelineStageFlagBits2::eNone,
+                 {},
+                 vk::PipelineStageFlagBits2::eClear,
+                 vk::AccessFlagBits2::eTransferWrite,
+                 vk::ImageLayout::eUndefined);
+
+    vk::ClearColorValue clearColor {.float32 = {{PYRAMID_CLEAR_DEPTH, 0.f, 0.f, 0.f}}};
+    vk::ImageSubresourceRange range {.aspectMask = vk::ImageAspectFlagBits::eColor,
+                                     .baseMipLevel = 0,
+                                     .levelCount = imageLevelCount(),
+                                     .baseArrayLayer = 0,
+                                     .layerCount = 1};
+    commandBuffer.clearColorImage(m_image.image(), vk::ImageLayout::eGeneral, clearColor, range);
+
+    imageBarrier(commandBuffer,
+                 m_image.image(),
+                 0,
+                 imageLevelCount(),
+                 vk::PipelineStageFlagBits2::eClear,
+                 vk::AccessFlagBits2::eTransferWrite,
+                 vk::PipelineStageFlagBits2::eComputeShader,
+                 vk::AccessFlagBits2::eShaderSampledRead | vk::AccessFlagBits2::eShaderStorageWrite,
+                 vk::ImageLayout::eGeneral);
+}
+
+void DepthPyramid::build(vk::CommandBuffer commandBuffer,
+                         vk::Pipeline reducePipeline,
+                         vk::PipelineLayout reduceLayout,
+                         size_t frame) const
+{
+    assert(m_imageView && m_depthViews[frame % m_framesInFlight]);
+
+    commandBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, reducePipeline);
+    for (uint32_t level = 0; level < levelCount(); ++level) {
+        vk::Extent2D input = level == 0 ? m_depthExtent : levelExtent(extent(), level - 1);
+        vk::Extent2D output = levelExtent(extent(), level);
+        DepthReducePushConstants constants {.inputSize = {input.width, input.height},
+                                            .outputSize = {output.width, output.height}};
+
+        commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eCompute,
+                                         reduceLayout,
+                                         0,
+                                         descriptorSet(level, frame),
+                                         nullptr);
+        pushConstants(commandBuffer, reduceLayout, vk::ShaderStageFlagBits::eCompute, constants);
+        commandBuffer.dispatch((output.width + REDUCE_WORKGROUP_SIZE - 1) / REDUCE_WORKGROUP_SIZE,
+                               (output.height + REDUCE_WORKGROUP_SIZE - 1) / REDUCE_WORKGROUP_SIZE,
+                               1);
+
+        // Read by the next level
+        if (level + 1 == levelCount()) {
+            break;
+        }
+        imageBarrier(commandBuffer,
+                     m_image.image(),
+                     level,
+                     1,
+                     vk::PipelineStageFlagBits2::eComputeShader,
+                     vk::AccessFlagBits2::eShaderStorageWrite,
+                     vk::PipelineStageFlagBits2::eComputeShader,
+                     vk::AccessFlagBits2::eShaderSampledRead,
+                     vk::ImageLayout::eGeneral);
+    }
+}
+
+vk::DescriptorSet DepthPyramid::descriptorSet(uint32_t level, size_t frame) const noexcept
+{
+    return level == 0 ? m_descriptorSets[frame % m_framesInFlight] : m_descriptorSets[m_framesInFlight + level - 1];
+}
+
+}   // namespace renderer
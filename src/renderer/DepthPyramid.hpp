@@ -0,0 +1,105 @@
+#ifndef RENDERER_DEPTH_PYRAMID_HPP
+#define RENDERER_DEPTH_PYRAMID_HPP
+
+#include "Image.hpp"
+
+// libs
+#include <glm/glm.hpp>
+#include <vk_mem_alloc.h>
+#include <vulkan/vulkan.hpp>
+
+// std
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace renderer
+{
+class DeletionQueue;
+
+struct DepthReducePushConstants {
+    glm::uvec2 inputSize;
+    glm::uvec2 outputSize;
+};
+
+// Hierarchical-Z: mip chain of the depth buffer where each texel keeps the farthest depth of the texels it covers, so
+// a single fetch tells whether a screen rectangle is entirely hidden. Level 0 is the rendered region of the depth
+// buffer rounded down to powers of two, so each level exactly halves the previous one. The image is allocated for the
+// largest region, which may shrink from frame to frame with the render scale. Stays in eGeneral
+class DepthPyramid
+{
+public:
+    DepthPyramid() noexcept = default;
+    // reduceSetLayout is set 0 of depth_reduce.comp
+    DepthPyramid(vk::Device device,
+                 VmaAllocator allocator,
+                 vk::DescriptorSetLayout reduceSetLayout,
+                 uint32_t framesInFlight);
+
+    DepthPyramid(const DepthPyramid&) = delete;
+    DepthPyramid& operator=(const DepthPyramid&) = delete;
+
+    DepthPyramid(DepthPyramid&&) noexcept = default;
+    DepthPyramid& operator=(DepthPyramid&&) noexcept = default;
+
+    ~DepthPyramid() noexcept = default;
+
+public:
+    // Recreates the pyramid when the largest depth buffer region changes, retiring the previous one. Returns whether it
+    // was recreated, in which case clear must be recorded before it is read, and its readers pointed at the new image
+    bool resize(const vk::Extent2D& maxDepthExtent, size_t frame, DeletionQueue& deletionQueue);
+
+    // Region of the depth buffer rendered this frame, from its origin and at most the extent given to resize. Sets the
+    // levels built, and those the readers of extent and levelCount should sample
+    void setDepthExtent(const vk::Extent2D& depthExtent) noexcept;
+
+    // Points level 0 at the depth buffer of the frame, a view of its depth aspect in eShaderReadOnlyOptimal. Each frame
+    // in flight has its own descriptor, the depth buffer being transient its view may change from frame to frame
+    void setDepthView(vk::ImageView depthView, size_t frame);
+
+    // Moves a new pyramid to eGeneral, cleared to the far plane so nothing is occluded until the first build
+    void clear(vk::CommandBuffer commandBuffer) const;
+
+    // Outside of rendering, with the depth buffer in eShaderReadOnlyOptimal and its writes made visible to compute
+    // shaders, and the previous reads of the pyramid done. Its last level still has to be made visible to the readers
+    void build(vk::CommandBuffer commandBuffer,
+               vk::Pipeline reducePipeline,
+               vk::PipelineLayout reduceLayout,
+               size_t frame) const;
+
+    vk::Image image() const noexcept { return m_image.image(); }
+    vk::Format format() const noexcept { return m_image.format(); }
+    // Of every level, for texelFetch
+    vk::ImageView imageView() const noexcept { return *m_imageView; }
+    vk::Sampler sampler() const noexcept { return *m_sampler; }
+    // Of level 0 for the current depth extent
+    vk::Extent2D extent() const noexcept { return m_extent; }
+    uint32_t levelCount() const noexcept { return m_levelCount; }
+    // Of the whole image, for barriers
+    uint32_t imageLevelCount() const noexcept { return m_image.mipLevels(); }
+
+private:
+    vk::DescriptorSet descriptorSet(uint32_t level, size_t frame) const noexcept;
+
+private:
+    vk::Device m_device;                         // not owned
+    VmaAllocator m_allocator = nullptr;          // not owned
+    vk::DescriptorSetLayout m_reduceSetLayout;   // not owned
+    uint32_t m_framesInFlight = 0;
+    vk::UniqueSampler m_sampler;
+    vk::Extent2D m_maxDepthExtent;
+    vk::Extent2D m_depthExtent;
+    vk::Extent2D m_extent;
+    uint32_t m_levelCount = 0;
+    std::vector<vk::ImageView> m_depthViews;   // not owned, per frame in flight
+    Allocated2DImage m_image;
+    vk::UniqueImageView m_imageView;
+    std::vector<vk::UniqueImageView> m_levelViews;
+    vk::UniqueDescriptorPool m_descriptorPool;
+    // Owned by the pool. Level 0 once per frame in flight, as it reads the depth buffer, then one per other level
+    std::vector<vk::DescriptorSet> m_descriptorSets;
+};
+
+}   // namespace renderer
+
+#endif
@@ -11,13 +11,21 @@ void DescriptorSetLayoutBuilder::addBinding(vk::DescriptorType descriptorType,
                                             uint32_t descriptorCount,
                                             vk::ShaderStageFlags stageFlags)
 {
-    uint32_t nextBindingNumber = static_cast<uint32_t>(m_bindings.size());
-    vk::DescriptorSetLayoutBinding binding {.binding = nextBindingNumber,
-                                            .descriptorType = descriptorType,
-                                            .descriptorCount = descriptorCount,
-                                            .stageFlags = stageFlags,
-                                            .pImmutableSamplers = nullptr};
-    m_bindings.push_back(binding);
+    uint32_t nextBindingNumber = m_bindings.empty() ? 0 : m_bindings.back().binding + 1;
+    addBinding(nextBindingNumber, descriptorType, descriptorCount, stageFlags);
+}
+
+void DescriptorSetLayoutBuilder::addBinding(uint32_t binding,
+                                            vk::DescriptorType descriptorType,
+                                            uint32_t descriptorCount,
+                                            vk::ShaderStageFlags stageFlags)
+{
+    vk::DescriptorSetLayoutBinding layoutBinding {.binding = binding,
+                                                  .descriptorType = descriptorType,
+                                                  .descriptorCount = descriptorCount,
+                                                  .stageFlags = stageFlags,
+                                                  .pImmutableSamplers = nullptr};
+    m_bindings.push_back(layoutBinding);
 }
 
 vk::UniqueDescriptorSetLayout DescriptorSetLayoutBuilder::build()
@@ -25,7 +25,12 @@ public:
     ~DescriptorSetLayoutBuilder() noexcept = default;
 
 public:
+    // Numbered after the previous binding
     void addBinding(vk::DescriptorType descriptorType, uint32_t descriptorCount, vk::ShaderStageFlags stageFlags);
+    void addBinding(uint32_t binding,
+                    vk::DescriptorType descriptorType,
+                    uint32_t descriptorCount,
+                    vk::ShaderStageFlags stageFlags);
 
     vk::UniqueDescriptorSetLayout build();
 
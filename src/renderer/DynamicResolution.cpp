@@ -0,0 +1,96 @@
+#include "DynamicResolution.hpp"
+
+#include "core/Logger.hpp"
+
+// std
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+namespace renderer
+{
+
+namespace
+{
+vk::Extent2D scaledExtent(const vk::Extent2D& extent, float scale) noexcept
+{
+    auto scaled = [scale](uint32_t size) {
+        return std::max(static_cast<uint32_t>(std::lround(static_cast<float>(size) * scale)), 1u);
+    };
+    return {.width = scaled(extent.width), .height = scaled(extent.height)};
+}
+}   // namespace
+
+DynamicResolution::DynamicResolution(const DynamicResolutionSettings& settings) noexcept
+    : m_settings(settings)
+{
+    assert(settings.minScale > 0.f && settings.minScale <= settings.maxScale && settings.scaleStep > 0.f);
+    // Starts sharp, the first frames over budget bring it down quickly
+    m_scale = quantize(settings.maxScale);
+    m_stats.scale = m_scale;
+}
+
+void DynamicResolution::update(float gpuTime, float renderScale) noexcept
+{
+    if (renderScale != m_scale) {
+        return;
+    }
+
+    m_stats.gpuTime = m_hasSample ? std::lerp(m_stats.gpuTime, gpuTime, m_settings.smoothing) : gpuTime;
+    m_hasSample = true;
+    if (m_stats.gpuTime > m_settings.targetGpuTime) {
+        ++m_framesOver;
+        m_framesUnder = 0;
+    } else if (m_stats.gpuTime < m_settings.headroom * m_settings.targetGpuTime) {
+        ++m_framesUnder;
+        m_framesOver = 0;
+    } else {
+        m_framesOver = 0;
+        m_framesUnder = 0;
+    }
+
+    if (m_framesOver >= m_settings.framesBeforeDecrease) {
+        // Aims at the middle of the hysteresis band, so the next frames neither drop nor grow again right away
+        float goal = 0.5f * (1.f + m_settings.headroom) * m_settings.targetGpuTime;
+        float predicted = m_scale * std::sqrt(goal / m_stats.gpuTime);
+        setScale(std::min(quantize(predicted), m_scale - m_settings.scaleStep));
+    } else if (m_framesUnder >= m_settings.framesBeforeIncrease) {
+        setScale(m_scale + m_settings.scaleStep);
+    }
+}
+
+vk::Extent2D DynamicResolution::renderExtent(const vk::Extent2D& outputExtent) const noexcept
+{
+    return scaledExtent(outputExtent, m_scale);
+}
+
+vk::Extent2D DynamicResolution::maxRenderExtent(const vk::Extent2D& outputExtent) const noexcept
+{
+    // Quantized like the scales, which can't exceed it
+    return scaledExtent(outputExtent, quantize(m_settings.maxScale));
+}
+
+float DynamicResolution::quantize(float scale) const noexcept
+{
+    float quantized = std::round(scale / m_settings.scaleStep) * m_settings.scaleStep;
+    return std::clamp(quantized, m_settings.minScale, m_settings.maxScale);
+}
+
+void DynamicResolution::setScale(float scale) noexcept
+{
+    scale = quantize(scale);
+    // Also when clamped to the current scale, so a budget out of reach is not retried every frame
+    m_framesOver = 0;
+    m_framesUnder = 0;
+    if (scale == m_scale) {
+        return;
+    }
+
+    DEBUG_FMT("Render scale {:.2f} -> {:.2f}, GPU frame time {:.2f} ms\n", m_scale, scale, m_stats.gpuTime);
+    m_scale = scale;
+    m_hasSample = false;
+    m_stats.scale = scale;
+    ++m_stats.scaleChanges;
+}
+
+}   // namespace renderer
@@ -0,0 +1,82 @@
+#ifndef RENDERER_DYNAMIC_RESOLUTION_HPP
+#define RENDERER_DYNAMIC_RESOLUTION_HPP
+
+// libs
+#include <vulkan/vulkan.hpp>
+
+// std
+#include <cstddef>
+#include <cstdint>
+
+namespace renderer
+{
+
+struct DynamicResolutionSettings {
+    float targetGpuTime = 1000.f / 60.f;   // milliseconds
+    // Of the output extent, per axis
+    float minScale = 0.5f;
+    float maxScale = 1.f;
+    // Scales are multiples of it, so the scale settles instead of following every small variation of the GPU time
+    float scaleStep = 0.05f;
+    // Hysteresis: the scale only grows while the GPU time stays below headroom * targetGpuTime
+    float headroom = 0.8f;
+    // Consecutive frames over the target before scaling down, and under the headroom before scaling up. Slow to grow
+    // back, so a spike right after a drop does not make the scale oscillate
+    uint32_t framesBeforeDecrease = 3;
+    uint32_t framesBeforeIncrease = 30;
+    // Weight of the newest frame in the smoothed GPU time
+    float smoothing = 0.2f;
+};
+
+struct DynamicResolutionStats {
+    float scale = 1.f;
+    float gpuTime = 0.f;   // smoothed, in milliseconds
+    size_t scaleChanges = 0;
+};
+
+// Chooses the render resolution from the measured GPU frame time. GPU time is assumed roughly proportional to the
+// pixel count, so a drop jumps straight to the predicted scale, while growth goes one step at a time
+class DynamicResolution
+{
+public:
+    DynamicResolution() noexcept = default;
+    explicit DynamicResolution(const DynamicResolutionSettings& settings) noexcept;
+
+    DynamicResolution(const DynamicResolution&) = delete;
+    DynamicResolution& operator=(const DynamicResolution&) = delete;
+
+    DynamicResolution(DynamicResolution&&) noexcept = default;
+    DynamicResolution& operator=(DynamicResolution&&) noexcept = default;
+
+    ~DynamicResolution() noexcept = default;
+
+public:
+    // GPU time of a frame rendered at renderScale, in milliseconds. The frames still in flight when the scale changed
+    // were rendered at the previous one, and are ignored
+    void update(float gpuTime, float renderScale) noexcept;
+
+    float scale() const noexcept { return m_scale; }
+    // At least 1x1
+    vk::Extent2D renderExtent(const vk::Extent2D& outputExtent) const noexcept;
+    // At maxScale. Render targets of this extent fit every scale, only the region of renderExtent is rendered
+    vk::Extent2D maxRenderExtent(const vk::Extent2D& outputExtent) const noexcept;
+
+    const DynamicResolutionSettings& settings() const noexcept { return m_settings; }
+    const DynamicResolutionStats& stats() const noexcept { return m_stats; }
+
+private:
+    float quantize(float scale) const noexcept;
+    void setScale(float scale) noexcept;
+
+private:
+    DynamicResolutionSettings m_settings;
+    float m_scale = 1.f;
+    bool m_hasSample = false;   // m_stats.gpuTime is a measure of the current scale
+    uint32_t m_framesOver = 0;
+    uint32_t m_framesUnder = 0;
+    DynamicResolutionStats m_stats;
+};
+
+}   // namespace renderer
+
+#endif
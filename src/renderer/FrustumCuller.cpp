@@ -0,0 +1,267 @@
+#include "FrustumCuller.hpp"
+
+#include "core/ThreadPool.hpp"
+
+// std
+#include <algorithm>
+#include <bit>
+#include <initializer_list>
+
+// SSE2 is part of x86-64, AVX2 is only used after checking for it
+#if defined(__x86_64__)
+    #define RENDERER_FRUSTUM_CULLER_X86
+    #include <immintrin.h>
+#endif
+
+namespace renderer
+{
+
+namespace
+{
+// Below this, splitting the work across threads costs more than it saves
+constexpr size_t PARALLEL_CULL_MIN_OBJECTS = 32 * 1024;
+
+struct Volumes {
+    const float* centerX;
+    const float* centerY;
+    const float* centerZ;
+    const float* radius;
+};
+
+// The box corner furthest along a plane's normal, the last one to leave its positive side
+struct PlaneCorner {
+    const float* x;
+    const float* y;
+    const float* z;
+};
+
+void appendVisible(uint32_t mask, size_t first, std::vector<uint32_t>& visible)
+{
+    while (mask != 0) {
+        visible.push_back(static_cast<uint32_t>(first) + static_cast<uint32_t>(std::countr_zero(mask)));
+        mask &= mask - 1;
+    }
+}
+
+void cullScalar(const Volumes& volumes,
+                std::span<const glm::vec4> planes,
+                std::span<const PlaneCorner> corners,
+                size_t begin,
+                size_t end,
+                std::vector<uint32_t>& visible)
+{
+    for (size_t i = begin; i < end; ++i) {
+        bool inside = true;
+        for (size_t p = 0; p < planes.size() && inside; ++p) {
+            const glm::vec4& plane = planes[p];
+            float sphereDistance =
+                plane.x * volumes.centerX[i] + plane.y * volumes.centerY[i] + plane.z * volumes.centerZ[i] + plane.w;
+            float boxDistance =
+                plane.x * corners[p].x[i] + plane.y * corners[p].y[i] + plane.z * corners[p].z[i] + plane.w;
+            inside = sphereDistance >= -volumes.radius[i] && boxDistance >= 0.f;
+        }
+        if (inside) {
+            visible.push_back(static_cast<uint32_t>(i));
+        }
+    }
+}
+
+#ifdef RENDERER_FRUSTUM_CULLER_X86
+void cullSse(const Volumes& volumes,
+             std::span<const glm::vec4> planes,
+             std::span<const PlaneCorner> corners,
+             size_t begin,
+             size_t end,
+             std::vector<uint32_t>& visible)
+{
+    const __m128 zero = _mm_setzero_ps();
+    size_t i = begin;
+    for (; i + 4 <= end; i += 4) {
+        __m128 centerX = _mm_loadu_ps(volumes.centerX + i);
+        __m128 centerY = _mm_loadu_ps(volumes.centerY + i);
+        __m128 centerZ = _mm_loadu_ps(volumes.centerZ + i);
+        __m128 negRadius = _mm_sub_ps(zero, _mm_loadu_ps(volumes.radius + i));
+
+        __m128 inside = _mm_cmpeq_ps(zero, zero);
+        for (size_t p = 0; p < planes.size(); ++p) {
+            __m128 normalX = _mm_set1_ps(planes[p].x);
+            __m128 normalY = _mm_set1_ps(planes[p].y);
+            __m128 normalZ = _mm_set1_ps(planes[p].z);
+            __m128 offset = _mm_set1_ps(planes[p].w);
+
+            __m128 sphereDistance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(normalX, centerX), _mm_mul_ps(normalY, centerY)),
+                                               _mm_add_ps(_mm_mul_ps(normalZ, centerZ), offset));
+            __m128 boxDistance =
+                _mm_add_ps(_mm_add_ps(_mm_mul_ps(normalX, _mm_loadu_ps(corners[p].x + i)),
+                                      _mm_mul_ps(normalY, _mm_loadu_ps(corners[p].y + i))),
+                           _mm_add_ps(_mm_mul_ps(normalZ, _mm_loadu_ps(corners[p].z + i)), offset));
+
+            inside = _mm_and_ps(inside,
+                                _mm_and_ps(_mm_cmpge_ps(sphereDistance, negRadius), _mm_cmpge_ps(boxDistance, zero)));
+            if (_mm_movemask_ps(inside) == 0) {
+                break;
+            }
+        }
+        appendVisible(static_cast<uint32_t>(_mm_movemask_ps(inside)), i, visible);
+    }
+    cullScalar(volumes, planes, corners, i, end, visible);
+}
+
+__attribute__((target("avx2,fma"))) void cullAvx2(const Volumes& volumes,
+                                                   std::span<const glm::vec4> planes,
+                                                   std::span<const PlaneCorner> corners,
+                                                   size_t begin,
+                                                   size_t end,
+                                                   std::vector<uint32_t>& visible)
+{
+    const __m256 zero = _mm256_setzero_ps();
+    size_t i = begin;
+    for (; i + 8 <= end; i += 8) {
+        __m256 centerX = _mm256_loadu_ps(volumes.centerX + i);
+        __m256 centerY = _mm256_loadu_ps(volumes.centerY + i);
+        __m256 centerZ = _mm256_loadu_ps(volumes.centerZ + i);
+        __m256 negRadius = _mm256_sub_ps(zero, _mm256_loadu_ps(volumes.radius + i));
+
+        __m256 inside = _mm256_cmp_ps(zero, zero, _CMP_EQ_OQ);
+        for (size_t p = 0; p < planes.size(); ++p) {
+            __m256 normalX = _mm256_set1_ps(planes[p].x);
+            __m256 normalY = _mm256_set1_ps(planes[p].y);
+            __m256 normalZ = _mm256_set1_ps(planes[p].z);
+            __m256 offset = _mm256_set1_ps(planes[p].w);
+
+            __m256 sphereDistance = _mm256_fmadd_ps(
+                normalX,
+                centerX,
+                _mm256_fmadd_ps(normalY, centerY, _mm256_fmadd_ps(normalZ, centerZ, offset)));
+            __m256 boxDistance = _mm256_fmadd_ps(
+                normalX,
+                _mm256_loadu_ps(corners[p].x + i),
+                _mm256_fmadd_ps(normalY,
+                                _mm256_loadu_ps(corners[p].y + i),
+                                _mm256_fmadd_ps(normalZ, _mm256_loadu_ps(corners[p].z + i), offset)));
+
+            inside = _mm256_and_ps(inside,
+                                   _mm256_and_ps(_mm256_cmp_ps(sphereDistance, negRadius, _CMP_GE_OQ),
+                                                 _mm256_cmp_ps(boxDistance, zero, _CMP_GE_OQ)));
+            if (_mm256_movemask_ps(inside) == 0) {
+                break;
+            }
+        }
+        appendVisible(static_cast<uint32_t>(_mm256_movemask_ps(inside)), i, visible);
+    }
+    cullScalar(volumes, planes, corners, i, end, visible);
+}
+#endif
+
+bool isSupported(FrustumCuller::Kernel kernel) noexcept
+{
+    switch (kernel) {
+        case FrustumCuller::Kernel::eScalar: return true;
+#ifdef RENDERER_FRUSTUM_CULLER_X86
+        case FrustumCuller::Kernel::eSse: return __builtin_cpu_supports("sse");
+        case FrustumCuller::Kernel::eAvx2: return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#endif
+        default: return false;
+    }
+}
+
+FrustumCuller::Kernel widestSupportedKernel() noexcept
+{
+    for (auto kernel : {FrustumCuller::Kernel::eAvx2, FrustumCuller::Kernel::eSse}) {
+        if (isSupported(kernel)) {
+            return kernel;
+        }
+    }
+    return FrustumCuller::Kernel::eScalar;
+}
+}   // namespace
+
+FrustumCuller::FrustumCuller() noexcept
+    : m_kernel(widestSupportedKernel())
+{}
+
+void FrustumCuller::clear() noexcept
+{
+    for (auto* values : {&m_centerX, &m_centerY, &m_centerZ, &m_radius, &m_minX, &m_minY, &m_minZ, &m_maxX, &m_maxY,
+                         &m_maxZ}) {
+        values->clear();
+    }
+}
+
+void FrustumCuller::reserve(size_t count)
+{
+    for (auto* values : {&m_centerX, &m_centerY, &m_centerZ, &m_radius, &m_minX, &m_minY, &m_minZ, &m_maxX, &m_maxY,
+                         &m_maxZ}) {
+        values->reserve(count);
+    }
+}
+
+uint32_t FrustumCuller::add(const glm::vec3& center, float radius, const glm::vec3& boxMin, const glm::vec3& boxMax)
+{
+    auto index = static_cast<uint32_t>(m_radius.size());
+    m_centerX.push_back(center.x);
+    m_centerY.push_back(center.y);
+    m_centerZ.push_back(center.z);
+    m_radius.push_back(radius);
+    m_minX.push_back(boxMin.x);
+    m_minY.push_back(boxMin.y);
+    m_minZ.push_back(boxMin.z);
+    m_maxX.push_back(boxMax.x);
+    m_maxY.push_back(boxMax.y);
+    m_maxZ.push_back(boxMax.z);
+    return index;
+}
+
+void FrustumCuller::setKernel(Kernel kernel) noexcept
+{
+    m_kernel = isSupported(kernel) ? kernel : widestSupportedKernel();
+}
+
+void FrustumCuller::cull(std::span<const glm::vec4> planes,
+                         std::vector<uint32_t>& visible,
+                         core::ThreadPool* threadPool) const
+{
+    visible.clear();
+
+    Volumes volumes {.centerX = m_centerX.data(),
+                     .centerY = m_centerY.data(),
+                     .centerZ = m_centerZ.data(),
+                     .radius = m_radius.data()};
+    std::vector<PlaneCorner> corners;
+    corners.reserve(planes.size());
+    for (const auto& plane : planes) {
+        corners.push_back({.x = plane.x >= 0.f ? m_maxX.data() : m_minX.data(),
+                           .y = plane.y >= 0.f ? m_maxY.data() : m_minY.data(),
+                           .z = plane.z >= 0.f ? m_maxZ.data() : m_minZ.data()});
+    }
+
+    auto cullRange = [this, &volumes, planes, &corners](size_t begin, size_t end, std::vector<uint32_t>& rangeVisible) {
+        switch (m_kernel) {
+#ifdef RENDERER_FRUSTUM_CULLER_X86
+            case Kernel::eAvx2: cullAvx2(volumes, planes, corners, begin, end, rangeVisible); break;
+            case Kernel::eSse: cullSse(volumes, planes, corners, begin, end, rangeVisible); break;
+#endif
+            default: cullScalar(volumes, planes, corners, begin, end, rangeVisible); break;
+        }
+    };
+
+    size_t count = size();
+    if (!threadPool || count < PARALLEL_CULL_MIN_OBJECTS) {
+        cullRange(0, count, visible);
+        return;
+    }
+
+    // Chunks are multiples of the widest kernel, and concatenated in order
+    size_t numChunks = threadPool->numThreads() + 1;
+    size_t chunkSize = ((count + numChunks - 1) / numChunks + 7) & ~size_t {7};
+    std::vector<std::vector<uint32_t>> chunkVisible(numChunks);
+    threadPool->parallelFor(numChunks, [&](size_t chunk) {
+        size_t begin = std::min(count, chunk * chunkSize);
+        cullRange(begin, std::min(count, begin + chunkSize), chunkVisible[chunk]);
+    });
+    for (const auto& chunk : chunkVisible) {
+        visible.insert(visible.end(), chunk.begin(), chunk.end());
+    }
+}
+
+}   // namespace renderer
@@ -0,0 +1,77 @@
+#ifndef RENDERER_FRUSTUM_CULLER_HPP
+#define RENDERER_FRUSTUM_CULLER_HPP
+
+// libs
+#include <glm/glm.hpp>
+
+// std
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace core
+{
+class ThreadPool;
+}
+
+namespace renderer
+{
+
+// Tests world space bounding spheres and boxes against frustum planes on the CPU. The volumes are stored as structure
+// of arrays, so the SSE and AVX2 kernels test 4 and 8 objects per instruction. An object is visible when both its
+// sphere and its box intersect the frustum
+class FrustumCuller
+{
+public:
+    enum class Kernel {
+        eScalar,
+        eSse,    // 4 wide, x86-64 baseline
+        eAvx2,   // 8 wide, with FMA
+    };
+
+    // Picks the widest kernel the CPU supports
+    FrustumCuller() noexcept;
+
+    FrustumCuller(const FrustumCuller&) = delete;
+    FrustumCuller& operator=(const FrustumCuller&) = delete;
+
+    FrustumCuller(FrustumCuller&&) noexcept = default;
+    FrustumCuller& operator=(FrustumCuller&&) noexcept = default;
+
+    ~FrustumCuller() noexcept = default;
+
+public:
+    void clear() noexcept;
+    void reserve(size_t count);
+    // Returns the index of the object
+    uint32_t add(const glm::vec3& center, float radius, const glm::vec3& boxMin, const glm::vec3& boxMax);
+    size_t size() const noexcept { return m_radius.size(); }
+
+    // Replaces visible with the indices of the objects on the positive side of every plane, in increasing order. Large
+    // sets are split across the workers of threadPool, if given. Must not be called from a worker
+    void cull(std::span<const glm::vec4> planes,
+              std::vector<uint32_t>& visible,
+              core::ThreadPool* threadPool = nullptr) const;
+
+    Kernel kernel() const noexcept { return m_kernel; }
+    // Falls back to the widest supported kernel if kernel is not
+    void setKernel(Kernel kernel) noexcept;
+
+private:
+    Kernel m_kernel = Kernel::eScalar;
+    std::vector<float> m_centerX;
+    std::vector<float> m_centerY;
+    std::vector<float> m_centerZ;
+    std::vector<float> m_radius;
+    std::vector<float> m_minX;
+    std::vector<float> m_minY;
+    std::vector<float> m_minZ;
+    std::vector<float> m_maxX;
+    std::vector<float> m_maxY;
+    std::vector<float> m_maxZ;
+};
+
+}   // namespace renderer
+
+#endif
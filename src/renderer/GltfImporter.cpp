@@ -0,0 +1,672 @@
+#include "GltfImporter.hpp"
+
+#include "core/File.hpp"
+#include "core/Json.hpp"
+#include "core/Logger.hpp"
+
+// libs
+#include <glm/ext/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+// std
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <format>
+#include <stdexcept>
+#include <string_view>
+#include <utility>
+
+namespace renderer
+{
+
+namespace
+{
+constexpr uint32_t GLB_MAGIC = 0x46546c67;        // "glTF"
+constexpr uint32_t GLB_CHUNK_JSON = 0x4e4f534a;   // "JSON"
+constexpr uint32_t GLB_CHUNK_BIN = 0x004e4942;    // "BIN\0"
+constexpr size_t GLB_HEADER_SIZE = 12;
+constexpr size_t GLB_CHUNK_HEADER_SIZE = 8;
+
+constexpr uint32_t COMPONENT_BYTE = 5120;
+constexpr uint32_t COMPONENT_UNSIGNED_BYTE = 5121;
+constexpr uint32_t COMPONENT_SHORT = 5122;
+constexpr uint32_t COMPONENT_UNSIGNED_SHORT = 5123;
+constexpr uint32_t COMPONENT_UNSIGNED_INT = 5125;
+constexpr uint32_t COMPONENT_FLOAT = 5126;
+
+constexpr size_t MODE_TRIANGLES = 4;
+constexpr size_t MAX_BYTE_STRIDE = 252;
+constexpr size_t MAX_NODE_DEPTH = 256;
+
+[[noreturn]] void fail(std::string_view reason)
+{
+    throw std::runtime_error(std::format("Invalid glTF: {}", reason));
+}
+
+uint32_t readU32(std::span<const char> bytes, size_t offset) noexcept
+{
+    uint32_t value;
+    std::memcpy(&value, bytes.data() + offset, sizeof(value));
+    return value;
+}
+
+size_t toIndex(const core::JsonValue& value)
+{
+    double number = value.number();
+    // Integers above 2^53 are not exactly representable in a JSON number anyway
+    if (number < 0. || number != std::floor(number) || number > 9007199254740992.) {
+        fail("expected a non negative integer");
+    }
+    return static_cast<size_t>(number);
+}
+
+size_t indexOr(const core::JsonValue& object, std::string_view key, size_t defaultValue)
+{
+    const core::JsonValue* value = object.find(key);
+    return value ? toIndex(*value) : defaultValue;
+}
+
+size_t componentSize(uint32_t componentType) noexcept
+{
+    switch (componentType) {
+        case COMPONENT_BYTE:
+        case COMPONENT_UNSIGNED_BYTE: return 1;
+        case COMPONENT_SHORT:
+        case COMPONENT_UNSIGNED_SHORT: return 2;
+        case COMPONENT_UNSIGNED_INT:
+        case COMPONENT_FLOAT: return 4;
+        default: return 0;
+    }
+}
+
+uint32_t numComponentsOf(std::string_view type)
+{
+    if (type == "SCALAR") {
+        return 1;
+    } else if (type == "VEC2") {
+        return 2;
+    } else if (type == "VEC3") {
+        return 3;
+    } else if (type == "VEC4" || type == "MAT2") {
+        return 4;
+    } else if (type == "MAT3") {
+        return 9;
+    } else if (type == "MAT4") {
+        return 16;
+    }
+    fail(std::format("unknown accessor type \"{}\"", type));
+}
+
+template <typename T>
+T load(const std::byte* data) noexcept
+{
+    T value;
+    std::memcpy(&value, data, sizeof(T));
+    return value;
+}
+
+float readComponent(const std::byte* data, uint32_t componentType, bool normalized) noexcept
+{
+    switch (componentType) {
+        case COMPONENT_BYTE: {
+            float value = static_cast<float>(load<int8_t>(data));
+            return normalized ? std::max(value / 127.f, -1.f) : value;
+        }
+        case COMPONENT_UNSIGNED_BYTE: {
+            float value = static_cast<float>(load<uint8_t>(data));
+            return normalized ? value / 255.f : value;
+        }
+        case COMPONENT_SHORT: {
+            float value = static_cast<float>(load<int16_t>(data));
+            return normalized ? std::max(value / 32767.f, -1.f) : value;
+        }
+        case COMPONENT_UNSIGNED_SHORT: {
+            float value = static_cast<float>(load<uint16_t>(data));
+            return normalized ? value / 65535.f : value;
+        }
+        case COMPONENT_UNSIGNED_INT: return static_cast<float>(load<uint32_t>(data));
+        case COMPONENT_FLOAT: return load<float>(data);
+        default: return 0.f;
+    }
+}
+
+// Components missing from the accessor keep the fallback value
+glm::vec4 readElement(const GltfAccessor& accessor, size_t index, const glm::vec4& fallback) noexcept
+{
+    glm::vec4 result = fallback;
+    glm::length_t numComponents = static_cast<glm::length_t>(std::min(accessor.numComponents, 4u));
+    if (!accessor.data) {
+        for (glm::length_t c = 0; c < numComponents; ++c) {
+            result[c] = 0.f;
+        }
+        return result;
+    }
+
+    const std::byte* element = accessor.data + index * accessor.stride;
+    if (accessor.componentType == COMPONENT_FLOAT) {
+        std::memcpy(&result, element, static_cast<size_t>(numComponents) * sizeof(float));
+        return result;
+    }
+
+    size_t size = componentSize(accessor.componentType);
+    for (glm::length_t c = 0; c < numComponents; ++c) {
+        result[c] = readComponent(element + static_cast<size_t>(c) * size, accessor.componentType, accessor.normalized);
+    }
+    return result;
+}
+
+template <typename T>
+void readIndicesAs(const GltfAccessor& accessor, size_t first, uint32_t maxIndex, std::span<uint32_t> out) noexcept
+{
+    const std::byte* element = accessor.data + first * accessor.stride;
+    for (auto& index : out) {
+        uint32_t value = load<T>(element);
+        index = std::min(value, maxIndex);
+        element += accessor.stride;
+    }
+}
+
+std::vector<char> decodeBase64(std::string_view text)
+{
+    auto sextet = [](char c) -> int {
+        if (c >= 'A' && c <= 'Z') {
+            return c - 'A';
+        } else if (c >= 'a' && c <= 'z') {
+            return c - 'a' + 26;
+        } else if (c >= '0' && c <= '9') {
+            return c - '0' + 52;
+        } else if (c == '+') {
+            return 62;
+        } else if (c == '/') {
+            return 63;
+        }
+        return -1;
+    };
+
+    while (!text.empty() && text.back() == '=') {
+        text.remove_suffix(1);
+    }
+
+    std::vector<char> bytes;
+    bytes.reserve(text.size() * 3 / 4);
+    uint32_t accumulator = 0;
+    uint32_t numBits = 0;
+    for (char c : text) {
+        int value = sextet(c);
+        if (value < 0) {
+            fail("invalid base64 data URI");
+        }
+        accumulator = (accumulator << 6) | static_cast<uint32_t>(value);
+        numBits += 6;
+        if (numBits >= 8) {
+            numBits -= 8;
+            bytes.push_back(static_cast<char>((accumulator >> numBits) & 0xff));
+        }
+    }
+    return bytes;
+}
+
+// URIs are percent encoded, e.g. spaces in file names are written as %20
+uint8_t hexDigit(char c)
+{
+    if (c >= '0' && c <= '9') {
+        return static_cast<uint8_t>(c - '0');
+    }
+    if (c >= 'a' && c <= 'f') {
+        return static_cast<uint8_t>(c - 'a' + 10);
+    }
+    if (c >= 'A' && c <= 'F') {
+        return static_cast<uint8_t>(c - 'A' + 10);
+    }
+    fail(std::format("invalid percent-encoding digit '{}' in uri", c));
+}
+
+std::string decodeUri(std::string_view uri)
+{
+    std::string decoded;
+    decoded.reserve(uri.size());
+    for (size_t i = 0; i < uri.size(); ++i) {
+        if (uri[i] == '%') {
+            if (i + 2 >= uri.size()) {
+                fail("truncated percent-encoding in uri");
+            }
+            decoded.push_back(static_cast<char>((hexDigit(uri[i + 1]) << 4) | hexDigit(uri[i + 2])));
+            i += 2;
+        } else {
+            decoded.push_back(uri[i]);
+        }
+    }
+    return decoded;
+}
+
+glm::mat4 nodeTransform(const core::JsonValue& node)
+{
+    if (const core::JsonValue* matrix = node.find("matrix")) {
+        if (matrix->size() != 16) {
+            fail("node matrix must have 16 elements");
+        }
+        // Column major, like glm
+        glm::mat4 result;
+        for (glm::length_t column = 0; column < 4; ++column) {
+            for (glm::length_t row = 0; row < 4; ++row) {
+                result[column][row] = static_cast<float>((*matrix)[static_cast<size_t>(column * 4 + row)].number());
+            }
+        }
+        return result;
+    }
+
+    auto readVector = [&node](std::string_view key, std::span<float> out) {
+        if (const core::JsonValue* value = node.find(key)) {
+            if (value->size() != out.size()) {
+                fail(std::format("node {} has the wrong number of elements", key));
+            }
+            for (size_t i = 0; i < out.size(); ++i) {
+                out[i] = static_cast<float>((*value)[i].number());
+            }
+        }
+    };
+
+    float translation[3] = {0.f, 0.f, 0.f};
+    float rotation[4] = {0.f, 0.f, 0.f, 1.f};   // x, y, z, w
+    float scale[3] = {1.f, 1.f, 1.f};
+    readVector("translation", translation);
+    readVector("rotation", rotation);
+    readVector("scale", scale);
+
+    glm::mat4 result = glm::translate(glm::mat4(1.f), glm::vec3(translation[0], translation[1], translation[2]));
+    result *= glm::mat4_cast(glm::quat(rotation[3], rotation[0], rotation[1], rotation[2]));
+    return glm::scale(result, glm::vec3(scale[0], scale[1], scale[2]));
+}
+}   // namespace
+
+GltfImporter::GltfImporter(const std::filesystem::path& path)
+{
+    std::vector<char> file = core::readFile(path);
+
+    std::string_view json(file.data(), file.size());
+    std::span<const std::byte> binChunk;
+    if (file.size() >= GLB_HEADER_SIZE && readU32(file, 0) == GLB_MAGIC) {
+        if (readU32(file, 4) != 2) {
+            fail("unsupported GLB container version");
+        }
+        size_t length = std::min<size_t>(readU32(file, 8), file.size());
+        if (length < GLB_HEADER_SIZE) {
+            fail("truncated GLB header");
+        }
+
+        json = {};
+        size_t offset = GLB_HEADER_SIZE;
+        while (length - offset >= GLB_CHUNK_HEADER_SIZE) {
+            size_t chunkLength = readU32(file, offset);
+            uint32_t chunkType = readU32(file, offset + 4);
+            offset += GLB_CHUNK_HEADER_SIZE;
+            if (chunkLength > length - offset) {
+                fail("GLB chunk exceeds the file size");
+            }
+
+            if (chunkType == GLB_CHUNK_JSON && json.empty()) {
+                json = std::string_view(file.data() + offset, chunkLength);
+            } else if (chunkType == GLB_CHUNK_BIN && binChunk.empty()) {
+                binChunk = std::as_bytes(std::span<const char>(file).subspan(offset, chunkLength));
+            }
+            offset += chunkLength;
+        }
+
+        if (json.empty()) {
+            fail("GLB file without a JSON chunk");
+        }
+    }
+
+    core::JsonValue document = core::JsonValue::parse(json);
+    if (!document.at("asset").at("version").string().starts_with("2.")) {
+        fail("only glTF 2.0 is supported");
+    }
+
+    // Moving the vector keeps its allocation, so binChunk stays valid
+    if (!binChunk.empty()) {
+        m_storage.push_back(std::move(file));
+    }
+
+    std::filesystem::path directory = path.parent_path();
+    loadBuffers(document, directory, binChunk);
+    parseMaterials(document, directory);
+    parseMeshes(document);
+    parseInstances(document);
+
+    DEBUG_FMT("Parsed glTF {}: {} meshes, {} materials, {} instances\n",
+              path.string(),
+              m_meshes.size(),
+              m_materials.size(),
+              m_instances.size());
+}
+
+void GltfImporter::readVertices(const GltfPrimitive& primitive, size_t first, std::span<Vertex> out) noexcept
+{
+    for (size_t i = 0; i < out.size(); ++i) {
+        size_t index = first + i;
+        glm::vec4 position = readElement(primitive.positions, index, glm::vec4(0.f));
+        glm::vec4 color = primitive.colors ? readElement(*primitive.colors, index, glm::vec4(1.f)) : glm::vec4(1.f);
+        glm::vec4 texCoord =
+            primitive.texCoords ? readElement(*primitive.texCoords, index, glm::vec4(0.f)) : glm::vec4(0.f);
+
+        // Whole struct stores, the destination is usually write combined memory
+        out[i] = Vertex {.pos = glm::vec3(position), .color = glm::vec3(color), .texCoord = glm::vec2(texCoord)};
+    }
+}
+
+void GltfImporter::readIndices(const GltfPrimitive& primitive, size_t first, std::span<uint32_t> out) noexcept
+{
+    if (!primitive.indices) {
+        for (size_t i = 0; i < out.size(); ++i) {
+            out[i] = static_cast<uint32_t>(first + i);
+        }
+        return;
+    }
+
+    const GltfAccessor& accessor = *primitive.indices;
+    if (!accessor.data) {
+        std::ranges::fill(out, 0u);
+        return;
+    }
+
+    uint32_t maxIndex = primitive.vertexCount() - 1;
+    switch (accessor.componentType) {
+        case COMPONENT_UNSIGNED_BYTE: readIndicesAs<uint8_t>(accessor, first, maxIndex, out); break;
+        case COMPONENT_UNSIGNED_SHORT: readIndicesAs<uint16_t>(accessor, first, maxIndex, out); break;
+        case COMPONENT_UNSIGNED_INT: readIndicesAs<uint32_t>(accessor, first, maxIndex, out); break;
+        default: std::ranges::fill(out, 0u); break;
+    }
+}
+
+void GltfImporter::loadBuffers(const core::JsonValue& document,
+                               const std::filesystem::path& directory,
+                               std::span<const std::byte> glbBinChunk)
+{
+    const core::JsonValue* buffers = document.find("buffers");
+    if (!buffers) {
+        return;
+    }
+
+    for (size_t i = 0; i < buffers->size(); ++i) {
+        const core::JsonValue& buffer = (*buffers)[i];
+        size_t byteLength = toIndex(buffer.at("byteLength"));
+
+        std::span<const std::byte> bytes;
+        if (const core::JsonValue* uri = buffer.find("uri")) {
+            std::string_view uriString = uri->string();
+            if (uriString.starts_with("data:")) {
+                size_t comma = uriString.find(',');
+                if (comma == std::string_view::npos || !uriString.substr(0, comma).ends_with(";base64")) {
+                    fail("only base64 data URIs are supported");
+                }
+                m_storage.push_back(decodeBase64(uriString.substr(comma + 1)));
+            } else {
+                m_storage.push_back(core::readFile(directory / decodeUri(uriString)));
+            }
+            bytes = std::as_bytes(std::span<const char>(m_storage.back()));
+        } else if (i == 0 && !glbBinChunk.empty()) {
+            bytes = glbBinChunk;
+        } else {
+            fail(std::format("buffer {} has no data", i));
+        }
+
+        if (bytes.size() < byteLength) {
+            fail(std::format("buffer {} is smaller than its byteLength", i));
+        }
+        m_buffers.push_back(bytes.first(byteLength));
+    }
+}
+
+GltfAccessor GltfImporter::parseAccessor(const core::JsonValue& document, size_t index) const
+{
+    const core::JsonValue& accessor = document.at("accessors")[index];
+    if (accessor.contains("sparse")) {
+        fail("sparse accessors are not supported");
+    }
+
+    GltfAccessor result;
+    result.componentType = static_cast<uint32_t>(toIndex(accessor.at("componentType")));
+    result.numComponents = numComponentsOf(accessor.at("type").string());
+    result.count = toIndex(accessor.at("count"));
+    const core::JsonValue* normalized = accessor.find("normalized");
+    result.normalized = normalized && normalized->boolean();
+
+    size_t size = componentSize(result.componentType);
+    if (size == 0) {
+        fail(std::format("accessor {} has an unknown component type", index));
+    }
+    size_t elementSize = size * result.numComponents;
+    result.stride = elementSize;
+
+    const core::JsonValue* bufferViewIndex = accessor.find("bufferView");
+    if (!bufferViewIndex) {
+        return result;
+    }
+
+    const core::JsonValue& bufferView = document.at("bufferViews")[toIndex(*bufferViewIndex)];
+    size_t bufferIndex = toIndex(bufferView.at("buffer"));
+    if (bufferIndex >= m_buffers.size()) {
+        fail(std::format("accessor {} references a missing buffer", index));
+    }
+
+    std::span<const std::byte> buffer = m_buffers[bufferIndex];
+    size_t viewOffset = indexOr(bufferView, "byteOffset", 0);
+    size_t viewLength = toIndex(bufferView.at("byteLength"));
+    size_t accessorOffset = indexOr(accessor, "byteOffset", 0);
+    result.stride = indexOr(bufferView, "byteStride", elementSize);
+
+    // Validated once here, so reading never goes out of bounds
+    if (viewOffset > buffer.size() || viewLength > buffer.size() - viewOffset) {
+        fail(std::format("accessor {} buffer view is out of bounds", index));
+    }
+    if (result.stride < elementSize || result.stride > MAX_BYTE_STRIDE) {
+        fail(std::format("accessor {} has an invalid byte stride", index));
+    }
+    if (result.count > 0 && (accessorOffset > viewLength ||
+                             (result.count - 1) * result.stride + elementSize > viewLength - accessorOffset)) {
+        fail(std::format("accessor {} is out of bounds", index));
+    }
+
+    result.data = buffer.data() + viewOffset + accessorOffset;
+    return result;
+}
+
+void GltfImporter::parseMeshes(const core::JsonValue& document)
+{
+    const core::JsonValue* meshes = document.find("meshes");
+    if (!meshes) {
+        return;
+    }
+
+    for (const auto& mesh : meshes->values()) {
+        GltfMesh& result = m_meshes.emplace_back();
+        result.name = mesh.stringOr("name", "");
+
+        for (const auto& primitive : mesh.at("primitives").values()) {
+            size_t mode = indexOr(primitive, "mode", MODE_TRIANGLES);
+            if (mode != MODE_TRIANGLES) {
+                WARN_FMT("Skipping a primitive of mesh \"{}\" with unsupported mode {}\n", result.name, mode);
+                continue;
+            }
+
+            const core::JsonValue& attributes = primitive.at("attributes");
+            GltfPrimitive parsed;
+            parsed.positions = parseAccessor(document, toIndex(attributes.at("POSITION")));
+            if (parsed.positions.numComponents != 3) {
+                fail("POSITION must be a VEC3");
+            }
+            if (parsed.positions.count > std::numeric_limits<uint32_t>::max()) {
+                fail("primitives are limited to 2^32 vertices");
+            }
+
+            if (const core::JsonValue* color = attributes.find("COLOR_0")) {
+                parsed.colors = parseAccessor(document, toIndex(*color));
+                if (parsed.colors->count < parsed.positions.count ||
+                    (parsed.colors->numComponents != 3 && parsed.colors->numComponents != 4)) {
+                    fail("COLOR_0 must be a VEC3 or VEC4 with one element per vertex");
+                }
+            }
+
+            if (const core::JsonValue* texCoord = attributes.find("TEXCOORD_0")) {
+                parsed.texCoords = parseAccessor(document, toIndex(*texCoord));
+                if (parsed.texCoords->count < parsed.positions.count || parsed.texCoords->numComponents != 2) {
+                    fail("TEXCOORD_0 must be a VEC2 with one element per vertex");
+                }
+            }
+
+            if (const core::JsonValue* indices = primitive.find("indices")) {
+                parsed.indices = parseAccessor(document, toIndex(*indices));
+                uint32_t componentType = parsed.indices->componentType;
+                if (parsed.indices->numComponents != 1 ||
+                    (componentType != COMPONENT_UNSIGNED_BYTE && componentType != COMPONENT_UNSIGNED_SHORT &&
+                     componentType != COMPONENT_UNSIGNED_INT)) {
+                    fail("indices must be unsigned integer scalars");
+                }
+                if (parsed.indices->count > std::numeric_limits<uint32_t>::max()) {
+                    fail("primitives are limited to 2^32 indices");
+                }
+            }
+
+            size_t material = indexOr(primitive, "material", GLTF_NONE);
+            if (material != GLTF_NONE && material >= m_materials.size()) {
+                fail("primitive references a missing material");
+            }
+            parsed.material = static_cast<uint32_t>(material);
+
+            if (parsed.vertexCount() == 0 || parsed.indexCount() == 0) {
+                continue;
+            }
+            result.primitives.push_back(parsed);
+        }
+    }
+}
+
+void GltfImporter::parseMaterials(const core::JsonValue& document, const std::filesystem::path& directory)
+{
+    if (const core::JsonValue* images = document.find("images")) {
+        for (const auto& image : images->values()) {
+            const core::JsonValue* uri = image.find("uri");
+            if (!uri || uri->string().starts_with("data:")) {
+                WARN("Skipping a glTF image embedded in a buffer or data URI, only external images are supported\n");
+                m_images.emplace_back();
+                continue;
+            }
+            m_images.push_back(directory / decodeUri(uri->string()));
+        }
+    }
+
+    std::vector<uint32_t> textureImages;
+    if (const core::JsonValue* textures = document.find("textures")) {
+        for (const auto& texture : textures->values()) {
+            size_t source = indexOr(texture, "source", GLTF_NONE);
+            textureImages.push_back(source < m_images.size() ? static_cast<uint32_t>(source) : GLTF_NONE);
+        }
+    }
+
+    const core::JsonValue* materials = document.find("materials");
+    if (!materials) {
+        return;
+    }
+
+    for (const auto& material : materials->values()) {
+        GltfMaterial result;
+        if (const core::JsonValue* pbr = material.find("pbrMetallicRoughness")) {
+            if (const core::JsonValue* factor = pbr->find("baseColorFactor")) {
+                if (factor->size() != 4) {
+                    fail("baseColorFactor must have 4 elements");
+                }
+                for (glm::length_t c = 0; c < 4; ++c) {
+                    result.baseColorFactor[c] = static_cast<float>((*factor)[static_cast<size_t>(c)].number());
+                }
+            }
+
+            if (const core::JsonValue* texture = pbr->find("baseColorTexture")) {
+                size_t textureIndex = toIndex(texture->at("index"));
+                if (textureIndex >= textureImages.size()) {
+                    fail("material references a missing texture");
+                }
+                result.baseColorImage = textureImages[textureIndex];
+            }
+        }
+        m_materials.push_back(result);
+    }
+}
+
+void GltfImporter::parseInstances(const core::JsonValue& document)
+{
+    const core::JsonValue* nodes = document.find("nodes");
+    if (!nodes) {
+        return;
+    }
+
+    std::vector<size_t> roots;
+    const core::JsonValue* scenes = document.find("scenes");
+    if (scenes && scenes->size() > 0) {
+        const core::JsonValue& scene = (*scenes)[indexOr(document, "scene", 0)];
+        if (const core::JsonValue* sceneNodes = scene.find("nodes")) {
+            for (const auto& node : sceneNodes->values()) {
+                roots.push_back(toIndex(node));
+            }
+        }
+    } else {
+        // No scene, every node that is not a child is a root
+        std::vector<bool> isChild(nodes->size(), false);
+        for (const auto& node : nodes->values()) {
+            if (const core::JsonValue* children = node.find("children")) {
+                for (const auto& child : children->values()) {
+                    size_t childIndex = toIndex(child);
+                    if (childIndex < isChild.size()) {
+                        isChild[childIndex] = true;
+                    }
+                }
+            }
+        }
+        for (size_t i = 0; i < isChild.size(); ++i) {
+            if (!isChild[i]) {
+                roots.push_back(i);
+            }
+        }
+    }
+
+    struct PendingNode {
+        size_t index;
+        glm::mat4 parentTransform;
+        size_t depth;
+    };
+
+    std::vector<PendingNode> stack;
+    for (size_t root : roots) {
+        stack.push_back({.index = root, .parentTransform = glm::mat4(1.f), .depth = 0});
+    }
+
+    while (!stack.empty()) {
+        PendingNode pending = stack.back();
+        stack.pop_back();
+        if (pending.depth > MAX_NODE_DEPTH) {
+            fail("node hierarchy is too deep or has a cycle");
+        }
+        if (pending.index >= nodes->size()) {
+            fail("scene references a missing node");
+        }
+
+        const core::JsonValue& node = (*nodes)[pending.index];
+        glm::mat4 transform = pending.parentTransform * nodeTransform(node);
+
+        if (const core::JsonValue* mesh = node.find("mesh")) {
+            size_t meshIndex = toIndex(*mesh);
+            if (meshIndex >= m_meshes.size()) {
+                fail("node references a missing mesh");
+            }
+            m_instances.push_back({.mesh = static_cast<uint32_t>(meshIndex), .transform = transform});
+        }
+
+        if (const core::JsonValue* children = node.find("children")) {
+            for (const auto& child : children->values()) {
+                stack.push_back({.index = toIndex(child), .parentTransform = transform, .depth = pending.depth + 1});
+            }
+        }
+    }
+}
+
+}   // namespace renderer
@@ -0,0 +1,116 @@
+#ifndef RENDERER_GLTF_IMPORTER_HPP
+#define RENDERER_GLTF_IMPORTER_HPP
+
+#include "Types.hpp"
+
+// libs
+#include <glm/glm.hpp>
+
+// std
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <limits>
+#include <optional>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace core
+{
+class JsonValue;
+}
+
+namespace renderer
+{
+
+inline constexpr uint32_t GLTF_NONE = std::numeric_limits<uint32_t>::max();
+
+// Validated view into one of the importer buffers
+struct GltfAccessor {
+    const std::byte* data = nullptr;   // null if the accessor has no buffer view, every element is then zero
+    size_t stride = 0;
+    size_t count = 0;
+    uint32_t componentType = 0;
+    uint32_t numComponents = 0;
+    bool normalized = false;
+};
+
+struct GltfPrimitive {
+    GltfAccessor positions;
+    std::optional<GltfAccessor> colors;
+    std::optional<GltfAccessor> texCoords;
+    std::optional<GltfAccessor> indices;   // non indexed primitives are read as 0, 1, 2, ...
+    uint32_t material = GLTF_NONE;
+
+    uint32_t vertexCount() const noexcept { return static_cast<uint32_t>(positions.count); }
+    uint32_t indexCount() const noexcept { return static_cast<uint32_t>(indices ? indices->count : positions.count); }
+};
+
+struct GltfMesh {
+    std::string name;
+    std::vector<GltfPrimitive> primitives;   // triangle lists only
+};
+
+struct GltfMaterial {
+    glm::vec4 baseColorFactor = glm::vec4(1.f);
+    uint32_t baseColorImage = GLTF_NONE;   // index into GltfImporter::images()
+};
+
+struct GltfInstance {
+    uint32_t mesh;   // index into GltfImporter::meshes()
+    glm::mat4 transform;
+};
+
+// Parses a .gltf (external or base64 embedded buffers) or a .glb file. The buffers are kept in memory, and the
+// attributes are only converted to the renderer formats on request, by ranges so the conversion can be split between
+// threads. Reading is const and thread safe.
+// Malformed files throw std::runtime_error, missing files std::ios_base::failure.
+class GltfImporter
+{
+public:
+    GltfImporter() noexcept = default;
+    explicit GltfImporter(const std::filesystem::path& path);
+
+    GltfImporter(const GltfImporter&) = delete;
+    GltfImporter& operator=(const GltfImporter&) = delete;
+
+    GltfImporter(GltfImporter&&) noexcept = default;
+    GltfImporter& operator=(GltfImporter&&) noexcept = default;
+
+    ~GltfImporter() noexcept = default;
+
+public:
+    const std::vector<GltfMesh>& meshes() const noexcept { return m_meshes; }
+    const std::vector<GltfMaterial>& materials() const noexcept { return m_materials; }
+    // Empty paths for images embedded in buffers or data URIs, which are not supported
+    const std::vector<std::filesystem::path>& images() const noexcept { return m_images; }
+    // Every mesh node reachable from the default scene, with its world transform
+    const std::vector<GltfInstance>& instances() const noexcept { return m_instances; }
+
+    // Writes the vertices [first, first + out.size()) of the primitive
+    static void readVertices(const GltfPrimitive& primitive, size_t first, std::span<Vertex> out) noexcept;
+    // Writes the indices [first, first + out.size()) of the primitive. Out of range indices are clamped
+    static void readIndices(const GltfPrimitive& primitive, size_t first, std::span<uint32_t> out) noexcept;
+
+private:
+    void loadBuffers(const core::JsonValue& document,
+                     const std::filesystem::path& directory,
+                     std::span<const std::byte> glbBinChunk);
+    GltfAccessor parseAccessor(const core::JsonValue& document, size_t index) const;
+    void parseMeshes(const core::JsonValue& document);
+    void parseMaterials(const core::JsonValue& document, const std::filesystem::path& directory);
+    void parseInstances(const core::JsonValue& document);
+
+private:
+    std::vector<std::vector<char>> m_storage;            // file content backing m_buffers
+    std::vector<std::span<const std::byte>> m_buffers;   // glTF buffers
+    std::vector<GltfMesh> m_meshes;
+    std::vector<GltfMaterial> m_materials;
+    std::vector<std::filesystem::path> m_images;
+    std::vector<GltfInstance> m_instances;
+};
+
+}   // namespace renderer
+
+#endif
@@ -0,0 +1,358 @@
+#include "GlyphCache.hpp"
+
+#include "DeletionQueue.hpp"
+#include "TrueTypeFont.hpp"
+#include "Types.hpp"
+#include "core/Logger.hpp"
+
+// std
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <iterator>
+#include <limits>
+#include <span>
+
+namespace renderer
+{
+
+namespace
+{
+constexpr vk::Format GLYPH_FORMAT = vk::Format::eR8Unorm;
+// Keeps the flattened curves within a tenth of a texel of the outline
+constexpr float MAX_FLATTENING_ERROR = 0.1f;
+constexpr uint32_t MAX_CURVE_SEGMENTS = 16;
+
+struct Segment {
+    glm::vec2 a;
+    glm::vec2 b;
+};
+
+vk::ImageMemoryBarrier2 imageBarrier(vk::Image image,
+                                     vk::ImageLayout oldLayout,
+                                     vk::ImageLayout newLayout,
+                                     vk::PipelineStageFlags2 srcStage,
+                                     vk::AccessFlags2 srcAccess,
+                                     vk::PipelineStageFlags2 dstStage,
+                                     vk::AccessFlags2 dstAccess) noexcept
+{
+    return vk::ImageMemoryBarrier2 {
+        .sType = vk::StructureType::eImageMemoryBarrier2,
+        .pNext = nullptr,
+        .srcStageMask = srcStage,
+        .srcAccessMask = srcAccess,
+        .dstStageMask = dstStage,
+        .dstAccessMask = dstAccess,
+        .oldLayout = oldLayout,
+        .newLayout = newLayout,
+        .srcQueueFamilyIndex = vk::QueueFamilyIgnored,
+        .dstQueueFamilyIndex = vk::QueueFamilyIgnored,
+        .image = image,
+        .subresourceRange = {.aspectMask = vk::ImageAspectFlagBits::eColor,
+                             .baseMipLevel = 0,
+                             .levelCount = 1,
+                             .baseArrayLayer = 0,
+                             .layerCount = 1}
+    };
+}
+
+void pipelineBarrier(vk::CommandBuffer commandBuffer, const vk::ImageMemoryBarrier2& barrier)
+{
+    vk::DependencyInfo dependencyInfo {.sType = vk::StructureType::eDependencyInfo,
+                                       .pNext = nullptr,
+                                       .dependencyFlags = {},
+                                       .memoryBarrierCount = 0,
+                                       .pMemoryBarriers = nullptr,
+                                       .bufferMemoryBarrierCount = 0,
+                                       .pBufferMemoryBarriers = nullptr,
+                                       .imageMemoryBarrierCount = 1,
+                                       .pImageMemoryBarriers = &barrier};
+
+    commandBuffer.pipelineBarrier2(dependencyInfo);
+}
+
+// In texels, y pointing down, with the outline's bounds at SDF_SPREAD texels from the top left corner
+std::vector<Segment> flattenOutline(const GlyphOutline& outline, float scale)
+{
+    auto toTexels = [&outline, scale](const glm::vec2& point) {
+        return glm::vec2((point.x - outline.min.x) * scale + GlyphCache::SDF_SPREAD,
+                         (outline.max.y - point.y) * scale + GlyphCache::SDF_SPREAD);
+    };
+
+    std::vector<Segment> segments;
+    segments.reserve(outline.curves.size() * 4);
+    for (const auto& curve : outline.curves) {
+        glm::vec2 p0 = toTexels(curve.p0);
+        glm::vec2 p1 = toTexels(curve.p1);
+        glm::vec2 p2 = toTexels(curve.p2);
+
+        // n segments are at most |p0 - 2 p1 + p2| / (8 n^2) away from the curve, and lines need a single one
+        float deviation = glm::length(p0 - 2.f * p1 + p2);
+        auto count = static_cast<uint32_t>(std::ceil(std::sqrt(deviation / (8.f * MAX_FLATTENING_ERROR))));
+        count = std::clamp(count, 1u, MAX_CURVE_SEGMENTS);
+
+        glm::vec2 previous = p0;
+        for (uint32_t i = 1; i <= count; ++i) {
+            float t = static_cast<float>(i) / static_cast<float>(count);
+            glm::vec2 point = (1.f - t) * (1.f - t) * p0 + 2.f * (1.f - t) * t * p1 + t * t * p2;
+            segments.push_back({.a = previous, .b = point});
+            previous = point;
+        }
+    }
+    return segments;
+}
+
+// Into the top left corner of a cell of texels, returning the extent covering the outline and its spread
+vk::Extent2D rasterizeSdf(const GlyphOutline& outline, float scale, std::span<uint8_t> cell)
+{
+    constexpr float spread = GlyphCache::SDF_SPREAD;
+    constexpr uint32_t cellSize = GlyphCache::CELL_SIZE;
+    glm::vec2 bounds = (outline.max - outline.min) * scale + 2.f * spread;
+    vk::Extent2D extent {.width = std::min(static_cast<uint32_t>(std::ceil(bounds.x)), cellSize),
+                         .height = std::min(static_cast<uint32_t>(std::ceil(bounds.y)), cellSize)};
+
+    std::vector<Segment> segments = flattenOutline(outline, scale);
+    for (uint32_t y = 0; y < extent.height; ++y) {
+        for (uint32_t x = 0; x < extent.width; ++x) {
+            glm::vec2 p(static_cast<float>(x) + 0.5f, static_cast<float>(y) + 0.5f);
+            float minDistance2 = std::numeric_limits<float>::max();
+            int32_t winding = 0;
+            for (const auto& segment : segments) {
+                glm::vec2 ab = segment.b - segment.a;
+                float t = std::clamp(glm::dot(p - segment.a, ab) / std::max(glm::dot(ab, ab), 1e-12f), 0.f, 1.f);
+                glm::vec2 closest = segment.a + t * ab - p;
+                minDistance2 = std::min(minDistance2, glm::dot(closest, closest));
+
+                // Crossings of a ray towards +x, for the nonzero winding rule
+                if ((segment.a.y <= p.y) != (segment.b.y <= p.y)) {
+                    float crossing = segment.a.x + (p.y - segment.a.y) / ab.y * ab.x;
+                    if (crossing > p.x) {
+                        winding += ab.y > 0.f ? 1 : -1;
+                    }
+                }
+            }
+
+            float distance = winding != 0 ? std::sqrt(minDistance2) : -std::sqrt(minDistance2);
+            float value = std::clamp(0.5f + distance / (2.f * spread), 0.f, 1.f);
+            cell[y * cellSize + x] = static_cast<uint8_t>(std::lround(value * 255.f));
+        }
+    }
+    return extent;
+}
+}   // namespace
+
+GlyphCache::GlyphCache(vk::Device device,
+                       VmaAllocator allocator,
+                       vk::Sampler sampler,
+                       vk::DescriptorSetLayout textureSetLayout,
+                       uint32_t pageSize)
+    : m_device(device)
+    , m_allocator(allocator)
+    , m_sampler(sampler)
+    , m_textureSetLayout(textureSetLayout)
+    , m_pageSize(pageSize)
+{
+    assert(pageSize >= CELL_SIZE && pageSize % CELL_SIZE == 0);
+
+    m_image = Allocated2DImage(m_allocator,
+                               GLYPH_FORMAT,
+                               {.width = m_pageSize, .height = m_pageSize},
+                               1,
+                               vk::ImageTiling::eOptimal,
+                               vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eSampled,
+                               0,
+                               VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE);
+
+    vk::ImageViewCreateInfo imageViewCreateInfo {
+        .sType = vk::StructureType::eImageViewCreateInfo,
+        .pNext = nullptr,
+        .flags = {},
+        .image = m_image.image(),
+        .viewType = vk::ImageViewType::e2D,
+        .format = GLYPH_FORMAT,
+        .components = {vk::ComponentSwizzle::eIdentity,
+                  vk::ComponentSwizzle::eIdentity,
+                  vk::ComponentSwizzle::eIdentity,
+                  vk::ComponentSwizzle::eIdentity},
+        .subresourceRange = {.aspectMask = vk::ImageAspectFlagBits::eColor,
+                  .baseMipLevel = 0,
+                  .levelCount = 1,
+                  .baseArrayLayer = 0,
+                  .layerCount = 1}
+    };
+    m_imageView = m_device.createImageViewUnique(imageViewCreateInfo);
+
+    vk::DescriptorPoolSize poolSizes[] {
+        {.type = vk::DescriptorType::eCombinedImageSampler, .descriptorCount = 1}
+    };
+
+    vk::DescriptorPoolCreateInfo poolCreateInfo {.sType = vk::StructureType::eDescriptorPoolCreateInfo,
+                                                 .pNext = nullptr,
+                                                 .flags = vk::DescriptorPoolCreateFlagBits::eFreeDescriptorSet,
+                                                 .maxSets = 1,
+                                                 .poolSizeCount = std::size(poolSizes),
+                                                 .pPoolSizes = poolSizes};
+    m_descriptorPool = m_device.createDescriptorPoolUnique(poolCreateInfo);
+
+    vk::DescriptorSetAllocateInfo allocateInfo {.sType = vk::StructureType::eDescriptorSetAllocateInfo,
+                                                .pNext = nullptr,
+                                                .descriptorPool = *m_descriptorPool,
+                                                .descriptorSetCount = 1,
+                                                .pSetLayouts = &m_textureSetLayout};
+    m_descriptor = std::move(m_device.allocateDescriptorSetsUnique(allocateInfo)[0]);
+
+    vk::DescriptorImageInfo imageInfo {.sampler = m_sampler,
+                                       .imageView = *m_imageView,
+                                       .imageLayout = vk::ImageLayout::eShaderReadOnlyOptimal};
+
+    vk::WriteDescriptorSet descriptorWrite {.sType = vk::StructureType::eWriteDescriptorSet,
+                                            .pNext = nullptr,
+                                            .dstSet = *m_descriptor,
+                                            .dstBinding = 0,
+                                            .dstArrayElement = 0,
+                                            .descriptorCount = 1,
+                                            .descriptorType = vk::DescriptorType::eCombinedImageSampler,
+                                            .pImageInfo = &imageInfo,
+                                            .pBufferInfo = nullptr,
+                                            .pTexelBufferView = nullptr};
+    m_device.updateDescriptorSets(descriptorWrite, nullptr);
+
+    // Popped from the back, so the first cells are used first
+    uint32_t cellsPerRow = m_pageSize / CELL_SIZE;
+    for (uint32_t cell = cellsPerRow * cellsPerRow; cell > 0; --cell) {
+        m_freeCells.push_back(cell - 1);
+    }
+}
+
+const CachedGlyph* GlyphCache::find(const TrueTypeFont& font, uint32_t fontId, uint32_t glyph, size_t frame)
+{
+    uint64_t key = uint64_t {fontId} << 32 | glyph;
+    if (auto it = m_entries.find(key); it != m_entries.end()) {
+        it->second.lastUsedFrame = frame;
+        m_lru.splice(m_lru.end(), m_lru, it->second.lruIt);
+        return &it->second.glyph;
+    }
+
+    std::optional<uint32_t> cell = allocateCell(frame);
+    if (!cell) {
+        return nullptr;
+    }
+
+    // At EM_SIZE, unless its bounds and spread would not fit in a cell
+    GlyphOutline outline = font.outline(glyph);
+    glm::vec2 bounds = outline.max - outline.min;
+    float scale = std::min(EM_SIZE / font.unitsPerEm(),
+                           (static_cast<float>(CELL_SIZE) - 2.f * SDF_SPREAD) / std::max({bounds.x, bounds.y, 1.f}));
+
+    PendingUpload upload {.cell = *cell, .texels = std::vector<uint8_t>(CELL_SIZE * CELL_SIZE, 0)};
+    vk::Extent2D extent = rasterizeSdf(outline, scale, upload.texels);
+    m_pendingUploads.push_back(std::move(upload));
+
+    glm::vec2 position(cellPosition(*cell));
+    glm::vec2 size(static_cast<float>(extent.width), static_cast<float>(extent.height));
+    float spread = SDF_SPREAD / scale;
+    CachedGlyph cached {
+        .uvRect = glm::vec4(position, size) / static_cast<float>(m_pageSize),
+        .planeRect =
+            glm::vec4(outline.min.x - spread, -(outline.max.y + spread), size / scale) / font.unitsPerEm()};
+
+    m_lru.push_back(key);
+    auto [it, inserted] = m_entries.emplace(
+        key, Entry {.glyph = cached, .cell = *cell, .lastUsedFrame = frame, .lruIt = std::prev(m_lru.end())});
+    assert(inserted);
+    ++m_stats.rasterized;
+    return &it->second.glyph;
+}
+
+void GlyphCache::update(vk::CommandBuffer commandBuffer, size_t frame, DeletionQueue& deletionQueue)
+{
+    if (m_pendingUploads.empty()) {
+        return;
+    }
+
+    constexpr size_t cellBytes = size_t {CELL_SIZE} * CELL_SIZE;
+    AllocatedBuffer stagingBuffer(m_allocator,
+                                  m_pendingUploads.size() * cellBytes,
+                                  vk::BufferUsageFlagBits::eTransferSrc,
+                                  VMA_ALLOCATION_CREATE_MAPPED_BIT |
+                                      VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT,
+                                  VMA_MEMORY_USAGE_AUTO);
+    auto* staging = static_cast<uint8_t*>(stagingBuffer.allocationInfo().pMappedData);
+
+    std::vector<vk::BufferImageCopy> regions;
+    regions.reserve(m_pendingUploads.size());
+    for (size_t i = 0; i < m_pendingUploads.size(); ++i) {
+        std::memcpy(staging + i * cellBytes, m_pendingUploads[i].texels.data(), cellBytes);
+        glm::uvec2 position = cellPosition(m_pendingUploads[i].cell);
+        regions.push_back({
+            .bufferOffset = i * cellBytes,
+            .bufferRowLength = 0,
+            .bufferImageHeight = 0,
+            .imageSubresource = {.aspectMask = vk::ImageAspectFlagBits::eColor,
+                                 .mipLevel = 0,
+                                 .baseArrayLayer = 0,
+                                 .layerCount = 1},
+            .imageOffset = {.x = static_cast<int32_t>(position.x), .y = static_cast<int32_t>(position.y), .z = 0},
+            .imageExtent = {.width = CELL_SIZE, .height = CELL_SIZE, .depth = 1}
+        });
+    }
+
+    // Waits for previous frames still sampling the page
+    pipelineBarrier(commandBuffer,
+                    imageBarrier(m_image.image(),
+                                 m_uploaded ? vk::ImageLayout::eShaderReadOnlyOptimal : vk::ImageLayout::eUndefined,
+                                 vk::ImageLayout::eTransferDstOptimal,
+                                 m_uploaded ? vk::PipelineStageFlagBits2::eFragmentShader
+                                            : vk::PipelineStageFlagBits2::eNone,
+                                 {},
+                                 vk::PipelineStageFlagBits2::eTransfer,
+                                 vk::AccessFlagBits2::eTransferWrite));
+    // The cells not uploaded yet are undefined on the first upload, but no glyph samples them
+    commandBuffer.copyBufferToImage(
+        stagingBuffer.buffer(), m_image.image(), vk::ImageLayout::eTransferDstOptimal, regions);
+    pipelineBarrier(commandBuffer,
+                    imageBarrier(m_image.image(),
+                                 vk::ImageLayout::eTransferDstOptimal,
+                                 vk::ImageLayout::eShaderReadOnlyOptimal,
+                                 vk::PipelineStageFlagBits2::eTransfer,
+                                 vk::AccessFlagBits2::eTransferWrite,
+                                 vk::PipelineStageFlagBits2::eFragmentShader,
+                                 vk::AccessFlagBits2::eShaderSampledRead));
+
+    m_uploaded = true;
+    TRACE_FMT("Uploaded {} glyphs\n", m_pendingUploads.size());
+    deletionQueue.retire(frame, std::move(stagingBuffer));
+    m_pendingUploads.clear();
+}
+
+std::optional<uint32_t> GlyphCache::allocateCell(size_t frame)
+{
+    if (!m_freeCells.empty()) {
+        uint32_t cell = m_freeCells.back();
+        m_freeCells.pop_back();
+        return cell;
+    }
+
+    // Every glyph drawn by this frame is more recent than the front
+    auto it = m_entries.find(m_lru.front());
+    if (it->second.lastUsedFrame >= frame) {
+        return std::nullopt;
+    }
+
+    // Two uploads to the same cell would overlap within the same copy
+    uint32_t cell = it->second.cell;
+    std::erase_if(m_pendingUploads, [cell](const PendingUpload& upload) { return upload.cell == cell; });
+    m_entries.erase(it);
+    m_lru.pop_front();
+    ++m_stats.evicted;
+    return cell;
+}
+
+glm::uvec2 GlyphCache::cellPosition(uint32_t cell) const noexcept
+{
+    uint32_t cellsPerRow = m_pageSize / CELL_SIZE;
+    return glm::uvec2(cell % cellsPerRow, cell / cellsPerRow) * CELL_SIZE;
+}
+
+}   // namespace renderer
@@ -0,0 +1,113 @@
+#ifndef RENDERER_GLYPH_CACHE_HPP
+#define RENDERER_GLYPH_CACHE_HPP
+
+#include "Image.hpp"
+
+// libs
+#include <glm/glm.hpp>
+#include <vk_mem_alloc.h>
+#include <vulkan/vulkan.hpp>
+
+// std
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+namespace renderer
+{
+class DeletionQueue;
+class TrueTypeFont;
+
+struct CachedGlyph {
+    glm::vec4 uvRect;      // min and size in the page
+    glm::vec4 planeRect;   // min and size in ems, from the pen position on the baseline, y pointing down
+};
+
+struct GlyphCacheStats {
+    size_t rasterized = 0;
+    size_t evicted = 0;
+};
+
+// Signed distance fields of glyphs, rasterized on the CPU on first use into the cells of a single page, evicting the
+// least recently used glyph once every cell is taken. The field is 0.5 on the outline, increasing inside, and reaches
+// 0 and 1 at SDF_SPREAD texels from it, so the same texels draw the glyph sharply at any scale
+class GlyphCache
+{
+public:
+    static constexpr uint32_t CELL_SIZE = 64;
+    static constexpr float SDF_SPREAD = 6.f;
+    // Of an em, smaller for the glyphs that would not fit in a cell
+    static constexpr float EM_SIZE = 40.f;
+
+    GlyphCache() noexcept = default;
+    GlyphCache(vk::Device device,
+               VmaAllocator allocator,
+               vk::Sampler sampler,
+               vk::DescriptorSetLayout textureSetLayout,
+               uint32_t pageSize);
+
+    GlyphCache(const GlyphCache&) = delete;
+    GlyphCache& operator=(const GlyphCache&) = delete;
+
+    GlyphCache(GlyphCache&&) noexcept = default;
+    GlyphCache& operator=(GlyphCache&&) noexcept = default;
+
+    ~GlyphCache() noexcept = default;
+
+public:
+    // For a glyph with an outline, drawn by the given frame. Null if every cell holds a glyph drawn by that frame
+    const CachedGlyph* find(const TrueTypeFont& font, uint32_t fontId, uint32_t glyph, size_t frame);
+
+    // Records the uploads of the glyphs rasterized since the last update. Must be called outside of a rendering
+    // scope, before any draw that uses them
+    void update(vk::CommandBuffer commandBuffer, size_t frame, DeletionQueue& deletionQueue);
+
+    // Written on creation, but only usable after the first update
+    vk::DescriptorSet descriptor() const noexcept { return *m_descriptor; }
+
+    size_t size() const noexcept { return m_entries.size(); }
+    const GlyphCacheStats& stats() const noexcept { return m_stats; }
+
+private:
+    struct Entry {
+        CachedGlyph glyph;
+        uint32_t cell;
+        size_t lastUsedFrame;
+        std::list<uint64_t>::iterator lruIt;
+    };
+
+    // The whole cell, so no texel of an evicted glyph is left around the new one
+    struct PendingUpload {
+        uint32_t cell;
+        std::vector<uint8_t> texels;
+    };
+
+    std::optional<uint32_t> allocateCell(size_t frame);
+    glm::uvec2 cellPosition(uint32_t cell) const noexcept;
+
+private:
+    vk::Device m_device;                          // not owned
+    VmaAllocator m_allocator = nullptr;           // not owned
+    vk::Sampler m_sampler;                        // not owned
+    vk::DescriptorSetLayout m_textureSetLayout;   // not owned
+    uint32_t m_pageSize = 0;
+    Allocated2DImage m_image;
+    vk::UniqueImageView m_imageView;
+    vk::UniqueDescriptorPool m_descriptorPool;
+    vk::UniqueDescriptorSet m_descriptor;
+    bool m_uploaded = false;   // the layout is eShaderReadOnlyOptimal, otherwise eUndefined
+
+    // By font id and glyph index
+    std::unordered_map<uint64_t, Entry> m_entries;
+    std::list<uint64_t> m_lru;   // least recently used first
+    std::vector<uint32_t> m_freeCells;
+    std::vector<PendingUpload> m_pendingUploads;
+    GlyphCacheStats m_stats;
+};
+
+}   // namespace renderer
+
+#endif
@@ -0,0 +1,90 @@
+#include "GpuFrameTimer.hpp"
+
+#include "core/Logger.hpp"
+
+// std
+#include <cassert>
+#include <limits>
+
+namespace renderer
+{
+
+namespace
+{
+constexpr uint32_t QUERIES_PER_FRAME = 2;
+constexpr float NANOSECONDS_PER_MILLISECOND = 1e6f;
+}   // namespace
+
+GpuFrameTimer::GpuFrameTimer(vk::Device device,
+                             vk::PhysicalDevice physicalDevice,
+                             uint32_t queueFamilyIndex,
+                             uint32_t framesInFlight)
+    : m_device(device)
+    , m_framesInFlight(framesInFlight)
+    , m_measured(framesInFlight, 0)
+{
+    uint32_t validBits = physicalDevice.getQueueFamilyProperties()[queueFamilyIndex].timestampValidBits;
+    if (validBits == 0) {
+        WARN("The graphics queue has no timestamps, GPU frame times are not measured\n");
+        return;
+    }
+    m_timestampMask = validBits >= 64 ? std::numeric_limits<uint64_t>::max() : (uint64_t {1} << validBits) - 1;
+    m_timestampPeriod = physicalDevice.getProperties().limits.timestampPeriod;
+
+    vk::QueryPoolCreateInfo createInfo {.sType = vk::StructureType::eQueryPoolCreateInfo,
+                                        .pNext = nullptr,
+                                        .flags = {},
+                                        .queryType = vk::QueryType::eTimestamp,
+                                        .queryCount = QUERIES_PER_FRAME * framesInFlight,
+                                        .pipelineStatistics = {}};
+    m_queryPool = device.createQueryPoolUnique(createInfo);
+}
+
+void GpuFrameTimer::begin(vk::CommandBuffer commandBuffer, size_t frame)
+{
+    if (!m_queryPool) {
+        return;
+    }
+    auto firstQuery = static_cast<uint32_t>(frame % m_framesInFlight) * QUERIES_PER_FRAME;
+    commandBuffer.resetQueryPool(*m_queryPool, firstQuery, QUERIES_PER_FRAME);
+    commandBuffer.writeTimestamp2(vk::PipelineStageFlagBits2::eNone, *m_queryPool, firstQuery);
+}
+
+void GpuFrameTimer::end(vk::CommandBuffer commandBuffer, size_t frame)
+{
+    if (!m_queryPool) {
+        return;
+    }
+    size_t slot = frame % m_framesInFlight;
+    // Once every command of the frame completed
+    commandBuffer.writeTimestamp2(vk::PipelineStageFlagBits2::eAllCommands,
+                                  *m_queryPool,
+                                  static_cast<uint32_t>(slot) * QUERIES_PER_FRAME + 1);
+    m_measured[slot] = true;
+}
+
+std::optional<float> GpuFrameTimer::read(size_t frame)
+{
+    size_t slot = frame % m_framesInFlight;
+    if (!m_queryPool || !m_measured[slot]) {
+        return std::nullopt;
+    }
+    m_measured[slot] = false;
+
+    // Not waiting: the fence signaled, unless the frame was never submitted
+    auto [result, timestamps] =
+        m_device.getQueryPoolResults<uint64_t>(*m_queryPool,
+                                               static_cast<uint32_t>(slot) * QUERIES_PER_FRAME,
+                                               QUERIES_PER_FRAME,
+                                               QUERIES_PER_FRAME * sizeof(uint64_t),
+                                               sizeof(uint64_t),
+                                               vk::QueryResultFlagBits::e64);
+    if (result != vk::Result::eSuccess) {
+        return std::nullopt;
+    }
+    assert(timestamps.size() == QUERIES_PER_FRAME);
+    uint64_t ticks = (timestamps[1] - timestamps[0]) & m_timestampMask;
+    return static_cast<float>(ticks) * m_timestampPeriod / NANOSECONDS_PER_MILLISECOND;
+}
+
+}   // namespace renderer
@@ -0,0 +1,58 @@
+#ifndef RENDERER_GPU_FRAME_TIMER_HPP
+#define RENDERER_GPU_FRAME_TIMER_HPP
+
+// libs
+#include <vulkan/vulkan.hpp>
+
+// std
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+namespace renderer
+{
+
+// GPU time of whole frames, between timestamps written at the start and at the end of their command buffer. A pair of
+// queries per frame in flight, so a frame's time is read once the fence of its slot signaled
+class GpuFrameTimer
+{
+public:
+    GpuFrameTimer() noexcept = default;
+    // Unsupported, and never measuring, when the queue family has no timestamps
+    GpuFrameTimer(vk::Device device,
+                  vk::PhysicalDevice physicalDevice,
+                  uint32_t queueFamilyIndex,
+                  uint32_t framesInFlight);
+
+    GpuFrameTimer(const GpuFrameTimer&) = delete;
+    GpuFrameTimer& operator=(const GpuFrameTimer&) = delete;
+
+    GpuFrameTimer(GpuFrameTimer&&) noexcept = default;
+    GpuFrameTimer& operator=(GpuFrameTimer&&) noexcept = default;
+
+    ~GpuFrameTimer() noexcept = default;
+
+public:
+    bool supported() const noexcept { return static_cast<bool>(m_queryPool); }
+
+    // First and last commands of the frame's command buffer, outside of a rendering scope
+    void begin(vk::CommandBuffer commandBuffer, size_t frame);
+    void end(vk::CommandBuffer commandBuffer, size_t frame);
+
+    // In milliseconds, of the last frame recorded in the slot of the given frame. Must be called after waiting for
+    // that slot's fence, and before recording the frame. Nothing if no frame was measured in the slot
+    std::optional<float> read(size_t frame);
+
+private:
+    vk::Device m_device;   // not owned
+    vk::UniqueQueryPool m_queryPool;
+    uint32_t m_framesInFlight = 0;
+    uint64_t m_timestampMask = 0;      // of the valid bits
+    float m_timestampPeriod = 0.f;     // nanoseconds per tick
+    std::vector<uint8_t> m_measured;   // per slot
+};
+
+}   // namespace renderer
+
+#endif
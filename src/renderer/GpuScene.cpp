@@ -0,0 +1,220 @@
+#include "GpuScene.hpp"
+
+#include "DeletionQueue.hpp"
+#include "PushConstants.hpp"
+
+// std
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <iterator>
+#include <utility>
+
+namespace renderer
+{
+
+namespace
+{
+// As declared by frustum_cull.comp
+constexpr uint32_t OBJECTS_BINDING = 0;
+constexpr uint32_t INSTANCES_BINDING = 1;
+constexpr uint32_t DRAW_COMMANDS_BINDING = 2;
+constexpr uint32_t DRAW_COUNT_BINDING = 3;
+constexpr uint32_t DEPTH_PYRAMID_BINDING = 4;
+constexpr uint32_t VISIBILITY_BINDING = 5;
+constexpr uint32_t MESHLETS_BINDING = 6;
+// Guaranteed minimum of maxComputeWorkGroupCount, the workgroups of larger scenes are split in two dimensions
+constexpr uint32_t MAX_WORKGROUP_COUNT = 65535;
+
+void memoryBarrier(vk::CommandBuffer commandBuffer,
+                   vk::PipelineStageFlags2 srcStageMask,
+                   vk::AccessFlags2 srcAccessMask,
+                   vk::PipelineStageFlags2 dstStageMask,
+                   vk::AccessFlags2 dstAccessMask)
+{
+    vk::MemoryBarrier2 barrier {.sType = vk::StructureType::eMemoryBarrier2,
+                                .pNext = nullptr,
+                                .srcStageMask = srcStageMask,
+                                .srcAccessMask = srcAccessMask,
+                                .dstStageMask = dstStageMask,
+                                .dstAccessMask = dstAccessMask};
+
+    vk::DependencyInfo dependencyInfo {.sType = vk::StructureType::eDependencyInfo,
+                                       .pNext = nullptr,
+                                       .dependencyFlags = {},
+                                       .memoryBarrierCount = 1,
+                                       .pMemoryBarriers = &barrier,
+                                       .bufferMemoryBarrierCount = 0,
+                                       .pBufferMemoryBarriers = nullptr,
+                                       .imageMemoryBarrierCount = 0,
+                                       .pImageMemoryBarriers = nullptr};
+
+    commandBuffer.pipelineBarrier2(dependencyInfo);
+}
+}   // namespace
+
+GpuScene::GpuScene(vk::Device device,
+                   VmaAllocator allocator,
+                   vk::DescriptorSetLayout cullSetLayout,
+                   uint32_t objectCount,
+                   uint32_t meshletCount,
+                   uint32_t drawCount)
+    : m_device(device)
+    , m_cullSetLayout(cullSetLayout)
+    , m_objectCount(objectCount)
+    , m_maxDrawCount(drawCount)
+    , m_objectBuffer(allocator,
+                     objectCount * sizeof(GpuObject),
+                     vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferDst,
+                     0,
+                     VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE)
+    , m_meshletBuffer(allocator,
+                      meshletCount * sizeof(GpuMeshlet),
+                      vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferDst,
+                      0,
+                      VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE)
+    , m_instanceBuffer(allocator,
+                       objectCount * sizeof(InstanceData),
+                       vk::BufferUsageFlagBits::eVertexBuffer | vk::BufferUsageFlagBits::eStorageBuffer |
+                           vk::BufferUsageFlagBits::eTransferDst,
+                       0,
+                       VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE)
+    , m_drawCommandBuffer(allocator,
+                          drawCount * sizeof(vk::DrawIndexedIndirectCommand),
+                          vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eIndirectBuffer,
+                          0,
+                          VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE)
+    , m_drawCountBuffer(allocator,
+                        sizeof(uint32_t),
+                        vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eIndirectBuffer |
+                            vk::BufferUsageFlagBits::eTransferDst,
+                        0,
+                        VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE)
+    , m_visibilityBuffer(allocator,
+                         drawCount * sizeof(uint32_t),
+                         vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferDst,
+                         0,
+                         VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE)
+{
+    assert(objectCount > 0 && meshletCount > 0 && drawCount > 0);
+    createDescriptorSet();
+}
+
+void GpuScene::setDepthPyramid(const DepthPyramid& depthPyramid, size_t frame, DeletionQueue& deletionQueue)
+{
+    deletionQueue.retire(frame, std::move(m_descriptorPool));
+    createDescriptorSet();
+
+    vk::DescriptorImageInfo imageInfo {.sampler = depthPyramid.sampler(),
+                                       .imageView = depthPyramid.imageView(),
+                                       .imageLayout = vk::ImageLayout::eGeneral};
+
+    vk::WriteDescriptorSet descriptorWrite {.sType = vk::StructureType::eWriteDescriptorSet,
+                                           .pNext = nullptr,
+                                           .dstSet = m_descriptorSet,
+                                           .dstBinding = DEPTH_PYRAMID_BINDING,
+                                           .dstArrayElement = 0,
+                                           .descriptorCount = 1,
+                                           .descriptorType = vk::DescriptorType::eCombinedImageSampler,
+                                           .pImageInfo = &imageInfo,
+                                           .pBufferInfo = nullptr,
+                                           .pTexelBufferView = nullptr};
+    m_device.updateDescriptorSets(descriptorWrite, nullptr);
+}
+
+void GpuScene::createDescriptorSet()
+{
+    vk::DescriptorPoolSize poolSizes[] {
+        {        .type = vk::DescriptorType::eStorageBuffer, .descriptorCount = 6},
+        {.type = vk::DescriptorType::eCombinedImageSampler, .descriptorCount = 1}
+    };
+
+    vk::DescriptorPoolCreateInfo poolCreateInfo {.sType = vk::StructureType::eDescriptorPoolCreateInfo,
+                                                 .pNext = nullptr,
+                                                 .flags = {},
+                                                 .maxSets = 1,
+                                                 .poolSizeCount = std::size(poolSizes),
+                                                 .pPoolSizes = poolSizes};
+
+    m_descriptorPool = m_device.createDescriptorPoolUnique(poolCreateInfo);
+
+    vk::DescriptorSetAllocateInfo allocateInfo {.sType = vk::StructureType::eDescriptorSetAllocateInfo,
+                                                .pNext = nullptr,
+                                                .descriptorPool = *m_descriptorPool,
+                                                .descriptorSetCount = 1,
+                                                .pSetLayouts = &m_cullSetLayout};
+    m_descriptorSet = m_device.allocateDescriptorSets(allocateInfo)[0];
+
+    // The depth pyramid is written by setDepthPyramid
+    std::pair<uint32_t, vk::Buffer> buffers[] = {
+        {      OBJECTS_BINDING,      m_objectBuffer.buffer()},
+        {    INSTANCES_BINDING,    m_instanceBuffer.buffer()},
+        {DRAW_COMMANDS_BINDING, m_drawCommandBuffer.buffer()},
+        {   DRAW_COUNT_BINDING,   m_drawCountBuffer.buffer()},
+        {   VISIBILITY_BINDING,  m_visibilityBuffer.buffer()},
+        {     MESHLETS_BINDING,     m_meshletBuffer.buffer()}
+    };
+
+    std::array<vk::DescriptorBufferInfo, std::size(buffers)> bufferInfos;
+    std::array<vk::WriteDescriptorSet, std::size(buffers)> descriptorWrites;
+    for (size_t i = 0; i < std::size(buffers); ++i) {
+        bufferInfos[i] = {.buffer = buffers[i].second, .offset = 0, .range = vk::WholeSize};
+        descriptorWrites[i] = {.sType = vk::StructureType::eWriteDescriptorSet,
+                               .pNext = nullptr,
+                               .dstSet = m_descriptorSet,
+                               .dstBinding = buffers[i].first,
+                               .dstArrayElement = 0,
+                               .descriptorCount = 1,
+                               .descriptorType = vk::DescriptorType::eStorageBuffer,
+                               .pImageInfo = nullptr,
+                               .pBufferInfo = &bufferInfos[i],
+                               .pTexelBufferView = nullptr};
+    }
+    m_device.updateDescriptorSets(descriptorWrites, nullptr);
+}
+
+void GpuScene::cull(vk::CommandBuffer commandBuffer,
+                    vk::Pipeline cullPipeline,
+                    vk::PipelineLayout cullPipelineLayout,
+                    const glm::mat4& viewProj,
+                    const glm::vec3& cameraPosition,
+                    CullPhase phase,
+                    const DepthPyramid& depthPyramid) const
+{
+    commandBuffer.fillBuffer(m_drawCountBuffer.buffer(), 0, sizeof(uint32_t), 0);
+    memoryBarrier(commandBuffer,
+                  vk::PipelineStageFlagBits2::eTransfer,
+                  vk::AccessFlagBits2::eTransferWrite,
+                  vk::PipelineStageFlagBits2::eComputeShader,
+                  vk::AccessFlagBits2::eShaderStorageRead | vk::AccessFlagBits2::eShaderStorageWrite);
+
+    CullPushConstants constants {.viewProj = viewProj,
+                                 .cameraPosition = glm::vec4(cameraPosition, 1.f),
+                                 .pyramidSize = {depthPyramid.extent().width, depthPyramid.extent().height},
+                                 .pyramidLevels = depthPyramid.levelCount(),
+                                 .objectCount = m_objectCount,
+                                 .phase = phase};
+
+    commandBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, cullPipeline);
+    commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eCompute, cullPipelineLayout, 0, m_descriptorSet, nullptr);
+    pushConstants(commandBuffer, cullPipelineLayout, vk::ShaderStageFlagBits::eCompute, constants);
+    uint32_t groupCountX = std::min(m_objectCount, MAX_WORKGROUP_COUNT);
+    commandBuffer.dispatch(groupCountX, (m_objectCount + groupCountX - 1) / groupCountX, 1);
+}
+
+void GpuScene::draw(vk::CommandBuffer commandBuffer, const Mesh& mesh) const
+{
+    vk::Buffer vertexBuffers[] = {mesh.vertexBuffer(), m_instanceBuffer.buffer()};
+    vk::DeviceSize offsets[] = {0, 0};
+    commandBuffer.bindVertexBuffers(0, vertexBuffers, offsets);
+    commandBuffer.bindIndexBuffer(mesh.indexBuffer(), 0, vk::IndexType::eUint32);
+    commandBuffer.drawIndexedIndirectCount(m_drawCommandBuffer.buffer(),
+                                           0,
+                                           m_drawCountBuffer.buffer(),
+                                           0,
+                                           m_maxDrawCount,
+                                           sizeof(vk::DrawIndexedIndirectCommand));
+}
+
+}   // namespace renderer
@@ -0,0 +1,131 @@
+#ifndef RENDERER_GPU_SCENE_HPP
+#define RENDERER_GPU_SCENE_HPP
+
+#include "DepthPyramid.hpp"
+#include "Types.hpp"
+
+// libs
+#include <glm/glm.hpp>
+#include <vk_mem_alloc.h>
+#include <vulkan/vulkan.hpp>
+
+// std
+#include <cstddef>
+#include <cstdint>
+
+namespace renderer
+{
+class DeletionQueue;
+
+// Per object data of the culling pass, mirroring frustum_cull.comp. The object draws the index ranges of its meshlets,
+// with its vertex offset
+struct GpuObject {
+    glm::vec4 boundingSphere;   // model space center, and radius
+    uint32_t firstMeshlet;      // into the meshlet buffer, shared by the objects of a mesh
+    uint32_t meshletCount;
+    uint32_t firstVisibility;   // into the visibility buffer, with one entry per meshlet of the object
+    int32_t vertexOffset;
+};
+
+// Meshlet, mirroring frustum_cull.comp
+struct GpuMeshlet {
+    glm::vec4 boundingSphere;   // model space center, and radius
+    glm::vec4 cone;             // model space axis, and cutoff
+    uint32_t firstIndex;
+    uint32_t indexCount;
+    uint32_t padding0 = 0;
+    uint32_t padding1 = 0;
+};
+
+enum class CullPhase : uint32_t {
+    // Draws the meshlets visible in the previous frame, not tested against the depth pyramid
+    eEarly,
+    // Tests every meshlet against the depth pyramid built from the early draws, drawing those not drawn yet
+    eLate,
+};
+
+struct CullPushConstants {
+    glm::mat4 viewProj;
+    glm::vec4 cameraPosition;   // world space, for the normal cones
+    glm::uvec2 pyramidSize;     // of level 0
+    uint32_t pyramidLevels;
+    uint32_t objectCount;
+    CullPhase phase;
+};
+
+// Objects of a mesh uploaded once, then culled on the GPU every frame, first whole, then meshlet by meshlet against the
+// frustum, their normal cones and the occluders. Each culling phase writes a VkDrawIndexedIndirectCommand per visible
+// meshlet and their count, consumed by a single drawIndexedIndirectCount, so the CPU cost of a frame does not grow with
+// the number of objects, and hidden parts of large meshes are not drawn. Meshlets becoming visible are drawn by the
+// late phase of the same frame, so they never pop in a frame late
+class GpuScene
+{
+public:
+    GpuScene() noexcept = default;
+    // Only allocates the buffers on the device. objectBuffer, meshletBuffer and instanceBuffer still have to be filled
+    // with a staging buffer, with objectCount GpuObject and InstanceData and meshletCount GpuMeshlet, and
+    // visibilityBuffer with zeros. drawCount is the sum of the objects' meshlet counts. None may be 0
+    GpuScene(vk::Device device,
+             VmaAllocator allocator,
+             vk::DescriptorSetLayout cullSetLayout,
+             uint32_t objectCount,
+             uint32_t meshletCount,
+             uint32_t drawCount);
+
+    GpuScene(const GpuScene&) = delete;
+    GpuScene& operator=(const GpuScene&) = delete;
+
+    GpuScene(GpuScene&&) noexcept = default;
+    GpuScene& operator=(GpuScene&&) noexcept = default;
+
+    ~GpuScene() noexcept = default;
+
+public:
+    // Points the late phase at the pyramid, e.g. after it was recreated along with the swapchain. The descriptor set is
+    // replaced rather than rewritten, the previous one is retired as submitted frames may still use it
+    void setDepthPyramid(const DepthPyramid& depthPyramid, size_t frame, DeletionQueue& deletionQueue);
+
+    // Outside of rendering, before draw. Only orders its own clear of the draw count before the dispatch: the accesses
+    // to the draw command, draw count and visibility buffers, and to the pyramid by the late phase, are synchronized by
+    // the render graph. The late phase must follow DepthPyramid::build
+    void cull(vk::CommandBuffer commandBuffer,
+              vk::Pipeline cullPipeline,
+              vk::PipelineLayout cullPipelineLayout,
+              const glm::mat4& viewProj,
+              const glm::vec3& cameraPosition,
+              CullPhase phase,
+              const DepthPyramid& depthPyramid) const;
+
+    // The bound pipeline must be instanced, each object's transform being its instance data
+    void draw(vk::CommandBuffer commandBuffer, const Mesh& mesh) const;
+
+    vk::Buffer objectBuffer() const noexcept { return m_objectBuffer.buffer(); }
+    vk::Buffer meshletBuffer() const noexcept { return m_meshletBuffer.buffer(); }
+    vk::Buffer instanceBuffer() const noexcept { return m_instanceBuffer.buffer(); }
+    vk::Buffer drawCommandBuffer() const noexcept { return m_drawCommandBuffer.buffer(); }
+    vk::Buffer drawCountBuffer() const noexcept { return m_drawCountBuffer.buffer(); }
+    vk::Buffer visibilityBuffer() const noexcept { return m_visibilityBuffer.buffer(); }
+    uint32_t objectCount() const noexcept { return m_objectCount; }
+
+private:
+    // With every binding but the depth pyramid written
+    void createDescriptorSet();
+
+private:
+    vk::Device m_device;                       // not owned
+    vk::DescriptorSetLayout m_cullSetLayout;   // not owned
+    uint32_t m_objectCount = 0;
+    uint32_t m_maxDrawCount = 0;
+    AllocatedBuffer m_objectBuffer;
+    AllocatedBuffer m_meshletBuffer;
+    AllocatedBuffer m_instanceBuffer;      // also read by the culling pass
+    AllocatedBuffer m_drawCommandBuffer;   // room for every meshlet of every object
+    AllocatedBuffer m_drawCountBuffer;
+    AllocatedBuffer m_visibilityBuffer;    // whether each meshlet of each object passed the last late phase
+    vk::UniqueDescriptorPool m_descriptorPool;
+    vk::DescriptorSet m_descriptorSet;   // owned by the pool
+};
+
+}   // namespace renderer
+
+#endif
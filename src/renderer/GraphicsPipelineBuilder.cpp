@@ -8,22 +8,32 @@
 // libs
 #include <vulkan/vulkan_to_string.hpp>
 
+// std
+#include <vector>
+
 namespace renderer
 {
 
 GraphicsPipelineBuilder::GraphicsPipelineBuilder(const VulkanGraphicsContext& context) noexcept
-    : m_context(context)
+    : m_device(context.device())
+    , m_colorFormat(context.swapchainColorFormat())
+{}
+
+GraphicsPipelineBuilder::GraphicsPipelineBuilder(vk::Device device) noexcept
+    : m_device(device)
 {}
 
+void GraphicsPipelineBuilder::setShaders(std::span<const uint32_t> vertexShaderCode,
+                                         std::span<const uint32_t> fragmentShaderCode)
+{
+    m_vertShaderModule = utils::createUniqueShaderModule(m_device, vertexShaderCode);
+    m_fragShaderModule = utils::createUniqueShaderModule(m_device, fragmentShaderCode);
+}
+
 void GraphicsPipelineBuilder::setShaders(const std::filesystem::path& vertexShaderSourcePath,
                                          const std::filesystem::path& fragmentShaderSourcePath)
 {
-    auto vertShaderCode = utils::readFile(vertexShaderSourcePath);
-    auto fragShaderCode = utils::readFile(fragmentShaderSourcePath);
-
-    const auto& device = m_context.device();
-    m_vertShaderModule = utils::createUniqueShaderModule(device, vertShaderCode);
-    m_fragShaderModule = utils::createUniqueShaderModule(device, fragShaderCode);
+    setShaders(utils::readSpirv(vertexShaderSourcePath), utils::readSpirv(fragmentShaderSourcePath));
 }
 
 void GraphicsPipelineBuilder::setPipelineLayout(vk::PipelineLayout layout) noexcept
@@ -31,16 +41,98 @@ void GraphicsPipelineBuilder::setPipelineLayout(vk::PipelineLayout layout) noexc
     m_pipelineLayout = layout;
 }
 
+void GraphicsPipelineBuilder::setPipelineCache(vk::PipelineCache cache) noexcept
+{
+    m_pipelineCache = cache;
+}
+
+void GraphicsPipelineBuilder::setSpecializationConstants(const SpecializationConstants& constants)
+{
+    m_specializationConstants = constants;
+}
+
+void GraphicsPipelineBuilder::setColorFormat(vk::Format format) noexcept
+{
+    m_colorFormat = format;
+}
+
+void GraphicsPipelineBuilder::setDepthFormat(vk::Format format) noexcept
+{
+    m_depthFormat = format;
+}
+
+void GraphicsPipelineBuilder::setTopology(vk::PrimitiveTopology topology) noexcept
+{
+    m_topology = topology;
+}
+
+void GraphicsPipelineBuilder::setRasterization(vk::PolygonMode polygonMode,
+                                               vk::CullModeFlags cullMode,
+                                               vk::FrontFace frontFace) noexcept
+{
+    m_polygonMode = polygonMode;
+    m_cullMode = cullMode;
+    m_frontFace = frontFace;
+}
+
+void GraphicsPipelineBuilder::setRasterizerDiscard(bool enable) noexcept
+{
+    m_rasterizerDiscard = enable;
+}
+
+void GraphicsPipelineBuilder::setPrimitiveRestart(bool enable) noexcept
+{
+    m_primitiveRestart = enable;
+}
+
+void GraphicsPipelineBuilder::setDepthBias(bool enable, float constantFactor, float slopeFactor) noexcept
+{
+    m_depthBias = enable;
+    m_depthBiasConstantFactor = constantFactor;
+    m_depthBiasSlopeFactor = slopeFactor;
+}
+
+void GraphicsPipelineBuilder::setDepthTest(bool test, bool write, vk::CompareOp compareOp) noexcept
+{
+    m_depthTest = test;
+    m_depthWrite = write;
+    m_depthCompareOp = compareOp;
+}
+
+void GraphicsPipelineBuilder::setAlphaBlending(bool enable) noexcept
+{
+    m_alphaBlending = enable;
+}
+
+void GraphicsPipelineBuilder::setVertexInput(VertexInput vertexInput) noexcept
+{
+    m_vertexInput = vertexInput;
+}
+
+void GraphicsPipelineBuilder::setDynamicStateMode(DynamicStateMode mode) noexcept
+{
+    m_dynamicStateMode = mode;
+}
+
+void GraphicsPipelineBuilder::setCreateFlags(vk::PipelineCreateFlags flags) noexcept
+{
+    m_createFlags = flags;
+}
+
 vk::UniquePipeline GraphicsPipelineBuilder::build()
 {
     // Shaders
+    vk::SpecializationInfo specializationInfo = m_specializationConstants.info();
+    const vk::SpecializationInfo* pSpecializationInfo =
+        m_specializationConstants.empty() ? nullptr : &specializationInfo;
+
     vk::PipelineShaderStageCreateInfo vertShaderStageInfo {.sType = vk::StructureType::ePipelineShaderStageCreateInfo,
                                                            .pNext = nullptr,
                                                            .flags = {},
                                                            .stage = vk::ShaderStageFlagBits::eVertex,
                                                            .module = *m_vertShaderModule,
                                                            .pName = "main",
-                                                           .pSpecializationInfo = nullptr};
+                                                           .pSpecializationInfo = pSpecializationInfo};
 
     vk::PipelineShaderStageCreateInfo fragShaderStageInfo {.sType = vk::StructureType::ePipelineShaderStageCreateInfo,
                                                            .pNext = nullptr,
@@ -48,20 +140,36 @@ vk::UniquePipeline GraphicsPipelineBuilder::build()
                                                            .stage = vk::ShaderStageFlagBits::eFragment,
                                                            .module = *m_fragShaderModule,
                                                            .pName = "main",
-                                                           .pSpecializationInfo = nullptr};
+                                                           .pSpecializationInfo = pSpecializationInfo};
 
     vk::PipelineShaderStageCreateInfo shaderStagesCreateInfos[] = {vertShaderStageInfo, fragShaderStageInfo};
 
     // Vertex input
-    auto bindingDescription = Vertex::bindingDescription();
-    auto attributeDescriptions = Vertex::attributeDescriptions();
+    std::vector<vk::VertexInputBindingDescription> bindingDescriptions;
+    std::vector<vk::VertexInputAttributeDescription> attributeDescriptions;
+    auto addBinding = [&](const vk::VertexInputBindingDescription& binding, const auto& attributes) {
+        bindingDescriptions.push_back(binding);
+        attributeDescriptions.insert(attributeDescriptions.end(), attributes.begin(), attributes.end());
+    };
+    switch (m_vertexInput) {
+        case VertexInput::eVertex: addBinding(Vertex::bindingDescription(), Vertex::attributeDescriptions()); break;
+        case VertexInput::eVertexInstanced:
+            addBinding(Vertex::bindingDescription(), Vertex::attributeDescriptions());
+            addBinding(InstanceData::bindingDescription(), InstanceData::attributeDescriptions());
+            break;
+        case VertexInput::eSprite:
+            addBinding(SpriteInstance::bindingDescription(), SpriteInstance::attributeDescriptions());
+            break;
+        case VertexInput::eNone: break;
+        default: break;
+    }
 
     vk::PipelineVertexInputStateCreateInfo vertexInputCreateInfo {
         .sType = vk::StructureType::ePipelineVertexInputStateCreateInfo,
         .pNext = nullptr,
         .flags = {},
-        .vertexBindingDescriptionCount = 1,
-        .pVertexBindingDescriptions = &bindingDescription,
+        .vertexBindingDescriptionCount = static_cast<uint32_t>(bindingDescriptions.size()),
+        .pVertexBindingDescriptions = bindingDescriptions.data(),
         .vertexAttributeDescriptionCount = static_cast<uint32_t>(attributeDescriptions.size()),
         .pVertexAttributeDescriptions = attributeDescriptions.data()};
 
@@ -70,18 +178,37 @@ vk::UniquePipeline GraphicsPipelineBuilder::build()
         .sType = vk::StructureType::ePipelineInputAssemblyStateCreateInfo,
         .pNext = nullptr,
         .flags = {},
-        .topology = vk::PrimitiveTopology::eTriangleList,
-        .primitiveRestartEnable = vk::False};
+        .topology = m_topology,
+        .primitiveRestartEnable = m_primitiveRestart ? vk::True : vk::False};
 
     // Dynamic states
-    vk::DynamicState dynamicStates[] = {vk::DynamicState::eViewport, vk::DynamicState::eScissor};
+    std::vector<vk::DynamicState> dynamicStates = {vk::DynamicState::eViewport, vk::DynamicState::eScissor};
+    if (m_dynamicStateMode != DynamicStateMode::eBaked) {
+        dynamicStates.insert(dynamicStates.end(),
+                             {vk::DynamicState::eCullMode,
+                              vk::DynamicState::eFrontFace,
+                              vk::DynamicState::ePrimitiveTopology,
+                              vk::DynamicState::eDepthTestEnable,
+                              vk::DynamicState::eDepthWriteEnable,
+                              vk::DynamicState::eDepthCompareOp,
+                              vk::DynamicState::eDepthBiasEnable,
+                              vk::DynamicState::eDepthBias,
+                              vk::DynamicState::ePrimitiveRestartEnable,
+                              vk::DynamicState::eRasterizerDiscardEnable});
+    }
+    if (m_dynamicStateMode == DynamicStateMode::eExtended3) {
+        dynamicStates.insert(dynamicStates.end(),
+                             {vk::DynamicState::ePolygonModeEXT,
+                              vk::DynamicState::eColorBlendEnableEXT,
+                              vk::DynamicState::eColorBlendEquationEXT});
+    }
 
-    vk::PipelineDynamicStateCreateInfo dynamicStateCreateInfo {.sType =
-                                                                   vk::StructureType::ePipelineDynamicStateCreateInfo,
-                                                               .pNext = nullptr,
-                                                               .flags = {},
-                                                               .dynamicStateCount = std::size(dynamicStates),
-                                                               .pDynamicStates = dynamicStates};
+    vk::PipelineDynamicStateCreateInfo dynamicStateCreateInfo {
+        .sType = vk::StructureType::ePipelineDynamicStateCreateInfo,
+        .pNext = nullptr,
+        .flags = {},
+        .dynamicStateCount = static_cast<uint32_t>(dynamicStates.size()),
+        .pDynamicStates = dynamicStates.data()};
 
     // Viewport state
     vk::PipelineViewportStateCreateInfo viewportStateCreateInfo {
@@ -99,14 +226,14 @@ vk::UniquePipeline GraphicsPipelineBuilder::build()
         .pNext = nullptr,
         .flags = {},
         .depthClampEnable = vk::False,
-        .rasterizerDiscardEnable = vk::False,
-        .polygonMode = vk::PolygonMode::eFill,
-        .cullMode = vk::CullModeFlagBits::eBack,
-        .frontFace = vk::FrontFace::eCounterClockwise,
-        .depthBiasEnable = vk::False,
-        .depthBiasConstantFactor = 0.f,
+        .rasterizerDiscardEnable = m_rasterizerDiscard ? vk::True : vk::False,
+        .polygonMode = m_polygonMode,
+        .cullMode = m_cullMode,
+        .frontFace = m_frontFace,
+        .depthBiasEnable = m_depthBias ? vk::True : vk::False,
+        .depthBiasConstantFactor = m_depthBiasConstantFactor,
         .depthBiasClamp = 0.f,
-        .depthBiasSlopeFactor = 0.f,
+        .depthBiasSlopeFactor = m_depthBiasSlopeFactor,
         .lineWidth = 1.f};
 
     // Multisampling
@@ -121,14 +248,29 @@ vk::UniquePipeline GraphicsPipelineBuilder::build()
         .alphaToCoverageEnable = vk::False,
         .alphaToOneEnable = vk::False};
 
+    // Depth
+    vk::PipelineDepthStencilStateCreateInfo depthStencilStateCreateInfo {
+        .sType = vk::StructureType::ePipelineDepthStencilStateCreateInfo,
+        .pNext = nullptr,
+        .flags = {},
+        .depthTestEnable = m_depthTest ? vk::True : vk::False,
+        .depthWriteEnable = m_depthWrite ? vk::True : vk::False,
+        .depthCompareOp = m_depthCompareOp,
+        .depthBoundsTestEnable = vk::False,
+        .stencilTestEnable = vk::False,
+        .front = {},
+        .back = {},
+        .minDepthBounds = 0.f,
+        .maxDepthBounds = 1.f};
+
     // Color Blending
     vk::PipelineColorBlendAttachmentState colorBlendAttachment {
-        .blendEnable = vk::False,
+        .blendEnable = m_alphaBlending ? vk::True : vk::False,
         .srcColorBlendFactor = vk::BlendFactor::eOne,
-        .dstColorBlendFactor = vk::BlendFactor::eZero,
+        .dstColorBlendFactor = m_alphaBlending ? vk::BlendFactor::eOneMinusSrcAlpha : vk::BlendFactor::eZero,
         .colorBlendOp = vk::BlendOp::eAdd,
         .srcAlphaBlendFactor = vk::BlendFactor::eOne,
-        .dstAlphaBlendFactor = vk::BlendFactor::eZero,
+        .dstAlphaBlendFactor = m_alphaBlending ? vk::BlendFactor::eOneMinusSrcAlpha : vk::BlendFactor::eZero,
         .alphaBlendOp = vk::BlendOp::eAdd,
         .colorWriteMask = vk::ColorComponentFlagBits::eR | vk::ColorComponentFlagBits::eG |
                           vk::ColorComponentFlagBits::eB | vk::ColorComponentFlagBits::eA};
@@ -144,19 +286,21 @@ vk::UniquePipeline GraphicsPipelineBuilder::build()
         .blendConstants = {{0.f, 0.f, 0.f, 0.f}}};
 
     // Rendering Create Info (dynamic rendering, Vulkan 1.3+)
-    vk::Format colorFormat = m_context.swapchainColorFormat();
     vk::PipelineRenderingCreateInfo renderingCreateInfo {.sType = vk::StructureType::ePipelineRenderingCreateInfo,
                                                          .pNext = nullptr,
                                                          .viewMask = 0,
                                                          .colorAttachmentCount = 1,
-                                                         .pColorAttachmentFormats = &colorFormat,
-                                                         .depthAttachmentFormat = vk::Format::eUndefined,
-                                                         .stencilAttachmentFormat = vk::Format::eUndefined};
+                                                         .pColorAttachmentFormats = &m_colorFormat,
+                                                         .depthAttachmentFormat = m_depthFormat,
+                                                         .stencilAttachmentFormat =
+                                                             utils::hasStencilComponent(m_depthFormat)
+                                                                 ? m_depthFormat
+                                                                 : vk::Format::eUndefined};
 
     // Graphics pipeline
     vk::GraphicsPipelineCreateInfo pipelineCreateInfo {.sType = vk::StructureType::eGraphicsPipelineCreateInfo,
                                                        .pNext = &renderingCreateInfo,
-                                                       .flags = {},
+                                                       .flags = m_createFlags,
                                                        .stageCount = std::size(shaderStagesCreateInfos),
                                                        .pStages = shaderStagesCreateInfos,
                                                        .pVertexInputState = &vertexInputCreateInfo,
@@ -165,7 +309,7 @@ vk::UniquePipeline GraphicsPipelineBuilder::build()
                                                        .pViewportState = &viewportStateCreateInfo,
                                                        .pRasterizationState = &rasterizationStateCreateInfo,
                                                        .pMultisampleState = &multisampleStateCreateInfo,
-                                                       .pDepthStencilState = nullptr,
+                                                       .pDepthStencilState = &depthStencilStateCreateInfo,
                                                        .pColorBlendState = &colorBlendStateCreateInfo,
                                                        .pDynamicState = &dynamicStateCreateInfo,
                                                        .layout = m_pipelineLayout,
@@ -174,11 +318,14 @@ vk::UniquePipeline GraphicsPipelineBuilder::build()
                                                        .basePipelineHandle = nullptr,
                                                        .basePipelineIndex = -1};
 
-    auto res = m_context.device().createGraphicsPipelineUnique(nullptr, pipelineCreateInfo);
+    auto res = m_device.createGraphicsPipelineUnique(m_pipelineCache, pipelineCreateInfo);
 
     if (res.result == vk::Result::eSuccess) {
         return std::move(res.value);
     }
+    if (res.result == vk::Result::ePipelineCompileRequired) {
+        return vk::UniquePipeline();
+    }
 
     FATAL_FMT("Graphics pipeline failed with result {}\n", vk::to_string(res.result));
     assert(0);
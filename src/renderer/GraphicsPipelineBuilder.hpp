@@ -1,21 +1,48 @@
 #ifndef RENDERER_GRAPHICS_PIPELINE_BUILDER_HPP
 #define RENDERER_GRAPHICS_PIPELINE_BUILDER_HPP
 
+#include "SpecializationConstants.hpp"
+
 // libs
 #include <vulkan/vulkan.hpp>
 
 // std
+#include <cstdint>
 #include <filesystem>
+#include <span>
 
 namespace renderer
 {
 class VulkanGraphicsContext;
 
+// The states left to the command buffer instead of being baked into the pipeline, besides viewport and scissor. Each
+// mode includes the previous ones
+enum class DynamicStateMode {
+    eBaked,
+    // Cull mode, front face, primitive topology within its class, depth test, depth bias, primitive restart and
+    // rasterizer discard, core in Vulkan 1.3
+    eExtended,
+    // Polygon mode, color blend enable and equation, with VK_EXT_extended_dynamic_state3
+    eExtended3,
+};
+
+// The vertex buffers a pipeline reads
+enum class VertexInput {
+    eVertex,            // Vertex at binding 0
+    eVertexInstanced,   // and InstanceData at binding 1
+    eSprite,            // SpriteInstance at binding 0, the shader builds the quad from the vertex index
+    eNone,              // no vertex buffer, as fullscreen passes
+};
+
+// Only keeps handles copied from the context, so it can be used on a worker thread while the context changes
 class GraphicsPipelineBuilder
 {
 public:
     GraphicsPipelineBuilder() = delete;
+    // Targets the swapchain color format
     explicit GraphicsPipelineBuilder(const VulkanGraphicsContext& context) noexcept;
+    // The color format must be set
+    explicit GraphicsPipelineBuilder(vk::Device device) noexcept;
 
     GraphicsPipelineBuilder(const GraphicsPipelineBuilder&) = delete;
     GraphicsPipelineBuilder& operator=(const GraphicsPipelineBuilder&) = delete;
@@ -26,19 +53,67 @@ public:
     ~GraphicsPipelineBuilder() noexcept = default;
 
 public:
+    void setShaders(std::span<const uint32_t> vertexShaderCode, std::span<const uint32_t> fragmentShaderCode);
+    // Reads the SPIR-V from disk, for hot reloading
     void setShaders(const std::filesystem::path& vertexShaderSourcePath,
                     const std::filesystem::path& fragmentShaderSourcePath);
 
     void setPipelineLayout(vk::PipelineLayout layout) noexcept;
 
-    // TODO: add more supported color formats to the pipeline instead of only using the current swapchain format
+    // Optional, shared between builders and threads
+    void setPipelineCache(vk::PipelineCache cache) noexcept;
+
+    // Applied to both stages
+    void setSpecializationConstants(const SpecializationConstants& constants);
+
+    void setColorFormat(vk::Format format) noexcept;
+    // eUndefined without a depth attachment. Formats with stencil are also used as the stencil attachment format
+    void setDepthFormat(vk::Format format) noexcept;
+    void setTopology(vk::PrimitiveTopology topology) noexcept;
+    void setRasterization(vk::PolygonMode polygonMode, vk::CullModeFlags cullMode, vk::FrontFace frontFace) noexcept;
+    void setRasterizerDiscard(bool enable) noexcept;
+    void setPrimitiveRestart(bool enable) noexcept;
+    // Unclamped, the factors are only applied when enabled
+    void setDepthBias(bool enable, float constantFactor, float slopeFactor) noexcept;
+    // Reverse-Z compares with eGreater
+    void setDepthTest(bool test, bool write, vk::CompareOp compareOp) noexcept;
+    // Premultiplied alpha blending when enabled
+    void setAlphaBlending(bool enable) noexcept;
+    void setVertexInput(VertexInput vertexInput) noexcept;
+    // The baked values of the dynamic states are ignored
+    void setDynamicStateMode(DynamicStateMode mode) noexcept;
+
+    // e.g. vk::PipelineCreateFlagBits::eFailOnPipelineCompileRequired
+    void setCreateFlags(vk::PipelineCreateFlags flags) noexcept;
+
+    // Null if eFailOnPipelineCompileRequired is set and the pipeline is not in the pipeline cache
     vk::UniquePipeline build();
 
 private:
-    const VulkanGraphicsContext& m_context;
+    vk::Device m_device;   // not owned
+    vk::Format m_colorFormat = vk::Format::eUndefined;
+    vk::Format m_depthFormat = vk::Format::eUndefined;
+    vk::PrimitiveTopology m_topology = vk::PrimitiveTopology::eTriangleList;
+    vk::PolygonMode m_polygonMode = vk::PolygonMode::eFill;
+    vk::CullModeFlags m_cullMode = vk::CullModeFlagBits::eBack;
+    vk::FrontFace m_frontFace = vk::FrontFace::eCounterClockwise;
+    bool m_rasterizerDiscard = false;
+    bool m_primitiveRestart = false;
+    bool m_depthBias = false;
+    float m_depthBiasConstantFactor = 0.f;
+    float m_depthBiasSlopeFactor = 0.f;
+    bool m_depthTest = false;
+    bool m_depthWrite = false;
+    vk::CompareOp m_depthCompareOp = vk::CompareOp::eAlways;
+    bool m_alphaBlending = false;
+    VertexInput m_vertexInput = VertexInput::eVertex;
+    DynamicStateMode m_dynamicStateMode = DynamicStateMode::eBaked;
+    vk::PipelineCreateFlags m_createFlags;
+    SpecializationConstants m_specializationConstants;
     vk::UniqueShaderModule m_vertShaderModule;
     vk::UniqueShaderModule m_fragShaderModule;
     vk::PipelineLayout m_pipelineLayout;   // not owned
+    vk::PipelineCache m_pipelineCache;     // not owned
 };
 
 }   // namespace renderer
@@ -7,11 +7,15 @@ namespace renderer
 Allocated2DImage::Allocated2DImage(VmaAllocator allocator,
                                    vk::Format format,
                                    const vk::Extent2D& extent,
+                                   uint32_t mipLevels,
                                    vk::ImageTiling tiling,
                                    vk::ImageUsageFlags usage,
                                    VmaAllocatorCreateFlags allocationFlags,
                                    VmaMemoryUsage memoryUsage)
     : m_allocator(allocator)
+    , m_format(format)
+    , m_extent(extent)
+    , m_mipLevels(mipLevels)
 {
     vk::ImageCreateInfo imageCreateInfo {
         .sType = vk::StructureType::eImageCreateInfo,
@@ -20,7 +24,7 @@ Allocated2DImage::Allocated2DImage(VmaAllocator allocator,
         .imageType = vk::ImageType::e2D,
         .format = format,
         .extent = {.width = extent.width, .height = extent.height, .depth = 1},
-        .mipLevels = 1,
+        .mipLevels = mipLevels,
         .arrayLayers = 1,
         .samples = vk::SampleCountFlagBits::e1,
         .tiling = tiling,
@@ -54,6 +58,9 @@ Allocated2DImage::Allocated2DImage(Allocated2DImage&& rhs) noexcept
     : m_allocator(std::exchange(rhs.m_allocator, nullptr))
     , m_allocation(rhs.m_allocation)
     , m_image(rhs.m_image)
+    , m_format(rhs.m_format)
+    , m_extent(rhs.m_extent)
+    , m_mipLevels(rhs.m_mipLevels)
 {}
 
 Allocated2DImage& Allocated2DImage::operator=(Allocated2DImage&& rhs) noexcept
@@ -62,6 +69,9 @@ Allocated2DImage& Allocated2DImage::operator=(Allocated2DImage&& rhs) noexcept
         std::swap(m_allocator, rhs.m_allocator);
         std::swap(m_allocation, rhs.m_allocation);
         std::swap(m_image, rhs.m_image);
+        std::swap(m_format, rhs.m_format);
+        std::swap(m_extent, rhs.m_extent);
+        std::swap(m_mipLevels, rhs.m_mipLevels);
     }
     return *this;
 }
@@ -72,16 +82,13 @@ Allocated2DImage::~Allocated2DImage() noexcept
         vmaDestroyImage(m_allocator, m_image, m_allocation);
     }
 }
-// End Allocated2DImage
 
-// Begin AllocatedTexture
-AllocatedTexture::AllocatedTexture(std::shared_ptr<const Allocated2DImage> image,
-                                   vk::UniqueImageView imageView,
-                                   vk::DescriptorSet descriptor)
-    : m_image(std::move(image))
-    , m_imageView(std::move(imageView))
-    , m_descriptor(descriptor)
-{}
-// End AllocatedTexture
+VmaAllocationInfo Allocated2DImage::allocationInfo() const noexcept
+{
+    VmaAllocationInfo allocationInfo;
+    vmaGetAllocationInfo(m_allocator, m_allocation, &allocationInfo);
+    return allocationInfo;
+}
+// End Allocated2DImage
 
 }   // namespace renderer
@@ -6,6 +6,7 @@
 #include <vulkan/vulkan.hpp>
 
 // std
+#include <cstdint>
 #include <memory>
 
 namespace renderer
@@ -18,6 +19,7 @@ public:
     Allocated2DImage(VmaAllocator allocator,
                      vk::Format format,
                      const vk::Extent2D& extent,
+                     uint32_t mipLevels,
                      vk::ImageTiling tiling,
                      vk::ImageUsageFlags usage,
                      VmaAllocatorCreateFlags allocationFlags,
@@ -33,38 +35,18 @@ public:
 
 public:
     vk::Image image() const noexcept { return m_image; }
+    vk::Format format() const noexcept { return m_format; }
+    vk::Extent2D extent() const noexcept { return m_extent; }
+    uint32_t mipLevels() const noexcept { return m_mipLevels; }
+    VmaAllocationInfo allocationInfo() const noexcept;
 
 private:
     VmaAllocator m_allocator = nullptr;   // not owned
     VmaAllocation m_allocation;
     vk::Image m_image;
-};
-
-class AllocatedTexture
-{
-public:
-    AllocatedTexture() noexcept = default;
-    AllocatedTexture(std::shared_ptr<const Allocated2DImage> image,
-                     vk::UniqueImageView imageView,
-                     vk::DescriptorSet descriptor);
-
-    AllocatedTexture(const AllocatedTexture&) = delete;
-    AllocatedTexture& operator=(const AllocatedTexture&) = delete;
-
-    AllocatedTexture(AllocatedTexture&&) noexcept = default;
-    AllocatedTexture& operator=(AllocatedTexture&&) noexcept = default;
-
-    ~AllocatedTexture() noexcept = default;
-
-public:
-    vk::Image image() const noexcept { return m_image->image(); }
-    vk::ImageView imageView() const noexcept { return *m_imageView; }
-    vk::DescriptorSet descriptor() const noexcept { return m_descriptor; }
-
-private:
-    std::shared_ptr<const Allocated2DImage> m_image;
-    vk::UniqueImageView m_imageView;
-    vk::DescriptorSet m_descriptor;   // owned by the pool;
+    vk::Format m_format;
+    vk::Extent2D m_extent;
+    uint32_t m_mipLevels;
 };
 
 }   // namespace renderer
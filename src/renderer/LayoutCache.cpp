@@ -0,0 +1,93 @@
+#include "LayoutCache.hpp"
+
+#include "DescriptorSetLayoutBuilder.hpp"
+#include "PipelineLayoutBuilder.hpp"
+#include "ShaderReflection.hpp"
+#include "core/Hash.hpp"
+
+// std
+#include <cstdint>
+#include <utility>
+
+namespace renderer
+{
+
+namespace
+{
+template <typename T>
+std::span<const std::byte> bytesOf(const T& value) noexcept
+{
+    return std::as_bytes(std::span(&value, 1));
+}
+}   // namespace
+
+size_t LayoutCache::BindingsHash::operator()(const std::vector<vk::DescriptorSetLayoutBinding>& bindings) const noexcept
+{
+    // Field by field, the structure has padding
+    uint64_t hash = core::FNV1A_64_OFFSET_BASIS;
+    for (const auto& binding : bindings) {
+        hash = core::fnv1a64(bytesOf(binding.binding), hash);
+        hash = core::fnv1a64(bytesOf(binding.descriptorType), hash);
+        hash = core::fnv1a64(bytesOf(binding.descriptorCount), hash);
+        hash = core::fnv1a64(bytesOf(binding.stageFlags), hash);
+    }
+    return hash;
+}
+
+size_t LayoutCache::PipelineLayoutKeyHash::operator()(const PipelineLayoutKey& key) const noexcept
+{
+    uint64_t hash = core::fnv1a64(std::as_bytes(std::span(key.setLayouts)));
+    for (const auto& range : key.pushConstantRanges) {
+        hash = core::fnv1a64(bytesOf(range.stageFlags), hash);
+        hash = core::fnv1a64(bytesOf(range.offset), hash);
+        hash = core::fnv1a64(bytesOf(range.size), hash);
+    }
+    return hash;
+}
+
+LayoutCache::LayoutCache(vk::Device device, uint32_t maxPushConstantsSize) noexcept
+    : m_device(device)
+    , m_maxPushConstantsSize(maxPushConstantsSize)
+{}
+
+vk::DescriptorSetLayout LayoutCache::descriptorSetLayout(std::span<const vk::DescriptorSetLayoutBinding> bindings)
+{
+    std::vector<vk::DescriptorSetLayoutBinding> key(bindings.begin(), bindings.end());
+    auto it = m_descriptorSetLayouts.find(key);
+    if (it != m_descriptorSetLayouts.end()) {
+        return *it->second;
+    }
+
+    DescriptorSetLayoutBuilder builder(m_device);
+    for (const auto& binding : bindings) {
+        builder.addBinding(binding.binding, binding.descriptorType, binding.descriptorCount, binding.stageFlags);
+    }
+    return *m_descriptorSetLayouts.emplace(std::move(key), builder.build()).first->second;
+}
+
+vk::PipelineLayout LayoutCache::pipelineLayout(const std::vector<vk::DescriptorSetLayout>& setLayouts,
+                                               const std::vector<vk::PushConstantRange>& pushConstantRanges)
+{
+    PipelineLayoutKey key {.setLayouts = setLayouts, .pushConstantRanges = pushConstantRanges};
+    auto it = m_pipelineLayouts.find(key);
+    if (it != m_pipelineLayouts.end()) {
+        return *it->second;
+    }
+
+    PipelineLayoutBuilder builder(m_device, m_maxPushConstantsSize);
+    builder.setDescriptorSetLayouts(setLayouts);
+    builder.setPushConstantRanges(pushConstantRanges);
+    return *m_pipelineLayouts.emplace(std::move(key), builder.build()).first->second;
+}
+
+vk::PipelineLayout LayoutCache::pipelineLayout(const ShaderReflection& reflection)
+{
+    std::vector<vk::DescriptorSetLayout> setLayouts;
+    setLayouts.reserve(reflection.descriptorSets.size());
+    for (const auto& bindings : reflection.descriptorSets) {
+        setLayouts.push_back(descriptorSetLayout(bindings));
+    }
+    return pipelineLayout(setLayouts, reflection.pushConstantRanges);
+}
+
+}   // namespace renderer
@@ -0,0 +1,74 @@
+#ifndef RENDERER_LAYOUT_CACHE_HPP
+#define RENDERER_LAYOUT_CACHE_HPP
+
+// libs
+#include <vulkan/vulkan.hpp>
+
+// std
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+namespace renderer
+{
+struct ShaderReflection;
+
+// Shares the descriptor set and pipeline layouts of every pipeline declaring the same interface. The layouts live as
+// long as the cache
+class LayoutCache
+{
+public:
+    LayoutCache() noexcept = default;
+    // Pipeline layouts are validated against maxPushConstantsSize, see PipelineLayoutBuilder::build
+    LayoutCache(vk::Device device, uint32_t maxPushConstantsSize) noexcept;
+
+    LayoutCache(const LayoutCache&) = delete;
+    LayoutCache& operator=(const LayoutCache&) = delete;
+
+    LayoutCache(LayoutCache&&) noexcept = default;
+    LayoutCache& operator=(LayoutCache&&) noexcept = default;
+
+    ~LayoutCache() noexcept = default;
+
+public:
+    // bindings must be sorted by binding number, as they are compared in order
+    vk::DescriptorSetLayout descriptorSetLayout(std::span<const vk::DescriptorSetLayoutBinding> bindings);
+
+    vk::PipelineLayout pipelineLayout(const std::vector<vk::DescriptorSetLayout>& setLayouts,
+                                      const std::vector<vk::PushConstantRange>& pushConstantRanges);
+    // With a set layout for every set up to the last one declared, the undeclared ones being empty
+    vk::PipelineLayout pipelineLayout(const ShaderReflection& reflection);
+
+    size_t descriptorSetLayoutCount() const noexcept { return m_descriptorSetLayouts.size(); }
+    size_t pipelineLayoutCount() const noexcept { return m_pipelineLayouts.size(); }
+
+private:
+    struct PipelineLayoutKey {
+        std::vector<vk::DescriptorSetLayout> setLayouts;
+        std::vector<vk::PushConstantRange> pushConstantRanges;
+
+        bool operator==(const PipelineLayoutKey&) const = default;
+    };
+
+    struct BindingsHash {
+        size_t operator()(const std::vector<vk::DescriptorSetLayoutBinding>& bindings) const noexcept;
+    };
+
+    struct PipelineLayoutKeyHash {
+        size_t operator()(const PipelineLayoutKey& key) const noexcept;
+    };
+
+private:
+    vk::Device m_device;   // not owned
+    uint32_t m_maxPushConstantsSize = 0;
+    // Before the pipeline layouts, which are created from them
+    std::unordered_map<std::vector<vk::DescriptorSetLayoutBinding>, vk::UniqueDescriptorSetLayout, BindingsHash>
+        m_descriptorSetLayouts;
+    std::unordered_map<PipelineLayoutKey, vk::UniquePipelineLayout, PipelineLayoutKeyHash> m_pipelineLayouts;
+};
+
+}   // namespace renderer
+
+#endif
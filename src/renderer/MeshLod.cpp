@@ -0,0 +1,382 @@
+#include "MeshLod.hpp"
+
+#include "MeshOptimizer.hpp"
+#include "core/Hash.hpp"
+
+// std
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <unordered_map>
+
+namespace renderer
+{
+
+namespace
+{
+// Fraction of LOD_PIXEL_ERROR under which a coarser LOD is taken
+constexpr float LOD_HYSTERESIS = 0.75f;
+// A LOD removing less than this fraction of the previous one is not worth its memory
+constexpr float LOD_MIN_REDUCTION = 0.15f;
+constexpr size_t LOD_MIN_INDICES = 3 * 64;
+constexpr float LOD_MAX_ERROR = 0.05f;
+
+// Symmetric 4x4 matrix, accumulating area weighted squared distances to planes
+struct Quadric {
+    double xx = 0., xy = 0., xz = 0., xw = 0.;
+    double yy = 0., yz = 0., yw = 0.;
+    double zz = 0., zw = 0.;
+    double ww = 0.;
+    double weight = 0.;
+
+    static Quadric fromPlane(const glm::dvec3& normal, double distance, double weight) noexcept
+    {
+        Quadric q;
+        q.xx = normal.x * normal.x * weight;
+        q.xy = normal.x * normal.y * weight;
+        q.xz = normal.x * normal.z * weight;
+        q.xw = normal.x * distance * weight;
+        q.yy = normal.y * normal.y * weight;
+        q.yz = normal.y * normal.z * weight;
+        q.yw = normal.y * distance * weight;
+        q.zz = normal.z * normal.z * weight;
+        q.zw = normal.z * distance * weight;
+        q.ww = distance * distance * weight;
+        q.weight = weight;
+        return q;
+    }
+
+    Quadric& operator+=(const Quadric& rhs) noexcept
+    {
+        xx += rhs.xx, xy += rhs.xy, xz += rhs.xz, xw += rhs.xw;
+        yy += rhs.yy, yz += rhs.yz, yw += rhs.yw;
+        zz += rhs.zz, zw += rhs.zw;
+        ww += rhs.ww;
+        weight += rhs.weight;
+        return *this;
+    }
+
+    // Mean squared distance of p to the accumulated planes
+    double error(const glm::dvec3& p) const noexcept
+    {
+        double value = xx * p.x * p.x + 2. * xy * p.x * p.y + 2. * xz * p.x * p.z + 2. * xw * p.x + yy * p.y * p.y +
+                       2. * yz * p.y * p.z + 2. * yw * p.y + zz * p.z * p.z + 2. * zw * p.z + ww;
+        return weight > 0. ? std::max(value, 0.) / weight : 0.;
+    }
+};
+
+struct Collapse {
+    uint32_t from;
+    uint32_t to;
+    double error;
+};
+
+uint64_t edgeKey(uint32_t a, uint32_t b) noexcept
+{
+    return (static_cast<uint64_t>(a) << 32) | b;
+}
+
+struct PositionHash {
+    size_t operator()(const glm::vec3& position) const noexcept
+    {
+        return core::fnv1a64(std::as_bytes(std::span(&position, 1)));
+    }
+};
+
+struct PositionEqual {
+    bool operator()(const glm::vec3& lhs, const glm::vec3& rhs) const noexcept
+    {
+        return std::memcmp(&lhs, &rhs, sizeof(glm::vec3)) == 0;
+    }
+};
+
+// Vertices sharing their position with another vertex are on an attribute seam, and vertices on an edge used by a
+// single triangle, or by more than two, are on a border. Collapsing either would open holes
+std::vector<bool> findLockedVertices(std::span<const uint32_t> indices, std::span<const Vertex> vertices)
+{
+    std::vector<bool> locked(vertices.size(), false);
+
+    std::unordered_map<glm::vec3, uint32_t, PositionHash, PositionEqual> firstWithPosition;
+    firstWithPosition.reserve(vertices.size());
+    std::vector<uint32_t> canonical(vertices.size());
+    for (uint32_t v = 0; v < vertices.size(); ++v) {
+        auto [it, inserted] = firstWithPosition.try_emplace(vertices[v].pos, v);
+        canonical[v] = it->second;
+        if (!inserted) {
+            locked[v] = true;
+            locked[it->second] = true;
+        }
+    }
+
+    std::unordered_map<uint64_t, uint32_t> directedEdges;
+    directedEdges.reserve(indices.size());
+    for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+        for (size_t k = 0; k < 3; ++k) {
+            uint32_t a = canonical[indices[i + k]];
+            uint32_t b = canonical[indices[i + (k + 1) % 3]];
+            ++directedEdges[edgeKey(a, b)];
+        }
+    }
+
+    for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+        for (size_t k = 0; k < 3; ++k) {
+            uint32_t a = indices[i + k];
+            uint32_t b = indices[i + (k + 1) % 3];
+            auto opposite = directedEdges.find(edgeKey(canonical[b], canonical[a]));
+            if (opposite == directedEdges.end() || opposite->second != 1 ||
+                directedEdges[edgeKey(canonical[a], canonical[b])] != 1) {
+                locked[a] = true;
+                locked[b] = true;
+            }
+        }
+    }
+    return locked;
+}
+
+glm::dvec3 triangleNormal(const glm::dvec3& p0, const glm::dvec3& p1, const glm::dvec3& p2) noexcept
+{
+    return glm::cross(p1 - p0, p2 - p0);
+}
+}   // namespace
+
+SimplifiedMesh simplifyMesh(std::span<const uint32_t> indices,
+                            std::span<const Vertex> vertices,
+                            size_t targetIndexCount,
+                            float targetError)
+{
+    SimplifiedMesh result;
+    result.indices.assign(indices.begin(), indices.end());
+    if (indices.size() <= targetIndexCount || vertices.empty()) {
+        return result;
+    }
+
+    // Work in a unit box, so errors are relative to the mesh extent
+    glm::vec3 minPosition(std::numeric_limits<float>::max());
+    glm::vec3 maxPosition(std::numeric_limits<float>::lowest());
+    for (const auto& vertex : vertices) {
+        minPosition = glm::min(minPosition, vertex.pos);
+        maxPosition = glm::max(maxPosition, vertex.pos);
+    }
+    glm::vec3 extent = maxPosition - minPosition;
+    double scale = 1. / std::max({extent.x, extent.y, extent.z, std::numeric_limits<float>::min()});
+
+    std::vector<glm::dvec3> positions(vertices.size());
+    for (size_t v = 0; v < vertices.size(); ++v) {
+        positions[v] = glm::dvec3(vertices[v].pos - minPosition) * scale;
+    }
+
+    std::vector<bool> locked = findLockedVertices(indices, vertices);
+
+    std::vector<Quadric> quadrics(vertices.size());
+    for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+        glm::dvec3 normal = triangleNormal(positions[indices[i]], positions[indices[i + 1]], positions[indices[i + 2]]);
+        double area = glm::length(normal);
+        if (area == 0.) {
+            continue;
+        }
+        normal /= area;
+        Quadric quadric = Quadric::fromPlane(normal, -glm::dot(normal, positions[indices[i]]), area);
+        for (size_t k = 0; k < 3; ++k) {
+            quadrics[indices[i + k]] += quadric;
+        }
+    }
+
+    double maxError = static_cast<double>(targetError) * static_cast<double>(targetError);
+    double resultError = 0.;
+    std::vector<uint32_t>& current = result.indices;
+    std::vector<uint32_t> adjacencyOffsets(vertices.size() + 1);
+    std::vector<uint32_t> adjacency;
+    std::vector<Collapse> collapses;
+    std::vector<uint32_t> remap(vertices.size());
+    std::vector<bool> touched(vertices.size());
+
+    // Each pass collapses independent edges in increasing error order, then rebuilds the index buffer
+    while (current.size() > targetIndexCount) {
+        size_t triangleCount = current.size() / 3;
+
+        std::ranges::fill(adjacencyOffsets, 0u);
+        for (uint32_t index : current) {
+            ++adjacencyOffsets[index + 1];
+        }
+        for (size_t v = 0; v < vertices.size(); ++v) {
+            adjacencyOffsets[v + 1] += adjacencyOffsets[v];
+        }
+        adjacency.resize(current.size());
+        {
+            std::vector<uint32_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+            for (size_t i = 0; i < current.size(); ++i) {
+                adjacency[fill[current[i]]++] = static_cast<uint32_t>(i / 3);
+            }
+        }
+
+        collapses.clear();
+        for (size_t i = 0; i < current.size(); ++i) {
+            uint32_t from = current[i];
+            uint32_t to = current[i - i % 3 + (i + 1) % 3];
+            if (locked[from]) {
+                continue;
+            }
+            Quadric quadric = quadrics[from];
+            quadric += quadrics[to];
+            double error = quadric.error(positions[to]);
+            if (error <= maxError) {
+                collapses.push_back({.from = from, .to = to, .error = error});
+            }
+        }
+        std::ranges::sort(collapses, [](const Collapse& lhs, const Collapse& rhs) noexcept {
+            return lhs.error < rhs.error;
+        });
+
+        // Rejects collapses flipping or degenerating one of the remaining triangles around from
+        auto flips = [&](uint32_t from, uint32_t to) {
+            for (uint32_t a = adjacencyOffsets[from]; a < adjacencyOffsets[from + 1]; ++a) {
+                size_t triangle = adjacency[a];
+                uint32_t triangleIndices[3] = {
+                    current[triangle * 3], current[triangle * 3 + 1], current[triangle * 3 + 2]};
+                if (std::ranges::find(triangleIndices, to) != std::end(triangleIndices)) {
+                    continue;
+                }
+
+                glm::dvec3 before[3];
+                glm::dvec3 after[3];
+                for (size_t k = 0; k < 3; ++k) {
+                    before[k] = positions[triangleIndices[k]];
+                    after[k] = triangleIndices[k] == from ? positions[to] : before[k];
+                }
+                glm::dvec3 normalBefore = triangleNormal(before[0], before[1], before[2]);
+                glm::dvec3 normalAfter = triangleNormal(after[0], after[1], after[2]);
+                if (glm::dot(normalBefore, normalAfter) <= 0.) {
+                    return true;
+                }
+            }
+            return false;
+        };
+
+        for (uint32_t v = 0; v < vertices.size(); ++v) {
+            remap[v] = v;
+        }
+        std::fill(touched.begin(), touched.end(), false);
+
+        // Each collapse removes about 2 triangles
+        size_t trianglesToRemove = (current.size() - targetIndexCount) / 3;
+        size_t numCollapses = 0;
+        for (const auto& collapse : collapses) {
+            if (numCollapses * 2 >= trianglesToRemove) {
+                break;
+            }
+            if (touched[collapse.from] || touched[collapse.to] || flips(collapse.from, collapse.to)) {
+                continue;
+            }
+
+            remap[collapse.from] = collapse.to;
+            quadrics[collapse.to] += quadrics[collapse.from];
+            resultError = std::max(resultError, collapse.error);
+            ++numCollapses;
+
+            // The neighborhood changed, later collapses in this pass could flip it without noticing
+            for (uint32_t a = adjacencyOffsets[collapse.from]; a < adjacencyOffsets[collapse.from + 1]; ++a) {
+                size_t triangle = adjacency[a];
+                for (size_t k = 0; k < 3; ++k) {
+                    touched[current[triangle * 3 + k]] = true;
+                }
+            }
+        }
+
+        if (numCollapses == 0) {
+            break;
+        }
+
+        size_t write = 0;
+        for (size_t triangle = 0; triangle < triangleCount; ++triangle) {
+            uint32_t a = remap[current[triangle * 3]];
+            uint32_t b = remap[current[triangle * 3 + 1]];
+            uint32_t c = remap[current[triangle * 3 + 2]];
+            if (a != b && b != c && c != a) {
+                current[write++] = a;
+                current[write++] = b;
+                current[write++] = c;
+            }
+        }
+        current.resize(write);
+    }
+
+    result.error = static_cast<float>(std::sqrt(resultError));
+    return result;
+}
+
+std::vector<MeshLod> generateLods(std::vector<uint32_t>& indices, std::span<const Vertex> vertices, uint32_t maxLods)
+{
+    std::vector<MeshLod> lods = {
+        {.firstIndex = 0, .indexCount = static_cast<uint32_t>(indices.size()), .error = 0.f}
+    };
+
+    std::vector<uint32_t> previous = indices;
+    float error = 0.f;
+    while (lods.size() < maxLods) {
+        size_t targetIndexCount = previous.size() / 6 * 3;
+        if (targetIndexCount < LOD_MIN_INDICES) {
+            break;
+        }
+
+        SimplifiedMesh simplified = simplifyMesh(previous, vertices, targetIndexCount, LOD_MAX_ERROR - error);
+        if (static_cast<float>(simplified.indices.size()) >
+            static_cast<float>(previous.size()) * (1.f - LOD_MIN_REDUCTION)) {
+            break;
+        }
+
+        // Each LOD is simplified from the previous one, so the errors add up
+        error += simplified.error;
+        optimizeVertexCache(simplified.indices, vertices.size());
+        lods.push_back({.firstIndex = static_cast<uint32_t>(indices.size()),
+                        .indexCount = static_cast<uint32_t>(simplified.indices.size()),
+                        .error = error});
+        indices.insert(indices.end(), simplified.indices.begin(), simplified.indices.end());
+        previous = std::move(simplified.indices);
+    }
+    return lods;
+}
+
+MeshBounds computeBounds(std::span<const Vertex> vertices) noexcept
+{
+    MeshBounds bounds;
+    if (vertices.empty()) {
+        return bounds;
+    }
+
+    glm::vec3 minPosition(std::numeric_limits<float>::max());
+    glm::vec3 maxPosition(std::numeric_limits<float>::lowest());
+    for (const auto& vertex : vertices) {
+        minPosition = glm::min(minPosition, vertex.pos);
+        maxPosition = glm::max(maxPosition, vertex.pos);
+    }
+
+    bounds.boxMin = minPosition;
+    bounds.boxMax = maxPosition;
+    bounds.center = (minPosition + maxPosition) * 0.5f;
+    for (const auto& vertex : vertices) {
+        bounds.radius = std::max(bounds.radius, glm::length(vertex.pos - bounds.center));
+    }
+    return bounds;
+}
+
+uint32_t selectLod(std::span<const MeshLod> lods, float screenSizePixels, uint32_t currentLod) noexcept
+{
+    // The errors are relative to the mesh extent, which is at most the bounding sphere diameter, so this slightly
+    // overestimates the error in pixels
+    auto coarsestWithin = [&](float pixelError) {
+        for (size_t lod = lods.size(); lod-- > 1;) {
+            if (lods[lod].error * screenSizePixels <= pixelError) {
+                return static_cast<uint32_t>(lod);
+            }
+        }
+        return 0u;
+    };
+
+    // Coarser LODs exceed the pixel error. Finer ones are left for this one once it is under the hysteresis fraction
+    uint32_t maxLod = coarsestWithin(LOD_PIXEL_ERROR);
+    uint32_t minLod = coarsestWithin(LOD_PIXEL_ERROR * LOD_HYSTERESIS);
+    return std::clamp(currentLod, minLod, maxLod);
+}
+
+}   // namespace renderer
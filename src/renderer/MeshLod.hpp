@@ -0,0 +1,43 @@
+#ifndef RENDERER_MESH_LOD_HPP
+#define RENDERER_MESH_LOD_HPP
+
+#include "Types.hpp"
+
+// std
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace renderer
+{
+
+// Largest screen space error, in pixels, allowed when picking a LOD
+inline constexpr float LOD_PIXEL_ERROR = 1.f;
+
+struct SimplifiedMesh {
+    std::vector<uint32_t> indices;
+    float error = 0.f;   // relative to the mesh extent
+};
+
+// Quadric error metric edge collapse (Garland and Heckbert 1997) onto existing vertices, so the vertex buffer is
+// shared with the source. Vertices on open borders and attribute seams are locked. Stops at targetIndexCount, or
+// before any collapse exceeding targetError, relative to the mesh extent
+SimplifiedMesh simplifyMesh(std::span<const uint32_t> indices,
+                            std::span<const Vertex> vertices,
+                            size_t targetIndexCount,
+                            float targetError);
+
+// Appends up to maxLods - 1 coarser LODs to indices, each with about half the triangles of the previous one, and
+// returns the ranges of every LOD including the original. Stops early when the mesh does not simplify further
+std::vector<MeshLod> generateLods(std::vector<uint32_t>& indices, std::span<const Vertex> vertices, uint32_t maxLods);
+
+MeshBounds computeBounds(std::span<const Vertex> vertices) noexcept;
+
+// Coarsest LOD whose error stays under LOD_PIXEL_ERROR at the given on-screen diameter. A coarser LOD is only taken
+// once its error is below a fraction of the limit, so objects around a switching distance do not alternate every frame
+uint32_t selectLod(std::span<const MeshLod> lods, float screenSizePixels, uint32_t currentLod) noexcept;
+
+}   // namespace renderer
+
+#endif
@@ -0,0 +1,463 @@
+#include "MeshOptimizer.hpp"
+
+#include "core/Hash.hpp"
+
+// std
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <numeric>
+#include <unordered_map>
+
+namespace renderer
+{
+
+namespace
+{
+constexpr uint32_t NO_VERTEX = std::numeric_limits<uint32_t>::max();
+// ACMR increase accepted in exchange for less overdraw
+constexpr float OVERDRAW_CACHE_THRESHOLD = 1.05f;
+constexpr int OVERDRAW_GRID_SIZE = 256;
+
+// FIFO cache simulated with time stamps: a vertex is cached if it was inserted less than cacheSize insertions ago
+class FifoCache
+{
+public:
+    FifoCache(size_t vertexCount, uint32_t cacheSize)
+        : m_insertionTimes(vertexCount, 0)
+        , m_cacheSize(cacheSize)
+        , m_time(cacheSize + 1)
+    {}
+
+    // Returns true on a miss
+    bool access(uint32_t vertex) noexcept
+    {
+        if (m_time - m_insertionTimes[vertex] > m_cacheSize) {
+            m_insertionTimes[vertex] = m_time++;
+            return true;
+        }
+        return false;
+    }
+
+    uint32_t age(uint32_t vertex) const noexcept { return m_time - m_insertionTimes[vertex]; }
+
+    void flush() noexcept { m_time += m_cacheSize + 1; }
+
+private:
+    std::vector<uint32_t> m_insertionTimes;
+    uint32_t m_cacheSize;
+    uint32_t m_time;
+};
+
+struct VertexHash {
+    size_t operator()(const Vertex& vertex) const noexcept
+    {
+        return core::fnv1a64(std::as_bytes(std::span(&vertex, 1)));
+    }
+};
+
+struct VertexEqual {
+    bool operator()(const Vertex& lhs, const Vertex& rhs) const noexcept
+    {
+        return std::memcmp(&lhs, &rhs, sizeof(Vertex)) == 0;
+    }
+};
+
+// Twice the signed area, positive for counter clockwise triangles
+float edgeFunction(const glm::vec3& a, const glm::vec3& b, float x, float y) noexcept
+{
+    return (b.x - a.x) * (y - a.y) - (b.y - a.y) * (x - a.x);
+}
+
+void rasterizeTriangle(const glm::vec3& p0,
+                       const glm::vec3& p1,
+                       const glm::vec3& p2,
+                       std::vector<float>& depthBuffer,
+                       size_t& shaded) noexcept
+{
+    float area = edgeFunction(p0, p1, p2.x, p2.y);
+    if (area <= 0.f) {
+        // Back facing or degenerate
+        return;
+    }
+
+    int minX = std::max(0, static_cast<int>(std::min({p0.x, p1.x, p2.x})));
+    int minY = std::max(0, static_cast<int>(std::min({p0.y, p1.y, p2.y})));
+    int maxX = std::min(OVERDRAW_GRID_SIZE - 1, static_cast<int>(std::max({p0.x, p1.x, p2.x})));
+    int maxY = std::min(OVERDRAW_GRID_SIZE - 1, static_cast<int>(std::max({p0.y, p1.y, p2.y})));
+
+    for (int y = minY; y <= maxY; ++y) {
+        for (int x = minX; x <= maxX; ++x) {
+            float sampleX = static_cast<float>(x) + 0.5f;
+            float sampleY = static_cast<float>(y) + 0.5f;
+            float w0 = edgeFunction(p1, p2, sampleX, sampleY);
+            float w1 = edgeFunction(p2, p0, sampleX, sampleY);
+            float w2 = edgeFunction(p0, p1, sampleX, sampleY);
+            if (w0 < 0.f || w1 < 0.f || w2 < 0.f) {
+                continue;
+            }
+
+            float depth = (w0 * p0.z + w1 * p1.z + w2 * p2.z) / area;
+            float& stored = depthBuffer[static_cast<size_t>(y * OVERDRAW_GRID_SIZE + x)];
+            if (depth < stored) {
+                stored = depth;
+                ++shaded;
+            }
+        }
+    }
+}
+}   // namespace
+
+VertexCacheStats analyzeVertexCache(std::span<const uint32_t> indices, size_t vertexCount, uint32_t cacheSize)
+{
+    VertexCacheStats stats;
+    if (indices.size() < 3 || vertexCount == 0) {
+        return stats;
+    }
+
+    FifoCache cache(vertexCount, cacheSize);
+    std::vector<bool> referenced(vertexCount, false);
+    size_t misses = 0;
+    size_t referencedCount = 0;
+    for (uint32_t index : indices) {
+        misses += cache.access(index) ? 1u : 0u;
+        if (!referenced[index]) {
+            referenced[index] = true;
+            ++referencedCount;
+        }
+    }
+
+    stats.acmr = static_cast<float>(misses) / static_cast<float>(indices.size() / 3);
+    stats.atvr = static_cast<float>(misses) / static_cast<float>(referencedCount);
+    return stats;
+}
+
+float analyzeOverdraw(std::span<const uint32_t> indices, std::span<const Vertex> vertices)
+{
+    if (indices.size() < 3 || vertices.empty()) {
+        return 0.f;
+    }
+
+    glm::vec3 minPosition(std::numeric_limits<float>::max());
+    glm::vec3 maxPosition(std::numeric_limits<float>::lowest());
+    for (const auto& vertex : vertices) {
+        minPosition = glm::min(minPosition, vertex.pos);
+        maxPosition = glm::max(maxPosition, vertex.pos);
+    }
+    glm::vec3 extent = maxPosition - minPosition;
+    // Uniform scale, to keep the aspect ratio of the projections
+    float scale = 1.f / std::max({extent.x, extent.y, extent.z, std::numeric_limits<float>::min()});
+
+    std::vector<float> depthBuffer(static_cast<size_t>(OVERDRAW_GRID_SIZE * OVERDRAW_GRID_SIZE));
+    size_t shaded = 0;
+    size_t covered = 0;
+    for (glm::length_t axis = 0; axis < 3; ++axis) {
+        for (bool mirrored : {false, true}) {
+            std::ranges::fill(depthBuffer, std::numeric_limits<float>::max());
+
+            // Looking from the opposite direction mirrors the image, which also flips the winding back
+            auto project = [&](uint32_t index) {
+                glm::vec3 normalized = (vertices[index].pos - minPosition) * scale;
+                float u = normalized[(axis + 1) % 3];
+                float v = normalized[(axis + 2) % 3];
+                float depth = normalized[axis];
+                auto grid = static_cast<float>(OVERDRAW_GRID_SIZE);
+                if (mirrored) {
+                    return glm::vec3((1.f - u) * grid, v * grid, 1.f - depth);
+                }
+                return glm::vec3(u * grid, v * grid, depth);
+            };
+
+            for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+                rasterizeTriangle(project(indices[i]),
+                                  project(indices[i + 1]),
+                                  project(indices[i + 2]),
+                                  depthBuffer,
+                                  shaded);
+            }
+
+            auto isCovered = [](float depth) noexcept { return depth < std::numeric_limits<float>::max(); };
+            covered += static_cast<size_t>(std::ranges::count_if(depthBuffer, isCovered));
+        }
+    }
+
+    return covered == 0 ? 0.f : static_cast<float>(shaded) / static_cast<float>(covered);
+}
+
+size_t deduplicateVertices(std::vector<Vertex>& vertices, std::span<uint32_t> indices)
+{
+    std::unordered_map<Vertex, uint32_t, VertexHash, VertexEqual> uniqueVertices;
+    uniqueVertices.reserve(vertices.size());
+
+    std::vector<uint32_t> remap(vertices.size());
+    size_t uniqueCount = 0;
+    for (size_t i = 0; i < vertices.size(); ++i) {
+        auto [it, inserted] = uniqueVertices.try_emplace(vertices[i], static_cast<uint32_t>(uniqueCount));
+        if (inserted) {
+            vertices[uniqueCount++] = vertices[i];
+        }
+        remap[i] = it->second;
+    }
+
+    for (auto& index : indices) {
+        index = remap[index];
+    }
+    vertices.resize(uniqueCount);
+    return uniqueCount;
+}
+
+std::vector<uint32_t> optimizeVertexCache(std::span<uint32_t> indices, size_t vertexCount, uint32_t cacheSize)
+{
+    std::vector<uint32_t> clusters;
+    size_t triangleCount = indices.size() / 3;
+    if (triangleCount == 0) {
+        return clusters;
+    }
+
+    // Vertex to triangles adjacency, in compressed rows
+    std::vector<uint32_t> liveTriangles(vertexCount, 0);
+    for (size_t i = 0; i < triangleCount * 3; ++i) {
+        ++liveTriangles[indices[i]];
+    }
+    std::vector<uint32_t> adjacencyOffsets(vertexCount + 1, 0);
+    for (size_t v = 0; v < vertexCount; ++v) {
+        adjacencyOffsets[v + 1] = adjacencyOffsets[v] + liveTriangles[v];
+    }
+    std::vector<uint32_t> adjacency(triangleCount * 3);
+    {
+        std::vector<uint32_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+        for (size_t i = 0; i < triangleCount * 3; ++i) {
+            adjacency[fill[indices[i]]++] = static_cast<uint32_t>(i / 3);
+        }
+    }
+
+    FifoCache cache(vertexCount, cacheSize);
+    std::vector<bool> emitted(triangleCount, false);
+    std::vector<uint32_t> deadEndStack;
+    std::vector<uint32_t> candidates;
+    std::vector<uint32_t> output;
+    output.reserve(triangleCount * 3);
+    size_t scanCursor = 0;
+
+    auto skipDeadEnd = [&]() {
+        while (!deadEndStack.empty()) {
+            uint32_t vertex = deadEndStack.back();
+            deadEndStack.pop_back();
+            if (liveTriangles[vertex] > 0) {
+                return vertex;
+            }
+        }
+        while (scanCursor < vertexCount) {
+            if (liveTriangles[scanCursor] > 0) {
+                return static_cast<uint32_t>(scanCursor++);
+            }
+            ++scanCursor;
+        }
+        return NO_VERTEX;
+    };
+
+    uint32_t fanningVertex = skipDeadEnd();
+    bool clusterStart = true;
+    while (fanningVertex != NO_VERTEX) {
+        // Emit every remaining triangle around the fanning vertex
+        candidates.clear();
+        for (uint32_t a = adjacencyOffsets[fanningVertex]; a < adjacencyOffsets[fanningVertex + 1]; ++a) {
+            uint32_t triangle = adjacency[a];
+            if (emitted[triangle]) {
+                continue;
+            }
+            if (clusterStart) {
+                clusters.push_back(static_cast<uint32_t>(output.size() / 3));
+                clusterStart = false;
+            }
+
+            for (size_t k = 0; k < 3; ++k) {
+                uint32_t vertex = indices[triangle * 3 + k];
+                output.push_back(vertex);
+                deadEndStack.push_back(vertex);
+                candidates.push_back(vertex);
+                --liveTriangles[vertex];
+                cache.access(vertex);
+            }
+            emitted[triangle] = true;
+        }
+
+        // Next fanning vertex: the oldest candidate that stays in the cache while its own fan is emitted
+        uint32_t nextVertex = NO_VERTEX;
+        uint32_t bestPriority = 0;
+        for (uint32_t vertex : candidates) {
+            if (liveTriangles[vertex] == 0) {
+                continue;
+            }
+            uint32_t age = cache.age(vertex);
+            uint32_t priority = age + 2 * liveTriangles[vertex] <= cacheSize ? age : 0;
+            if (priority > bestPriority) {
+                bestPriority = priority;
+                nextVertex = vertex;
+            }
+        }
+
+        if (nextVertex == NO_VERTEX) {
+            nextVertex = skipDeadEnd();
+            clusterStart = true;
+        }
+        fanningVertex = nextVertex;
+    }
+
+    std::ranges::copy(output, indices.begin());
+    return clusters;
+}
+
+void optimizeOverdraw(std::span<uint32_t> indices,
+                      std::span<const Vertex> vertices,
+                      std::span<const uint32_t> clusters,
+                      float threshold,
+                      uint32_t cacheSize)
+{
+    size_t triangleCount = indices.size() / 3;
+    if (triangleCount == 0 || clusters.empty()) {
+        return;
+    }
+
+    // Split the hard clusters where the running ACMR is good enough, starting each piece with a cold cache as the
+    // pieces will be reordered
+    std::vector<uint32_t> softClusters;
+    FifoCache cache(vertices.size(), cacheSize);
+    auto triangleMisses = [&](size_t triangle) {
+        uint32_t misses = 0;
+        for (size_t k = 0; k < 3; ++k) {
+            misses += cache.access(indices[triangle * 3 + k]) ? 1u : 0u;
+        }
+        return misses;
+    };
+
+    for (size_t c = 0; c < clusters.size(); ++c) {
+        size_t begin = clusters[c];
+        size_t end = c + 1 < clusters.size() ? clusters[c + 1] : triangleCount;
+
+        cache.flush();
+        size_t clusterMisses = 0;
+        for (size_t t = begin; t < end; ++t) {
+            clusterMisses += triangleMisses(t);
+        }
+        float targetAcmr = static_cast<float>(clusterMisses) / static_cast<float>(end - begin) * threshold;
+
+        cache.flush();
+        size_t start = begin;
+        size_t misses = 0;
+        softClusters.push_back(static_cast<uint32_t>(begin));
+        for (size_t t = begin; t < end; ++t) {
+            misses += triangleMisses(t);
+            if (t + 1 < end && static_cast<float>(misses) / static_cast<float>(t + 1 - start) <= targetAcmr) {
+                softClusters.push_back(static_cast<uint32_t>(t + 1));
+                start = t + 1;
+                misses = 0;
+                cache.flush();
+            }
+        }
+    }
+
+    // Area weighted centroid and normal of every cluster
+    struct ClusterSortData {
+        uint32_t begin;
+        uint32_t end;
+        float key;
+    };
+
+    std::vector<ClusterSortData> sortData(softClusters.size());
+    std::vector<glm::vec3> centroids(softClusters.size());
+    std::vector<glm::vec3> normals(softClusters.size());
+    glm::vec3 meshCentroid(0.f);
+    float meshArea = 0.f;
+    for (size_t c = 0; c < softClusters.size(); ++c) {
+        uint32_t begin = softClusters[c];
+        uint32_t end = c + 1 < softClusters.size() ? softClusters[c + 1] : static_cast<uint32_t>(triangleCount);
+
+        glm::vec3 centroid(0.f);
+        glm::vec3 normal(0.f);
+        float area = 0.f;
+        for (uint32_t t = begin; t < end; ++t) {
+            const glm::vec3& p0 = vertices[indices[t * 3 + 0]].pos;
+            const glm::vec3& p1 = vertices[indices[t * 3 + 1]].pos;
+            const glm::vec3& p2 = vertices[indices[t * 3 + 2]].pos;
+            glm::vec3 cross = glm::cross(p1 - p0, p2 - p0);
+            float triangleArea = glm::length(cross);
+            centroid += (p0 + p1 + p2) * (triangleArea / 3.f);
+            normal += cross;
+            area += triangleArea;
+        }
+
+        meshCentroid += centroid;
+        meshArea += area;
+        centroids[c] = area > 0.f ? centroid / area : centroid;
+        normals[c] = glm::length(normal) > 0.f ? glm::normalize(normal) : normal;
+        sortData[c] = {.begin = begin, .end = end, .key = 0.f};
+    }
+
+    if (meshArea > 0.f) {
+        meshCentroid /= meshArea;
+    }
+    for (size_t c = 0; c < sortData.size(); ++c) {
+        sortData[c].key = glm::dot(centroids[c] - meshCentroid, normals[c]);
+    }
+    std::ranges::stable_sort(sortData, [](const auto& lhs, const auto& rhs) noexcept { return lhs.key > rhs.key; });
+
+    std::vector<uint32_t> output;
+    output.reserve(triangleCount * 3);
+    for (const auto& cluster : sortData) {
+        auto triangles = indices.subspan(cluster.begin * 3, (cluster.end - cluster.begin) * 3);
+        output.insert(output.end(), triangles.begin(), triangles.end());
+    }
+    std::ranges::copy(output, indices.begin());
+}
+
+size_t optimizeVertexFetch(std::vector<Vertex>& vertices, std::span<uint32_t> indices)
+{
+    std::vector<uint32_t> remap(vertices.size(), NO_VERTEX);
+    std::vector<Vertex> reordered;
+    reordered.reserve(vertices.size());
+
+    for (auto& index : indices) {
+        if (remap[index] == NO_VERTEX) {
+            remap[index] = static_cast<uint32_t>(reordered.size());
+            reordered.push_back(vertices[index]);
+        }
+        index = remap[index];
+    }
+
+    vertices = std::move(reordered);
+    return vertices.size();
+}
+
+MeshOptimizationStats optimizeMesh(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices, bool withOverdraw)
+{
+    MeshOptimizationStats stats;
+    stats.verticesBefore = vertices.size();
+    stats.cacheBefore = analyzeVertexCache(indices, vertices.size());
+    if (withOverdraw) {
+        stats.overdrawBefore = analyzeOverdraw(indices, vertices);
+    }
+
+    deduplicateVertices(vertices, indices);
+
+    std::vector<uint32_t> clusters = optimizeVertexCache(indices, vertices.size());
+    VertexCacheStats cacheOptimized = analyzeVertexCache(indices, vertices.size());
+
+    // The cluster reordering is only kept if the cache efficiency stays within the threshold
+    std::vector<uint32_t> cacheOrder = indices;
+    optimizeOverdraw(indices, vertices, clusters, OVERDRAW_CACHE_THRESHOLD);
+    if (analyzeVertexCache(indices, vertices.size()).acmr > cacheOptimized.acmr * OVERDRAW_CACHE_THRESHOLD) {
+        indices = std::move(cacheOrder);
+    }
+
+    optimizeVertexFetch(vertices, indices);
+
+    stats.verticesAfter = vertices.size();
+    stats.cacheAfter = analyzeVertexCache(indices, vertices.size());
+    if (withOverdraw) {
+        stats.overdrawAfter = analyzeOverdraw(indices, vertices);
+    }
+    return stats;
+}
+
+}   // namespace renderer
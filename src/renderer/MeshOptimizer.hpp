@@ -0,0 +1,68 @@
+#ifndef RENDERER_MESH_OPTIMIZER_HPP
+#define RENDERER_MESH_OPTIMIZER_HPP
+
+#include "Types.hpp"
+
+// std
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace renderer
+{
+
+// Post-transform cache size used to order and analyze triangles. Actual GPUs do not have a FIFO cache, but meshes
+// ordered for one also batch well on them
+inline constexpr uint32_t VERTEX_CACHE_SIZE = 16;
+
+struct VertexCacheStats {
+    float acmr = 0.f;   // average cache miss ratio, transformed vertices per triangle. 0.5 at best, 3 at worst
+    float atvr = 0.f;   // average transformed vertex ratio, transformed vertices per vertex. 1 at best
+};
+
+struct MeshOptimizationStats {
+    size_t verticesBefore = 0;
+    size_t verticesAfter = 0;
+    VertexCacheStats cacheBefore;
+    VertexCacheStats cacheAfter;
+    float overdrawBefore = 0.f;   // only computed on request
+    float overdrawAfter = 0.f;
+};
+
+// Simulates a FIFO post-transform cache over the triangle list
+VertexCacheStats analyzeVertexCache(std::span<const uint32_t> indices,
+                                    size_t vertexCount,
+                                    uint32_t cacheSize = VERTEX_CACHE_SIZE);
+
+// Rasterizes the mesh in index order from the 6 axis directions with back face culling, and returns the ratio of
+// shaded fragments to covered pixels. 1 means no overdraw
+float analyzeOverdraw(std::span<const uint32_t> indices, std::span<const Vertex> vertices);
+
+// Merges bitwise identical vertices. Returns the new vertex count
+size_t deduplicateVertices(std::vector<Vertex>& vertices, std::span<uint32_t> indices);
+
+// Reorders the triangles for post-transform cache locality with Tipsify (Sander et al. 2007). Returns the first
+// triangle of every cluster ending in a dead end, which optimizeOverdraw can reorder without hurting the cache much
+std::vector<uint32_t> optimizeVertexCache(std::span<uint32_t> indices,
+                                          size_t vertexCount,
+                                          uint32_t cacheSize = VERTEX_CACHE_SIZE);
+
+// Splits the clusters where their cache efficiency allows it, within threshold of the cluster ACMR, and draws the
+// clusters facing away from the mesh center first, as they are the likeliest to occlude the others
+void optimizeOverdraw(std::span<uint32_t> indices,
+                      std::span<const Vertex> vertices,
+                      std::span<const uint32_t> clusters,
+                      float threshold,
+                      uint32_t cacheSize = VERTEX_CACHE_SIZE);
+
+// Reorders the vertices in first use order, so vertex fetching walks memory linearly, and drops unused vertices.
+// Returns the new vertex count
+size_t optimizeVertexFetch(std::vector<Vertex>& vertices, std::span<uint32_t> indices);
+
+// Runs every pass above. The overdraw analysis rasterizes the mesh twice, so it is opt-in
+MeshOptimizationStats optimizeMesh(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices, bool withOverdraw);
+
+}   // namespace renderer
+
+#endif
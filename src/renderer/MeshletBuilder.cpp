@@ -0,0 +1,195 @@
+#include "MeshletBuilder.hpp"
+
+// std
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <limits>
+#include <numeric>
+
+namespace renderer
+{
+
+namespace
+{
+constexpr uint32_t NO_TRIANGLE = std::numeric_limits<uint32_t>::max();
+// Below this, the normals spread over more than about 84 degrees from the axis and the cone never culls
+constexpr float MESHLET_MIN_CONE_DOT = 0.1f;
+
+// Zero for degenerate triangles
+glm::vec3 unitNormal(std::span<const uint32_t> triangle, std::span<const Vertex> vertices) noexcept
+{
+    const glm::vec3& p0 = vertices[triangle[0]].pos;
+    glm::vec3 normal = glm::cross(vertices[triangle[1]].pos - p0, vertices[triangle[2]].pos - p0);
+    float length = glm::length(normal);
+    return length > 0.f ? normal / length : glm::vec3(0.f);
+}
+
+void computeMeshletBounds(Meshlet& meshlet,
+                          std::span<const uint32_t> meshletIndices,
+                          std::span<const uint32_t> meshletVertices,
+                          std::span<const Vertex> vertices) noexcept
+{
+    glm::vec3 minPosition(std::numeric_limits<float>::max());
+    glm::vec3 maxPosition(std::numeric_limits<float>::lowest());
+    for (uint32_t vertex : meshletVertices) {
+        minPosition = glm::min(minPosition, vertices[vertex].pos);
+        maxPosition = glm::max(maxPosition, vertices[vertex].pos);
+    }
+    meshlet.center = (minPosition + maxPosition) * 0.5f;
+    meshlet.radius = 0.f;
+    for (uint32_t vertex : meshletVertices) {
+        meshlet.radius = std::max(meshlet.radius, glm::length(vertices[vertex].pos - meshlet.center));
+    }
+
+    // The cone of the unit triangle normals, around their average
+    glm::vec3 axis(0.f);
+    for (size_t i = 0; i < meshletIndices.size(); i += 3) {
+        axis += unitNormal(meshletIndices.subspan(i, 3), vertices);
+    }
+
+    meshlet.coneAxis = glm::vec3(0.f, 0.f, 1.f);
+    meshlet.coneCutoff = 1.f;
+    float axisLength = glm::length(axis);
+    if (axisLength == 0.f) {
+        return;
+    }
+    axis /= axisLength;
+
+    float minDot = 1.f;
+    for (size_t i = 0; i < meshletIndices.size(); i += 3) {
+        glm::vec3 normal = unitNormal(meshletIndices.subspan(i, 3), vertices);
+        if (normal != glm::vec3(0.f)) {
+            minDot = std::min(minDot, glm::dot(axis, normal));
+        }
+    }
+
+    meshlet.coneAxis = axis;
+    if (minDot >= MESHLET_MIN_CONE_DOT) {
+        // Sine of the cone half angle: the view direction must be within 90 degrees minus it of the axis
+        meshlet.coneCutoff = std::sqrt(1.f - minDot * minDot);
+    }
+}
+}   // namespace
+
+std::vector<Meshlet> buildMeshlets(std::span<uint32_t> indices,
+                                   std::span<const Vertex> vertices,
+                                   uint32_t firstIndex,
+                                   uint32_t maxVertices,
+                                   uint32_t maxTriangles)
+{
+    assert(indices.size() % 3 == 0);
+    assert(maxVertices >= 3 && maxTriangles >= 1);
+    const size_t triangleCount = indices.size() / 3;
+
+    // Triangles using each vertex
+    std::vector<uint32_t> adjacencyOffsets(vertices.size() + 1, 0);
+    for (uint32_t index : indices) {
+        ++adjacencyOffsets[index + 1];
+    }
+    std::partial_sum(adjacencyOffsets.begin(), adjacencyOffsets.end(), adjacencyOffsets.begin());
+    std::vector<uint32_t> adjacency(indices.size());
+    std::vector<uint32_t> adjacencyFill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+    for (size_t i = 0; i < indices.size(); ++i) {
+        adjacency[adjacencyFill[indices[i]]++] = static_cast<uint32_t>(i / 3);
+    }
+
+    std::vector<glm::vec3> centroids(triangleCount);
+    for (size_t triangle = 0; triangle < triangleCount; ++triangle) {
+        centroids[triangle] = (vertices[indices[3 * triangle]].pos + vertices[indices[3 * triangle + 1]].pos +
+                               vertices[indices[3 * triangle + 2]].pos) /
+                              3.f;
+    }
+
+    std::vector<bool> emitted(triangleCount, false);
+    // Index of the last meshlet each vertex was added to
+    std::vector<uint32_t> vertexMeshlet(vertices.size(), std::numeric_limits<uint32_t>::max());
+
+    std::vector<Meshlet> meshlets;
+    std::vector<uint32_t> ordered;
+    ordered.reserve(indices.size());
+    std::vector<uint32_t> meshletVertices;
+    meshletVertices.reserve(maxVertices);
+
+    size_t seed = 0;
+    while (true) {
+        while (seed < triangleCount && emitted[seed]) {
+            ++seed;
+        }
+        if (seed == triangleCount) {
+            break;
+        }
+
+        auto meshletIndex = static_cast<uint32_t>(meshlets.size());
+        size_t meshletStart = ordered.size();
+        meshletVertices.clear();
+        glm::vec3 centroidSum(0.f);
+
+        auto newVertexCount = [&](uint32_t triangle) {
+            uint32_t count = 0;
+            for (size_t corner = 0; corner < 3; ++corner) {
+                uint32_t vertex = indices[3 * triangle + corner];
+                // Repeated corners of degenerate triangles are only counted once
+                bool repeated = corner > 0 && indices[3 * triangle] == vertex;
+                repeated = repeated || (corner > 1 && indices[3 * triangle + 1] == vertex);
+                count += vertexMeshlet[vertex] != meshletIndex && !repeated ? 1u : 0u;
+            }
+            return count;
+        };
+
+        auto candidate = static_cast<uint32_t>(seed);
+        while (candidate != NO_TRIANGLE) {
+            emitted[candidate] = true;
+            centroidSum += centroids[candidate];
+            for (size_t corner = 0; corner < 3; ++corner) {
+                uint32_t vertex = indices[3 * candidate + corner];
+                ordered.push_back(vertex);
+                if (vertexMeshlet[vertex] != meshletIndex) {
+                    vertexMeshlet[vertex] = meshletIndex;
+                    meshletVertices.push_back(vertex);
+                }
+            }
+
+            size_t meshletTriangles = (ordered.size() - meshletStart) / 3;
+            if (meshletTriangles == maxTriangles) {
+                break;
+            }
+
+            // Among the triangles sharing a vertex with the meshlet, so it stays connected
+            glm::vec3 meshletCentroid = centroidSum / static_cast<float>(meshletTriangles);
+            candidate = NO_TRIANGLE;
+            uint32_t bestNewVertices = 3;
+            float bestDistance = std::numeric_limits<float>::max();
+            for (uint32_t vertex : meshletVertices) {
+                for (uint32_t i = adjacencyOffsets[vertex]; i < adjacencyOffsets[vertex + 1]; ++i) {
+                    uint32_t triangle = adjacency[i];
+                    if (emitted[triangle]) {
+                        continue;
+                    }
+                    uint32_t newVertices = newVertexCount(triangle);
+                    if (meshletVertices.size() + newVertices > maxVertices || newVertices > bestNewVertices) {
+                        continue;
+                    }
+                    glm::vec3 offset = centroids[triangle] - meshletCentroid;
+                    float distance = glm::dot(offset, offset);
+                    if (newVertices < bestNewVertices || distance < bestDistance) {
+                        candidate = triangle;
+                        bestNewVertices = newVertices;
+                        bestDistance = distance;
+                    }
+                }
+            }
+        }
+
+        Meshlet meshlet {};
+        meshlet.firstIndex = firstIndex + static_cast<uint32_t>(meshletStart);
+        meshlet.indexCount = static_cast<uint32_t>(ordered.size() - meshletStart);
+        computeMeshletBounds(meshlet, std::span(ordered).subspan(meshletStart), meshletVertices, vertices);
+        meshlets.push_back(meshlet);
+    }
+
+    std::ranges::copy(ordered, indices.begin());
+    return meshlets;
+}
+
+}   // namespace renderer
@@ -0,0 +1,30 @@
+#ifndef RENDERER_MESHLET_BUILDER_HPP
+#define RENDERER_MESHLET_BUILDER_HPP
+
+#include "Types.hpp"
+
+// std
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace renderer
+{
+
+// The usual mesh shader limits. Without mesh shaders the vertex limit only bounds the cluster's spatial extent, but
+// keeps the clusters usable by a mesh shader path
+inline constexpr uint32_t MESHLET_MAX_VERTICES = 64;
+inline constexpr uint32_t MESHLET_MAX_TRIANGLES = 124;
+
+// Greedily grows clusters over shared edges, preferring the triangles adding the fewest vertices, then the closest
+// ones, so the clusters are compact and their bounding spheres and normal cones tight. Reorders the triangles of
+// indices so each cluster is contiguous; firstIndex is where indices starts in the mesh's index buffer
+std::vector<Meshlet> buildMeshlets(std::span<uint32_t> indices,
+                                   std::span<const Vertex> vertices,
+                                   uint32_t firstIndex,
+                                   uint32_t maxVertices = MESHLET_MAX_VERTICES,
+                                   uint32_t maxTriangles = MESHLET_MAX_TRIANGLES);
+
+}   // namespace renderer
+
+#endif
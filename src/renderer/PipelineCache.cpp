@@ -0,0 +1,173 @@
+#include "PipelineCache.hpp"
+
+#include "core/File.hpp"
+#include "core/Hash.hpp"
+#include "core/Logger.hpp"
+
+// std
+#include <algorithm>
+#include <cstring>
+#include <exception>
+#include <fstream>
+#include <span>
+#include <utility>
+
+namespace renderer
+{
+
+namespace
+{
+constexpr uint32_t PIPELINE_CACHE_MAGIC = 0x48435050;   // "PPCH"
+constexpr uint32_t PIPELINE_CACHE_VERSION = 1;
+}   // namespace
+
+PipelineCache::PipelineCache(vk::Device device, vk::PhysicalDevice physicalDevice, std::filesystem::path path)
+    : m_device(device)
+    , m_path(std::move(path))
+    , m_lastSave(std::chrono::steady_clock::now())
+{
+    vk::PhysicalDeviceIDProperties idProperties;
+    vk::PhysicalDeviceProperties2 properties2;
+    properties2.pNext = &idProperties;
+    physicalDevice.getProperties2(&properties2);
+    const auto& properties = properties2.properties;
+
+    m_header.magic = PIPELINE_CACHE_MAGIC;
+    m_header.version = PIPELINE_CACHE_VERSION;
+    m_header.vendorId = properties.vendorID;
+    m_header.deviceId = properties.deviceID;
+    m_header.driverVersion = properties.driverVersion;
+    std::ranges::copy(idProperties.driverUUID, m_header.driverUuid);
+    std::ranges::copy(properties.pipelineCacheUUID, m_header.pipelineCacheUuid);
+
+    std::vector<char> data = loadData();
+    vk::PipelineCacheCreateInfo createInfo {.sType = vk::StructureType::ePipelineCacheCreateInfo,
+                                            .pNext = nullptr,
+                                            .flags = {},
+                                            .initialDataSize = data.size(),
+                                            .pInitialData = data.data()};
+    m_cache = m_device.createPipelineCacheUnique(createInfo);
+    m_savedSize = data.size();
+}
+
+PipelineCache& PipelineCache::operator=(PipelineCache&& rhs) noexcept
+{
+    if (this != &rhs) {
+        if (m_cache) {
+            saveNoThrow();
+        }
+        m_device = rhs.m_device;
+        m_cache = std::move(rhs.m_cache);
+        m_path = std::move(rhs.m_path);
+        m_header = rhs.m_header;
+        m_savedSize = rhs.m_savedSize;
+        m_lastSave = rhs.m_lastSave;
+    }
+    return *this;
+}
+
+PipelineCache::~PipelineCache() noexcept
+{
+    if (m_cache) {
+        saveNoThrow();
+    }
+}
+
+void PipelineCache::save()
+{
+    if (!m_cache) {
+        return;
+    }
+
+    // Caches only grow, an unchanged size means nothing was added
+    std::vector<uint8_t> data = m_device.getPipelineCacheData(*m_cache);
+    m_lastSave = std::chrono::steady_clock::now();
+    if (data.size() == m_savedSize) {
+        return;
+    }
+
+    FileHeader header = m_header;
+    header.dataSize = data.size();
+    header.dataHash = core::fnv1a64(std::as_bytes(std::span(data)));
+
+    if (m_path.has_parent_path()) {
+        std::filesystem::create_directories(m_path.parent_path());
+    }
+    std::filesystem::path temporaryPath = m_path;
+    temporaryPath += ".tmp";
+    {
+        std::ofstream file;
+        file.exceptions(std::ofstream::badbit | std::ofstream::failbit);
+        file.open(temporaryPath, std::ios::binary | std::ios::trunc);
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+    }
+    std::filesystem::rename(temporaryPath, m_path);
+
+    m_savedSize = data.size();
+    DEBUG_FMT("Saved pipeline cache to {} ({} bytes)\n", m_path.string(), data.size());
+}
+
+void PipelineCache::update()
+{
+    if (m_cache && std::chrono::steady_clock::now() - m_lastSave >= SAVE_INTERVAL) {
+        saveNoThrow();
+    }
+}
+
+std::vector<char> PipelineCache::loadData() const
+{
+    if (!std::filesystem::exists(m_path)) {
+        INFO_FMT("No pipeline cache at {}, starting empty\n", m_path.string());
+        return {};
+    }
+
+    std::vector<char> file;
+    try {
+        file = core::readFile(m_path);
+    } catch (const std::exception& e) {
+        WARN_FMT("Could not read pipeline cache {}: {}\n", m_path.string(), e.what());
+        return {};
+    }
+
+    FileHeader header;
+    if (file.size() < sizeof(header)) {
+        WARN_FMT("Pipeline cache {} is truncated, ignoring it\n", m_path.string());
+        return {};
+    }
+    std::memcpy(&header, file.data(), sizeof(header));
+
+    if (header.magic != m_header.magic || header.version != m_header.version) {
+        WARN_FMT("{} is not a pipeline cache of this version, ignoring it\n", m_path.string());
+        return {};
+    }
+
+    // Pipeline binaries are only valid for the device and driver that compiled them
+    if (header.vendorId != m_header.vendorId || header.deviceId != m_header.deviceId ||
+        header.driverVersion != m_header.driverVersion ||
+        std::memcmp(header.driverUuid, m_header.driverUuid, sizeof(header.driverUuid)) != 0 ||
+        std::memcmp(header.pipelineCacheUuid, m_header.pipelineCacheUuid, sizeof(header.pipelineCacheUuid)) != 0) {
+        INFO_FMT("Pipeline cache {} was written by another device or driver, ignoring it\n", m_path.string());
+        return {};
+    }
+
+    std::span<const char> data = std::span<const char>(file).subspan(sizeof(header));
+    if (header.dataSize != data.size() || header.dataHash != core::fnv1a64(std::as_bytes(data))) {
+        WARN_FMT("Pipeline cache {} is corrupted, ignoring it\n", m_path.string());
+        return {};
+    }
+
+    INFO_FMT("Loaded pipeline cache {} ({} bytes)\n", m_path.string(), data.size());
+    return std::vector<char>(data.begin(), data.end());
+}
+
+void PipelineCache::saveNoThrow() noexcept
+{
+    try {
+        save();
+    } catch (const std::exception& e) {
+        WARN_FMT("Could not save pipeline cache {}: {}\n", m_path.string(), e.what());
+    }
+}
+
+}   // namespace renderer
@@ -0,0 +1,77 @@
+#ifndef RENDERER_PIPELINE_CACHE_HPP
+#define RENDERER_PIPELINE_CACHE_HPP
+
+// libs
+#include <vulkan/vulkan.hpp>
+
+// std
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <vector>
+
+namespace renderer
+{
+
+// VkPipelineCache persisted to a file, shared by every pipeline built on the device. The file is ignored when it was
+// written by another device or driver, or is corrupted, and the cache then starts empty
+class PipelineCache
+{
+public:
+    PipelineCache() noexcept = default;
+    PipelineCache(vk::Device device, vk::PhysicalDevice physicalDevice, std::filesystem::path path);
+
+    PipelineCache(const PipelineCache&) = delete;
+    PipelineCache& operator=(const PipelineCache&) = delete;
+
+    PipelineCache(PipelineCache&&) noexcept = default;
+    // Saves the current cache before taking over rhs
+    PipelineCache& operator=(PipelineCache&& rhs) noexcept;
+
+    // Saves, failures are only logged
+    ~PipelineCache() noexcept;
+
+public:
+    vk::PipelineCache get() const noexcept { return *m_cache; }
+
+    // Writes to a temporary file renamed over the previous one, so a crash while saving never leaves a truncated
+    // cache behind. Does nothing if the cache did not grow since the last save
+    void save();
+
+    // Saves at most every SAVE_INTERVAL, so pipelines compiled during a session survive a crash
+    void update();
+
+private:
+    // Written before the VkPipelineCache data. The data has its own header, but it does not cover the driver UUID
+    struct FileHeader {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t vendorId;
+        uint32_t deviceId;
+        uint32_t driverVersion;
+        uint32_t reserved;   // keeps the header free of implicit padding
+        uint8_t driverUuid[vk::UuidSize];
+        uint8_t pipelineCacheUuid[vk::UuidSize];
+        uint64_t dataSize;
+        uint64_t dataHash;
+    };
+
+    static constexpr std::chrono::seconds SAVE_INTERVAL {30};
+
+    // Empty if the file is missing or does not match m_header
+    std::vector<char> loadData() const;
+    void saveNoThrow() noexcept;
+
+private:
+    vk::Device m_device;   // not owned
+    vk::UniquePipelineCache m_cache;
+    std::filesystem::path m_path;
+    FileHeader m_header {};   // of the current device, dataSize and dataHash unset
+    size_t m_savedSize = 0;
+    std::chrono::steady_clock::time_point m_lastSave;
+};
+
+}   // namespace renderer
+
+#endif
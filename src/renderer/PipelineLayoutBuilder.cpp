@@ -1,10 +1,51 @@
 #include "PipelineLayoutBuilder.hpp"
 
+// libs
+#include <vulkan/vulkan_to_string.hpp>
+
+// std
+#include <format>
+#include <stdexcept>
+
 namespace renderer
 {
 
-PipelineLayoutBuilder::PipelineLayoutBuilder(vk::Device device) noexcept
+namespace
+{
+// The valid usage rules of VkPipelineLayoutCreateInfo, checked up front as breaking them is undefined behavior
+void validatePushConstantRanges(const std::vector<vk::PushConstantRange>& pushConstantRanges,
+                                uint32_t maxPushConstantsSize)
+{
+    vk::ShaderStageFlags usedStages;
+    for (const auto& range : pushConstantRanges) {
+        if (range.offset % 4 != 0 || range.size % 4 != 0 || range.size == 0) {
+            throw std::runtime_error(std::format("push constant range at offset {} of size {} is not a non-empty "
+                                                 "multiple of 4 bytes",
+                                                 range.offset,
+                                                 range.size));
+        }
+        if (range.offset >= maxPushConstantsSize || range.size > maxPushConstantsSize - range.offset) {
+            throw std::runtime_error(std::format("push constant range at offset {} of size {} is past the {} bytes "
+                                                 "the device supports",
+                                                 range.offset,
+                                                 range.size,
+                                                 maxPushConstantsSize));
+        }
+        if (!range.stageFlags) {
+            throw std::runtime_error("push constant range without stages");
+        }
+        if (usedStages & range.stageFlags) {
+            throw std::runtime_error(std::format("several push constant ranges for the stages {}",
+                                                 vk::to_string(usedStages & range.stageFlags)));
+        }
+        usedStages |= range.stageFlags;
+    }
+}
+}   // namespace
+
+PipelineLayoutBuilder::PipelineLayoutBuilder(vk::Device device, uint32_t maxPushConstantsSize) noexcept
     : m_device(device)
+    , m_maxPushConstantsSize(maxPushConstantsSize)
 {}
 
 void PipelineLayoutBuilder::setDescriptorSetLayouts(const std::vector<vk::DescriptorSetLayout>& descriptorSetLayouts)
@@ -12,16 +53,24 @@ void PipelineLayoutBuilder::setDescriptorSetLayouts(const std::vector<vk::Descri
     m_descriptorSetLayouts = descriptorSetLayouts;
 }
 
+void PipelineLayoutBuilder::setPushConstantRanges(const std::vector<vk::PushConstantRange>& pushConstantRanges)
+{
+    m_pushConstantRanges = pushConstantRanges;
+}
+
 vk::UniquePipelineLayout PipelineLayoutBuilder::build()
 {
+    validatePushConstantRanges(m_pushConstantRanges, m_maxPushConstantsSize);
+
     vk::PipelineLayoutCreateInfo pipelineLayoutCreateInfo {.sType = vk::StructureType::ePipelineLayoutCreateInfo,
                                                            .pNext = nullptr,
                                                            .flags = {},
                                                            .setLayoutCount =
                                                                static_cast<uint32_t>(m_descriptorSetLayouts.size()),
                                                            .pSetLayouts = m_descriptorSetLayouts.data(),
-                                                           .pushConstantRangeCount = 0,
-                                                           .pPushConstantRanges = nullptr};
+                                                           .pushConstantRangeCount =
+                                                               static_cast<uint32_t>(m_pushConstantRanges.size()),
+                                                           .pPushConstantRanges = m_pushConstantRanges.data()};
 
     return m_device.createPipelineLayoutUnique(pipelineLayoutCreateInfo);
 }
@@ -1,10 +1,13 @@
 #ifndef RENDERER_PIPELINE_LAYOUT_BUILDER
 #define RENDERER_PIPELINE_LAYOUT_BUILDER
 
+#include "PushConstants.hpp"
+
 // libs
 #include <vulkan/vulkan.hpp>
 
 // std
+#include <cstdint>
 #include <vector>
 
 namespace renderer
@@ -14,7 +17,9 @@ class PipelineLayoutBuilder
 {
 public:
     PipelineLayoutBuilder() = delete;
-    explicit PipelineLayoutBuilder(vk::Device device) noexcept;
+    // maxPushConstantsSize is the device limit the push constant ranges are validated against
+    explicit PipelineLayoutBuilder(vk::Device device,
+                                   uint32_t maxPushConstantsSize = MIN_MAX_PUSH_CONSTANTS_SIZE) noexcept;
 
     PipelineLayoutBuilder(const PipelineLayoutBuilder&) = delete;
     PipelineLayoutBuilder& operator=(const PipelineLayoutBuilder&) = delete;
@@ -26,12 +31,16 @@ public:
 
 public:
     void setDescriptorSetLayouts(const std::vector<vk::DescriptorSetLayout>& descriptorSetLayouts);
+    void setPushConstantRanges(const std::vector<vk::PushConstantRange>& pushConstantRanges);
 
+    // Throws if a push constant range is misaligned, empty, past the device limit, or shares a stage with another
     vk::UniquePipelineLayout build();
 
 private:
     vk::Device m_device;                                           // not owned
+    uint32_t m_maxPushConstantsSize = MIN_MAX_PUSH_CONSTANTS_SIZE;
     std::vector<vk::DescriptorSetLayout> m_descriptorSetLayouts;   // not owned
+    std::vector<vk::PushConstantRange> m_pushConstantRanges;
 };
 
 }   // namespace renderer
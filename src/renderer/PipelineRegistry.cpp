@@ -0,0 +1,326 @@
+#include "PipelineRegistry.hpp"
+
+#include "DeletionQueue.hpp"
+#include "GraphicsPipelineBuilder.hpp"
+#include "Utils.hpp"
+#include "core/Hash.hpp"
+#include "core/Logger.hpp"
+#include "core/ThreadPool.hpp"
+
+// std
+#include <algorithm>
+#include <cassert>
+#include <exception>
+#include <initializer_list>
+#include <span>
+#include <stdexcept>
+#include <utility>
+
+namespace renderer
+{
+
+namespace
+{
+std::span<const uint32_t> shaderCode(const ShaderSource& shader, std::vector<uint32_t>& storage)
+{
+    if (!shader.code.empty()) {
+        return shader.code;
+    }
+    storage = utils::readSpirv(shader.path);
+    return storage;
+}
+
+vk::UniquePipeline buildPipeline(vk::Device device,
+                                 vk::PipelineCache pipelineCache,
+                                 const GraphicsPipelineState& state,
+                                 vk::PipelineCreateFlags flags)
+{
+    std::vector<uint32_t> vertexFile;
+    std::vector<uint32_t> fragmentFile;
+    GraphicsPipelineBuilder builder(device);
+    builder.setShaders(shaderCode(state.vertexShader, vertexFile), shaderCode(state.fragmentShader, fragmentFile));
+    builder.setPipelineLayout(state.layout);
+    builder.setPipelineCache(pipelineCache);
+    builder.setColorFormat(state.colorFormat);
+    builder.setDepthFormat(state.depthFormat);
+    builder.setTopology(state.topology);
+    builder.setRasterization(state.polygonMode, state.cullMode, state.frontFace);
+    builder.setRasterizerDiscard(state.rasterizerDiscard);
+    builder.setPrimitiveRestart(state.primitiveRestart);
+    builder.setDepthBias(state.depthBias, state.depthBiasConstantFactor, state.depthBiasSlopeFactor);
+    builder.setDepthTest(state.depthTest, state.depthWrite, state.depthCompareOp);
+    builder.setAlphaBlending(state.alphaBlending);
+    builder.setVertexInput(state.vertexInput);
+    builder.setDynamicStateMode(state.dynamicStateMode);
+    builder.setSpecializationConstants(state.specializationConstants);
+    builder.setCreateFlags(flags);
+    return builder.build();
+}
+
+// Dynamic topologies must stay in the class of the pipeline's
+vk::PrimitiveTopology topologyClass(vk::PrimitiveTopology topology) noexcept
+{
+    switch (topology) {
+        case vk::PrimitiveTopology::ePointList: return vk::PrimitiveTopology::ePointList;
+        case vk::PrimitiveTopology::eLineList:
+        case vk::PrimitiveTopology::eLineStrip:
+        case vk::PrimitiveTopology::eLineListWithAdjacency:
+        case vk::PrimitiveTopology::eLineStripWithAdjacency: return vk::PrimitiveTopology::eLineList;
+        case vk::PrimitiveTopology::ePatchList: return vk::PrimitiveTopology::ePatchList;
+        default: return vk::PrimitiveTopology::eTriangleList;
+    }
+}
+
+template <typename T>
+std::span<const std::byte> bytesOf(const T& value) noexcept
+{
+    return std::as_bytes(std::span(&value, 1));
+}
+}   // namespace
+
+size_t GraphicsPipelineStateHash::operator()(const GraphicsPipelineState& state) const noexcept
+{
+    // The paths are enough to tell the shaders apart, the embedded code is only compared
+    uint64_t hash = core::fnv1a64(std::as_bytes(std::span(state.vertexShader.path.native())));
+    hash = core::fnv1a64(std::as_bytes(std::span(state.fragmentShader.path.native())), hash);
+    hash = core::fnv1a64(bytesOf(state.layout), hash);
+    hash = core::fnv1a64(bytesOf(state.colorFormat), hash);
+    hash = core::fnv1a64(bytesOf(state.depthFormat), hash);
+    hash = core::fnv1a64(bytesOf(state.vertexInput), hash);
+    hash = core::fnv1a64(bytesOf(state.dynamicStateMode), hash);
+    if (state.dynamicStateMode == DynamicStateMode::eBaked) {
+        hash = core::fnv1a64(bytesOf(state.topology), hash);
+        hash = core::fnv1a64(bytesOf(state.cullMode), hash);
+        hash = core::fnv1a64(bytesOf(state.frontFace), hash);
+        hash = core::fnv1a64(bytesOf(state.rasterizerDiscard), hash);
+        hash = core::fnv1a64(bytesOf(state.primitiveRestart), hash);
+        hash = core::fnv1a64(bytesOf(state.depthBias), hash);
+        // Adding 0 turns -0 into 0, which compares equal
+        hash = core::fnv1a64(bytesOf(state.depthBiasConstantFactor + 0.f), hash);
+        hash = core::fnv1a64(bytesOf(state.depthBiasSlopeFactor + 0.f), hash);
+        hash = core::fnv1a64(bytesOf(state.depthTest), hash);
+        hash = core::fnv1a64(bytesOf(state.depthWrite), hash);
+        hash = core::fnv1a64(bytesOf(state.depthCompareOp), hash);
+    } else {
+        hash = core::fnv1a64(bytesOf(topologyClass(state.topology)), hash);
+    }
+    if (state.dynamicStateMode != DynamicStateMode::eExtended3) {
+        hash = core::fnv1a64(bytesOf(state.polygonMode), hash);
+        hash = core::fnv1a64(bytesOf(state.alphaBlending), hash);
+    }
+    return state.specializationConstants.hash(hash);
+}
+
+bool GraphicsPipelineStateEqual::operator()(const GraphicsPipelineState& lhs,
+                                            const GraphicsPipelineState& rhs) const noexcept
+{
+    if (lhs.dynamicStateMode != rhs.dynamicStateMode) {
+        return false;
+    }
+    bool extended = lhs.dynamicStateMode != DynamicStateMode::eBaked;
+    bool extended3 = lhs.dynamicStateMode == DynamicStateMode::eExtended3;
+
+    return lhs.vertexShader == rhs.vertexShader && lhs.fragmentShader == rhs.fragmentShader &&
+           lhs.layout == rhs.layout && lhs.colorFormat == rhs.colorFormat && lhs.depthFormat == rhs.depthFormat &&
+           lhs.vertexInput == rhs.vertexInput &&
+           (extended ? topologyClass(lhs.topology) == topologyClass(rhs.topology) : lhs.topology == rhs.topology) &&
+           (extended || (lhs.cullMode == rhs.cullMode && lhs.frontFace == rhs.frontFace &&
+                         lhs.rasterizerDiscard == rhs.rasterizerDiscard &&
+                         lhs.primitiveRestart == rhs.primitiveRestart && lhs.depthBias == rhs.depthBias &&
+                         lhs.depthBiasConstantFactor == rhs.depthBiasConstantFactor &&
+                         lhs.depthBiasSlopeFactor == rhs.depthBiasSlopeFactor && lhs.depthTest == rhs.depthTest &&
+                         lhs.depthWrite == rhs.depthWrite && lhs.depthCompareOp == rhs.depthCompareOp)) &&
+           (extended3 || (lhs.polygonMode == rhs.polygonMode && lhs.alphaBlending == rhs.alphaBlending)) &&
+           lhs.specializationConstants == rhs.specializationConstants;
+}
+
+void setDynamicState(vk::CommandBuffer commandBuffer, const GraphicsPipelineState& state)
+{
+    if (state.dynamicStateMode == DynamicStateMode::eBaked) {
+        return;
+    }
+    commandBuffer.setCullMode(state.cullMode);
+    commandBuffer.setFrontFace(state.frontFace);
+    commandBuffer.setPrimitiveTopology(state.topology);
+    commandBuffer.setDepthTestEnable(state.depthTest ? vk::True : vk::False);
+    commandBuffer.setDepthWriteEnable(state.depthWrite ? vk::True : vk::False);
+    commandBuffer.setDepthCompareOp(state.depthCompareOp);
+    commandBuffer.setRasterizerDiscardEnable(state.rasterizerDiscard ? vk::True : vk::False);
+    commandBuffer.setPrimitiveRestartEnable(state.primitiveRestart ? vk::True : vk::False);
+    commandBuffer.setDepthBiasEnable(state.depthBias ? vk::True : vk::False);
+    commandBuffer.setDepthBias(state.depthBiasConstantFactor, 0.f, state.depthBiasSlopeFactor);
+
+    if (state.dynamicStateMode != DynamicStateMode::eExtended3) {
+        return;
+    }
+    commandBuffer.setPolygonModeEXT(state.polygonMode);
+    vk::Bool32 blendEnable = state.alphaBlending ? vk::True : vk::False;
+    commandBuffer.setColorBlendEnableEXT(0, blendEnable);
+    // Premultiplied, as baked by GraphicsPipelineBuilder::setAlphaBlending
+    vk::ColorBlendEquationEXT blendEquation {
+        .srcColorBlendFactor = vk::BlendFactor::eOne,
+        .dstColorBlendFactor = state.alphaBlending ? vk::BlendFactor::eOneMinusSrcAlpha : vk::BlendFactor::eZero,
+        .colorBlendOp = vk::BlendOp::eAdd,
+        .srcAlphaBlendFactor = vk::BlendFactor::eOne,
+        .dstAlphaBlendFactor = state.alphaBlending ? vk::BlendFactor::eOneMinusSrcAlpha : vk::BlendFactor::eZero,
+        .alphaBlendOp = vk::BlendOp::eAdd};
+    commandBuffer.setColorBlendEquationEXT(0, blendEquation);
+}
+
+bool sameDynamicState(const GraphicsPipelineState& lhs, const GraphicsPipelineState& rhs) noexcept
+{
+    if (lhs.dynamicStateMode != rhs.dynamicStateMode) {
+        return false;
+    }
+    if (lhs.dynamicStateMode == DynamicStateMode::eBaked) {
+        return true;
+    }
+
+    bool extended = lhs.cullMode == rhs.cullMode && lhs.frontFace == rhs.frontFace && lhs.topology == rhs.topology &&
+                    lhs.depthTest == rhs.depthTest && lhs.depthWrite == rhs.depthWrite &&
+                    lhs.depthCompareOp == rhs.depthCompareOp && lhs.rasterizerDiscard == rhs.rasterizerDiscard &&
+                    lhs.primitiveRestart == rhs.primitiveRestart && lhs.depthBias == rhs.depthBias &&
+                    lhs.depthBiasConstantFactor == rhs.depthBiasConstantFactor &&
+                    lhs.depthBiasSlopeFactor == rhs.depthBiasSlopeFactor;
+    return extended && (lhs.dynamicStateMode != DynamicStateMode::eExtended3 ||
+                        (lhs.polygonMode == rhs.polygonMode && lhs.alphaBlending == rhs.alphaBlending));
+}
+
+PipelineRegistry::PipelineRegistry(vk::Device device,
+                                   vk::PipelineCache pipelineCache,
+                                   core::ThreadPool& threadPool) noexcept
+    : m_device(device)
+    , m_pipelineCache(pipelineCache)
+    , m_threadPool(&threadPool)
+{}
+
+PipelineRegistry::~PipelineRegistry() noexcept
+{
+    for (auto& [state, entry] : m_entries) {
+        if (entry.pending.valid()) {
+            entry.pending.wait();
+        }
+    }
+}
+
+vk::Pipeline PipelineRegistry::get(const GraphicsPipelineState& state, vk::Pipeline fallback)
+{
+    auto [it, inserted] = m_entries.try_emplace(state);
+    Entry& entry = it->second;
+    if (inserted) {
+        entry.id = static_cast<uint32_t>(m_entries.size() - 1);
+        // Without compiling, this only succeeds if the pipeline cache has the pipeline, and takes microseconds
+        try {
+            entry.pipeline = buildPipeline(m_device,
+                                           m_pipelineCache,
+                                           withReloadedShaders(state),
+                                           vk::PipelineCreateFlagBits::eFailOnPipelineCompileRequired);
+        } catch (const std::exception& e) {
+            WARN_FMT("Could not create pipeline for {} and {}: {}\n",
+                     state.vertexShader.path.string(),
+                     state.fragmentShader.path.string(),
+                     e.what());
+            entry.failed = true;
+            ++m_stats.failed;
+        }
+
+        if (entry.pipeline) {
+            ++m_stats.cacheHits;
+        } else if (!entry.failed) {
+            compile(state, entry);
+        }
+    }
+    return entry.pipeline ? *entry.pipeline : fallback;
+}
+
+uint32_t PipelineRegistry::id(const GraphicsPipelineState& state) const
+{
+    auto it = m_entries.find(state);
+    assert(it != m_entries.end());
+    return it->second.id;
+}
+
+void PipelineRegistry::reload(const std::filesystem::path& shader)
+{
+    if (std::ranges::find(m_reloadedShaders, shader) == m_reloadedShaders.end()) {
+        m_reloadedShaders.push_back(shader);
+    }
+
+    for (auto& [state, entry] : m_entries) {
+        if (state.vertexShader.path != shader && state.fragmentShader.path != shader) {
+            continue;
+        }
+
+        entry.failed = false;
+        if (entry.pending.valid()) {
+            entry.reloadRequested = true;
+        } else {
+            compile(state, entry);
+        }
+    }
+}
+
+void PipelineRegistry::update(size_t frame, DeletionQueue& deletionQueue)
+{
+    for (auto& [state, entry] : m_entries) {
+        if (!core::isReady(entry.pending)) {
+            continue;
+        }
+
+        try {
+            vk::UniquePipeline pipeline = entry.pending.get();
+            if (!pipeline) {
+                throw std::runtime_error("pipeline creation failed");
+            }
+            if (entry.pipeline) {
+                deletionQueue.retire(frame, std::move(entry.pipeline));
+            }
+            entry.pipeline = std::move(pipeline);
+            ++m_stats.compiled;
+        } catch (const std::exception& e) {
+            WARN_FMT("Could not compile pipeline for {} and {}{}: {}\n",
+                     state.vertexShader.path.string(),
+                     state.fragmentShader.path.string(),
+                     entry.pipeline ? ", keeping the previous one" : "",
+                     e.what());
+            entry.failed = !entry.pipeline;
+            ++m_stats.failed;
+        }
+
+        if (entry.reloadRequested) {
+            entry.reloadRequested = false;
+            compile(state, entry);
+        }
+    }
+}
+
+size_t PipelineRegistry::pendingCount() const noexcept
+{
+    size_t count = 0;
+    for (const auto& [state, entry] : m_entries) {
+        count += entry.pending.valid() ? 1u : 0u;
+    }
+    return count;
+}
+
+void PipelineRegistry::compile(const GraphicsPipelineState& state, Entry& entry)
+{
+    // The job gets its own copy of the state, the map may rehash while it runs
+    entry.pending = m_threadPool->submit(
+        [device = m_device, pipelineCache = m_pipelineCache, state = withReloadedShaders(state)]() {
+            return buildPipeline(device, pipelineCache, state, {});
+        });
+}
+
+GraphicsPipelineState PipelineRegistry::withReloadedShaders(const GraphicsPipelineState& state) const
+{
+    GraphicsPipelineState resolved = state;
+    for (ShaderSource* shader : {&resolved.vertexShader, &resolved.fragmentShader}) {
+        if (std::ranges::find(m_reloadedShaders, shader->path) != m_reloadedShaders.end()) {
+            shader->code = {};
+        }
+    }
+    return resolved;
+}
+
+}   // namespace renderer
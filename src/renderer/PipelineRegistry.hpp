@@ -0,0 +1,143 @@
+#ifndef RENDERER_PIPELINE_REGISTRY_HPP
+#define RENDERER_PIPELINE_REGISTRY_HPP
+
+#include "GraphicsPipelineBuilder.hpp"
+#include "SpecializationConstants.hpp"
+
+// libs
+#include <vulkan/vulkan.hpp>
+
+// std
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <future>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+namespace core
+{
+class ThreadPool;
+}
+
+namespace renderer
+{
+class DeletionQueue;
+
+// SPIR-V embedded in the executable, and the file it was compiled to, which replaces it once hot reloaded
+struct ShaderSource {
+    std::filesystem::path path;
+    std::span<const uint32_t> code;   // read from path when empty
+
+    bool operator==(const ShaderSource& rhs) const noexcept
+    {
+        return path == rhs.path && code.data() == rhs.code.data() && code.size() == rhs.code.size();
+    }
+};
+
+// Everything a graphics pipeline is built from. Identical states share a single pipeline, and states only differing in
+// what dynamicStateMode leaves dynamic too
+struct GraphicsPipelineState {
+    ShaderSource vertexShader;
+    ShaderSource fragmentShader;
+    vk::PipelineLayout layout;
+    vk::Format colorFormat = vk::Format::eUndefined;
+    vk::Format depthFormat = vk::Format::eUndefined;
+    vk::PrimitiveTopology topology = vk::PrimitiveTopology::eTriangleList;
+    vk::PolygonMode polygonMode = vk::PolygonMode::eFill;
+    vk::CullModeFlags cullMode = vk::CullModeFlagBits::eBack;
+    vk::FrontFace frontFace = vk::FrontFace::eCounterClockwise;
+    bool rasterizerDiscard = false;
+    bool primitiveRestart = false;
+    bool depthBias = false;   // the factors are only applied when enabled
+    float depthBiasConstantFactor = 0.f;
+    float depthBiasSlopeFactor = 0.f;
+    bool depthTest = false;
+    bool depthWrite = false;
+    vk::CompareOp depthCompareOp = vk::CompareOp::eAlways;
+    bool alphaBlending = false;
+    VertexInput vertexInput = VertexInput::eVertex;
+    DynamicStateMode dynamicStateMode = DynamicStateMode::eBaked;
+    SpecializationConstants specializationConstants;
+};
+
+// Both ignore the states left dynamic
+struct GraphicsPipelineStateHash {
+    size_t operator()(const GraphicsPipelineState& state) const noexcept;
+};
+
+struct GraphicsPipelineStateEqual {
+    bool operator()(const GraphicsPipelineState& lhs, const GraphicsPipelineState& rhs) const noexcept;
+};
+
+// Records the states dynamicStateMode leaves dynamic, after binding the pipeline of the state
+void setDynamicState(vk::CommandBuffer commandBuffer, const GraphicsPipelineState& state);
+// Whether setDynamicState records the same states for both, which may then share a pipeline but not their draws
+bool sameDynamicState(const GraphicsPipelineState& lhs, const GraphicsPipelineState& rhs) noexcept;
+
+struct PipelineRegistryStats {
+    size_t cacheHits = 0;   // created from the pipeline cache without compiling
+    size_t compiled = 0;    // compiled on a worker
+    size_t failed = 0;
+};
+
+// Compiles graphics pipelines on the worker threads, so requesting a new state never stalls the frame. A state
+// first tries the pipeline cache with eFailOnPipelineCompileRequired, which is cheap, and is only compiled in the
+// background when that fails
+class PipelineRegistry
+{
+public:
+    PipelineRegistry() noexcept = default;
+    PipelineRegistry(vk::Device device, vk::PipelineCache pipelineCache, core::ThreadPool& threadPool) noexcept;
+
+    PipelineRegistry(const PipelineRegistry&) = delete;
+    PipelineRegistry& operator=(const PipelineRegistry&) = delete;
+
+    PipelineRegistry(PipelineRegistry&&) noexcept = default;
+    PipelineRegistry& operator=(PipelineRegistry&&) noexcept = default;
+
+    // Waits for the pending compilations, as they use the layouts of their states
+    ~PipelineRegistry() noexcept;
+
+public:
+    // Returns fallback while the pipeline is compiling, or if it failed to compile
+    vk::Pipeline get(const GraphicsPipelineState& state, vk::Pipeline fallback = nullptr);
+    // Of a state already requested with get, numbered in request order. Stable across reloads, for sort keys
+    uint32_t id(const GraphicsPipelineState& state) const;
+
+    // Compiles again every pipeline using the shader, read from its path from now on. The previous pipelines are used
+    // until the new ones are ready, and kept if they fail
+    void reload(const std::filesystem::path& shader);
+
+    // Swaps in the pipelines compiled since the last call, retiring those they replace. Call once per frame
+    void update(size_t frame, DeletionQueue& deletionQueue);
+
+    size_t pendingCount() const noexcept;
+    const PipelineRegistryStats& stats() const noexcept { return m_stats; }
+
+private:
+    struct Entry {
+        vk::UniquePipeline pipeline;
+        std::future<vk::UniquePipeline> pending;
+        bool reloadRequested = false;   // the shaders changed again while compiling
+        bool failed = false;            // and no pipeline to fall back on
+        uint32_t id = 0;
+    };
+
+    void compile(const GraphicsPipelineState& state, Entry& entry);
+    // Drops the embedded code of the reloaded shaders, so they are read from disk
+    GraphicsPipelineState withReloadedShaders(const GraphicsPipelineState& state) const;
+
+private:
+    vk::Device m_device;                        // not owned
+    vk::PipelineCache m_pipelineCache;          // not owned
+    core::ThreadPool* m_threadPool = nullptr;   // not owned
+    std::unordered_map<GraphicsPipelineState, Entry, GraphicsPipelineStateHash, GraphicsPipelineStateEqual> m_entries;
+    std::vector<std::filesystem::path> m_reloadedShaders;
+    PipelineRegistryStats m_stats;
+};
+
+}   // namespace renderer
+
+#endif
@@ -0,0 +1,34 @@
+#ifndef RENDERER_PUSH_CONSTANTS_HPP
+#define RENDERER_PUSH_CONSTANTS_HPP
+
+// libs
+#include <vulkan/vulkan.hpp>
+
+// std
+#include <cstdint>
+#include <type_traits>
+
+namespace renderer
+{
+
+// maxPushConstantsSize every device supports
+inline constexpr uint32_t MIN_MAX_PUSH_CONSTANTS_SIZE = 128;
+
+// Records per-draw data straight into the command buffer, without descriptor or buffer updates. T mirrors the shader's
+// push constant block at offset, which the pipeline layout must cover for stages
+template <typename T>
+void pushConstants(vk::CommandBuffer commandBuffer,
+                   vk::PipelineLayout layout,
+                   vk::ShaderStageFlags stages,
+                   const T& constants,
+                   uint32_t offset = 0)
+{
+    static_assert(std::is_trivially_copyable_v<T>, "push constants are copied bytewise");
+    static_assert(sizeof(T) % 4 == 0, "push constant sizes are multiples of 4 bytes");
+    static_assert(sizeof(T) <= MIN_MAX_PUSH_CONSTANTS_SIZE, "larger push constants are not supported everywhere");
+    commandBuffer.pushConstants(layout, stages, offset, static_cast<uint32_t>(sizeof(T)), &constants);
+}
+
+}   // namespace renderer
+
+#endif
@@ -0,0 +1,760 @@
+#include "RenderGraph.hpp"
+
+#include "DeletionQueue.hpp"
+#include "Utils.hpp"
+#include "core/Logger.hpp"
+
+// std
+#include <algorithm>
+#include <cassert>
+#include <limits>
+#include <numeric>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+namespace renderer
+{
+
+namespace
+{
+constexpr uint32_t NO_TRANSIENT = std::numeric_limits<uint32_t>::max();
+
+constexpr vk::AccessFlags2 WRITE_ACCESS = vk::AccessFlagBits2::eShaderStorageWrite |
+                                          vk::AccessFlagBits2::eColorAttachmentWrite |
+                                          vk::AccessFlagBits2::eDepthStencilAttachmentWrite |
+                                          vk::AccessFlagBits2::eTransferWrite;
+constexpr vk::PipelineStageFlags2 DEPTH_TEST_STAGES = vk::PipelineStageFlagBits2::eEarlyFragmentTests |
+                                                      vk::PipelineStageFlagBits2::eLateFragmentTests;
+constexpr vk::AccessFlags2 DEPTH_ATTACHMENT_ACCESS = vk::AccessFlagBits2::eDepthStencilAttachmentRead |
+                                                     vk::AccessFlagBits2::eDepthStencilAttachmentWrite;
+
+struct Access {
+    vk::PipelineStageFlags2 stages;
+    vk::AccessFlags2 access;
+    vk::ImageLayout layout;   // eUndefined for buffers
+    bool readsPrevious;       // false if the previous contents are cleared or overwritten
+};
+
+Access imageAccess(ImageUsage usage) noexcept
+{
+    switch (usage) {
+        case ImageUsage::eColorAttachmentWrite:
+            return {vk::PipelineStageFlagBits2::eColorAttachmentOutput,
+                    vk::AccessFlagBits2::eColorAttachmentWrite,
+                    vk::ImageLayout::eColorAttachmentOptimal,
+                    false};
+        case ImageUsage::eColorAttachmentReadWrite:
+            return {vk::PipelineStageFlagBits2::eColorAttachmentOutput,
+                    vk::AccessFlagBits2::eColorAttachmentRead | vk::AccessFlagBits2::eColorAttachmentWrite,
+                    vk::ImageLayout::eColorAttachmentOptimal,
+                    true};
+        case ImageUsage::eDepthAttachmentWrite:
+            return {DEPTH_TEST_STAGES, DEPTH_ATTACHMENT_ACCESS, vk::ImageLayout::eDepthStencilAttachmentOptimal, false};
+        case ImageUsage::eDepthAttachmentReadWrite:
+            return {DEPTH_TEST_STAGES, DEPTH_ATTACHMENT_ACCESS, vk::ImageLayout::eDepthStencilAttachmentOptimal, true};
+        case ImageUsage::eComputeSampled:
+            return {vk::PipelineStageFlagBits2::eComputeShader,
+                    vk::AccessFlagBits2::eShaderSampledRead,
+                    vk::ImageLayout::eShaderReadOnlyOptimal,
+                    true};
+        case ImageUsage::eFragmentSampled:
+            return {vk::PipelineStageFlagBits2::eFragmentShader,
+                    vk::AccessFlagBits2::eShaderSampledRead,
+                    vk::ImageLayout::eShaderReadOnlyOptimal,
+                    true};
+        case ImageUsage::eComputeStorageRead:
+            return {vk::PipelineStageFlagBits2::eComputeShader,
+                    vk::AccessFlagBits2::eShaderStorageRead | vk::AccessFlagBits2::eShaderSampledRead,
+                    vk::ImageLayout::eGeneral,
+                    true};
+        case ImageUsage::eComputeStorageReadWrite:
+            return {vk::PipelineStageFlagBits2::eComputeShader,
+                    vk::AccessFlagBits2::eShaderStorageRead | vk::AccessFlagBits2::eShaderSampledRead |
+                        vk::AccessFlagBits2::eShaderStorageWrite,
+                    vk::ImageLayout::eGeneral,
+                    true};
+        case ImageUsage::eTransferWrite:
+            return {vk::PipelineStageFlagBits2::eAllTransfer,
+                    vk::AccessFlagBits2::eTransferWrite,
+                    vk::ImageLayout::eTransferDstOptimal,
+                    false};
+        default:
+            assert(0);
+            return {};
+    }
+}
+
+Access bufferAccess(BufferUsage usage) noexcept
+{
+    switch (usage) {
+        case BufferUsage::eTransferWrite:
+            return {vk::PipelineStageFlagBits2::eAllTransfer,
+                    vk::AccessFlagBits2::eTransferWrite,
+                    vk::ImageLayout::eUndefined,
+                    false};
+        case BufferUsage::eComputeStorageRead:
+            return {vk::PipelineStageFlagBits2::eComputeShader,
+                    vk::AccessFlagBits2::eShaderStorageRead,
+                    vk::ImageLayout::eUndefined,
+                    true};
+        case BufferUsage::eComputeStorageWrite:
+            return {vk::PipelineStageFlagBits2::eComputeShader,
+                    vk::AccessFlagBits2::eShaderStorageWrite,
+                    vk::ImageLayout::eUndefined,
+                    false};
+        case BufferUsage::eComputeStorageReadWrite:
+            return {vk::PipelineStageFlagBits2::eComputeShader,
+                    vk::AccessFlagBits2::eShaderStorageRead | vk::AccessFlagBits2::eShaderStorageWrite,
+                    vk::ImageLayout::eUndefined,
+                    true};
+        case BufferUsage::eIndirectRead:
+            return {vk::PipelineStageFlagBits2::eDrawIndirect,
+                    vk::AccessFlagBits2::eIndirectCommandRead,
+                    vk::ImageLayout::eUndefined,
+                    true};
+        default:
+            assert(0);
+            return {};
+    }
+}
+
+vk::ImageUsageFlags imageUsageFlags(ImageUsage usage) noexcept
+{
+    switch (usage) {
+        case ImageUsage::eColorAttachmentWrite:
+        case ImageUsage::eColorAttachmentReadWrite: return vk::ImageUsageFlagBits::eColorAttachment;
+        case ImageUsage::eDepthAttachmentWrite:
+        case ImageUsage::eDepthAttachmentReadWrite: return vk::ImageUsageFlagBits::eDepthStencilAttachment;
+        case ImageUsage::eComputeSampled:
+        case ImageUsage::eFragmentSampled: return vk::ImageUsageFlagBits::eSampled;
+        case ImageUsage::eComputeStorageRead:
+        case ImageUsage::eComputeStorageReadWrite: return vk::ImageUsageFlagBits::eStorage;
+        case ImageUsage::eTransferWrite: return vk::ImageUsageFlagBits::eTransferDst;
+        default:
+            assert(0);
+            return {};
+    }
+}
+
+vk::ImageAspectFlags aspectMask(vk::Format format) noexcept
+{
+    switch (format) {
+        case vk::Format::eD16Unorm:
+        case vk::Format::eX8D24UnormPack32:
+        case vk::Format::eD32Sfloat: return vk::ImageAspectFlagBits::eDepth;
+        case vk::Format::eS8Uint: return vk::ImageAspectFlagBits::eStencil;
+        case vk::Format::eD16UnormS8Uint:
+        case vk::Format::eD24UnormS8Uint:
+        case vk::Format::eD32SfloatS8Uint: return vk::ImageAspectFlagBits::eDepth | vk::ImageAspectFlagBits::eStencil;
+        default: return vk::ImageAspectFlagBits::eColor;
+    }
+}
+
+// The usages of a resource by a pass, merged
+struct ResourceAccess {
+    uint32_t resource;
+    Access access;
+};
+
+template <typename Use, typename AccessFunction>
+std::vector<ResourceAccess> mergeUses(std::span<const Use> uses, AccessFunction accessOf)
+{
+    std::vector<ResourceAccess> accesses;
+    for (const auto& use : uses) {
+        Access access = accessOf(use.usage);
+        auto it = std::ranges::find(accesses, use.resource, &ResourceAccess::resource);
+        if (it == accesses.end()) {
+            accesses.push_back({use.resource, access});
+            continue;
+        }
+        assert(it->access.layout == access.layout);
+        it->access.stages |= access.stages;
+        it->access.access |= access.access;
+        it->access.readsPrevious = it->access.readsPrevious || access.readsPrevious;
+    }
+    return accesses;
+}
+
+// What the next access of a resource has to wait for
+struct ResourceState {
+    vk::ImageLayout layout;
+    // Of the last write or layout transition
+    vk::PipelineStageFlags2 writeStages;
+    vk::AccessFlags2 writeAccess;
+    // Of the reads since, which already wait for it
+    vk::PipelineStageFlags2 readStages;
+    vk::AccessFlags2 readAccess;
+};
+
+struct Barrier {
+    vk::PipelineStageFlags2 srcStages;
+    vk::AccessFlags2 srcAccess;
+    vk::ImageLayout oldLayout;
+};
+
+// Updates the state with the access. Layout transitions and writes wait for every previous access, reads only for the
+// last write, unless a previous read already did at the same stages
+std::optional<Barrier> transition(ResourceState& state, const Access& access) noexcept
+{
+    bool layoutChange = state.layout != access.layout;
+    bool writes = static_cast<bool>(access.access & WRITE_ACCESS);
+    Barrier barrier {.srcStages = state.writeStages | state.readStages,
+                     .srcAccess = state.writeAccess,
+                     .oldLayout = state.layout};
+
+    if (layoutChange || writes) {
+        // The transition itself is ordered before the access, so it is what later accesses wait for
+        state = {.layout = access.layout,
+                 .writeStages = access.stages,
+                 .writeAccess = access.access & WRITE_ACCESS,
+                 .readStages = writes ? vk::PipelineStageFlags2 {} : access.stages,
+                 .readAccess = writes ? vk::AccessFlags2 {} : access.access};
+        if (!layoutChange && !barrier.srcStages) {
+            return std::nullopt;
+        }
+        return barrier;
+    }
+
+    bool waited = !(access.stages & ~state.readStages) && !(access.access & ~state.readAccess);
+    state.readStages |= access.stages;
+    state.readAccess |= access.access;
+    if (waited || !state.writeStages) {
+        return std::nullopt;
+    }
+    barrier.srcStages = state.writeStages;
+    return barrier;
+}
+
+void pipelineBarrier(vk::CommandBuffer commandBuffer,
+                     std::span<const vk::ImageMemoryBarrier2> imageBarriers,
+                     std::span<const vk::BufferMemoryBarrier2> bufferBarriers)
+{
+    if (imageBarriers.empty() && bufferBarriers.empty()) {
+        return;
+    }
+
+    vk::DependencyInfo dependencyInfo {.sType = vk::StructureType::eDependencyInfo,
+                                       .pNext = nullptr,
+                                       .dependencyFlags = {},
+                                       .memoryBarrierCount = 0,
+                                       .pMemoryBarriers = nullptr,
+                                       .bufferMemoryBarrierCount = static_cast<uint32_t>(bufferBarriers.size()),
+                                       .pBufferMemoryBarriers = bufferBarriers.data(),
+                                       .imageMemoryBarrierCount = static_cast<uint32_t>(imageBarriers.size()),
+                                       .pImageMemoryBarriers = imageBarriers.data()};
+
+    commandBuffer.pipelineBarrier2(dependencyInfo);
+}
+}   // namespace
+
+// Begin RenderGraphPass
+RenderGraphPass::RenderGraphPass(std::string name, std::function<void(vk::CommandBuffer)> record)
+    : m_name(std::move(name))
+    , m_record(std::move(record))
+{}
+
+RenderGraphPass& RenderGraphPass::use(RenderGraphImage image, ImageUsage usage)
+{
+    m_images.push_back({.resource = image.index, .usage = usage});
+    return *this;
+}
+
+RenderGraphPass& RenderGraphPass::use(RenderGraphBuffer buffer, BufferUsage usage)
+{
+    m_buffers.push_back({.resource = buffer.index, .usage = usage});
+    return *this;
+}
+// End RenderGraphPass
+
+// Begin RenderGraph::TransientMemory
+RenderGraph::TransientMemory::TransientMemory(VmaAllocator allocator, const vk::MemoryRequirements& requirements)
+    : m_allocator(allocator)
+{
+    VmaAllocationCreateInfo allocationCreateInfo {.flags = VMA_ALLOCATION_CREATE_DEDICATED_MEMORY_BIT,
+                                                  .usage = VMA_MEMORY_USAGE_UNKNOWN,
+                                                  .requiredFlags = {},
+                                                  .preferredFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                                                  .memoryTypeBits = {},
+                                                  .pool = nullptr,
+                                                  .pUserData = nullptr,
+                                                  .priority = 0.f};
+
+    VkMemoryRequirements memoryRequirements = requirements;
+    vk::detail::resultCheck(static_cast<vk::Result>(vmaAllocateMemory(m_allocator,
+                                                                      &memoryRequirements,
+                                                                      &allocationCreateInfo,
+                                                                      &m_allocation,
+                                                                      nullptr)),
+                            "vmaAllocateMemory");
+}
+
+RenderGraph::TransientMemory::TransientMemory(TransientMemory&& rhs) noexcept
+    : m_allocator(std::exchange(rhs.m_allocator, nullptr))
+    , m_allocation(std::exchange(rhs.m_allocation, nullptr))
+{}
+
+RenderGraph::TransientMemory& RenderGraph::TransientMemory::operator=(TransientMemory&& rhs) noexcept
+{
+    if (this != &rhs) {
+        std::swap(m_allocator, rhs.m_allocator);
+        std::swap(m_allocation, rhs.m_allocation);
+    }
+    return *this;
+}
+
+RenderGraph::TransientMemory::~TransientMemory() noexcept
+{
+    if (m_allocator) {
+        vmaFreeMemory(m_allocator, m_allocation);
+    }
+}
+
+void RenderGraph::TransientMemory::bind(vk::Image image, vk::DeviceSize offset) const
+{
+    auto result = vmaBindImageMemory2(m_allocator, m_allocation, offset, static_cast<VkImage>(image), nullptr);
+    vk::detail::resultCheck(static_cast<vk::Result>(result), "vmaBindImageMemory2");
+}
+// End RenderGraph::TransientMemory
+
+// Begin RenderGraph
+RenderGraph::RenderGraph(vk::Device device, VmaAllocator allocator)
+    : m_device(device)
+    , m_allocator(allocator)
+{}
+
+RenderGraphImage RenderGraph::importImage(std::string name, const ImportedImage& image)
+{
+    assert(!m_compiled);
+    m_images.push_back(
+        {.name = std::move(name), .imported = true, .importedImage = image, .desc = {}, .transient = NO_TRANSIENT});
+    return {static_cast<uint32_t>(m_images.size() - 1)};
+}
+
+RenderGraphImage RenderGraph::createImage(std::string name, const TransientImageDesc& desc)
+{
+    assert(!m_compiled);
+    m_images.push_back(
+        {.name = std::move(name), .imported = false, .importedImage = {}, .desc = desc, .transient = NO_TRANSIENT});
+    return {static_cast<uint32_t>(m_images.size() - 1)};
+}
+
+RenderGraphBuffer RenderGraph::importBuffer(std::string name, const ImportedBuffer& buffer)
+{
+    assert(!m_compiled);
+    m_buffers.push_back({.name = std::move(name), .importedBuffer = buffer});
+    return {static_cast<uint32_t>(m_buffers.size() - 1)};
+}
+
+RenderGraphPass& RenderGraph::addPass(std::string name, std::function<void(vk::CommandBuffer)> record)
+{
+    assert(!m_compiled);
+    return m_passes.emplace_back(std::move(name), std::move(record));
+}
+
+void RenderGraph::compile(size_t frame, DeletionQueue& deletionQueue)
+{
+    assert(!m_compiled);
+    std::vector<bool> passUsed = cullPasses();
+
+    std::string culledPasses;
+    for (size_t i = 0; i < m_passes.size(); ++i) {
+        if (!passUsed[i]) {
+            culledPasses += (culledPasses.empty() ? "" : ", ") + m_passes[i].m_name;
+        }
+    }
+    if (culledPasses != m_culledPasses) {
+        DEBUG_FMT("Render graph culled passes: {}\n", culledPasses.empty() ? "none" : culledPasses);
+        m_culledPasses = std::move(culledPasses);
+    }
+
+    allocateTransientImages(passUsed, frame, deletionQueue);
+    inferBarriers(passUsed);
+    m_compiled = true;
+}
+
+vk::Image RenderGraph::image(RenderGraphImage image) const noexcept
+{
+    const auto& resource = m_images[image.index];
+    if (resource.imported) {
+        return resource.importedImage.image;
+    }
+    assert(m_compiled && resource.transient != NO_TRANSIENT);
+    return *m_transientImages[resource.transient].image;
+}
+
+vk::ImageView RenderGraph::imageView(RenderGraphImage image) const noexcept
+{
+    const auto& resource = m_images[image.index];
+    if (resource.imported) {
+        return resource.importedImage.view;
+    }
+    assert(m_compiled && resource.transient != NO_TRANSIENT);
+    return *m_transientImages[resource.transient].view;
+}
+
+vk::ImageView RenderGraph::sampledImageView(RenderGraphImage image) const noexcept
+{
+    const auto& resource = m_images[image.index];
+    if (resource.imported) {
+        return resource.importedImage.sampledView ? resource.importedImage.sampledView : resource.importedImage.view;
+    }
+    assert(m_compiled && resource.transient != NO_TRANSIENT);
+    const auto& transient = m_transientImages[resource.transient];
+    return transient.sampledView ? *transient.sampledView : *transient.view;
+}
+
+void RenderGraph::execute(vk::CommandBuffer commandBuffer)
+{
+    assert(m_compiled);
+    for (const auto& compiled : m_compiledPasses) {
+        pipelineBarrier(commandBuffer, compiled.imageBarriers, compiled.bufferBarriers);
+        m_passes[compiled.pass].m_record(commandBuffer);
+    }
+    pipelineBarrier(commandBuffer, m_finalBarriers, {});
+
+    m_images.clear();
+    m_buffers.clear();
+    m_passes.clear();
+    m_compiledPasses.clear();
+    m_finalBarriers.clear();
+    m_compiled = false;
+}
+
+std::vector<bool> RenderGraph::cullPasses() const
+{
+    // Walking back from the last pass, a pass is used if it writes an imported resource, or an image a used pass after
+    // it reads. Every buffer is imported
+    std::vector<bool> imageNeeded(m_images.size());
+    for (size_t i = 0; i < m_images.size(); ++i) {
+        imageNeeded[i] = m_images[i].imported;
+    }
+
+    std::vector<bool> passUsed(m_passes.size(), false);
+    for (size_t i = m_passes.size(); i-- > 0;) {
+        const auto& pass = m_passes[i];
+        auto images = mergeUses<RenderGraphPass::ImageUse>(pass.m_images, imageAccess);
+        bool used = std::ranges::any_of(pass.m_buffers, [](const auto& use) {
+            return static_cast<bool>(bufferAccess(use.usage).access & WRITE_ACCESS);
+        });
+        used = used || std::ranges::any_of(images, [&imageNeeded](const ResourceAccess& image) {
+            return (image.access.access & WRITE_ACCESS) && imageNeeded[image.resource];
+        });
+        if (!used) {
+            continue;
+        }
+
+        passUsed[i] = true;
+        for (const auto& image : images) {
+            if (image.access.readsPrevious) {
+                imageNeeded[image.resource] = true;
+            } else if (image.access.access & WRITE_ACCESS) {
+                // Overwritten, the passes before only matter to the imported images
+                imageNeeded[image.resource] = m_images[image.resource].imported;
+            }
+        }
+    }
+    return passUsed;
+}
+
+void RenderGraph::allocateTransientImages(const std::vector<bool>& passUsed,
+                                          size_t frame,
+                                          DeletionQueue& deletionQueue)
+{
+    // Usage flags and the range of passes of every transient image used by a pass
+    std::vector<TransientKey> keys;
+    for (auto& resource : m_images) {
+        resource.transient = NO_TRANSIENT;
+    }
+    for (uint32_t pass = 0; pass < m_passes.size(); ++pass) {
+        if (!passUsed[pass]) {
+            continue;
+        }
+        for (const auto& use : m_passes[pass].m_images) {
+            auto& resource = m_images[use.resource];
+            if (resource.imported) {
+                continue;
+            }
+            if (resource.transient == NO_TRANSIENT) {
+                resource.transient = static_cast<uint32_t>(keys.size());
+                keys.push_back({.format = resource.desc.format,
+                                .extent = resource.desc.extent,
+                                .usage = {},
+                                .firstPass = pass,
+                                .lastPass = pass});
+            }
+            auto& key = keys[resource.transient];
+            key.usage |= imageUsageFlags(use.usage);
+            key.lastPass = pass;
+        }
+    }
+
+    if (keys == m_transientKeys) {
+        return;
+    }
+
+    if (!m_transientImages.empty()) {
+        deletionQueue.retire(frame, std::move(m_transientImages));
+        deletionQueue.retire(frame, std::move(m_transientMemory));
+        m_transientImages.clear();
+    }
+    m_transientKeys = keys;
+    if (keys.empty()) {
+        return;
+    }
+
+    std::vector<vk::MemoryRequirements> requirements;
+    for (const auto& key : keys) {
+        vk::ImageCreateInfo imageCreateInfo {
+            .sType = vk::StructureType::eImageCreateInfo,
+            .pNext = nullptr,
+            .flags = {},
+            .imageType = vk::ImageType::e2D,
+            .format = key.format,
+            .extent = {.width = key.extent.width, .height = key.extent.height, .depth = 1},
+            .mipLevels = 1,
+            .arrayLayers = 1,
+            .samples = vk::SampleCountFlagBits::e1,
+            .tiling = vk::ImageTiling::eOptimal,
+            .usage = key.usage,
+            .sharingMode = vk::SharingMode::eExclusive,
+            .queueFamilyIndexCount = 0,
+            .pQueueFamilyIndices = nullptr,
+            .initialLayout = vk::ImageLayout::eUndefined
+        };
+
+        auto& transient = m_transientImages.emplace_back();
+        transient.image = m_device.createImageUnique(imageCreateInfo);
+        requirements.push_back(m_device.getImageMemoryRequirements(*transient.image));
+        transient.size = requirements.back().size;
+    }
+
+    // Largest first, each at the lowest offset left free by the images placed so far whose pass ranges overlap its own
+    std::vector<uint32_t> order(keys.size());
+    std::iota(order.begin(), order.end(), 0u);
+    std::ranges::stable_sort(order, std::ranges::greater {}, [&](uint32_t i) { return requirements[i].size; });
+
+    vk::MemoryRequirements memoryRequirements {.size = 0, .alignment = 1, .memoryTypeBits = ~0u};
+    vk::DeviceSize unaliasedSize = 0;
+    std::vector<uint32_t> placed;
+    for (uint32_t i : order) {
+        std::vector<std::pair<vk::DeviceSize, vk::DeviceSize>> occupied;
+        for (uint32_t j : placed) {
+            if (keys[j].firstPass <= keys[i].lastPass && keys[i].firstPass <= keys[j].lastPass) {
+                const auto& other = m_transientImages[j];
+                occupied.emplace_back(other.offset, other.offset + other.size);
+            }
+        }
+        std::ranges::sort(occupied);
+
+        const vk::DeviceSize alignment = requirements[i].alignment;
+        vk::DeviceSize offset = 0;
+        for (const auto& [begin, end] : occupied) {
+            if (offset + requirements[i].size <= begin) {
+                break;
+            }
+            offset = std::max(offset, (end + alignment - 1) / alignment * alignment);
+        }
+
+        m_transientImages[i].offset = offset;
+        placed.push_back(i);
+        memoryRequirements.size = std::max(memoryRequirements.size, offset + requirements[i].size);
+        memoryRequirements.alignment = std::max(memoryRequirements.alignment, alignment);
+        memoryRequirements.memoryTypeBits &= requirements[i].memoryTypeBits;
+        unaliasedSize += requirements[i].size;
+    }
+
+    if (!memoryRequirements.memoryTypeBits) {
+        throw std::runtime_error("the transient images of the render graph share no memory type");
+    }
+    m_transientMemory = TransientMemory(m_allocator, memoryRequirements);
+
+    for (const auto& resource : m_images) {
+        if (resource.transient == NO_TRANSIENT) {
+            continue;
+        }
+        auto& transient = m_transientImages[resource.transient];
+        m_transientMemory.bind(*transient.image, transient.offset);
+
+        vk::ImageViewCreateInfo imageViewCreateInfo {
+            .sType = vk::StructureType::eImageViewCreateInfo,
+            .pNext = nullptr,
+            .flags = {},
+            .image = *transient.image,
+            .viewType = vk::ImageViewType::e2D,
+            .format = resource.desc.format,
+            .components = {vk::ComponentSwizzle::eIdentity,
+                      vk::ComponentSwizzle::eIdentity,
+                      vk::ComponentSwizzle::eIdentity,
+                      vk::ComponentSwizzle::eIdentity},
+            .subresourceRange = {.aspectMask = aspectMask(resource.desc.format),
+                      .baseMipLevel = 0,
+                      .levelCount = 1,
+                      .baseArrayLayer = 0,
+                      .layerCount = 1}
+        };
+        transient.view = m_device.createImageViewUnique(imageViewCreateInfo);
+
+        if (utils::hasStencilComponent(resource.desc.format) &&
+            (keys[resource.transient].usage & vk::ImageUsageFlagBits::eSampled)) {
+            imageViewCreateInfo.subresourceRange.aspectMask = vk::ImageAspectFlagBits::eDepth;
+            transient.sampledView = m_device.createImageViewUnique(imageViewCreateInfo);
+        }
+
+        DEBUG_FMT("Placed transient image {} at offset {}, {} bytes\n",
+                  resource.name,
+                  transient.offset,
+                  transient.size);
+    }
+
+    DEBUG_FMT("Allocated {} bytes for {} transient images, {} bytes without aliasing\n",
+              memoryRequirements.size,
+              keys.size(),
+              unaliasedSize);
+}
+
+void RenderGraph::inferBarriers(const std::vector<bool>& passUsed)
+{
+    std::vector<ResourceState> imageStates;
+    imageStates.reserve(m_images.size());
+    for (const auto& resource : m_images) {
+        const auto& imported = resource.importedImage;
+        if (resource.imported) {
+            imageStates.push_back({.layout = imported.initialLayout,
+                                   .writeStages = imported.initialStages,
+                                   .writeAccess = imported.initialAccess,
+                                   .readStages = {},
+                                   .readAccess = {}});
+        } else {
+            // Set below, for the transient images used by a pass
+            imageStates.push_back({.layout = vk::ImageLayout::eUndefined,
+                                   .writeStages = {},
+                                   .writeAccess = {},
+                                   .readStages = {},
+                                   .readAccess = {}});
+        }
+    }
+
+    std::vector<ResourceState> bufferStates;
+    bufferStates.reserve(m_buffers.size());
+    for (const auto& resource : m_buffers) {
+        bufferStates.push_back({.layout = vk::ImageLayout::eUndefined,
+                                .writeStages = resource.importedBuffer.initialStages,
+                                .writeAccess = resource.importedBuffer.initialAccess,
+                                .readStages = {},
+                                .readAccess = {}});
+    }
+
+    // Before its first use in the frame, a transient image waits for every access to the memory it shares, by the
+    // images used before it in this frame, and by every image in the previous frames
+    std::vector<Access> transientAccesses(m_transientImages.size());
+    for (uint32_t pass = 0; pass < m_passes.size(); ++pass) {
+        if (!passUsed[pass]) {
+            continue;
+        }
+        for (const auto& use : m_passes[pass].m_images) {
+            uint32_t transient = m_images[use.resource].transient;
+            if (transient != NO_TRANSIENT) {
+                Access access = imageAccess(use.usage);
+                transientAccesses[transient].stages |= access.stages;
+                transientAccesses[transient].access |= access.access & WRITE_ACCESS;
+            }
+        }
+    }
+    for (size_t i = 0; i < m_images.size(); ++i) {
+        uint32_t transient = m_images[i].transient;
+        if (transient == NO_TRANSIENT) {
+            continue;
+        }
+        const auto& image = m_transientImages[transient];
+        for (size_t other = 0; other < m_transientImages.size(); ++other) {
+            const auto& otherImage = m_transientImages[other];
+            if (image.offset < otherImage.offset + otherImage.size && otherImage.offset < image.offset + image.size) {
+                imageStates[i].writeStages |= transientAccesses[other].stages;
+                imageStates[i].writeAccess |= transientAccesses[other].access;
+            }
+        }
+    }
+
+    // Resolved here rather than through image(), which is only valid once the graph is compiled
+    auto imageBarrier = [this](uint32_t index, const Barrier& barrier, const Access& access) {
+        const auto& resource = m_images[index];
+        assert(resource.imported || resource.transient != NO_TRANSIENT);
+        vk::Format format = resource.imported ? resource.importedImage.format : resource.desc.format;
+        vk::Image image =
+            resource.imported ? resource.importedImage.image : *m_transientImages[resource.transient].image;
+        return vk::ImageMemoryBarrier2 {
+            .sType = vk::StructureType::eImageMemoryBarrier2,
+            .pNext = nullptr,
+            .srcStageMask = barrier.srcStages,
+            .srcAccessMask = barrier.srcAccess,
+            .dstStageMask = access.stages,
+            .dstAccessMask = access.access,
+            .oldLayout = barrier.oldLayout,
+            .newLayout = access.layout,
+            .srcQueueFamilyIndex = vk::QueueFamilyIgnored,
+            .dstQueueFamilyIndex = vk::QueueFamilyIgnored,
+            .image = image,
+            .subresourceRange = {.aspectMask = aspectMask(format),
+                                 .baseMipLevel = 0,
+                                 .levelCount = resource.imported ? resource.importedImage.levelCount : 1,
+                                 .baseArrayLayer = 0,
+                                 .layerCount = 1}
+        };
+    };
+
+    m_compiledPasses.clear();
+    for (uint32_t pass = 0; pass < m_passes.size(); ++pass) {
+        if (!passUsed[pass]) {
+            continue;
+        }
+        auto& compiled = m_compiledPasses.emplace_back();
+        compiled.pass = pass;
+
+        for (const auto& image : mergeUses<RenderGraphPass::ImageUse>(m_passes[pass].m_images, imageAccess)) {
+            if (auto barrier = transition(imageStates[image.resource], image.access)) {
+                compiled.imageBarriers.push_back(imageBarrier(image.resource, *barrier, image.access));
+            }
+        }
+
+        for (const auto& buffer : mergeUses<RenderGraphPass::BufferUse>(m_passes[pass].m_buffers, bufferAccess)) {
+            if (auto barrier = transition(bufferStates[buffer.resource], buffer.access)) {
+                compiled.bufferBarriers.push_back({.sType = vk::StructureType::eBufferMemoryBarrier2,
+                                                   .pNext = nullptr,
+                                                   .srcStageMask = barrier->srcStages,
+                                                   .srcAccessMask = barrier->srcAccess,
+                                                   .dstStageMask = buffer.access.stages,
+                                                   .dstAccessMask = buffer.access.access,
+                                                   .srcQueueFamilyIndex = vk::QueueFamilyIgnored,
+                                                   .dstQueueFamilyIndex = vk::QueueFamilyIgnored,
+                                                   .buffer = m_buffers[buffer.resource].importedBuffer.buffer,
+                                                   .offset = 0,
+                                                   .size = vk::WholeSize});
+            }
+        }
+    }
+
+    // Nothing after the graph waits on the final layouts but the semaphores of the submission
+    m_finalBarriers.clear();
+    for (uint32_t i = 0; i < m_images.size(); ++i) {
+        const auto& resource = m_images[i];
+        const auto& state = imageStates[i];
+        vk::ImageLayout finalLayout = resource.importedImage.finalLayout;
+        if (!resource.imported || finalLayout == vk::ImageLayout::eUndefined || finalLayout == state.layout) {
+            continue;
+        }
+        Barrier barrier {.srcStages = state.writeStages | state.readStages,
+                         .srcAccess = state.writeAccess,
+                         .oldLayout = state.layout};
+        Access access {.stages = vk::PipelineStageFlagBits2::eNone,
+                       .access = {},
+                       .layout = finalLayout,
+                       .readsPrevious = true};
+        m_finalBarriers.push_back(imageBarrier(i, barrier, access));
+    }
+}
+// End RenderGraph
+
+}   // namespace renderer
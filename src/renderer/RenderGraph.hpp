@@ -0,0 +1,246 @@
+#ifndef RENDERER_RENDER_GRAPH_HPP
+#define RENDERER_RENDER_GRAPH_HPP
+
+// libs
+#include <vk_mem_alloc.h>
+#include <vulkan/vulkan.hpp>
+
+// std
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace renderer
+{
+class DeletionQueue;
+
+// How a pass accesses an image, which implies the stages, accesses and layout the barriers around it need
+enum class ImageUsage : uint8_t {
+    eColorAttachmentWrite,       // cleared or overwritten
+    eColorAttachmentReadWrite,   // loaded, e.g. to draw over the previous pass
+    eDepthAttachmentWrite,       // cleared
+    eDepthAttachmentReadWrite,   // loaded, tested and written
+    eComputeSampled,             // in eShaderReadOnlyOptimal
+    eFragmentSampled,            // in eShaderReadOnlyOptimal
+    eComputeStorageRead,         // loaded or sampled, in eGeneral
+    eComputeStorageReadWrite,    // in eGeneral
+    eTransferWrite,
+};
+
+enum class BufferUsage : uint8_t {
+    eTransferWrite,
+    eComputeStorageRead,
+    eComputeStorageWrite,
+    eComputeStorageReadWrite,
+    eIndirectRead,
+};
+
+// Handles to the resources of the graph being declared, invalid once it is executed
+struct RenderGraphImage {
+    uint32_t index;
+};
+
+struct RenderGraphBuffer {
+    uint32_t index;
+};
+
+// Image whose contents outlive the graph, e.g. the swapchain image. The passes writing imported resources are never
+// culled
+struct ImportedImage {
+    vk::Image image;
+    vk::ImageView view;
+    vk::ImageView sampledView;   // of a single aspect for combined depth stencil formats, or null to use view
+    vk::Format format;
+    uint32_t levelCount;
+    vk::ImageLayout initialLayout;
+    // eUndefined leaves the image in the layout of its last use
+    vk::ImageLayout finalLayout;
+    // Accesses before the graph its first use must wait for, e.g. the stages the acquire semaphore is waited at
+    vk::PipelineStageFlags2 initialStages;
+    vk::AccessFlags2 initialAccess;
+};
+
+struct ImportedBuffer {
+    vk::Buffer buffer;
+    vk::PipelineStageFlags2 initialStages;
+    vk::AccessFlags2 initialAccess;
+};
+
+// Image only living through the graph, undefined at its first use. Its usage flags follow from the passes using it
+struct TransientImageDesc {
+    vk::Format format;
+    vk::Extent2D extent;
+};
+
+class RenderGraphPass
+{
+public:
+    RenderGraphPass(std::string name, std::function<void(vk::CommandBuffer)> record);
+
+    RenderGraphPass(const RenderGraphPass&) = delete;
+    RenderGraphPass& operator=(const RenderGraphPass&) = delete;
+
+    RenderGraphPass(RenderGraphPass&&) noexcept = default;
+    RenderGraphPass& operator=(RenderGraphPass&&) noexcept = default;
+
+    ~RenderGraphPass() noexcept = default;
+
+public:
+    // A resource used in several ways by the pass, e.g. cleared then written by a shader, is declared once per usage.
+    // The usages of an image must share its layout
+    RenderGraphPass& use(RenderGraphImage image, ImageUsage usage);
+    RenderGraphPass& use(RenderGraphBuffer buffer, BufferUsage usage);
+
+private:
+    friend class RenderGraph;
+
+    struct ImageUse {
+        uint32_t resource;
+        ImageUsage usage;
+    };
+
+    struct BufferUse {
+        uint32_t resource;
+        BufferUsage usage;
+    };
+
+    std::string m_name;
+    std::function<void(vk::CommandBuffer)> m_record;
+    std::vector<ImageUse> m_images;
+    std::vector<BufferUse> m_buffers;
+};
+
+// A frame declared as passes and the resources they use, instead of hand placed barriers. Compiling it culls the
+// passes whose results are never used, infers the narrowest barriers between the remaining ones and batches them per
+// pass, and places the transient images so those not used by overlapping ranges of passes share memory. Passes are
+// executed in declaration order, the graph only adds the synchronization between them; each pass still records its
+// own barriers between its own commands
+class RenderGraph
+{
+public:
+    RenderGraph() noexcept = default;
+    RenderGraph(vk::Device device, VmaAllocator allocator);
+
+    RenderGraph(const RenderGraph&) = delete;
+    RenderGraph& operator=(const RenderGraph&) = delete;
+
+    RenderGraph(RenderGraph&&) noexcept = default;
+    RenderGraph& operator=(RenderGraph&&) noexcept = default;
+
+    ~RenderGraph() noexcept = default;
+
+public:
+    RenderGraphImage importImage(std::string name, const ImportedImage& image);
+    RenderGraphImage createImage(std::string name, const TransientImageDesc& desc);
+    RenderGraphBuffer importBuffer(std::string name, const ImportedBuffer& buffer);
+
+    // The resources it uses are declared on the returned pass, which is only valid until the next addPass
+    RenderGraphPass& addPass(std::string name, std::function<void(vk::CommandBuffer)> record);
+
+    // Culls the passes and allocates the transient images. Their memory is kept across frames, and only reallocated,
+    // retiring the previous one, when the transient images or the passes using them change
+    void compile(size_t frame, DeletionQueue& deletionQueue);
+
+    // Between compile and execute, e.g. to write descriptors, or while recording the passes
+    vk::Image image(RenderGraphImage image) const noexcept;
+    vk::ImageView imageView(RenderGraphImage image) const noexcept;
+    // Of the depth aspect only for combined depth stencil formats, as sampled views cannot cover both aspects
+    vk::ImageView sampledImageView(RenderGraphImage image) const noexcept;
+
+    // Records the passes that were not culled with the barriers before them, then moves the imported images to their
+    // final layout. Clears the graph for the next frame
+    void execute(vk::CommandBuffer commandBuffer);
+
+private:
+    // Memory shared by the transient images
+    class TransientMemory
+    {
+    public:
+        TransientMemory() noexcept = default;
+        TransientMemory(VmaAllocator allocator, const vk::MemoryRequirements& requirements);
+
+        TransientMemory(const TransientMemory&) = delete;
+        TransientMemory& operator=(const TransientMemory&) = delete;
+
+        TransientMemory(TransientMemory&&) noexcept;
+        TransientMemory& operator=(TransientMemory&&) noexcept;
+
+        ~TransientMemory() noexcept;
+
+    public:
+        void bind(vk::Image image, vk::DeviceSize offset) const;
+
+    private:
+        VmaAllocator m_allocator = nullptr;   // not owned
+        VmaAllocation m_allocation = nullptr;
+    };
+
+    struct ImageResource {
+        std::string name;
+        bool imported;
+        ImportedImage importedImage;
+        TransientImageDesc desc;
+        uint32_t transient;   // into m_transientImages, for transient images used by a pass
+    };
+
+    struct BufferResource {
+        std::string name;
+        ImportedBuffer importedBuffer;
+    };
+
+    // What the transient memory was allocated for
+    struct TransientKey {
+        vk::Format format;
+        vk::Extent2D extent;
+        vk::ImageUsageFlags usage;
+        uint32_t firstPass;
+        uint32_t lastPass;
+
+        bool operator==(const TransientKey&) const noexcept = default;
+    };
+
+    struct TransientImage {
+        vk::UniqueImage image;
+        vk::UniqueImageView view;
+        vk::UniqueImageView sampledView;   // null if view only covers a single aspect
+        vk::DeviceSize offset;
+        vk::DeviceSize size;
+    };
+
+    // With the barriers recorded before it
+    struct CompiledPass {
+        uint32_t pass;
+        std::vector<vk::ImageMemoryBarrier2> imageBarriers;
+        std::vector<vk::BufferMemoryBarrier2> bufferBarriers;
+    };
+
+    std::vector<bool> cullPasses() const;
+    void allocateTransientImages(const std::vector<bool>& passUsed, size_t frame, DeletionQueue& deletionQueue);
+    // Also moves the imported images to their final layout, after the last pass
+    void inferBarriers(const std::vector<bool>& passUsed);
+
+    vk::Device m_device;                  // not owned
+    VmaAllocator m_allocator = nullptr;   // not owned
+
+    // Declared for the current frame
+    std::vector<ImageResource> m_images;
+    std::vector<BufferResource> m_buffers;
+    std::vector<RenderGraphPass> m_passes;
+    bool m_compiled = false;
+
+    // In execution order
+    std::vector<CompiledPass> m_compiledPasses;
+    std::vector<vk::ImageMemoryBarrier2> m_finalBarriers;
+
+    // Kept across frames
+    std::string m_culledPasses;   // logged when they change
+    std::vector<TransientKey> m_transientKeys;
+    std::vector<TransientImage> m_transientImages;
+    TransientMemory m_transientMemory;
+};
+
+}   // namespace renderer
+
+#endif
@@ -0,0 +1,121 @@
+#include "RenderQueue.hpp"
+
+#include "PipelineRegistry.hpp"
+#include "PushConstants.hpp"
+
+// std
+#include <array>
+#include <bit>
+#include <utility>
+
+namespace renderer
+{
+
+uint64_t makeSortKey(uint32_t pass, uint32_t pipeline, uint32_t material, uint32_t mesh, float viewDistance) noexcept
+{
+    // The bits of positive floats order like the floats, the top 16 keep the exponent and 7 bits of mantissa
+    uint32_t depth = viewDistance > 0.f ? std::bit_cast<uint32_t>(viewDistance) >> 16 : 0;
+    return (uint64_t {pass & 0xfu} << 60) | (uint64_t {pipeline & 0xfffu} << 48) |
+           (uint64_t {material & 0xffffu} << 32) | (uint64_t {mesh & 0xffffu} << 16) | uint64_t {depth};
+}
+
+void RenderQueue::submit(const DrawItem& item)
+{
+    m_sortEntries.push_back({.key = item.sortKey, .item = static_cast<uint32_t>(m_items.size())});
+    m_items.push_back(item);
+}
+
+void RenderQueue::flush(vk::CommandBuffer commandBuffer)
+{
+    sort();
+    m_stats = {};
+
+    const DrawItem* bound = nullptr;
+    for (const auto& entry : m_sortEntries) {
+        const DrawItem& item = m_items[entry.item];
+
+        // Sets stay bound across pipelines of the same layout
+        bool layoutChanged = !bound || bound->layout != item.layout;
+        bool pipelineChanged = !bound || bound->pipeline != item.pipeline;
+        if (pipelineChanged) {
+            commandBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, item.pipeline);
+            ++m_stats.pipelineBinds;
+        } else {
+            ++m_stats.pipelineBindsSaved;
+        }
+        // States differing only in what is dynamic share a pipeline, and sort next to each other
+        if (item.pipelineState &&
+            (pipelineChanged || !bound->pipelineState ||
+             (bound->pipelineState != item.pipelineState &&
+              !sameDynamicState(*bound->pipelineState, *item.pipelineState)))) {
+            setDynamicState(commandBuffer, *item.pipelineState);
+        }
+
+        if (layoutChanged || bound->materialSetIndex != item.materialSetIndex ||
+            bound->materialSet != item.materialSet) {
+            commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics,
+                                             item.layout,
+                                             item.materialSetIndex,
+                                             item.materialSet,
+                                             nullptr);
+            ++m_stats.descriptorSetBinds;
+        } else {
+            ++m_stats.descriptorSetBindsSaved;
+        }
+
+        if (!bound || bound->vertexBuffer != item.vertexBuffer || bound->instanceBuffer != item.instanceBuffer) {
+            vk::Buffer vertexBuffers[] = {item.vertexBuffer, item.instanceBuffer};
+            vk::DeviceSize offsets[] = {0, 0};
+            commandBuffer.bindVertexBuffers(0, item.instanceBuffer ? 2u : 1u, vertexBuffers, offsets);
+        }
+        if (!bound || bound->indexBuffer != item.indexBuffer) {
+            commandBuffer.bindIndexBuffer(item.indexBuffer, 0, vk::IndexType::eUint32);
+            ++m_stats.indexBufferBinds;
+        } else {
+            ++m_stats.indexBufferBindsSaved;
+        }
+
+        pushConstants(commandBuffer, item.layout, vk::ShaderStageFlagBits::eVertex, item.pushConstants);
+        commandBuffer.drawIndexed(item.indexCount, item.instanceCount, item.firstIndex, 0, item.firstInstance);
+        ++m_stats.draws;
+        bound = &item;
+    }
+
+    m_items.clear();
+    m_sortEntries.clear();
+}
+
+void RenderQueue::sort()
+{
+    constexpr size_t DIGITS = sizeof(uint64_t);
+    constexpr size_t RADIX = 256;
+
+    // Every digit's histogram in a single pass over the keys
+    std::array<std::array<uint32_t, RADIX>, DIGITS> counts {};
+    for (const auto& entry : m_sortEntries) {
+        for (size_t digit = 0; digit < DIGITS; ++digit) {
+            ++counts[digit][(entry.key >> (8 * digit)) & 0xff];
+        }
+    }
+
+    m_sortScratch.resize(m_sortEntries.size());
+    for (size_t digit = 0; digit < DIGITS; ++digit) {
+        auto& digitCounts = counts[digit];
+        // Skipped when every key has the same digit, as with the unused fields of the key
+        uint64_t firstDigit = m_sortEntries.empty() ? 0 : (m_sortEntries.front().key >> (8 * digit)) & 0xff;
+        if (digitCounts[firstDigit] == m_sortEntries.size()) {
+            continue;
+        }
+
+        uint32_t offset = 0;
+        for (auto& count : digitCounts) {
+            offset += std::exchange(count, offset);
+        }
+        for (const auto& entry : m_sortEntries) {
+            m_sortScratch[digitCounts[(entry.key >> (8 * digit)) & 0xff]++] = entry;
+        }
+        std::swap(m_sortEntries, m_sortScratch);
+    }
+}
+
+}   // namespace renderer
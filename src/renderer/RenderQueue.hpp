@@ -0,0 +1,94 @@
+#ifndef RENDERER_RENDER_QUEUE_HPP
+#define RENDERER_RENDER_QUEUE_HPP
+
+#include "Types.hpp"
+
+// libs
+#include <vulkan/vulkan.hpp>
+
+// std
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace renderer
+{
+struct GraphicsPipelineState;
+
+// Most significant first, so the most expensive state changes are grouped first: pass (4 bits), pipeline (12 bits),
+// material (16 bits), mesh (16 bits), then view distance, front to back. Fields are truncated to their width, which
+// only costs binds when ids collide
+uint64_t makeSortKey(uint32_t pass, uint32_t pipeline, uint32_t material, uint32_t mesh, float viewDistance) noexcept;
+
+struct DrawItem {
+    uint64_t sortKey;
+    vk::Pipeline pipeline;
+    const GraphicsPipelineState* pipelineState;   // its dynamic states are set with the pipeline, if not null
+    vk::PipelineLayout layout;
+    uint32_t materialSetIndex;
+    vk::DescriptorSet materialSet;
+    vk::Buffer vertexBuffer;
+    vk::Buffer instanceBuffer;   // bound after vertexBuffer if not null
+    vk::Buffer indexBuffer;      // of uint32_t indices
+    uint32_t indexCount;
+    uint32_t firstIndex;
+    uint32_t instanceCount;
+    uint32_t firstInstance;
+    DrawPushConstants pushConstants;   // to the vertex stage
+};
+
+// Of the last flush. Saved binds were skipped as the same state was still bound
+struct RenderQueueStats {
+    size_t draws = 0;
+    size_t pipelineBinds = 0;
+    size_t pipelineBindsSaved = 0;
+    size_t descriptorSetBinds = 0;
+    size_t descriptorSetBindsSaved = 0;
+    size_t indexBufferBinds = 0;
+    size_t indexBufferBindsSaved = 0;
+};
+
+// Collects a frame's draws, then records them sorted by key, only binding what changes between consecutive draws
+class RenderQueue
+{
+public:
+    RenderQueue() noexcept = default;
+
+    RenderQueue(const RenderQueue&) = delete;
+    RenderQueue& operator=(const RenderQueue&) = delete;
+
+    RenderQueue(RenderQueue&&) noexcept = default;
+    RenderQueue& operator=(RenderQueue&&) noexcept = default;
+
+    ~RenderQueue() noexcept = default;
+
+public:
+    void submit(const DrawItem& item);
+
+    // Within rendering, and empties the queue. Binds each draw's pipeline, material set and buffers, starting from
+    // nothing bound. The other sets of the draws' layouts must already be bound by the caller, such as the Renderer's
+    // global set 0, bound by the test scene draw before the flush
+    void flush(vk::CommandBuffer commandBuffer);
+
+    size_t size() const noexcept { return m_items.size(); }
+    const RenderQueueStats& stats() const noexcept { return m_stats; }
+
+private:
+    struct SortEntry {
+        uint64_t key;
+        uint32_t item;
+    };
+
+    // Stable LSD radix sort of m_sortEntries, a byte at a time
+    void sort();
+
+private:
+    std::vector<DrawItem> m_items;
+    std::vector<SortEntry> m_sortEntries;
+    std::vector<SortEntry> m_sortScratch;
+    RenderQueueStats m_stats;
+};
+
+}   // namespace renderer
+
+#endif
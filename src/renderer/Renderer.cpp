@@ -1,33 +1,101 @@
 #include "Renderer.hpp"
 
-#include "DescriptorSetLayoutBuilder.hpp"
-#include "GraphicsPipelineBuilder.hpp"
-#include "PipelineLayoutBuilder.hpp"
+#include "ComputePipelineBuilder.hpp"
+#include "MeshLod.hpp"
+#include "MeshOptimizer.hpp"
+#include "MeshletBuilder.hpp"
+#include "PushConstants.hpp"
+#include "ShaderReflection.hpp"
+#include "Utils.hpp"
+#include "core/File.hpp"
 #include "core/Logger.hpp"
+#include "shaders/depth_reduce_comp.hpp"
+#include "shaders/frustum_cull_comp.hpp"
+#include "shaders/simple_shader_frag.hpp"
+#include "shaders/simple_shader_vert.hpp"
+#include "shaders/sprite_frag.hpp"
+#include "shaders/sprite_vert.hpp"
+#include "shaders/text_frag.hpp"
+#include "shaders/upscale_frag.hpp"
+#include "shaders/upscale_vert.hpp"
 
 // libs
+#include <SDL_filesystem.h>
 #include <SDL_vulkan.h>
 #include <glm/ext/matrix_clip_space.hpp>
 #include <glm/ext/matrix_transform.hpp>
 #include <stb_image.h>
+#include <vulkan/vulkan_to_string.hpp>
 
 // std
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
 #include <cstdint>
+#include <exception>
+#include <iterator>
 #include <limits>
+#include <memory>
+#include <stdexcept>
+#include <utility>
 #include <vector>
 
 namespace renderer
 {
 
 // TODO: remove
-static const std::vector<Vertex> vertices = {
-    {{-0.5f, -0.5f}, {1.0f, 0.0f, 0.0f}, {1.0f, 0.0f}},
-    { {0.5f, -0.5f}, {0.0f, 1.0f, 0.0f}, {0.0f, 0.0f}},
-    {  {0.5f, 0.5f}, {0.0f, 0.0f, 1.0f}, {0.0f, 1.0f}},
-    { {-0.5f, 0.5f}, {1.0f, 1.0f, 1.0f}, {1.0f, 1.0f}}
+static const std::vector<Vertex> quadVertices = {
+    {{-0.5f, -0.5f, 0.0f}, {1.0f, 0.0f, 0.0f}, {1.0f, 0.0f}},
+    { {0.5f, -0.5f, 0.0f}, {0.0f, 1.0f, 0.0f}, {0.0f, 0.0f}},
+    {  {0.5f, 0.5f, 0.0f}, {0.0f, 0.0f, 1.0f}, {0.0f, 1.0f}},
+    { {-0.5f, 0.5f, 0.0f}, {1.0f, 1.0f, 1.0f}, {1.0f, 1.0f}}
 };
 
-static const std::vector<uint32_t> indices = {0, 1, 2, 2, 3, 0};
+static const std::vector<uint32_t> quadIndices = {0, 1, 2, 2, 3, 0};
+
+// Quads per side of the GPU culled grid under the test mesh
+static constexpr int TEST_SCENE_GRID_SIZE = 64;
+static constexpr float TEST_SCENE_GRID_SPACING = 1.5f;
+
+// Vertex and index ranges converted per worker job when importing meshes
+static constexpr size_t IMPORT_CONVERSION_CHUNK = 64 * 1024;
+// Full detail included
+static constexpr uint32_t IMPORT_MAX_LODS = 5;
+
+// Next to the executable, as it is only valid for the machine that wrote it. In the working directory if SDL cannot
+// tell where the executable is
+static std::filesystem::path pipelineCachePath()
+{
+    std::unique_ptr<char, decltype(&SDL_free)> basePath(SDL_GetBasePath(), &SDL_free);
+    return (basePath ? std::filesystem::path(basePath.get()) : std::filesystem::path()) / "pipeline_cache.bin";
+}
+
+// Embedded at build time, the files are only read once they change
+static const std::filesystem::path simpleShaderVertPath = "../shaders/simple_shader.vert.spv";
+static const std::filesystem::path simpleShaderFragPath = "../shaders/simple_shader.frag.spv";
+static const std::filesystem::path spriteVertPath = "../shaders/sprite.vert.spv";
+static const std::filesystem::path spriteFragPath = "../shaders/sprite.frag.spv";
+static const std::filesystem::path textFragPath = "../shaders/text.frag.spv";
+static const std::filesystem::path upscaleVertPath = "../shaders/upscale.vert.spv";
+static const std::filesystem::path upscaleFragPath = "../shaders/upscale.frag.spv";
+// Depth is 1 at the near plane and 0 at infinity, see utils::perspectiveReverseZ
+static constexpr float REVERSE_Z_CLEAR_DEPTH = 0.f;
+static constexpr vk::CompareOp REVERSE_Z_COMPARE_OP = vk::CompareOp::eGreater;
+static constexpr float CAMERA_NEAR_PLANE = 0.1f;
+
+// Render queue passes, drawn in order
+static constexpr uint32_t MAIN_PASS = 0;
+
+// Descriptor sets of the simple shader
+static constexpr uint32_t GLOBAL_SET = 0;
+static constexpr uint32_t TEXTURE_SET = 1;
+// Descriptor set of the sprite and text shaders
+static constexpr uint32_t SPRITE_TEXTURE_SET = 0;
+// Descriptor set of the upscale shader, the scene color
+static constexpr uint32_t UPSCALE_SOURCE_SET = 0;
+// constant_id of the simple shader's specialization constants
+static constexpr uint32_t SIMPLE_SHADER_USE_TEXTURE = 0;
+static constexpr uint32_t SIMPLE_SHADER_USE_VERTEX_COLOR = 1;
 
 Renderer::Renderer(SDL_Window* window)
 {
@@ -40,11 +108,15 @@ Renderer::Renderer(SDL_Window* window)
 
     vk::PhysicalDeviceFeatures features10 {};
     features10.samplerAnisotropy = true;
+    features10.multiDrawIndirect = true;
     vk::PhysicalDeviceVulkan12Features features12 {};
     features12.bufferDeviceAddress = true;
+    features12.drawIndirectCount = true;
     vk::PhysicalDeviceVulkan13Features features13 {};
     features13.dynamicRendering = true;
     features13.synchronization2 = true;
+    // Core and required since 1.3, lets the pipeline registry check the pipeline cache without compiling
+    features13.pipelineCreationCacheControl = true;
 
     VulkanGraphicsContextCreateInfo createInfo {};
     createInfo.vulkanApiVersion = vk::makeApiVersion(0, 1, 3, 0);
@@ -56,26 +128,77 @@ Renderer::Renderer(SDL_Window* window)
     createInfo.requiredDevice10Features = &features10;
     createInfo.requiredDevice12Features = &features12;
     createInfo.requiredDevice13Features = &features13;
+    createInfo.enableExtendedDynamicState3IfSupported = true;
     m_vkContext = VulkanGraphicsContext(createInfo);
+    m_pipelineCache = PipelineCache(m_vkContext.device(), m_vkContext.physicalDevice(), pipelineCachePath());
+    m_threadPool = std::make_unique<core::ThreadPool>();
+    m_depthFormat = utils::findDepthFormat(m_vkContext.physicalDevice());
+    DEBUG_FMT("Using depth format {}\n", vk::to_string(m_depthFormat));
+    m_renderGraph = RenderGraph(m_vkContext.device(), m_vkContext.allocator());
+    m_pipelineRegistry = PipelineRegistry(m_vkContext.device(), m_pipelineCache.get(), *m_threadPool);
 
     initTransferCommandData();
     initFrameCommandData();
 
+    createGraphicsPipelineLayout();
+
     createGlobalDescriptorPool();
     allocateFrameUboBuffers();
-    vk::UniqueDescriptorSetLayout globalDescriptorSetLayout = createGlobalDescriptorSets();
+    createGlobalDescriptorSets();
 
     createTextureSampler();
-    createTextureDescriptorPool();
-    m_textureSetLayout = createTextureSetLayout();
-
-    std::vector<vk::DescriptorSetLayout> setLayouts = {*globalDescriptorSetLayout, *m_textureSetLayout};
-    createGraphicsPipeline(setLayouts);
+    m_textureStreamer = TextureStreamer(m_vkContext.device(),
+                                        m_vkContext.allocator(),
+                                        *m_textureSampler,
+                                        m_textureSetLayout,
+                                        TEXTURE_STREAMING_BUDGET);
+    m_spriteAtlas = TextureAtlas(m_vkContext.device(),
+                                 m_vkContext.allocator(),
+                                 *m_textureSampler,
+                                 m_textureSetLayout,
+                                 vk::Format::eR8G8B8A8Srgb,
+                                 SPRITE_ATLAS_PAGE_SIZE,
+                                 SPRITE_ATLAS_MIP_LEVELS);
+    m_textRenderer =
+        TextRenderer(m_vkContext.device(), m_vkContext.allocator(), *m_textureSampler, m_textureSetLayout);
+    m_assetManager = AssetManager(UNUSED_ASSETS_BUDGET);
+
+    createGraphicsPipeline();
+    createSpritePipelines();
+    createCullPipeline();
+    createDepthReducePipeline();
+    createUpscalePipeline();
+    m_depthPyramid =
+        DepthPyramid(m_vkContext.device(), m_vkContext.allocator(), m_depthReduceSetLayout, MAX_FRAMES_IN_FLIGHT);
+    m_gpuFrameTimer = GpuFrameTimer(m_vkContext.device(),
+                                    m_vkContext.physicalDevice(),
+                                    m_vkContext.graphicsQueueFamilyIndex(),
+                                    MAX_FRAMES_IN_FLIGHT);
+    m_dynamicResolution = DynamicResolution(DynamicResolutionSettings {});
+    try {
+        m_fileWatcher.watch(simpleShaderVertPath);
+        m_fileWatcher.watch(simpleShaderFragPath);
+        m_fileWatcher.watch(spriteVertPath);
+        m_fileWatcher.watch(spriteFragPath);
+        m_fileWatcher.watch(textFragPath);
+        m_fileWatcher.watch(upscaleVertPath);
+        m_fileWatcher.watch(upscaleFragPath);
+    } catch (const std::exception& e) {
+        WARN_FMT("Shader hot reload disabled: {}\n", e.what());
+    }
 
-    m_testMesh = createMesh();
-    std::shared_ptr<const Allocated2DImage> image =
-        std::make_shared<const Allocated2DImage>(loadImage("../res/images/texture.jpg"));
-    m_testTexture = createTexture(std::move(image), vk::Format::eR8G8B8A8Srgb);
+    m_testMesh = createMesh(quadVertices, quadIndices);
+    std::vector<glm::mat4> testSceneTransforms;
+    for (int y = 0; y < TEST_SCENE_GRID_SIZE; ++y) {
+        for (int x = 0; x < TEST_SCENE_GRID_SIZE; ++x) {
+            glm::vec3 position(static_cast<float>(x - TEST_SCENE_GRID_SIZE / 2) * TEST_SCENE_GRID_SPACING,
+                               static_cast<float>(y - TEST_SCENE_GRID_SIZE / 2) * TEST_SCENE_GRID_SPACING,
+                               -1.f);
+            testSceneTransforms.push_back(glm::translate(glm::mat4(1.f), position));
+        }
+    }
+    m_testScene = createGpuScene(m_testMesh, testSceneTransforms);
+    m_testTexture = loadTexture("../res/images/texture.jpg", vk::Format::eR8G8B8A8Srgb);
 }
 
 void Renderer::initTransferCommandData()
@@ -126,6 +249,26 @@ void Renderer::initFrameCommandData()
     DEBUG("Successfully created frame command data\n");
 }
 
+void Renderer::createGraphicsPipelineLayout()
+{
+    ShaderReflection reflection = reflectShader(shaders::simple_shader_vert);
+    reflection.merge(reflectShader(shaders::simple_shader_frag));
+    std::vector<vk::VertexInputAttributeDescription> attributes;
+    std::ranges::copy(Vertex::attributeDescriptions(), std::back_inserter(attributes));
+    std::ranges::copy(InstanceData::attributeDescriptions(), std::back_inserter(attributes));
+    validateVertexInputs(reflection.vertexInputs, attributes);
+    if (reflection.descriptorSets.size() <= TEXTURE_SET) {
+        throw std::runtime_error("the simple shader does not declare the texture set");
+    }
+
+    m_layoutCache =
+        LayoutCache(m_vkContext.device(), m_vkContext.physicalDevice().getProperties().limits.maxPushConstantsSize);
+    m_graphicsPipelineLayout = m_layoutCache.pipelineLayout(reflection);
+    m_globalSetLayout = m_layoutCache.descriptorSetLayout(reflection.descriptorSets[GLOBAL_SET]);
+    m_textureSetLayout = m_layoutCache.descriptorSetLayout(reflection.descriptorSets[TEXTURE_SET]);
+    DEBUG("Successfully created the graphics pipeline layout from shader reflection\n");
+}
+
 void Renderer::createGlobalDescriptorPool()
 {
     vk::DescriptorPoolSize poolSizes[] {
@@ -156,15 +299,11 @@ void Renderer::allocateFrameUboBuffers()
     DEBUG("Successfully allocated frame UBOs buffers\n");
 }
 
-vk::UniqueDescriptorSetLayout Renderer::createGlobalDescriptorSets()
+void Renderer::createGlobalDescriptorSets()
 {
     const auto& device = m_vkContext.device();
-    DescriptorSetLayoutBuilder descriptorSetLayoutBuilder(device);
-    descriptorSetLayoutBuilder.addBinding(vk::DescriptorType::eUniformBuffer, 1, vk::ShaderStageFlagBits::eVertex);
-    vk::UniqueDescriptorSetLayout globalSetLayout = descriptorSetLayoutBuilder.build();
-
     vk::DescriptorSetLayout descriptorSetLayouts[MAX_FRAMES_IN_FLIGHT];
-    std::ranges::fill(descriptorSetLayouts, *globalSetLayout);
+    std::ranges::fill(descriptorSetLayouts, m_globalSetLayout);
 
     vk::DescriptorSetAllocateInfo allocateInfo {.sType = vk::StructureType::eDescriptorSetAllocateInfo,
                                                 .pNext = nullptr,
@@ -202,7 +341,6 @@ vk::UniqueDescriptorSetLayout Renderer::createGlobalDescriptorSets()
         device.updateDescriptorSets(descriptorWrite, nullptr);
     }
     DEBUG("Successfully created UBO descriptor sets\n");
-    return globalSetLayout;
 }
 
 void Renderer::createTextureSampler()
@@ -224,7 +362,7 @@ void Renderer::createTextureSampler()
                                              .compareEnable = vk::False,
                                              .compareOp = vk::CompareOp::eAlways,
                                              .minLod = 0.f,
-                                             .maxLod = 0.f,
+                                             .maxLod = vk::LodClampNone,
                                              .borderColor = vk::BorderColor::eIntOpaqueBlack,
                                              .unnormalizedCoordinates = vk::False};
 
@@ -232,11 +370,228 @@ void Renderer::createTextureSampler()
     DEBUG("Successfully created texture sampler\n");
 }
 
-void Renderer::createTextureDescriptorPool()
+void Renderer::createGraphicsPipeline()
+{
+    m_graphicsPipelineState = {.vertexShader = {.path = simpleShaderVertPath, .code = shaders::simple_shader_vert},
+                               .fragmentShader = {.path = simpleShaderFragPath, .code = shaders::simple_shader_frag},
+                               .layout = m_graphicsPipelineLayout,
+                               .colorFormat = m_vkContext.swapchainColorFormat(),
+                               .depthFormat = m_depthFormat,
+                               .depthTest = true,
+                               .depthWrite = true,
+                               .depthCompareOp = REVERSE_Z_COMPARE_OP,
+                               .vertexInput = VertexInput::eVertexInstanced,
+                               .dynamicStateMode = m_vkContext.supportsExtendedDynamicState3()
+                                                       ? DynamicStateMode::eExtended3
+                                                       : DynamicStateMode::eExtended};
+    m_graphicsPipelineState.specializationConstants.set(SIMPLE_SHADER_USE_TEXTURE, true);
+    m_graphicsPipelineState.specializationConstants.set(SIMPLE_SHADER_USE_VERTEX_COLOR, false);
+    // Starts compiling, unless the pipeline cache already has it
+    m_pipelineRegistry.get(m_graphicsPipelineState);
+}
+
+void Renderer::createSpritePipelines()
+{
+    auto reflectSpriteShaders = [this](std::span<const uint32_t> fragmentCode) {
+        ShaderReflection reflection = reflectShader(shaders::sprite_vert);
+        reflection.merge(reflectShader(fragmentCode));
+        validateVertexInputs(reflection.vertexInputs, SpriteInstance::attributeDescriptions());
+        if (reflection.descriptorSets.size() <= SPRITE_TEXTURE_SET ||
+            m_layoutCache.descriptorSetLayout(reflection.descriptorSets[SPRITE_TEXTURE_SET]) != m_textureSetLayout) {
+            throw std::runtime_error("a sprite shader does not declare the texture set of the simple shader");
+        }
+        return m_layoutCache.pipelineLayout(reflection);
+    };
+    m_spritePipelineLayout = reflectSpriteShaders(shaders::sprite_frag);
+    m_textPipelineLayout = reflectSpriteShaders(shaders::text_frag);
+
+    // Screen space quads in layer order, blended over the scene without depth
+    m_spritePipelineState = {.vertexShader = {.path = spriteVertPath, .code = shaders::sprite_vert},
+                             .fragmentShader = {.path = spriteFragPath, .code = shaders::sprite_frag},
+                             .layout = m_spritePipelineLayout,
+                             .colorFormat = m_vkContext.swapchainColorFormat(),
+                             .depthFormat = vk::Format::eUndefined,
+                             .topology = vk::PrimitiveTopology::eTriangleStrip,
+                             .cullMode = vk::CullModeFlagBits::eNone,
+                             .alphaBlending = true,
+                             .vertexInput = VertexInput::eSprite,
+                             .dynamicStateMode = m_vkContext.supportsExtendedDynamicState3()
+                                                     ? DynamicStateMode::eExtended3
+                                                     : DynamicStateMode::eExtended};
+    m_pipelineRegistry.get(m_spritePipelineState);
+
+    // The same quads, with the glyphs' distance fields as coverage
+    m_textPipelineState = m_spritePipelineState;
+    m_textPipelineState.fragmentShader = {.path = textFragPath, .code = shaders::text_frag};
+    m_textPipelineState.layout = m_textPipelineLayout;
+    m_pipelineRegistry.get(m_textPipelineState);
+}
+
+void Renderer::cullInstances(const glm::mat4& viewProj)
 {
-    // TODO: make a growable pool, no way of knowing ahead the amount of texture descriptors needed
+    m_frustumCuller.clear();
+    m_frustumCuller.reserve(m_instances.size());
+    for (const auto& draw : m_instancedDraws) {
+        for (uint32_t i = draw.firstInstance; i < draw.firstInstance + draw.instanceCount; ++i) {
+            MeshBounds bounds = utils::transformBounds(draw.mesh->bounds(), draw.transform * m_instances[i].model);
+            m_frustumCuller.add(bounds.center, bounds.radius, bounds.boxMin, bounds.boxMax);
+        }
+    }
+    m_frustumCuller.cull(utils::frustumPlanes(viewProj), m_visibleInstances, m_threadPool.get());
+
+    // In place, as the visible indices are increasing and the draws' instances are in order
+    size_t nextVisible = 0;
+    uint32_t instanceCount = 0;
+    size_t drawCount = 0;
+    for (auto& draw : m_instancedDraws) {
+        uint32_t firstInstance = instanceCount;
+        for (; nextVisible < m_visibleInstances.size() &&
+               m_visibleInstances[nextVisible] < draw.firstInstance + draw.instanceCount;
+             ++nextVisible) {
+            m_instances[instanceCount++] = m_instances[m_visibleInstances[nextVisible]];
+        }
+        if (instanceCount > firstInstance) {
+            draw.firstInstance = firstInstance;
+            draw.instanceCount = instanceCount - firstInstance;
+            m_instancedDraws[drawCount++] = draw;
+        }
+    }
+    m_instances.resize(instanceCount);
+    m_instancedDraws.resize(drawCount);
+}
+
+void Renderer::uploadInstances(FrameData& frameData)
+{
+    if (m_instances.size() > frameData.instanceCapacity) {
+        // Grows geometrically, so the buffer settles after a few frames
+        size_t capacity = std::max(m_instances.size(), 2 * frameData.instanceCapacity);
+        if (frameData.instanceCapacity != 0) {
+            m_deletionQueue.retire(m_frameCount, std::move(frameData.instanceBuffer));
+        }
+        frameData.instanceBuffer =
+            AllocatedBuffer(m_vkContext.allocator(),
+                            capacity * sizeof(InstanceData),
+                            vk::BufferUsageFlagBits::eVertexBuffer,
+                            VMA_ALLOCATION_CREATE_MAPPED_BIT | VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT,
+                            VMA_MEMORY_USAGE_AUTO);
+        frameData.instanceCapacity = capacity;
+        DEBUG_FMT("Grew frame instance buffer to {} instances\n", capacity);
+    }
+
+    if (!m_instances.empty()) {
+        std::memcpy(frameData.instanceBuffer.allocationInfo().pMappedData,
+                    m_instances.data(),
+                    m_instances.size() * sizeof(InstanceData));
+    }
+}
+
+void Renderer::uploadSprites(FrameData& frameData)
+{
+    std::span<const SpriteInstance> spriteInstances = m_spriteBatch.instances();
+    std::span<const SpriteInstance> textInstances = m_textBatch.instances();
+    size_t instanceCount = spriteInstances.size() + textInstances.size();
+    if (instanceCount > frameData.spriteCapacity) {
+        // Grows geometrically, so the buffer settles after a few frames
+        size_t capacity = std::max(instanceCount, 2 * frameData.spriteCapacity);
+        if (frameData.spriteCapacity != 0) {
+            m_deletionQueue.retire(m_frameCount, std::move(frameData.spriteBuffer));
+        }
+        frameData.spriteBuffer =
+            AllocatedBuffer(m_vkContext.allocator(),
+                            capacity * sizeof(SpriteInstance),
+                            vk::BufferUsageFlagBits::eVertexBuffer,
+                            VMA_ALLOCATION_CREATE_MAPPED_BIT | VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT,
+                            VMA_MEMORY_USAGE_AUTO);
+        frameData.spriteCapacity = capacity;
+        DEBUG_FMT("Grew frame sprite buffer to {} sprites\n", capacity);
+    }
+
+    if (instanceCount > 0) {
+        auto* mapped = static_cast<std::byte*>(frameData.spriteBuffer.allocationInfo().pMappedData);
+        std::memcpy(mapped, spriteInstances.data(), spriteInstances.size_bytes());
+        std::memcpy(mapped + spriteInstances.size_bytes(), textInstances.data(), textInstances.size_bytes());
+    }
+}
+
+vk::DescriptorSet Renderer::spriteTextureDescriptor(const SpriteTexture& texture) const
+{
+    switch (texture.source) {
+        case SpriteTexture::Source::eStreamed: return m_textureStreamer.descriptor(texture.handle);
+        case SpriteTexture::Source::eAtlasPage: return m_spriteAtlas.descriptor(texture.handle);
+        case SpriteTexture::Source::eGlyphPage: return m_textRenderer.descriptor();
+        default: throw std::invalid_argument("unknown sprite texture source");
+    }
+}
+
+void Renderer::createCullPipeline()
+{
+    ShaderReflection reflection = reflectShader(shaders::frustum_cull_comp);
+    if (reflection.descriptorSets.empty()) {
+        throw std::runtime_error("the culling shader declares no descriptor set");
+    }
+    m_cullPipelineLayout = m_layoutCache.pipelineLayout(reflection);
+    m_cullSetLayout = m_layoutCache.descriptorSetLayout(reflection.descriptorSets[0]);
+
+    ComputePipelineBuilder builder(m_vkContext.device());
+    builder.setShader(shaders::frustum_cull_comp);
+    builder.setPipelineLayout(m_cullPipelineLayout);
+    builder.setPipelineCache(m_pipelineCache.get());
+    m_cullPipeline = builder.build();
+    DEBUG("Successfully created the culling pipeline\n");
+}
+
+void Renderer::createDepthReducePipeline()
+{
+    ShaderReflection reflection = reflectShader(shaders::depth_reduce_comp);
+    if (reflection.descriptorSets.empty()) {
+        throw std::runtime_error("the depth reduction shader declares no descriptor set");
+    }
+    m_depthReducePipelineLayout = m_layoutCache.pipelineLayout(reflection);
+    m_depthReduceSetLayout = m_layoutCache.descriptorSetLayout(reflection.descriptorSets[0]);
+
+    ComputePipelineBuilder builder(m_vkContext.device());
+    builder.setShader(shaders::depth_reduce_comp);
+    builder.setPipelineLayout(m_depthReducePipelineLayout);
+    builder.setPipelineCache(m_pipelineCache.get());
+    m_depthReducePipeline = builder.build();
+    DEBUG("Successfully created the depth reduction pipeline\n");
+}
+
+void Renderer::createUpscalePipeline()
+{
+    const auto& device = m_vkContext.device();
+    ShaderReflection reflection = reflectShader(shaders::upscale_vert);
+    reflection.merge(reflectShader(shaders::upscale_frag));
+    validateVertexInputs(reflection.vertexInputs, {});
+    if (reflection.descriptorSets.size() <= UPSCALE_SOURCE_SET) {
+        throw std::runtime_error("the upscale shader declares no descriptor set");
+    }
+    m_upscalePipelineLayout = m_layoutCache.pipelineLayout(reflection);
+    m_upscaleSetLayout = m_layoutCache.descriptorSetLayout(reflection.descriptorSets[UPSCALE_SOURCE_SET]);
+
+    // Bilinear, without mipmaps, and clamped so the screen edges do not bleed into each other
+    vk::SamplerCreateInfo samplerCreateInfo {.sType = vk::StructureType::eSamplerCreateInfo,
+                                             .pNext = nullptr,
+                                             .flags = {},
+                                             .magFilter = vk::Filter::eLinear,
+                                             .minFilter = vk::Filter::eLinear,
+                                             .mipmapMode = vk::SamplerMipmapMode::eNearest,
+                                             .addressModeU = vk::SamplerAddressMode::eClampToEdge,
+                                             .addressModeV = vk::SamplerAddressMode::eClampToEdge,
+                                             .addressModeW = vk::SamplerAddressMode::eClampToEdge,
+                                             .mipLodBias = 0.f,
+                                             .anisotropyEnable = vk::False,
+                                             .maxAnisotropy = 1.f,
+                                             .compareEnable = vk::False,
+                                             .compareOp = vk::CompareOp::eAlways,
+                                             .minLod = 0.f,
+                                             .maxLod = 0.f,
+                                             .borderColor = vk::BorderColor::eIntOpaqueBlack,
+                                             .unnormalizedCoordinates = vk::False};
+    m_upscaleSampler = device.createSamplerUnique(samplerCreateInfo);
+
     vk::DescriptorPoolSize poolSizes[] {
-        {.type = vk::DescriptorType::eCombinedImageSampler, .descriptorCount = 1}
+        {.type = vk::DescriptorType::eCombinedImageSampler, .descriptorCount = MAX_FRAMES_IN_FLIGHT}
     };
 
     vk::DescriptorPoolCreateInfo poolCreateInfo {.sType = vk::StructureType::eDescriptorPoolCreateInfo,
@@ -245,33 +600,77 @@ void Renderer::createTextureDescriptorPool()
                                                  .maxSets = MAX_FRAMES_IN_FLIGHT,
                                                  .poolSizeCount = std::size(poolSizes),
                                                  .pPoolSizes = poolSizes};
+    m_upscaleDescriptorPool = device.createDescriptorPoolUnique(poolCreateInfo);
 
-    m_textureDescriptorPool = m_vkContext.device().createDescriptorPoolUnique(poolCreateInfo);
-    DEBUG("Successfully created texture descriptor pool\n");
-}
+    vk::DescriptorSetLayout descriptorSetLayouts[MAX_FRAMES_IN_FLIGHT];
+    std::ranges::fill(descriptorSetLayouts, m_upscaleSetLayout);
 
-vk::UniqueDescriptorSetLayout Renderer::createTextureSetLayout()
-{
-    const auto& device = m_vkContext.device();
-    DescriptorSetLayoutBuilder descriptorSetLayoutBuilder(device);
-    descriptorSetLayoutBuilder.addBinding(vk::DescriptorType::eCombinedImageSampler,
-                                          1,
-                                          vk::ShaderStageFlagBits::eFragment);
-    return descriptorSetLayoutBuilder.build();
+    vk::DescriptorSetAllocateInfo allocateInfo {.sType = vk::StructureType::eDescriptorSetAllocateInfo,
+                                                .pNext = nullptr,
+                                                .descriptorPool = *m_upscaleDescriptorPool,
+                                                .descriptorSetCount = std::size(descriptorSetLayouts),
+                                                .pSetLayouts = descriptorSetLayouts};
+    auto descriptorSets = device.allocateDescriptorSets(allocateInfo);
+    for (uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i) {
+        m_frameData[i].upscaleDescriptorSet = descriptorSets[i];
+    }
+
+    // A fullscreen triangle, overwriting every pixel of the swapchain image
+    m_upscalePipelineState = {.vertexShader = {.path = upscaleVertPath, .code = shaders::upscale_vert},
+                              .fragmentShader = {.path = upscaleFragPath, .code = shaders::upscale_frag},
+                              .layout = m_upscalePipelineLayout,
+                              .colorFormat = m_vkContext.swapchainColorFormat(),
+                              .depthFormat = vk::Format::eUndefined,
+                              .cullMode = vk::CullModeFlagBits::eNone,
+                              .vertexInput = VertexInput::eNone,
+                              .dynamicStateMode = m_vkContext.supportsExtendedDynamicState3()
+                                                      ? DynamicStateMode::eExtended3
+                                                      : DynamicStateMode::eExtended};
+    m_pipelineRegistry.get(m_upscalePipelineState);
+    DEBUG("Successfully created the upscale pipeline layout and descriptor sets\n");
 }
 
-void Renderer::createGraphicsPipeline(const std::vector<vk::DescriptorSetLayout>& setLayouts)
+void Renderer::reloadChangedAssets()
 {
-    const auto& device = m_vkContext.device();
-    PipelineLayoutBuilder pipelineLayoutBuilder(device);
-    pipelineLayoutBuilder.setDescriptorSetLayouts(setLayouts);
-    m_graphicsPipelineLayout = pipelineLayoutBuilder.build();
+    for (const auto& path : m_fileWatcher.poll()) {
+        INFO_FMT("{} changed, reloading\n", path.string());
+        m_pipelineRegistry.reload(path);
+        for (TextureHandle handle : m_assetManager.textures(path)) {
+            vk::Format format = m_textureStreamer.format(handle);
+            auto texture = m_threadPool->submit([path, format]() { return TextureStreamer::decode(path, format); });
+
+            // A newer version replaces a pending one, so they can't complete out of order
+            auto pending = std::ranges::find(m_pendingTextureReloads, handle, &PendingTextureReload::handle);
+            if (pending != m_pendingTextureReloads.end()) {
+                pending->path = path;
+                pending->texture = std::move(texture);
+            } else {
+                m_pendingTextureReloads.push_back({.path = path, .handle = handle, .texture = std::move(texture)});
+            }
+        }
+    }
+
+    // Failed reloads keep the previous version, so a typo in a shader does not end the session
+    for (size_t i = 0; i < m_pendingTextureReloads.size();) {
+        auto& pending = m_pendingTextureReloads[i];
+        if (!core::isReady(pending.texture)) {
+            ++i;
+            continue;
+        }
 
-    GraphicsPipelineBuilder pipelineBuilder(m_vkContext);
-    pipelineBuilder.setShaders("../shaders/simple_shader.vert.spv", "../shaders/simple_shader.frag.spv");
-    pipelineBuilder.setPipelineLayout(*m_graphicsPipelineLayout);
-    m_graphicsPipeline = pipelineBuilder.build();
-    DEBUG("Successfully created graphics pipeline\n");
+        try {
+            m_assetManager.reloadTexture(pending.path,
+                                         pending.handle,
+                                         pending.texture.get(),
+                                         m_frameCount,
+                                         m_deletionQueue,
+                                         m_textureStreamer);
+        } catch (const std::exception& e) {
+            WARN_FMT("Could not reload texture, keeping the previous one: {}\n", e.what());
+        }
+        pending = std::move(m_pendingTextureReloads.back());
+        m_pendingTextureReloads.pop_back();
+    }
 }
 
 vk::UniqueCommandBuffer Renderer::beginSingleTimeTransferCommand() const
@@ -322,227 +721,151 @@ void Renderer::endSingleTimeTransferCommand(vk::UniqueCommandBuffer&& commandBuf
     m_vkContext.device().resetCommandPool(*m_transferCommandData.commandPool);
 }
 
-void Renderer::transitionImageLayout(vk::CommandBuffer commandBuffer,
-                                     vk::Image image,
-                                     vk::Format format,
-                                     vk::ImageLayout oldLayout,
-                                     vk::ImageLayout newLayout)
-{
-    (void) format;
-
-    vk::PipelineStageFlags2 sourceStage;
-    vk::AccessFlags2 sourceAccess;
-    vk::PipelineStageFlags2 destStage;
-    vk::AccessFlags2 destAccess;
-
-    if (oldLayout == vk::ImageLayout::eUndefined && newLayout == vk::ImageLayout::eTransferDstOptimal) {
-        sourceAccess = {};
-        destAccess = vk::AccessFlagBits2::eTransferWrite;
-        sourceStage = vk::PipelineStageFlagBits2::eTopOfPipe;
-        destStage = vk::PipelineStageFlagBits2::eTransfer;
-    } else if (oldLayout == vk::ImageLayout::eTransferDstOptimal &&
-               newLayout == vk::ImageLayout::eShaderReadOnlyOptimal) {
-        sourceAccess = vk::AccessFlagBits2::eTransferWrite;
-        destAccess = vk::AccessFlagBits2::eShaderRead;
-        sourceStage = vk::PipelineStageFlagBits2::eTransfer;
-        destStage = vk::PipelineStageFlagBits2::eFragmentShader;
-    } else if ((oldLayout == vk::ImageLayout::eUndefined && newLayout == vk::ImageLayout::eColorAttachmentOptimal) ||
-               (oldLayout == vk::ImageLayout::eColorAttachmentOptimal &&
-                newLayout == vk::ImageLayout::ePresentSrcKHR)) {
-        // TODO: review
-        sourceAccess = vk::AccessFlagBits2::eMemoryWrite;
-        destAccess = vk::AccessFlagBits2::eMemoryWrite | vk::AccessFlagBits2::eMemoryRead;
-        sourceStage = vk::PipelineStageFlagBits2::eAllCommands;
-        destStage = vk::PipelineStageFlagBits2::eAllCommands;
-    } else {
-        assert(0);
-    }
-
-    vk::ImageMemoryBarrier2 imageBarrier {
-        .sType = vk::StructureType::eImageMemoryBarrier2,
+void Renderer::beginMainPass(vk::CommandBuffer commandBuffer,
+                             vk::ImageView colorView,
+                             vk::ImageView depthView,
+                             const vk::Extent2D& extent,
+                             bool clear) const
+{
+    vk::RenderingAttachmentInfo colorAttachment {.sType = vk::StructureType::eRenderingAttachmentInfo,
+                                                 .pNext = nullptr,
+                                                 .imageView = colorView,
+                                                 .imageLayout = vk::ImageLayout::eColorAttachmentOptimal,
+                                                 .resolveMode = {},
+                                                 .resolveImageView = {},
+                                                 .resolveImageLayout = {},
+                                                 .loadOp = clear ? vk::AttachmentLoadOp::eClear
+                                                                 : vk::AttachmentLoadOp::eLoad,
+                                                 .storeOp = vk::AttachmentStoreOp::eStore,
+                                                 .clearValue = {}};
+
+    vk::RenderingAttachmentInfo depthAttachment {
+        .sType = vk::StructureType::eRenderingAttachmentInfo,
         .pNext = nullptr,
-        .srcStageMask = sourceStage,
-        .srcAccessMask = sourceAccess,
-        .dstStageMask = destStage,
-        .dstAccessMask = destAccess,
-        .oldLayout = oldLayout,
-        .newLayout = newLayout,
-        .srcQueueFamilyIndex = vk::QueueFamilyIgnored,
-        .dstQueueFamilyIndex = vk::QueueFamilyIgnored,
-        .image = image,
-        .subresourceRange = {.aspectMask = vk::ImageAspectFlagBits::eColor,
-                             .baseMipLevel = 0,
-                             .levelCount = 1,
-                             .baseArrayLayer = 0,
-                             .layerCount = 1}
+        .imageView = depthView,
+        .imageLayout = vk::ImageLayout::eDepthStencilAttachmentOptimal,
+        .resolveMode = {},
+        .resolveImageView = {},
+        .resolveImageLayout = {},
+        .loadOp = clear ? vk::AttachmentLoadOp::eClear : vk::AttachmentLoadOp::eLoad,
+        .storeOp = clear ? vk::AttachmentStoreOp::eStore : vk::AttachmentStoreOp::eDontCare,
+        .clearValue = {.depthStencil = {.depth = REVERSE_Z_CLEAR_DEPTH, .stencil = 0}}};
+
+    vk::RenderingInfo renderingInfo {
+        .sType = vk::StructureType::eRenderingInfo,
+        .pNext = nullptr,
+        .flags = {},
+        .renderArea = {vk::Offset2D {0, 0}, extent},
+        .layerCount = 1,
+        .viewMask = 0,
+        .colorAttachmentCount = 1,
+        .pColorAttachments = &colorAttachment,
+        .pDepthAttachment = depthView ? &depthAttachment : nullptr,
+        // Must match the stencil format the pipeline was built with
+        .pStencilAttachment = depthView && utils::hasStencilComponent(m_depthFormat) ? &depthAttachment : nullptr
     };
 
-    vk::DependencyInfo dependencyInfo {.sType = vk::StructureType::eDependencyInfo,
-                                       .pNext = nullptr,
-                                       .dependencyFlags = {},
-                                       .memoryBarrierCount = 0,
-                                       .pMemoryBarriers = nullptr,
-                                       .bufferMemoryBarrierCount = 0,
-                                       .pBufferMemoryBarriers = nullptr,
-                                       .imageMemoryBarrierCount = 1,
-                                       .pImageMemoryBarriers = &imageBarrier};
+    commandBuffer.beginRendering(renderingInfo);
 
-    commandBuffer.pipelineBarrier2(dependencyInfo);
+    // set dynamic viewport and scissor
+    vk::Viewport viewport {.x = 0.f,
+                           .y = 0.f,
+                           .width = static_cast<float>(extent.width),
+                           .height = static_cast<float>(extent.height),
+                           .minDepth = 0.f,
+                           .maxDepth = 1.f};
+    commandBuffer.setViewport(0, viewport);
+
+    vk::Rect2D scissor {
+        .offset = {0, 0},
+        .extent = extent
+    };
+    commandBuffer.setScissor(0, scissor);
 }
 
-void Renderer::updateUbo(vk::CommandBuffer command, vk::Buffer ubo, const vk::Extent2D& swapchainExtent) const
+UniformBufferObject Renderer::updateUbo(vk::CommandBuffer command,
+                                       vk::Buffer ubo,
+                                       const vk::Extent2D& swapchainExtent) const
 {
-    static auto startTime = std::chrono::high_resolution_clock::now();
-    auto currentTime = std::chrono::high_resolution_clock::now();
-    float time = std::chrono::duration<float, std::chrono::seconds::period>(currentTime - startTime).count();
-
     UniformBufferObject uboData {};
-    uboData.model = glm::rotate(glm::mat4(1.0f), time * glm::radians(90.0f), glm::vec3(0.0f, 0.0f, 1.0f));
     uboData.view = glm::lookAt(glm::vec3(2.0f, 2.0f, 2.0f), glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f));
-    uboData.proj = glm::perspective(glm::radians(45.0f),
-                                    swapchainExtent.width / static_cast<float>(swapchainExtent.height),
-                                    0.1f,
-                                    10.0f);
+    uboData.proj = utils::perspectiveReverseZ(glm::radians(45.0f),
+                                              swapchainExtent.width / static_cast<float>(swapchainExtent.height),
+                                              CAMERA_NEAR_PLANE);
     uboData.proj[1][1] *= -1;
 
     command.updateBuffer(ubo, 0, sizeof(uboData), &uboData);
+    return uboData;
 }
 
-Allocated2DImage Renderer::loadImage(const std::filesystem::path& path) const
+glm::mat4 Renderer::testMeshTransform() const
 {
-    int texWidth, texHeight, texChannels;
-    using unique_stbi_uc_t = std::unique_ptr<stbi_uc, decltype(&stbi_image_free)>;
-    unique_stbi_uc_t pixels(stbi_load(path.c_str(), &texWidth, &texHeight, &texChannels, STBI_rgb_alpha),
-                            &stbi_image_free);
+    static auto startTime = std::chrono::high_resolution_clock::now();
+    auto currentTime = std::chrono::high_resolution_clock::now();
+    float time = std::chrono::duration<float, std::chrono::seconds::period>(currentTime - startTime).count();
+    return glm::rotate(glm::mat4(1.0f), time * glm::radians(90.0f), glm::vec3(0.0f, 0.0f, 1.0f));
+}
 
-    if (!pixels) {
-        throw std::ios_base::failure(std::string("Could not open file " + path.string()));
+TextureHandle Renderer::loadTexture(const std::filesystem::path& path, vk::Format format)
+{
+    TextureHandle handle = m_assetManager.loadTexture(path, format, m_textureStreamer);
+    // The caller owns the reference once this returns, a watcher failure only costs hot reload
+    try {
+        m_fileWatcher.watch(path);
+    } catch (const std::exception& e) {
+        WARN_FMT("Hot reload of {} disabled: {}\n", path.string(), e.what());
     }
-
-    const auto& allocator = m_vkContext.allocator();
-    assert(texWidth >= 0);
-    assert(texHeight >= 0);
-    vk::DeviceSize imageSize = static_cast<vk::DeviceSize>(texWidth * texHeight * 4);
-    AllocatedBuffer stagingBuffer(allocator,
-                                  imageSize,
-                                  vk::BufferUsageFlagBits::eTransferSrc,
-                                  VMA_ALLOCATION_CREATE_MAPPED_BIT |
-                                      VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT,
-                                  VMA_MEMORY_USAGE_AUTO);
-
-    VmaAllocationInfo stagingAllocationInfo = stagingBuffer.allocationInfo();
-    auto& data = stagingAllocationInfo.pMappedData;
-    std::memcpy(data, pixels.get(), static_cast<size_t>(imageSize));
-
-    Allocated2DImage image(allocator,
-                           vk::Format::eR8G8B8A8Srgb,
-                           {.width = static_cast<uint32_t>(texWidth), .height = static_cast<uint32_t>(texHeight)},
-                           vk::ImageTiling::eOptimal,
-                           vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eSampled,
-                           0,
-                           VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE);
-
-    auto commandBuffer = beginSingleTimeTransferCommand();
-
-    transitionImageLayout(*commandBuffer,
-                          image.image(),
-                          vk::Format::eUndefined,
-                          vk::ImageLayout::eUndefined,
-                          vk::ImageLayout::eTransferDstOptimal);
-
-    vk::BufferImageCopy region {
-        .bufferOffset = 0,
-        .bufferRowLength = 0,
-        .bufferImageHeight = 0,
-        .imageSubresource = {.aspectMask = vk::ImageAspectFlagBits::eColor,
-                             .mipLevel = 0,
-                             .baseArrayLayer = 0,
-                             .layerCount = 1},
-        .imageOffset = {.x = 0, .y = 0, .z = 0},
-        .imageExtent = {.width = static_cast<uint32_t>(texWidth),
-                             .height = static_cast<uint32_t>(texHeight),
-                             .depth = 1}
-    };
-    commandBuffer->copyBufferToImage(stagingBuffer.buffer(),
-                                     image.image(),
-                                     vk::ImageLayout::eTransferDstOptimal,
-                                     region);
-
-    transitionImageLayout(*commandBuffer,
-                          image.image(),
-                          vk::Format::eUndefined,
-                          vk::ImageLayout::eTransferDstOptimal,
-                          vk::ImageLayout::eShaderReadOnlyOptimal);
-
-    endSingleTimeTransferCommand(std::move(commandBuffer));
-
-    return image;
+    return handle;
 }
 
-AllocatedTexture Renderer::createTexture(std::shared_ptr<const Allocated2DImage> image, vk::Format format) const
+void Renderer::releaseTexture(TextureHandle handle)
 {
-    vk::ImageViewCreateInfo imageViewCreateInfo {
-        .sType = vk::StructureType::eImageViewCreateInfo,
-        .pNext = nullptr,
-        .flags = {},
-        .image = image->image(),
-        .viewType = vk::ImageViewType::e2D,
-        .format = format,
-        .components = {vk::ComponentSwizzle::eIdentity,
-                  vk::ComponentSwizzle::eIdentity,
-                  vk::ComponentSwizzle::eIdentity,
-                  vk::ComponentSwizzle::eIdentity},
-        .subresourceRange = {.aspectMask = vk::ImageAspectFlagBits::eColor,
-                  .baseMipLevel = 0,
-                  .levelCount = 1,
-                  .baseArrayLayer = 0,
-                  .layerCount = 1}
-    };
-
-    const auto& device = m_vkContext.device();
-    auto imageView = device.createImageViewUnique(imageViewCreateInfo);
-
-    // Allocate descriptor
-    vk::DescriptorSetAllocateInfo allocateInfo {.sType = vk::StructureType::eDescriptorSetAllocateInfo,
-                                                .pNext = nullptr,
-                                                .descriptorPool = *m_textureDescriptorPool,
-                                                .descriptorSetCount = 1,
-                                                .pSetLayouts = &*m_textureSetLayout};
-
-    auto descriptorSetsVec = device.allocateDescriptorSets(allocateInfo);
-    assert(descriptorSetsVec.size() == 1);
-    auto& textureSet = descriptorSetsVec[0];
+    m_assetManager.releaseTexture(handle);
+}
 
-    // Write descriptor
-    vk::DescriptorImageInfo imageInfo {.sampler = *m_textureSampler,
-                                       .imageView = *imageView,
-                                       .imageLayout = vk::ImageLayout::eShaderReadOnlyOptimal};
+AtlasRegion Renderer::loadSpriteImage(const std::filesystem::path& path)
+{
+    std::string key = std::filesystem::weakly_canonical(path).string();
+    if (auto it = m_spriteImages.find(key); it != m_spriteImages.end()) {
+        return it->second;
+    }
 
-    vk::WriteDescriptorSet descriptorWrite {.sType = vk::StructureType::eWriteDescriptorSet,
-                                            .pNext = nullptr,
-                                            .dstSet = textureSet,
-                                            .dstBinding = 0,
-                                            .dstArrayElement = 0,
-                                            .descriptorCount = 1,
-                                            .descriptorType = vk::DescriptorType::eCombinedImageSampler,
-                                            .pImageInfo = &imageInfo,
-                                            .pBufferInfo = nullptr,
-                                            .pTexelBufferView = nullptr};
+    std::vector<char> encodedImage = core::readFile(path);
+    int width, height, channels;
+    using unique_stbi_uc_t = std::unique_ptr<stbi_uc, decltype(&stbi_image_free)>;
+    unique_stbi_uc_t pixels(stbi_load_from_memory(reinterpret_cast<const stbi_uc*>(encodedImage.data()),
+                                                  static_cast<int>(encodedImage.size()),
+                                                  &width,
+                                                  &height,
+                                                  &channels,
+                                                  STBI_rgb_alpha),
+                            &stbi_image_free);
 
-    device.updateDescriptorSets(descriptorWrite, nullptr);
+    if (!pixels) {
+        throw std::ios_base::failure("Could not decode image " + path.string() + ": " + stbi_failure_reason());
+    }
 
-    return AllocatedTexture(std::move(image), std::move(imageView), textureSet);
+    assert(width >= 0);
+    assert(height >= 0);
+    vk::Extent2D extent {.width = static_cast<uint32_t>(width), .height = static_cast<uint32_t>(height)};
+    AtlasRegion region = m_spriteAtlas.add({pixels.get(), size_t {extent.width} * extent.height * 4}, extent);
+    m_spriteImages.emplace(std::move(key), region);
+    return region;
 }
 
-Mesh Renderer::createMesh() const
+Mesh Renderer::createMesh(std::span<const Vertex> vertices, std::span<const uint32_t> indices)
 {
     const auto& device = m_vkContext.device();
     const auto& allocator = m_vkContext.allocator();
 
-    const vk::DeviceSize vertexBufferSize = vertices.size() * sizeof(vertices[0]);
-    const vk::DeviceSize indexBufferSize = indices.size() * sizeof(indices[0]);
+    const vk::DeviceSize vertexBufferSize = vertices.size_bytes();
+    const vk::DeviceSize indexBufferSize = indices.size_bytes();
 
-    auto mesh = Mesh(device, allocator, vertexBufferSize, indexBufferSize);
+    // Clustered in a copy, building the meshlets reorders the triangles
+    std::vector<uint32_t> clusteredIndices(indices.begin(), indices.end());
+    std::vector<Meshlet> meshlets = buildMeshlets(clusteredIndices, vertices, 0);
+
+    auto mesh = Mesh(device, allocator, vertexBufferSize, indexBufferSize, m_meshCount++);
 
     // create staging buffer, contiguous memory containing [vertexBufferData, indexBufferData]
     AllocatedBuffer stagingBuffer(allocator,
@@ -557,7 +880,7 @@ Mesh Renderer::createMesh() const
     // copy vertex buffer data
     std::memcpy(stagingData, vertices.data(), vertexBufferSize);
     // copy index buffer data
-    std::memcpy(static_cast<char*>(stagingData) + vertexBufferSize, indices.data(), indexBufferSize);
+    std::memcpy(static_cast<char*>(stagingData) + vertexBufferSize, clusteredIndices.data(), indexBufferSize);
 
     auto commandBuffer = beginSingleTimeTransferCommand();
     // Record vkCmdCopyBuffer from staging buffer to device mesh vertex buffer and index buffer
@@ -568,14 +891,341 @@ Mesh Renderer::createMesh() const
     commandBuffer->copyBuffer(stagingBuffer.buffer(), mesh.indexBuffer(), indexCopyRegion);
 
     endSingleTimeTransferCommand(std::move(commandBuffer));
+    mesh.setBounds(computeBounds(vertices));
+    mesh.setMeshlets(std::move(meshlets));
     return mesh;
 }
 
+GpuScene Renderer::createGpuScene(const Mesh& mesh, std::span<const glm::mat4> transforms) const
+{
+    const auto& allocator = m_vkContext.allocator();
+    const MeshBounds& bounds = mesh.bounds();
+
+    // Every object draws the meshlets of the full detail LOD, shared through the meshlet buffer
+    std::vector<GpuMeshlet> meshlets;
+    meshlets.reserve(mesh.meshlets().size());
+    for (const auto& meshlet : mesh.meshlets()) {
+        meshlets.push_back({.boundingSphere = glm::vec4(meshlet.center, meshlet.radius),
+                            .cone = glm::vec4(meshlet.coneAxis, meshlet.coneCutoff),
+                            .firstIndex = meshlet.firstIndex,
+                            .indexCount = meshlet.indexCount,
+                            .padding0 = 0,
+                            .padding1 = 0});
+    }
+    const auto meshletCount = static_cast<uint32_t>(meshlets.size());
+
+    std::vector<GpuObject> objects;
+    std::vector<InstanceData> instances;
+    objects.reserve(transforms.size());
+    instances.reserve(transforms.size());
+    for (const auto& transform : transforms) {
+        objects.push_back({.boundingSphere = glm::vec4(bounds.center, bounds.radius),
+                           .firstMeshlet = 0,
+                           .meshletCount = meshletCount,
+                           .firstVisibility = static_cast<uint32_t>(objects.size()) * meshletCount,
+                           .vertexOffset = 0});
+        instances.push_back({.model = transform});
+    }
+
+    GpuScene scene(m_vkContext.device(),
+                   allocator,
+                   m_cullSetLayout,
+                   static_cast<uint32_t>(objects.size()),
+                   meshletCount,
+                   static_cast<uint32_t>(objects.size()) * meshletCount);
+
+    // create staging buffer, contiguous memory containing [objects, meshlets, instances]
+    const vk::DeviceSize objectsSize = objects.size() * sizeof(GpuObject);
+    const vk::DeviceSize meshletsSize = meshlets.size() * sizeof(GpuMeshlet);
+    const vk::DeviceSize instancesSize = instances.size() * sizeof(InstanceData);
+    AllocatedBuffer stagingBuffer(allocator,
+                                  objectsSize + meshletsSize + instancesSize,
+                                  vk::BufferUsageFlagBits::eTransferSrc,
+                                  VMA_ALLOCATION_CREATE_MAPPED_BIT |
+                                      VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT,
+                                  VMA_MEMORY_USAGE_AUTO);
+
+    auto* stagingData = static_cast<std::byte*>(stagingBuffer.allocationInfo().pMappedData);
+    std::memcpy(stagingData, objects.data(), objectsSize);
+    std::memcpy(stagingData + objectsSize, meshlets.data(), meshletsSize);
+    std::memcpy(stagingData + objectsSize + meshletsSize, instances.data(), instancesSize);
+
+    auto commandBuffer = beginSingleTimeTransferCommand();
+    vk::BufferCopy objectsCopyRegion {.srcOffset = 0, .dstOffset = 0, .size = objectsSize};
+    commandBuffer->copyBuffer(stagingBuffer.buffer(), scene.objectBuffer(), objectsCopyRegion);
+
+    vk::BufferCopy meshletsCopyRegion {.srcOffset = objectsSize, .dstOffset = 0, .size = meshletsSize};
+    commandBuffer->copyBuffer(stagingBuffer.buffer(), scene.meshletBuffer(), meshletsCopyRegion);
+
+    vk::BufferCopy instancesCopyRegion {.srcOffset = objectsSize + meshletsSize, .dstOffset = 0, .size = instancesSize};
+    commandBuffer->copyBuffer(stagingBuffer.buffer(), scene.instanceBuffer(), instancesCopyRegion);
+
+    // Nothing was visible before the first frame, its late phase draws every meshlet passing the tests
+    commandBuffer->fillBuffer(scene.visibilityBuffer(), 0, vk::WholeSize, 0);
+
+    endSingleTimeTransferCommand(std::move(commandBuffer));
+    DEBUG_FMT("Uploaded GPU scene of {} objects, {} meshlets each\n", objects.size(), meshletCount);
+    return scene;
+}
+
+ImportedModel Renderer::importGltf(const std::filesystem::path& path, bool measureOverdraw)
+{
+    const auto& device = m_vkContext.device();
+    const auto& allocator = m_vkContext.allocator();
+
+    GltfImporter importer(path);
+    ImportedModel model;
+
+    // Convert every primitive to the renderer formats, in similarly sized jobs so large primitives are spread
+    // across the workers
+    struct PrimitiveData {
+        const GltfPrimitive* primitive;
+        std::vector<Vertex> vertices;
+        std::vector<uint32_t> indices;
+        MeshOptimizationStats stats;
+        std::vector<MeshLod> lods;
+        std::vector<Meshlet> meshlets;
+        MeshBounds bounds;
+        vk::DeviceSize stagingOffset;
+    };
+
+    std::vector<PrimitiveData> primitives;
+    std::vector<uint32_t> firstMeshOfGltfMesh;
+    for (const auto& gltfMesh : importer.meshes()) {
+        firstMeshOfGltfMesh.push_back(static_cast<uint32_t>(primitives.size()));
+        for (const auto& primitive : gltfMesh.primitives) {
+            primitives.push_back({.primitive = &primitive,
+                                  .vertices = std::vector<Vertex>(primitive.vertexCount()),
+                                  .indices = std::vector<uint32_t>(primitive.indexCount()),
+                                  .stats = {},
+                                  .lods = {},
+                                  .meshlets = {},
+                                  .bounds = {},
+                                  .stagingOffset = 0});
+        }
+    }
+
+    struct ConversionJob {
+        PrimitiveData* data;
+        bool indices;
+        size_t first;
+        size_t count;
+    };
+
+    std::vector<ConversionJob> jobs;
+    for (auto& data : primitives) {
+        for (size_t first = 0; first < data.vertices.size(); first += IMPORT_CONVERSION_CHUNK) {
+            size_t count = std::min(IMPORT_CONVERSION_CHUNK, data.vertices.size() - first);
+            jobs.push_back({.data = &data, .indices = false, .first = first, .count = count});
+        }
+        for (size_t first = 0; first < data.indices.size(); first += IMPORT_CONVERSION_CHUNK) {
+            size_t count = std::min(IMPORT_CONVERSION_CHUNK, data.indices.size() - first);
+            jobs.push_back({.data = &data, .indices = true, .first = first, .count = count});
+        }
+    }
+
+    m_threadPool->parallelFor(jobs.size(), [&jobs](size_t i) {
+        const auto& job = jobs[i];
+        if (job.indices) {
+            std::span out(job.data->indices.data() + job.first, job.count);
+            GltfImporter::readIndices(*job.data->primitive, job.first, out);
+        } else {
+            std::span out(job.data->vertices.data() + job.first, job.count);
+            GltfImporter::readVertices(*job.data->primitive, job.first, out);
+        }
+    });
+
+    // Cook the meshes for the post-transform cache, overdraw and vertex fetch, then append their LODs to the index
+    // buffers. The LODs reuse the optimized vertices, so they go after the vertex fetch reordering. The full detail
+    // LOD is then split into meshlets, which keeps most of the cache locality as each meshlet is a compact patch
+    m_threadPool->parallelFor(primitives.size(), [&primitives, measureOverdraw](size_t i) {
+        auto& data = primitives[i];
+        data.stats = optimizeMesh(data.vertices, data.indices, measureOverdraw);
+        data.lods = generateLods(data.indices, data.vertices, IMPORT_MAX_LODS);
+        data.meshlets = buildMeshlets(std::span(data.indices).first(data.lods.front().indexCount), data.vertices, 0);
+        data.bounds = computeBounds(data.vertices);
+    });
+
+    // Lay out every primitive in a single staging buffer, 16 bytes aligned so Vertex stores stay aligned
+    vk::DeviceSize stagingSize = 0;
+    size_t numTriangles = 0;
+    float missesBefore = 0.f;
+    float missesAfter = 0.f;
+    float overdrawBefore = 0.f;
+    float overdrawAfter = 0.f;
+    for (auto& data : primitives) {
+        vk::DeviceSize vertexBytes = data.vertices.size() * sizeof(Vertex);
+        vk::DeviceSize indexBytes = data.indices.size() * sizeof(uint32_t);
+        data.stagingOffset = stagingSize;
+        stagingSize = (stagingSize + vertexBytes + indexBytes + 15) & ~static_cast<vk::DeviceSize>(15);
+
+        // The stats only cover the full detail LOD, and are weighted by its triangle count
+        size_t triangles = data.lods.front().indexCount / 3;
+        numTriangles += triangles;
+        missesBefore += data.stats.cacheBefore.acmr * static_cast<float>(triangles);
+        missesAfter += data.stats.cacheAfter.acmr * static_cast<float>(triangles);
+        overdrawBefore += data.stats.overdrawBefore * static_cast<float>(triangles);
+        overdrawAfter += data.stats.overdrawAfter * static_cast<float>(triangles);
+
+        auto& mesh = model.meshes.emplace_back(device, allocator, vertexBytes, indexBytes, m_meshCount++);
+        mesh.setLods(std::move(data.lods));
+        mesh.setMeshlets(std::move(data.meshlets));
+        mesh.setBounds(data.bounds);
+        model.meshMaterials.push_back(data.primitive->material);
+    }
+
+    if (!primitives.empty()) {
+        AllocatedBuffer stagingBuffer(allocator,
+                                      stagingSize,
+                                      vk::BufferUsageFlagBits::eTransferSrc,
+                                      VMA_ALLOCATION_CREATE_MAPPED_BIT |
+                                          VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT,
+                                      VMA_MEMORY_USAGE_AUTO);
+        auto* stagingData = static_cast<std::byte*>(stagingBuffer.allocationInfo().pMappedData);
+
+        m_threadPool->parallelFor(primitives.size(), [&primitives, stagingData](size_t i) {
+            const auto& data = primitives[i];
+            std::byte* out = stagingData + data.stagingOffset;
+            std::memcpy(out, data.vertices.data(), data.vertices.size() * sizeof(Vertex));
+            std::memcpy(out + data.vertices.size() * sizeof(Vertex),
+                        data.indices.data(),
+                        data.indices.size() * sizeof(uint32_t));
+        });
+
+        auto commandBuffer = beginSingleTimeTransferCommand();
+        for (size_t i = 0; i < primitives.size(); ++i) {
+            const auto& data = primitives[i];
+            vk::DeviceSize vertexBytes = data.vertices.size() * sizeof(Vertex);
+            vk::BufferCopy vertexCopyRegion {.srcOffset = data.stagingOffset, .dstOffset = 0, .size = vertexBytes};
+            commandBuffer->copyBuffer(stagingBuffer.buffer(), model.meshes[i].vertexBuffer(), vertexCopyRegion);
+
+            vk::BufferCopy indexCopyRegion {.srcOffset = data.stagingOffset + vertexBytes,
+                                            .dstOffset = 0,
+                                            .size = data.indices.size() * sizeof(uint32_t)};
+            commandBuffer->copyBuffer(stagingBuffer.buffer(), model.meshes[i].indexBuffer(), indexCopyRegion);
+        }
+        endSingleTimeTransferCommand(std::move(commandBuffer));
+    }
+
+    if (numTriangles > 0 && measureOverdraw) {
+        INFO_FMT("Optimized {}: ACMR {:.3f} -> {:.3f}, overdraw {:.3f} -> {:.3f}\n",
+                 path.string(),
+                 missesBefore / static_cast<float>(numTriangles),
+                 missesAfter / static_cast<float>(numTriangles),
+                 overdrawBefore / static_cast<float>(numTriangles),
+                 overdrawAfter / static_cast<float>(numTriangles));
+    } else if (numTriangles > 0) {
+        INFO_FMT("Optimized {}: ACMR {:.3f} -> {:.3f}\n",
+                 path.string(),
+                 missesBefore / static_cast<float>(numTriangles),
+                 missesAfter / static_cast<float>(numTriangles));
+    }
+
+    // Only base color textures are used for now, and only those get loaded
+    std::vector<TextureHandle> imageTextures(importer.images().size(), INVALID_TEXTURE_HANDLE);
+    for (const auto& material : importer.materials()) {
+        TextureHandle baseColorTexture = INVALID_TEXTURE_HANDLE;
+        if (material.baseColorImage != GLTF_NONE && !importer.images()[material.baseColorImage].empty()) {
+            auto& texture = imageTextures[material.baseColorImage];
+            if (texture == INVALID_TEXTURE_HANDLE) {
+                texture = loadTexture(importer.images()[material.baseColorImage], vk::Format::eR8G8B8A8Srgb);
+            }
+            baseColorTexture = texture;
+        }
+        model.materials.push_back({.baseColorFactor = material.baseColorFactor, .baseColorTexture = baseColorTexture});
+    }
+
+    for (const auto& instance : importer.instances()) {
+        uint32_t firstMesh = firstMeshOfGltfMesh[instance.mesh];
+        uint32_t numPrimitives = static_cast<uint32_t>(importer.meshes()[instance.mesh].primitives.size());
+        for (uint32_t i = 0; i < numPrimitives; ++i) {
+            model.instances.push_back({.mesh = firstMesh + i, .transform = instance.transform});
+        }
+    }
+
+    INFO_FMT("Imported {}: {} meshes, {} triangles, {} instances\n",
+             path.string(),
+             model.meshes.size(),
+             numTriangles,
+             model.instances.size());
+    return model;
+}
+
+void Renderer::drawInstanced(const Mesh& mesh,
+                             TextureHandle texture,
+                             std::span<const glm::mat4> instanceTransforms,
+                             const glm::mat4& transform,
+                             uint32_t lod)
+{
+    assert(lod < mesh.lods().size());
+    if (instanceTransforms.empty()) {
+        return;
+    }
+
+    m_instancedDraws.push_back({.mesh = &mesh,
+                                .texture = texture,
+                                .lod = lod,
+                                .transform = transform,
+                                .firstInstance = static_cast<uint32_t>(m_instances.size()),
+                                .instanceCount = static_cast<uint32_t>(instanceTransforms.size())});
+    for (const auto& instanceTransform : instanceTransforms) {
+        m_instances.push_back({.model = instanceTransform});
+    }
+}
+
+void Renderer::drawSprite(const Sprite& sprite)
+{
+    m_spriteBatch.add(sprite);
+}
+
+void Renderer::drawSprites(std::span<const Sprite> sprites)
+{
+    m_spriteBatch.add(sprites);
+}
+
+void Renderer::drawText(const Text& text)
+{
+    m_textRenderer.draw(text, m_textBatch, m_frameCount);
+}
+
+void Renderer::setDynamicResolution(const DynamicResolutionSettings& settings)
+{
+    // Starts over from maxScale, measuring again
+    m_dynamicResolution = DynamicResolution(settings);
+}
+
+void Renderer::submitInstancedDraws(const FrameData& frameData,
+                                    vk::Pipeline pipeline,
+                                    uint32_t pipelineId,
+                                    const glm::mat4& view)
+{
+    for (const auto& draw : m_instancedDraws) {
+        const MeshLod& lod = draw.mesh->lods()[draw.lod];
+        float viewDistance = glm::length(glm::vec3(view * draw.transform[3]));
+        // Past 2^16 meshes, ids collide in the key, which only costs binds
+        uint64_t sortKey = makeSortKey(MAIN_PASS, pipelineId, draw.texture, draw.mesh->id(), viewDistance);
+        m_renderQueue.submit({.sortKey = sortKey,
+                              .pipeline = pipeline,
+                              .pipelineState = &m_graphicsPipelineState,
+                              .layout = m_graphicsPipelineLayout,
+                              .materialSetIndex = TEXTURE_SET,
+                              .materialSet = m_textureStreamer.descriptor(draw.texture),
+                              .vertexBuffer = draw.mesh->vertexBuffer(),
+                              .instanceBuffer = frameData.instanceBuffer.buffer(),
+                              .indexBuffer = draw.mesh->indexBuffer(),
+                              .indexCount = lod.indexCount,
+                              .firstIndex = lod.firstIndex,
+                              .instanceCount = draw.instanceCount,
+                              .firstInstance = draw.firstInstance,
+                              .pushConstants = {.model = draw.transform}});
+    }
+}
+
 void Renderer::drawFrame()
 {
     const auto& device = m_vkContext.device();
     const auto& swapchain = m_vkContext.swapchain();
-    const auto& frameData = m_frameData[m_frameCount % MAX_FRAMES_IN_FLIGHT];
+    auto& frameData = m_frameData[m_frameCount % MAX_FRAMES_IN_FLIGHT];
     const auto& swapchainExtent = m_vkContext.swapchainExtent();
 
     const auto& frameCommandData = frameData.commandData;
@@ -585,12 +1235,28 @@ void Renderer::drawFrame()
         device.waitForFences(*frameCommandData.renderFence, vk::True, std::numeric_limits<uint64_t>::max());
     device.resetFences(*frameCommandData.renderFence);
 
+    // The frame that used this slot before has finished, and every frame before it
+    if (m_frameCount >= MAX_FRAMES_IN_FLIGHT) {
+        m_deletionQueue.collect(m_frameCount - MAX_FRAMES_IN_FLIGHT);
+    }
+    if (auto gpuTime = m_gpuFrameTimer.read(m_frameCount)) {
+        m_dynamicResolution.update(*gpuTime, frameData.renderScale);
+    }
+    m_assetManager.collect(m_frameCount, m_deletionQueue, m_textureStreamer);
+    reloadChangedAssets();
+    m_pipelineRegistry.update(m_frameCount, m_deletionQueue);
+    m_pipelineCache.update();
+
     auto imgRes = device.acquireNextImageKHR(swapchain,
                                              std::numeric_limits<uint64_t>::max(),
                                              *frameCommandData.swapchainSemaphore);
 
     if (imgRes.result == vk::Result::eErrorOutOfDateKHR) {
         m_vkContext.recreateSwapchain();
+        m_instances.clear();
+        m_instancedDraws.clear();
+        m_spriteBatch.clear();
+        m_textBatch.clear();
         return;
     }
 
@@ -603,72 +1269,321 @@ void Renderer::drawFrame()
                                                        .pInheritanceInfo = nullptr};
 
     commandBuffer.begin(commandBufferBeginInfo);
-
-    updateUbo(commandBuffer, frameData.ubo.buffer(), swapchainExtent);
-
-    transitionImageLayout(commandBuffer,
-                          m_vkContext.swapchainImage(imgRes.value),
-                          vk::Format::eUndefined,
-                          vk::ImageLayout::eUndefined,
-                          vk::ImageLayout::eColorAttachmentOptimal);
-
-    vk::RenderingAttachmentInfo colorAttachment {.sType = vk::StructureType::eRenderingAttachmentInfo,
-                                                 .pNext = nullptr,
-                                                 .imageView = m_vkContext.swapchainImageView(imgRes.value),
-                                                 .imageLayout = vk::ImageLayout::eColorAttachmentOptimal,
-                                                 .resolveMode = {},
-                                                 .resolveImageView = {},
-                                                 .resolveImageLayout = {},
-                                                 .loadOp = vk::AttachmentLoadOp::eClear,
-                                                 .storeOp = vk::AttachmentStoreOp::eStore,
-                                                 .clearValue = {}};
-
-    vk::RenderingInfo renderingInfo {
-        .sType = vk::StructureType::eRenderingInfo,
-        .pNext = nullptr,
-        .flags = {},
-        .renderArea = {vk::Offset2D {0, 0}, swapchainExtent},
-        .layerCount = 1,
-        .viewMask = 0,
-        .colorAttachmentCount = 1,
-        .pColorAttachments = &colorAttachment,
-        .pDepthAttachment = nullptr,
-        .pStencilAttachment = nullptr
+    m_gpuFrameTimer.begin(commandBuffer, m_frameCount);
+
+    // The scene is rendered in the renderExtent region of targets sized for the largest scale, so scale changes do not
+    // reallocate them. Whenever the scale can change, it goes through a scene color target and is upscaled to the
+    // swapchain, even on frames at full scale
+    frameData.renderScale = m_dynamicResolution.scale();
+    vk::Extent2D renderExtent = m_dynamicResolution.renderExtent(swapchainExtent);
+    vk::Extent2D targetExtent = m_dynamicResolution.maxRenderExtent(swapchainExtent);
+    const auto& resolutionSettings = m_dynamicResolution.settings();
+    bool upscaled = targetExtent != swapchainExtent ||
+                    (m_gpuFrameTimer.supported() && resolutionSettings.minScale < resolutionSettings.maxScale);
+
+    UniformBufferObject uboData = updateUbo(commandBuffer, frameData.ubo.buffer(), swapchainExtent);
+    glm::mat4 testMeshModel = testMeshTransform();
+
+    // Texture streaming and LOD selection feedback
+    const MeshBounds& bounds = m_testMesh.bounds();
+    float meshScreenSize = utils::projectedSphereDiameter(uboData.view * testMeshModel,
+                                                          uboData.proj,
+                                                          bounds.center,
+                                                          bounds.radius,
+                                                          static_cast<float>(renderExtent.height));
+    m_textureStreamer.requestScreenSize(m_testTexture, meshScreenSize);
+    m_testMeshLod = selectLod(m_testMesh.lods(), meshScreenSize, m_testMeshLod);
+    m_spriteBatch.build();
+    for (const auto& draw : m_spriteBatch.draws()) {
+        // Atlas pages are always resident
+        if (draw.texture.source == SpriteTexture::Source::eStreamed) {
+            m_textureStreamer.requestScreenSize(draw.texture.handle, draw.textureScreenSize);
+        }
+    }
+    m_textureStreamer.update(commandBuffer, m_frameCount, m_deletionQueue);
+    m_spriteAtlas.update(commandBuffer, m_frameCount, m_deletionQueue);
+    m_textBatch.build();
+    m_textRenderer.update(commandBuffer, m_frameCount, m_deletionQueue);
+
+    glm::mat4 testMeshInstance(1.f);
+    drawInstanced(m_testMesh, m_testTexture, {&testMeshInstance, 1}, testMeshModel, m_testMeshLod);
+    glm::mat4 viewProj = uboData.proj * uboData.view;
+    glm::vec3 cameraPosition(glm::inverse(uboData.view)[3]);
+    cullInstances(viewProj);
+    uploadInstances(frameData);
+    uploadSprites(frameData);
+
+    // The previous pyramid and the scene's descriptor set reading it are retired, frames in flight may still use them
+    if (m_depthPyramid.resize(targetExtent, m_frameCount, m_deletionQueue)) {
+        m_depthPyramid.clear(commandBuffer);
+        m_testScene.setDepthPyramid(m_depthPyramid, m_frameCount, m_deletionQueue);
+    }
+    m_depthPyramid.setDepthExtent(renderExtent);
+
+    // Follows the swapchain format, compiling a new pipeline if it changes
+    m_graphicsPipelineState.colorFormat = m_vkContext.swapchainColorFormat();
+    m_graphicsPipelineState.depthFormat = m_depthFormat;
+    vk::Pipeline graphicsPipeline = m_pipelineRegistry.get(m_graphicsPipelineState);
+    uint32_t graphicsPipelineId = m_pipelineRegistry.id(m_graphicsPipelineState);
+    m_spritePipelineState.colorFormat = m_vkContext.swapchainColorFormat();
+    vk::Pipeline spritePipeline = m_pipelineRegistry.get(m_spritePipelineState);
+    m_textPipelineState.colorFormat = m_vkContext.swapchainColorFormat();
+    vk::Pipeline textPipeline = m_pipelineRegistry.get(m_textPipelineState);
+    m_upscalePipelineState.colorFormat = m_vkContext.swapchainColorFormat();
+    vk::Pipeline upscalePipeline = upscaled ? m_pipelineRegistry.get(m_upscalePipelineState) : nullptr;
+
+    // Culled on the GPU, their transforms are their instance data. Skipped while the pipeline compiles
+    auto drawTestScene = [&](vk::CommandBuffer passCommandBuffer) {
+        vk::DescriptorSet sets[] = {frameData.globalDescriptorSet, m_textureStreamer.descriptor(m_testTexture)};
+        passCommandBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, graphicsPipeline);
+        setDynamicState(passCommandBuffer, m_graphicsPipelineState);
+        passCommandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics,
+                                             m_graphicsPipelineLayout,
+                                             0,
+                                             sets,
+                                             nullptr);
+        pushConstants(passCommandBuffer,
+                      m_graphicsPipelineLayout,
+                      vk::ShaderStageFlagBits::eVertex,
+                      DrawPushConstants {.model = glm::mat4(1.f)});
+        m_testScene.draw(passCommandBuffer, m_testMesh);
     };
 
-    commandBuffer.beginRendering(renderingInfo);
-
-    commandBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, *m_graphicsPipeline);
-
-    // set dynamic viewport and scissor
-    vk::Viewport viewport {.x = 0.f,
-                           .y = 0.f,
-                           .width = static_cast<float>(swapchainExtent.width),
-                           .height = static_cast<float>(swapchainExtent.height),
-                           .minDepth = 0.f,
-                           .maxDepth = 1.f};
-    commandBuffer.setViewport(0, viewport);
-
-    vk::Rect2D scissor {
-        .offset = {0, 0},
-        .extent = swapchainExtent
+    // The initial accesses are those of the previous frame, and of the acquire semaphore's wait for the swapchain
+    // image. The depth buffer only lives through the frame
+    RenderGraphImage swapchainImage =
+        m_renderGraph.importImage("Swapchain image",
+                                  {.image = m_vkContext.swapchainImage(imgRes.value),
+                                   .view = m_vkContext.swapchainImageView(imgRes.value),
+                                   .sampledView = nullptr,
+                                   .format = m_vkContext.swapchainColorFormat(),
+                                   .levelCount = 1,
+                                   .initialLayout = vk::ImageLayout::eUndefined,
+                                   .finalLayout = vk::ImageLayout::ePresentSrcKHR,
+                                   .initialStages = vk::PipelineStageFlagBits2::eColorAttachmentOutput,
+                                   .initialAccess = {}});
+    RenderGraphImage depth = m_renderGraph.createImage("Depth", {.format = m_depthFormat, .extent = targetExtent});
+    RenderGraphImage sceneColor =
+        upscaled ? m_renderGraph.createImage("Scene color",
+                                             {.format = m_vkContext.swapchainColorFormat(), .extent = targetExtent})
+                 : swapchainImage;
+    RenderGraphImage depthPyramid =
+        m_renderGraph.importImage("Depth pyramid",
+                                  {.image = m_depthPyramid.image(),
+                                   .view = m_depthPyramid.imageView(),
+                                   .sampledView = nullptr,
+                                   .format = m_depthPyramid.format(),
+                                   .levelCount = m_depthPyramid.imageLevelCount(),
+                                   .initialLayout = vk::ImageLayout::eGeneral,
+                                   .finalLayout = vk::ImageLayout::eUndefined,
+                                   .initialStages = vk::PipelineStageFlagBits2::eComputeShader,
+                                   .initialAccess = {}});
+    RenderGraphBuffer drawCommands =
+        m_renderGraph.importBuffer("Draw commands",
+                                   {.buffer = m_testScene.drawCommandBuffer(),
+                                    .initialStages = vk::PipelineStageFlagBits2::eDrawIndirect,
+                                    .initialAccess = {}});
+    RenderGraphBuffer drawCount =
+        m_renderGraph.importBuffer("Draw count",
+                                   {.buffer = m_testScene.drawCountBuffer(),
+                                    .initialStages = vk::PipelineStageFlagBits2::eDrawIndirect,
+                                    .initialAccess = {}});
+    RenderGraphBuffer visibility =
+        m_renderGraph.importBuffer("Visibility",
+                                   {.buffer = m_testScene.visibilityBuffer(),
+                                    .initialStages = vk::PipelineStageFlagBits2::eComputeShader,
+                                    .initialAccess = vk::AccessFlagBits2::eShaderStorageWrite});
+
+    auto cullTestScene = [&](vk::CommandBuffer passCommandBuffer, CullPhase phase) {
+        m_testScene.cull(passCommandBuffer,
+                         *m_cullPipeline,
+                         m_cullPipelineLayout,
+                         viewProj,
+                         cameraPosition,
+                         phase,
+                         m_depthPyramid);
     };
-    commandBuffer.setScissor(0, scissor);
 
-    // draw
-    vk::DescriptorSet sets[] = {frameData.globalDescriptorSet, m_testTexture.descriptor()};
-    commandBuffer.bindVertexBuffers(0, m_testMesh.vertexBuffer(), {0});
-    commandBuffer.bindIndexBuffer(m_testMesh.indexBuffer(), 0, vk::IndexType::eUint32);
-    commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, *m_graphicsPipelineLayout, 0, sets, nullptr);
-    commandBuffer.drawIndexed(m_testMesh.numIndices(), 1, 0, 0, 0);
+    m_renderGraph
+        .addPass("Early cull",
+                 [&](vk::CommandBuffer passCommandBuffer) { cullTestScene(passCommandBuffer, CullPhase::eEarly); })
+        .use(drawCommands, BufferUsage::eComputeStorageWrite)
+        .use(drawCount, BufferUsage::eTransferWrite)
+        .use(drawCount, BufferUsage::eComputeStorageReadWrite)
+        .use(visibility, BufferUsage::eComputeStorageRead);
+
+    // Early pass: the objects visible in the previous frame, the occluders of the depth pyramid
+    m_renderGraph
+        .addPass("Early pass",
+                 [&](vk::CommandBuffer passCommandBuffer) {
+                     beginMainPass(passCommandBuffer,
+                                   m_renderGraph.imageView(sceneColor),
+                                   m_renderGraph.imageView(depth),
+                                   renderExtent,
+                                   true);
+                     if (graphicsPipeline) {
+                         drawTestScene(passCommandBuffer);
+                     }
+                     passCommandBuffer.endRendering();
+                 })
+        .use(sceneColor, ImageUsage::eColorAttachmentWrite)
+        .use(depth, ImageUsage::eDepthAttachmentWrite)
+        .use(drawCommands, BufferUsage::eIndirectRead)
+        .use(drawCount, BufferUsage::eIndirectRead);
+
+    m_renderGraph
+        .addPass("Depth pyramid",
+                 [&](vk::CommandBuffer passCommandBuffer) {
+                     m_depthPyramid.build(
+                         passCommandBuffer, *m_depthReducePipeline, m_depthReducePipelineLayout, m_frameCount);
+                 })
+        .use(depth, ImageUsage::eComputeSampled)
+        .use(depthPyramid, ImageUsage::eComputeStorageReadWrite);
+
+    m_renderGraph
+        .addPass("Late cull",
+                 [&](vk::CommandBuffer passCommandBuffer) { cullTestScene(passCommandBuffer, CullPhase::eLate); })
+        .use(drawCommands, BufferUsage::eComputeStorageWrite)
+        .use(drawCount, BufferUsage::eTransferWrite)
+        .use(drawCount, BufferUsage::eComputeStorageReadWrite)
+        .use(visibility, BufferUsage::eComputeStorageReadWrite)
+        .use(depthPyramid, ImageUsage::eComputeStorageRead);
+
+    // Late pass: the objects that just became visible, then everything else
+    m_renderGraph
+        .addPass("Late pass",
+                 [&](vk::CommandBuffer passCommandBuffer) {
+                     beginMainPass(passCommandBuffer,
+                                   m_renderGraph.imageView(sceneColor),
+                                   m_renderGraph.imageView(depth),
+                                   renderExtent,
+                                   false);
+                     if (graphicsPipeline) {
+                         // Bound again, the dispatches in between may have disturbed the push constants
+                         drawTestScene(passCommandBuffer);
+                         submitInstancedDraws(frameData, graphicsPipeline, graphicsPipelineId, uboData.view);
+                         m_renderQueue.flush(passCommandBuffer);
+                     }
+                     passCommandBuffer.endRendering();
+                 })
+        .use(sceneColor, ImageUsage::eColorAttachmentReadWrite)
+        .use(depth, ImageUsage::eDepthAttachmentReadWrite)
+        .use(drawCommands, BufferUsage::eIndirectRead)
+        .use(drawCount, BufferUsage::eIndirectRead);
+
+    // Bilinear, the swapchain images are only color attachments so they cannot be blitted to
+    if (upscaled) {
+        // Only the rendered region is sampled, clamped half a texel inside it so filtering does not read past it
+        glm::vec2 targetSize(targetExtent.width, targetExtent.height);
+        glm::vec2 renderSize(renderExtent.width, renderExtent.height);
+        UpscalePushConstants upscaleConstants {.uvScale = renderSize / targetSize,
+                                               .uvMax = (renderSize - 0.5f) / targetSize};
+        m_renderGraph
+            .addPass("Upscale",
+                     [&](vk::CommandBuffer passCommandBuffer) {
+                         beginMainPass(passCommandBuffer,
+                                       m_renderGraph.imageView(swapchainImage),
+                                       nullptr,
+                                       swapchainExtent,
+                                       true);
+                         if (upscalePipeline) {
+                             passCommandBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, upscalePipeline);
+                             setDynamicState(passCommandBuffer, m_upscalePipelineState);
+                             passCommandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics,
+                                                                  m_upscalePipelineLayout,
+                                                                  UPSCALE_SOURCE_SET,
+                                                                  frameData.upscaleDescriptorSet,
+                                                                  nullptr);
+                             pushConstants(passCommandBuffer,
+                                           m_upscalePipelineLayout,
+                                           vk::ShaderStageFlagBits::eFragment,
+                                           upscaleConstants);
+                             passCommandBuffer.draw(3, 1, 0, 0);
+                         }
+                         passCommandBuffer.endRendering();
+                     })
+            .use(sceneColor, ImageUsage::eFragmentSampled)
+            .use(swapchainImage, ImageUsage::eColorAttachmentWrite);
+    }
 
-    commandBuffer.endRendering();
+    // Sprites over the scene, then text over the sprites, without depth
+    if (!m_spriteBatch.empty() || !m_textBatch.empty()) {
+        m_renderGraph
+            .addPass("Sprites",
+                     [&](vk::CommandBuffer passCommandBuffer) {
+                         beginMainPass(passCommandBuffer,
+                                       m_renderGraph.imageView(swapchainImage),
+                                       nullptr,
+                                       swapchainExtent,
+                                       false);
+                         // Pixels have y pointing down, as Vulkan's clip space
+                         glm::mat4 pixelsToClip = glm::ortho(0.f,
+                                                             static_cast<float>(swapchainExtent.width),
+                                                             0.f,
+                                                             static_cast<float>(swapchainExtent.height));
+                         if (spritePipeline && !m_spriteBatch.empty()) {
+                             passCommandBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, spritePipeline);
+                             setDynamicState(passCommandBuffer, m_spritePipelineState);
+                             pushConstants(passCommandBuffer,
+                                           m_spritePipelineLayout,
+                                           vk::ShaderStageFlagBits::eVertex,
+                                           SpritePushConstants {.viewProj = pixelsToClip});
+                             m_spriteBatch.record(passCommandBuffer,
+                                                  m_spritePipelineLayout,
+                                                  SPRITE_TEXTURE_SET,
+                                                  [this](const SpriteTexture& texture) {
+                                                      return spriteTextureDescriptor(texture);
+                                                  },
+                                                  frameData.spriteBuffer.buffer(),
+                                                  0);
+                         }
+                         if (textPipeline && !m_textBatch.empty()) {
+                             passCommandBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, textPipeline);
+                             setDynamicState(passCommandBuffer, m_textPipelineState);
+                             pushConstants(passCommandBuffer,
+                                           m_textPipelineLayout,
+                                           vk::ShaderStageFlagBits::eVertex,
+                                           SpritePushConstants {.viewProj = pixelsToClip});
+                             // Uploaded after the sprite instances
+                             m_textBatch.record(passCommandBuffer,
+                                                m_textPipelineLayout,
+                                                SPRITE_TEXTURE_SET,
+                                                [this](const SpriteTexture& texture) {
+                                                    return spriteTextureDescriptor(texture);
+                                                },
+                                                frameData.spriteBuffer.buffer(),
+                                                m_spriteBatch.instances().size_bytes());
+                         }
+                         passCommandBuffer.endRendering();
+                     })
+            .use(swapchainImage, ImageUsage::eColorAttachmentReadWrite);
+    }
 
-    transitionImageLayout(commandBuffer,
-                          m_vkContext.swapchainImage(imgRes.value),
-                          vk::Format::eUndefined,
-                          vk::ImageLayout::eColorAttachmentOptimal,
-                          vk::ImageLayout::ePresentSrcKHR);
+    m_renderGraph.compile(m_frameCount, m_deletionQueue);
+    m_depthPyramid.setDepthView(m_renderGraph.sampledImageView(depth), m_frameCount);
+    if (upscaled) {
+        // Not in use, the frame that used this slot before has finished
+        vk::DescriptorImageInfo imageInfo {.sampler = *m_upscaleSampler,
+                                           .imageView = m_renderGraph.sampledImageView(sceneColor),
+                                           .imageLayout = vk::ImageLayout::eShaderReadOnlyOptimal};
+        vk::WriteDescriptorSet descriptorWrite {.sType = vk::StructureType::eWriteDescriptorSet,
+                                                .pNext = nullptr,
+                                                .dstSet = frameData.upscaleDescriptorSet,
+                                                .dstBinding = 0,
+                                                .dstArrayElement = 0,
+                                                .descriptorCount = 1,
+                                                .descriptorType = vk::DescriptorType::eCombinedImageSampler,
+                                                .pImageInfo = &imageInfo,
+                                                .pBufferInfo = nullptr,
+                                                .pTexelBufferView = nullptr};
+        device.updateDescriptorSets(descriptorWrite, nullptr);
+    }
+    m_renderGraph.execute(commandBuffer);
+    m_gpuFrameTimer.end(commandBuffer, m_frameCount);
+    m_instances.clear();
+    m_instancedDraws.clear();
+    m_spriteBatch.clear();
+    m_textBatch.clear();
 
     commandBuffer.end();
 
@@ -1,18 +1,58 @@
 #ifndef RENDERER_RENDERER_HPP
 #define RENDERER_RENDERER_HPP
 
+#include "AssetManager.hpp"
+#include "DeletionQueue.hpp"
+#include "DepthPyramid.hpp"
+#include "DynamicResolution.hpp"
+#include "FrustumCuller.hpp"
+#include "GltfImporter.hpp"
+#include "GpuFrameTimer.hpp"
+#include "GpuScene.hpp"
 #include "Image.hpp"
+#include "LayoutCache.hpp"
+#include "PipelineCache.hpp"
+#include "PipelineRegistry.hpp"
+#include "RenderGraph.hpp"
+#include "RenderQueue.hpp"
+#include "SpriteBatch.hpp"
+#include "TextureAtlas.hpp"
+#include "TextRenderer.hpp"
+#include "TextureStreamer.hpp"
 #include "Types.hpp"
 #include "VulkanGraphicsContext.hpp"
+#include "core/FileWatcher.hpp"
+#include "core/ThreadPool.hpp"
+
+// libs
+#include <glm/glm.hpp>
 
 // std
 #include <filesystem>
+#include <future>
+#include <memory>
+#include <span>
+#include <string>
+#include <unordered_map>
+#include <vector>
 
 struct SDL_Window;
 
 namespace renderer
 {
 
+struct ImportedMaterial {
+    glm::vec4 baseColorFactor;
+    TextureHandle baseColorTexture;   // INVALID_TEXTURE_HANDLE if untextured
+};
+
+struct ImportedModel {
+    std::vector<Mesh> meshes;              // one per glTF primitive
+    std::vector<uint32_t> meshMaterials;   // index into materials for each mesh, GLTF_NONE for the default material
+    std::vector<ImportedMaterial> materials;
+    std::vector<GltfInstance> instances;   // GltfInstance::mesh indexes meshes
+};
+
 class Renderer
 {
 public:
@@ -30,57 +70,202 @@ public:
 public:
     void drawFrame();
 
+    // Draws the mesh once per instance transform, in a single draw call of the next drawFrame. transform applies to
+    // every instance. The mesh must stay alive until then. Draws are sorted to minimize state changes
+    void drawInstanced(const Mesh& mesh,
+                       TextureHandle texture,
+                       std::span<const glm::mat4> instanceTransforms,
+                       const glm::mat4& transform = glm::mat4(1.f),
+                       uint32_t lod = 0);
+
+    // Drawn over the scene by the next drawFrame, in screen space. The textures must stay loaded until then
+    void drawSprite(const Sprite& sprite);
+    void drawSprites(std::span<const Sprite> sprites);
+    // Drawn over the sprites by the next drawFrame, the string is only read during the call
+    void drawText(const Text& text);
+
+    // Streamed, and reloaded when the file changes. Loads of the same file and format, or of identical files, share the
+    // texture. Each load must be paired with a releaseTexture once no draw uses the handle anymore
+    TextureHandle loadTexture(const std::filesystem::path& path, vk::Format format = vk::Format::eR8G8B8A8Srgb);
+    void releaseTexture(TextureHandle handle);
+    // Packed into the sprite atlas on first use, so sprites using any of these images are drawn together. Never
+    // evicted nor reloaded
+    AtlasRegion loadSpriteImage(const std::filesystem::path& path);
+    // A .ttf file, for drawText
+    FontHandle loadFont(const std::filesystem::path& path);
+
+    // Loads every mesh of a .gltf or .glb file with a single staging buffer and transfer submission. Each primitive is
+    // converted into its own vertex and index arrays, optimized, given its LODs and meshlets on the worker threads,
+    // then copied to the staging buffer: the converted meshes and the staging buffer are both alive at the peak, about
+    // twice the size of the uploaded geometry. The cache and overdraw gains are logged; measuring overdraw rasterizes
+    // every mesh twice, which large scenes may skip
+    ImportedModel importGltf(const std::filesystem::path& path, bool measureOverdraw = true);
+
+    // The scene is rendered at the scale holding the GPU frame time target, then upscaled to the swapchain. Sprites
+    // and text are drawn after the upscale, at full resolution. Without GPU timestamps, the scale stays at maxScale
+    void setDynamicResolution(const DynamicResolutionSettings& settings);
+
+    // Of the last frame's drawInstanced calls
+    const RenderQueueStats& renderQueueStats() const noexcept { return m_renderQueue.stats(); }
+    // Of the last frame's sprites
+    const SpriteBatchStats& spriteBatchStats() const noexcept { return m_spriteBatch.stats(); }
+    // Of the last frame's text
+    const TextStats& textStats() const noexcept { return m_textRenderer.stats(); }
+    const DynamicResolutionStats& dynamicResolutionStats() const noexcept { return m_dynamicResolution.stats(); }
+
 private:
     void initTransferCommandData();
     void initFrameCommandData();
 
+    // Reflected from the shaders, along with the set layouts
+    void createGraphicsPipelineLayout();
+
     void createGlobalDescriptorPool();
     void allocateFrameUboBuffers();
-    vk::UniqueDescriptorSetLayout createGlobalDescriptorSets();
+    void createGlobalDescriptorSets();
 
     void createTextureSampler();
-    void createTextureDescriptorPool();
-    vk::UniqueDescriptorSetLayout createTextureSetLayout();
 
-    void createGraphicsPipeline(const std::vector<vk::DescriptorSetLayout>& descriptorSetLayouts);
+    void createGraphicsPipeline();
+    // Layouts reflected from the sprite and text shaders, sharing the texture set layout
+    void createSpritePipelines();
+    // Layout reflected from frustum_cull.comp
+    void createCullPipeline();
+    // Layout reflected from depth_reduce.comp
+    void createDepthReducePipeline();
+    // Layout reflected from the upscale shaders, with its clamping sampler and a descriptor set per frame
+    void createUpscalePipeline();
+
+    // Drops the queued instances outside of the frustum, and the draws left without instances
+    void cullInstances(const glm::mat4& viewProj);
+    // Writes the instances queued by drawInstanced to the frame's instance buffer, growing it if needed
+    void uploadInstances(FrameData& frameData);
+    // Submits the queued draws to the render queue, along with their instances uploaded to the frame
+    void submitInstancedDraws(const FrameData& frameData,
+                              vk::Pipeline pipeline,
+                              uint32_t pipelineId,
+                              const glm::mat4& view);
+    // Writes the built sprite instances, then the text ones, to the frame's sprite buffer, growing it if needed
+    void uploadSprites(FrameData& frameData);
+    // Resolved at record time, as streamed textures change their descriptor when their resolution changes
+    vk::DescriptorSet spriteTextureDescriptor(const SpriteTexture& texture) const;
+
+    // Hot reload: changed files are rebuilt on the worker threads, and swapped in at the start of a frame
+    void reloadChangedAssets();
 
     vk::UniqueCommandBuffer beginSingleTimeTransferCommand() const;
     void endSingleTimeTransferCommand(vk::UniqueCommandBuffer&& commandBuffer) const;
 
-    static void transitionImageLayout(vk::CommandBuffer commandBuffer,
-                                      vk::Image image,
-                                      vk::Format format,
-                                      vk::ImageLayout oldLayout,
-                                      vk::ImageLayout newLayout);
+    // Begins rendering to the color and depth views, with the viewport and scissor covering extent. The first pass of a
+    // frame clears both, and stores the depth for the depth pyramid; the next ones load them. A null depth view renders
+    // without depth attachment
+    void beginMainPass(vk::CommandBuffer commandBuffer,
+                       vk::ImageView colorView,
+                       vk::ImageView depthView,
+                       const vk::Extent2D& extent,
+                       bool clear) const;
 
     // TODO: move when being relative to a camera
-    void updateUbo(vk::CommandBuffer command, vk::Buffer ubo, const vk::Extent2D& swapchainExtent) const;
+    UniformBufferObject updateUbo(vk::CommandBuffer command, vk::Buffer ubo, const vk::Extent2D& swapchainExtent) const;
+    // Model matrix of the test scene's mesh, spinning a quarter turn per second around z
+    glm::mat4 testMeshTransform() const;
 
     // TODO: create a render object? Somehow pass these to draw frame to be called extenally
-    Allocated2DImage loadImage(const std::filesystem::path& path) const;
-    AllocatedTexture createTexture(std::shared_ptr<const Allocated2DImage> image, vk::Format format) const;
-    Mesh createMesh() const;
+    Mesh createMesh(std::span<const Vertex> vertices, std::span<const uint32_t> indices);
+    // An object per transform, drawing the full detail of the mesh
+    GpuScene createGpuScene(const Mesh& mesh, std::span<const glm::mat4> transforms) const;
 
 private:
     static constexpr uint32_t MAX_FRAMES_IN_FLIGHT = 2;
+    static constexpr vk::DeviceSize TEXTURE_STREAMING_BUDGET = 256 * 1024 * 1024;
+    // Device memory kept for assets no longer referenced, so reloading them is free
+    static constexpr vk::DeviceSize UNUSED_ASSETS_BUDGET = 64 * 1024 * 1024;
+    static constexpr uint32_t SPRITE_ATLAS_PAGE_SIZE = 2048;
+    // Images are padded by 2^(mips - 1) texels
+    static constexpr uint32_t SPRITE_ATLAS_MIP_LEVELS = 4;
 
     VulkanGraphicsContext m_vkContext;
+    // Before the thread pool, as workers may still be building pipelines when it is destroyed
+    PipelineCache m_pipelineCache;
+    std::unique_ptr<core::ThreadPool> m_threadPool;
     TransferCommandData m_transferCommandData;
     size_t m_frameCount = 0;
     FrameData m_frameData[MAX_FRAMES_IN_FLIGHT];
+    vk::Format m_depthFormat = vk::Format::eUndefined;
+    RenderGraph m_renderGraph;
+
+    LayoutCache m_layoutCache;
+    vk::DescriptorSetLayout m_globalSetLayout;     // not owned
+    vk::DescriptorSetLayout m_textureSetLayout;    // not owned
+    vk::PipelineLayout m_graphicsPipelineLayout;   // not owned
+    vk::DescriptorSetLayout m_cullSetLayout;       // not owned
+    vk::PipelineLayout m_cullPipelineLayout;       // not owned
+    vk::UniquePipeline m_cullPipeline;
+    vk::DescriptorSetLayout m_depthReduceSetLayout;   // not owned
+    vk::PipelineLayout m_depthReducePipelineLayout;   // not owned
+    vk::UniquePipeline m_depthReducePipeline;
+    DepthPyramid m_depthPyramid;
+    GpuFrameTimer m_gpuFrameTimer;
+    DynamicResolution m_dynamicResolution;
 
     vk::UniqueDescriptorPool m_globalDescriptorPool;
 
     vk::UniqueSampler m_textureSampler;
-    vk::UniqueDescriptorPool m_textureDescriptorPool;
-    vk::UniqueDescriptorSetLayout m_textureSetLayout;
+    TextureStreamer m_textureStreamer;
+    TextureAtlas m_spriteAtlas;
+    std::unordered_map<std::string, AtlasRegion> m_spriteImages;   // by canonical path
+    TextRenderer m_textRenderer;
+    AssetManager m_assetManager;
 
-    vk::UniquePipelineLayout m_graphicsPipelineLayout;
-    vk::UniquePipeline m_graphicsPipeline;
+    // After the layout cache, its destructor waits for the compilations using its layouts
+    PipelineRegistry m_pipelineRegistry;
+    GraphicsPipelineState m_graphicsPipelineState;
+    vk::PipelineLayout m_spritePipelineLayout;   // not owned
+    GraphicsPipelineState m_spritePipelineState;
+    vk::PipelineLayout m_textPipelineLayout;   // not owned
+    GraphicsPipelineState m_textPipelineState;
+    vk::DescriptorSetLayout m_upscaleSetLayout;   // not owned
+    vk::PipelineLayout m_upscalePipelineLayout;   // not owned
+    GraphicsPipelineState m_upscalePipelineState;
+    vk::UniqueSampler m_upscaleSampler;
+    vk::UniqueDescriptorPool m_upscaleDescriptorPool;
 
+    struct PendingTextureReload {
+        std::filesystem::path path;
+        TextureHandle handle;
+        std::future<TextureStreamer::DecodedTexture> texture;
+    };
+
+    struct InstancedDraw {
+        const Mesh* mesh;
+        TextureHandle texture;
+        uint32_t lod;
+        glm::mat4 transform;
+        uint32_t firstInstance;   // into m_instances
+        uint32_t instanceCount;
+    };
+
+    // Queued for the next frame
+    std::vector<InstanceData> m_instances;
+    std::vector<InstancedDraw> m_instancedDraws;
+    FrustumCuller m_frustumCuller;
+    std::vector<uint32_t> m_visibleInstances;
+    RenderQueue m_renderQueue;
+    SpriteBatch m_spriteBatch;
+    SpriteBatch m_textBatch;
+
+    core::FileWatcher m_fileWatcher;
+    std::vector<PendingTextureReload> m_pendingTextureReloads;
+
+    uint32_t m_meshCount = 0;   // numbers the created meshes
     // TODO: remove
     Mesh m_testMesh;
-    AllocatedTexture m_testTexture;
+    uint32_t m_testMeshLod = 0;
+    TextureHandle m_testTexture = INVALID_TEXTURE_HANDLE;
+    GpuScene m_testScene;
+
+    // Declared last, so retired resources are destroyed before the pools and allocators they came from
+    DeletionQueue m_deletionQueue;
 };
 
 }   // namespace renderer
@@ -0,0 +1,495 @@
+#include "ShaderReflection.hpp"
+
+// libs
+#include <vulkan/vulkan_to_string.hpp>
+
+// std
+#include <algorithm>
+#include <optional>
+#include <stdexcept>
+#include <string>
+
+namespace renderer
+{
+
+namespace
+{
+// Values from the SPIR-V specification, only those needed to find the interface of a shader
+namespace spv
+{
+constexpr uint32_t MAGIC = 0x07230203;
+constexpr size_t HEADER_WORDS = 5;
+
+constexpr uint32_t OP_ENTRY_POINT = 15;
+constexpr uint32_t OP_TYPE_BOOL = 20;
+constexpr uint32_t OP_TYPE_INT = 21;
+constexpr uint32_t OP_TYPE_FLOAT = 22;
+constexpr uint32_t OP_TYPE_VECTOR = 23;
+constexpr uint32_t OP_TYPE_MATRIX = 24;
+constexpr uint32_t OP_TYPE_IMAGE = 25;
+constexpr uint32_t OP_TYPE_SAMPLER = 26;
+constexpr uint32_t OP_TYPE_SAMPLED_IMAGE = 27;
+constexpr uint32_t OP_TYPE_ARRAY = 28;
+constexpr uint32_t OP_TYPE_RUNTIME_ARRAY = 29;
+constexpr uint32_t OP_TYPE_STRUCT = 30;
+constexpr uint32_t OP_TYPE_POINTER = 32;
+constexpr uint32_t OP_CONSTANT = 43;
+constexpr uint32_t OP_SPEC_CONSTANT = 50;
+constexpr uint32_t OP_VARIABLE = 59;
+constexpr uint32_t OP_DECORATE = 71;
+constexpr uint32_t OP_MEMBER_DECORATE = 72;
+constexpr uint32_t OP_TYPE_ACCELERATION_STRUCTURE = 5341;
+
+constexpr uint32_t DECORATION_BUFFER_BLOCK = 3;
+constexpr uint32_t DECORATION_ARRAY_STRIDE = 6;
+constexpr uint32_t DECORATION_MATRIX_STRIDE = 7;
+constexpr uint32_t DECORATION_BUILT_IN = 11;
+constexpr uint32_t DECORATION_LOCATION = 30;
+constexpr uint32_t DECORATION_BINDING = 33;
+constexpr uint32_t DECORATION_DESCRIPTOR_SET = 34;
+constexpr uint32_t DECORATION_OFFSET = 35;
+
+constexpr uint32_t STORAGE_CLASS_UNIFORM_CONSTANT = 0;
+constexpr uint32_t STORAGE_CLASS_INPUT = 1;
+constexpr uint32_t STORAGE_CLASS_UNIFORM = 2;
+constexpr uint32_t STORAGE_CLASS_PUSH_CONSTANT = 9;
+constexpr uint32_t STORAGE_CLASS_STORAGE_BUFFER = 12;
+
+constexpr uint32_t DIM_BUFFER = 5;
+constexpr uint32_t DIM_SUBPASS_DATA = 6;
+
+constexpr uint32_t IMAGE_SAMPLED = 1;
+}   // namespace spv
+
+struct MemberDecorations {
+    uint32_t offset = 0;
+    uint32_t matrixStride = 0;
+};
+
+struct Decorations {
+    std::optional<uint32_t> set;
+    std::optional<uint32_t> binding;
+    std::optional<uint32_t> location;
+    bool builtIn = false;
+    bool bufferBlock = false;
+    uint32_t arrayStride = 0;
+    std::vector<MemberDecorations> members;
+};
+
+struct Variable {
+    uint32_t id = 0;
+    uint32_t type = 0;   // the pointee
+    uint32_t storageClass = 0;
+};
+
+// Only the declarations, function bodies are skipped
+struct Module {
+    vk::ShaderStageFlags stage;
+    // By id: the opcode followed by the operands after the result id. Empty for ids that are not types
+    std::vector<std::vector<uint32_t>> types;
+    std::vector<std::optional<uint32_t>> constants;
+    std::vector<Decorations> decorations;
+    std::vector<Variable> variables;
+
+    uint32_t id(uint32_t value) const
+    {
+        if (value >= types.size()) {
+            throw std::runtime_error("SPIR-V id " + std::to_string(value) + " is out of bounds");
+        }
+        return value;
+    }
+
+    const std::vector<uint32_t>& type(uint32_t typeId) const
+    {
+        const auto& result = types[id(typeId)];
+        if (result.empty()) {
+            throw std::runtime_error("SPIR-V id " + std::to_string(typeId) + " is not a type");
+        }
+        return result;
+    }
+
+    uint32_t constant(uint32_t constantId) const
+    {
+        const auto& result = constants[id(constantId)];
+        if (!result) {
+            throw std::runtime_error("SPIR-V id " + std::to_string(constantId) + " is not a constant");
+        }
+        return *result;
+    }
+};
+
+vk::ShaderStageFlags executionModelStage(uint32_t executionModel)
+{
+    switch (executionModel) {
+        case 0: return vk::ShaderStageFlagBits::eVertex;
+        case 1: return vk::ShaderStageFlagBits::eTessellationControl;
+        case 2: return vk::ShaderStageFlagBits::eTessellationEvaluation;
+        case 3: return vk::ShaderStageFlagBits::eGeometry;
+        case 4: return vk::ShaderStageFlagBits::eFragment;
+        case 5: return vk::ShaderStageFlagBits::eCompute;
+        case 5364: return vk::ShaderStageFlagBits::eTaskEXT;
+        case 5365: return vk::ShaderStageFlagBits::eMeshEXT;
+        default: throw std::runtime_error("unsupported SPIR-V execution model " + std::to_string(executionModel));
+    }
+}
+
+void decorate(Decorations& decorations, uint32_t decoration, std::span<const uint32_t> literals)
+{
+    uint32_t literal = literals.empty() ? 0 : literals[0];
+    switch (decoration) {
+        case spv::DECORATION_DESCRIPTOR_SET: decorations.set = literal; break;
+        case spv::DECORATION_BINDING: decorations.binding = literal; break;
+        case spv::DECORATION_LOCATION: decorations.location = literal; break;
+        case spv::DECORATION_BUILT_IN: decorations.builtIn = true; break;
+        case spv::DECORATION_BUFFER_BLOCK: decorations.bufferBlock = true; break;
+        case spv::DECORATION_ARRAY_STRIDE: decorations.arrayStride = literal; break;
+        default: break;
+    }
+}
+
+void decorateMember(Decorations& decorations, uint32_t member, uint32_t decoration, std::span<const uint32_t> literals)
+{
+    if (decorations.members.size() <= member) {
+        decorations.members.resize(member + 1);
+    }
+    uint32_t literal = literals.empty() ? 0 : literals[0];
+    switch (decoration) {
+        case spv::DECORATION_OFFSET: decorations.members[member].offset = literal; break;
+        case spv::DECORATION_MATRIX_STRIDE: decorations.members[member].matrixStride = literal; break;
+        case spv::DECORATION_BUILT_IN:
+            // Members of gl_PerVertex
+            decorations.builtIn = true;
+            break;
+        default: break;
+    }
+}
+
+Module parseModule(std::span<const uint32_t> code)
+{
+    if (code.size() < spv::HEADER_WORDS || code[0] != spv::MAGIC) {
+        throw std::runtime_error("not SPIR-V");
+    }
+
+    Module module;
+    uint32_t bound = code[3];
+    module.types.resize(bound);
+    module.constants.resize(bound);
+    module.decorations.resize(bound);
+
+    bool hasEntryPoint = false;
+    for (size_t i = spv::HEADER_WORDS; i < code.size();) {
+        uint32_t wordCount = code[i] >> 16;
+        uint32_t opcode = code[i] & 0xffff;
+        if (wordCount == 0 || i + wordCount > code.size()) {
+            throw std::runtime_error("truncated SPIR-V instruction");
+        }
+        std::span<const uint32_t> operands = code.subspan(i + 1, wordCount - 1);
+        i += wordCount;
+
+        switch (opcode) {
+            case spv::OP_ENTRY_POINT:
+                // Modules with several entry points are reflected as their first one
+                if (!hasEntryPoint && !operands.empty()) {
+                    module.stage = executionModelStage(operands[0]);
+                    hasEntryPoint = true;
+                }
+                break;
+            case spv::OP_TYPE_BOOL:
+            case spv::OP_TYPE_INT:
+            case spv::OP_TYPE_FLOAT:
+            case spv::OP_TYPE_VECTOR:
+            case spv::OP_TYPE_MATRIX:
+            case spv::OP_TYPE_IMAGE:
+            case spv::OP_TYPE_SAMPLER:
+            case spv::OP_TYPE_SAMPLED_IMAGE:
+            case spv::OP_TYPE_ARRAY:
+            case spv::OP_TYPE_RUNTIME_ARRAY:
+            case spv::OP_TYPE_STRUCT:
+            case spv::OP_TYPE_POINTER:
+            case spv::OP_TYPE_ACCELERATION_STRUCTURE:
+                if (!operands.empty()) {
+                    auto& type = module.types[module.id(operands[0])];
+                    type.push_back(opcode);
+                    type.insert(type.end(), operands.begin() + 1, operands.end());
+                }
+                break;
+            case spv::OP_CONSTANT:
+            case spv::OP_SPEC_CONSTANT:
+                // Only 32 bit integers are used as array lengths. Specialized lengths keep their default
+                if (operands.size() >= 3) {
+                    module.constants[module.id(operands[1])] = operands[2];
+                }
+                break;
+            case spv::OP_VARIABLE:
+                if (operands.size() >= 3) {
+                    const auto& pointer = module.type(operands[0]);
+                    if (pointer[0] != spv::OP_TYPE_POINTER || pointer.size() < 3) {
+                        throw std::runtime_error("SPIR-V variable is not a pointer");
+                    }
+                    module.variables.push_back(
+                        {.id = module.id(operands[1]), .type = pointer[2], .storageClass = operands[2]});
+                }
+                break;
+            case spv::OP_DECORATE:
+                if (operands.size() >= 2) {
+                    decorate(module.decorations[module.id(operands[0])], operands[1], operands.subspan(2));
+                }
+                break;
+            case spv::OP_MEMBER_DECORATE:
+                if (operands.size() >= 3) {
+                    decorateMember(module.decorations[module.id(operands[0])],
+                                   operands[1],
+                                   operands[2],
+                                   operands.subspan(3));
+                }
+                break;
+            default: break;
+        }
+    }
+
+    if (!hasEntryPoint) {
+        throw std::runtime_error("SPIR-V module has no entry point");
+    }
+    return module;
+}
+
+// Size in bytes of an explicitly laid out type, as in push constant blocks
+uint32_t typeSize(const Module& module, uint32_t typeId, uint32_t matrixStride = 0)
+{
+    const auto& type = module.type(typeId);
+    switch (type[0]) {
+        case spv::OP_TYPE_BOOL: return 4;
+        case spv::OP_TYPE_INT:
+        case spv::OP_TYPE_FLOAT: return type.at(1) / 8;
+        case spv::OP_TYPE_VECTOR: return type.at(2) * typeSize(module, type.at(1));
+        case spv::OP_TYPE_MATRIX: return type.at(2) * (matrixStride != 0 ? matrixStride : typeSize(module, type.at(1)));
+        case spv::OP_TYPE_ARRAY: {
+            uint32_t stride = module.decorations[typeId].arrayStride;
+            return module.constant(type.at(2)) * (stride != 0 ? stride : typeSize(module, type.at(1)));
+        }
+        case spv::OP_TYPE_STRUCT: {
+            const auto& members = module.decorations[typeId].members;
+            uint32_t size = 0;
+            for (size_t i = 1; i < type.size(); ++i) {
+                MemberDecorations member = i - 1 < members.size() ? members[i - 1] : MemberDecorations {};
+                size = std::max(size, member.offset + typeSize(module, type[i], member.matrixStride));
+            }
+            return size;
+        }
+        default: throw std::runtime_error("SPIR-V type without a size in a push constant block");
+    }
+}
+
+vk::DescriptorType descriptorType(const Module& module, uint32_t typeId, uint32_t storageClass)
+{
+    const auto& type = module.type(typeId);
+    if (storageClass == spv::STORAGE_CLASS_STORAGE_BUFFER) {
+        return vk::DescriptorType::eStorageBuffer;
+    }
+    if (storageClass == spv::STORAGE_CLASS_UNIFORM) {
+        // Storage buffers before SPIR-V 1.3
+        return module.decorations[typeId].bufferBlock ? vk::DescriptorType::eStorageBuffer
+                                                      : vk::DescriptorType::eUniformBuffer;
+    }
+
+    switch (type[0]) {
+        case spv::OP_TYPE_SAMPLER: return vk::DescriptorType::eSampler;
+        case spv::OP_TYPE_SAMPLED_IMAGE: return vk::DescriptorType::eCombinedImageSampler;
+        case spv::OP_TYPE_ACCELERATION_STRUCTURE: return vk::DescriptorType::eAccelerationStructureKHR;
+        case spv::OP_TYPE_IMAGE: {
+            bool sampled = type.at(6) == spv::IMAGE_SAMPLED;
+            if (type.at(2) == spv::DIM_BUFFER) {
+                return sampled ? vk::DescriptorType::eUniformTexelBuffer : vk::DescriptorType::eStorageTexelBuffer;
+            }
+            if (type.at(2) == spv::DIM_SUBPASS_DATA) {
+                return vk::DescriptorType::eInputAttachment;
+            }
+            return sampled ? vk::DescriptorType::eSampledImage : vk::DescriptorType::eStorageImage;
+        }
+        default: throw std::runtime_error("SPIR-V uniform of a type without a descriptor type");
+    }
+}
+
+vk::Format vertexInputFormat(const Module& module, uint32_t typeId)
+{
+    const auto& type = module.type(typeId);
+    uint32_t components = 1;
+    const auto* scalar = &type;
+    if (type[0] == spv::OP_TYPE_VECTOR) {
+        components = type.at(2);
+        scalar = &module.type(type.at(1));
+    }
+
+    static constexpr vk::Format floatFormats[] = {vk::Format::eR32Sfloat,
+                                                  vk::Format::eR32G32Sfloat,
+                                                  vk::Format::eR32G32B32Sfloat,
+                                                  vk::Format::eR32G32B32A32Sfloat};
+    static constexpr vk::Format intFormats[] = {vk::Format::eR32Sint,
+                                                vk::Format::eR32G32Sint,
+                                                vk::Format::eR32G32B32Sint,
+                                                vk::Format::eR32G32B32A32Sint};
+    static constexpr vk::Format uintFormats[] = {vk::Format::eR32Uint,
+                                                 vk::Format::eR32G32Uint,
+                                                 vk::Format::eR32G32B32Uint,
+                                                 vk::Format::eR32G32B32A32Uint};
+
+    if (components < 1 || components > 4 || scalar->size() < 2 || scalar->at(1) != 32) {
+        throw std::runtime_error("unsupported SPIR-V vertex input type");
+    }
+    if ((*scalar)[0] == spv::OP_TYPE_FLOAT) {
+        return floatFormats[components - 1];
+    }
+    if ((*scalar)[0] == spv::OP_TYPE_INT) {
+        return scalar->at(2) != 0 ? intFormats[components - 1] : uintFormats[components - 1];
+    }
+    throw std::runtime_error("unsupported SPIR-V vertex input type");
+}
+
+void reflectDescriptor(const Module& module, const Variable& variable, ShaderReflection& reflection)
+{
+    const Decorations& decorations = module.decorations[variable.id];
+    if (!decorations.set || !decorations.binding) {
+        throw std::runtime_error("SPIR-V uniform without a descriptor set or binding");
+    }
+
+    uint32_t typeId = variable.type;
+    uint32_t count = 1;
+    // Only single dimensional arrays of descriptors are valid in Vulkan
+    const auto& type = module.type(typeId);
+    if (type[0] == spv::OP_TYPE_ARRAY) {
+        count = module.constant(type.at(2));
+        typeId = type.at(1);
+    } else if (type[0] == spv::OP_TYPE_RUNTIME_ARRAY) {
+        throw std::runtime_error("runtime sized descriptor arrays are not supported");
+    }
+
+    if (reflection.descriptorSets.size() <= *decorations.set) {
+        reflection.descriptorSets.resize(*decorations.set + 1);
+    }
+    reflection.descriptorSets[*decorations.set].push_back(
+        vk::DescriptorSetLayoutBinding {.binding = *decorations.binding,
+                                        .descriptorType = descriptorType(module, typeId, variable.storageClass),
+                                        .descriptorCount = count,
+                                        .stageFlags = module.stage,
+                                        .pImmutableSamplers = nullptr});
+}
+
+void reflectPushConstants(const Module& module, const Variable& variable, ShaderReflection& reflection)
+{
+    const auto& members = module.decorations[variable.type].members;
+    uint32_t offset = members.empty() ? 0 : std::ranges::min(members, {}, &MemberDecorations::offset).offset;
+    // Rounded up, push constant ranges are multiples of 4 bytes
+    uint32_t end = (typeSize(module, variable.type) + 3) & ~3u;
+    reflection.pushConstantRanges.push_back({.stageFlags = module.stage, .offset = offset, .size = end - offset});
+}
+
+void reflectVertexInput(const Module& module, const Variable& variable, ShaderReflection& reflection)
+{
+    const Decorations& decorations = module.decorations[variable.id];
+    if (decorations.builtIn || module.decorations[variable.type].builtIn) {
+        return;
+    }
+    if (!decorations.location) {
+        throw std::runtime_error("SPIR-V vertex input without a location");
+    }
+
+    // Matrices take a location per column
+    const auto& type = module.type(variable.type);
+    if (type[0] == spv::OP_TYPE_MATRIX) {
+        vk::Format columnFormat = vertexInputFormat(module, type.at(1));
+        for (uint32_t column = 0; column < type.at(2); ++column) {
+            reflection.vertexInputs.push_back({.location = *decorations.location + column, .format = columnFormat});
+        }
+    } else {
+        reflection.vertexInputs.push_back(
+            {.location = *decorations.location, .format = vertexInputFormat(module, variable.type)});
+    }
+}
+}   // namespace
+
+void ShaderReflection::merge(const ShaderReflection& other)
+{
+    stages |= other.stages;
+
+    if (descriptorSets.size() < other.descriptorSets.size()) {
+        descriptorSets.resize(other.descriptorSets.size());
+    }
+    for (size_t set = 0; set < other.descriptorSets.size(); ++set) {
+        auto& bindings = descriptorSets[set];
+        for (const auto& binding : other.descriptorSets[set]) {
+            auto it = std::ranges::lower_bound(bindings, binding.binding, {}, &vk::DescriptorSetLayoutBinding::binding);
+            if (it == bindings.end() || it->binding != binding.binding) {
+                bindings.insert(it, binding);
+                continue;
+            }
+            if (it->descriptorType != binding.descriptorType || it->descriptorCount != binding.descriptorCount) {
+                throw std::runtime_error("stages declare set " + std::to_string(set) + " binding " +
+                                         std::to_string(binding.binding) + " differently");
+            }
+            it->stageFlags |= binding.stageFlags;
+        }
+    }
+
+    for (const auto& range : other.pushConstantRanges) {
+        if (pushConstantRanges.empty()) {
+            pushConstantRanges.push_back(range);
+            continue;
+        }
+        auto& merged = pushConstantRanges.front();
+        uint32_t end = std::max(merged.offset + merged.size, range.offset + range.size);
+        merged.offset = std::min(merged.offset, range.offset);
+        merged.size = end - merged.offset;
+        merged.stageFlags |= range.stageFlags;
+    }
+
+    if (vertexInputs.empty()) {
+        vertexInputs = other.vertexInputs;
+    }
+}
+
+ShaderReflection reflectShader(std::span<const uint32_t> code)
+{
+    Module module = parseModule(code);
+
+    ShaderReflection reflection;
+    reflection.stages = module.stage;
+    for (const auto& variable : module.variables) {
+        switch (variable.storageClass) {
+            case spv::STORAGE_CLASS_UNIFORM_CONSTANT:
+            case spv::STORAGE_CLASS_UNIFORM:
+            case spv::STORAGE_CLASS_STORAGE_BUFFER: reflectDescriptor(module, variable, reflection); break;
+            case spv::STORAGE_CLASS_PUSH_CONSTANT: reflectPushConstants(module, variable, reflection); break;
+            case spv::STORAGE_CLASS_INPUT:
+                if (module.stage == vk::ShaderStageFlagBits::eVertex) {
+                    reflectVertexInput(module, variable, reflection);
+                }
+                break;
+            default: break;
+        }
+    }
+
+    for (auto& bindings : reflection.descriptorSets) {
+        std::ranges::sort(bindings, {}, &vk::DescriptorSetLayoutBinding::binding);
+    }
+    std::ranges::sort(reflection.vertexInputs, {}, &ReflectedVertexInput::location);
+    return reflection;
+}
+
+void validateVertexInputs(std::span<const ReflectedVertexInput> inputs,
+                          std::span<const vk::VertexInputAttributeDescription> attributes)
+{
+    for (const auto& input : inputs) {
+        auto attribute = std::ranges::find(attributes, input.location, &vk::VertexInputAttributeDescription::location);
+        if (attribute == attributes.end()) {
+            throw std::runtime_error("vertex shader input location " + std::to_string(input.location) +
+                                     " has no vertex attribute");
+        }
+        if (attribute->format != input.format) {
+            throw std::runtime_error("vertex shader input location " + std::to_string(input.location) + " is " +
+                                     vk::to_string(input.format) + ", but its vertex attribute is " +
+                                     vk::to_string(attribute->format));
+        }
+    }
+}
+
+}   // namespace renderer
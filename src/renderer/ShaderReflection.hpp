@@ -0,0 +1,43 @@
+#ifndef RENDERER_SHADER_REFLECTION_HPP
+#define RENDERER_SHADER_REFLECTION_HPP
+
+// libs
+#include <vulkan/vulkan.hpp>
+
+// std
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace renderer
+{
+
+struct ReflectedVertexInput {
+    uint32_t location = 0;
+    vk::Format format = vk::Format::eUndefined;
+};
+
+// The interface a shader declares, read from its SPIR-V, so layouts do not have to be written again by hand
+struct ShaderReflection {
+    vk::ShaderStageFlags stages;
+    // Indexed by set number, sorted by binding number. Sets not declared are empty
+    std::vector<std::vector<vk::DescriptorSetLayoutBinding>> descriptorSets;
+    // A single range covering every stage's push constant block, as the stages share the block in practice
+    std::vector<vk::PushConstantRange> pushConstantRanges;
+    // Of the vertex stage, sorted by location. Built-ins are left out
+    std::vector<ReflectedVertexInput> vertexInputs;
+
+    // Combines the stages of a pipeline. Throws if they declare the same binding differently
+    void merge(const ShaderReflection& other);
+};
+
+// Throws on malformed SPIR-V, and on declarations without a Vulkan layout equivalent
+ShaderReflection reflectShader(std::span<const uint32_t> code);
+
+// Throws if the shader reads a location the attributes do not provide, or with another format
+void validateVertexInputs(std::span<const ReflectedVertexInput> inputs,
+                          std::span<const vk::VertexInputAttributeDescription> attributes);
+
+}   // namespace renderer
+
+#endif
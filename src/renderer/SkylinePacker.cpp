@@ -0,0 +1,84 @@
+#include "SkylinePacker.hpp"
+
+// std
+#include <algorithm>
+#include <cstddef>
+#include <limits>
+
+namespace renderer
+{
+
+SkylinePacker::SkylinePacker(const vk::Extent2D& extent)
+    : m_extent(extent)
+    , m_skyline({Segment {.x = 0, .y = 0, .width = extent.width}})
+{}
+
+std::optional<glm::uvec2> SkylinePacker::insert(const vk::Extent2D& size)
+{
+    if (size.width == 0 || size.height == 0 || size.width > m_extent.width || size.height > m_extent.height) {
+        return std::nullopt;
+    }
+
+    size_t best = m_skyline.size();
+    uint32_t bestY = std::numeric_limits<uint32_t>::max();
+    for (size_t i = 0; i < m_skyline.size(); ++i) {
+        uint32_t x = m_skyline[i].x;
+        if (x + size.width > m_extent.width) {
+            // The next segments start further right
+            break;
+        }
+
+        // Rests on the lowest of the segments it spans
+        uint32_t y = 0;
+        uint32_t covered = 0;
+        for (size_t j = i; covered < size.width; ++j) {
+            y = std::max(y, m_skyline[j].y);
+            covered += m_skyline[j].width;
+        }
+        if (y + size.height <= m_extent.height && y < bestY) {
+            best = i;
+            bestY = y;
+        }
+    }
+    if (best == m_skyline.size()) {
+        return std::nullopt;
+    }
+
+    // Drops the segments under the rectangle, and shortens the last one it partially covers
+    uint32_t x = m_skyline[best].x;
+    uint32_t right = x + size.width;
+    size_t next = best;
+    for (; next < m_skyline.size() && m_skyline[next].x < right; ++next) {
+        Segment& segment = m_skyline[next];
+        uint32_t end = segment.x + segment.width;
+        if (end > right) {
+            segment = {.x = right, .y = segment.y, .width = end - right};
+            break;
+        }
+    }
+    auto first = m_skyline.begin() + static_cast<std::ptrdiff_t>(best);
+    first = m_skyline.erase(first, m_skyline.begin() + static_cast<std::ptrdiff_t>(next));
+    m_skyline.insert(first, {.x = x, .y = bestY + size.height, .width = size.width});
+
+    // Neighbours at the same height are a single segment
+    size_t merged = 0;
+    for (size_t i = 1; i < m_skyline.size(); ++i) {
+        if (m_skyline[i].y == m_skyline[merged].y) {
+            m_skyline[merged].width += m_skyline[i].width;
+        } else {
+            m_skyline[++merged] = m_skyline[i];
+        }
+    }
+    m_skyline.resize(merged + 1);
+
+    m_usedArea += uint64_t {size.width} * size.height;
+    return glm::uvec2(x, bestY);
+}
+
+float SkylinePacker::occupancy() const noexcept
+{
+    uint64_t area = uint64_t {m_extent.width} * m_extent.height;
+    return area > 0 ? static_cast<float>(m_usedArea) / static_cast<float>(area) : 0.f;
+}
+
+}   // namespace renderer
@@ -0,0 +1,57 @@
+#ifndef RENDERER_SKYLINE_PACKER_HPP
+#define RENDERER_SKYLINE_PACKER_HPP
+
+// libs
+#include <glm/glm.hpp>
+#include <vulkan/vulkan.hpp>
+
+// std
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+namespace renderer
+{
+
+// Packs rectangles into a fixed area, one at a time, without ever moving the placed ones. The skyline is the lower edge
+// of the placed rectangles, y pointing down; each new rectangle goes where it rests highest on it, then leftmost. The
+// space under overhangs is lost, a few percent of the area against MaxRects, in exchange for insertions linear in the
+// number of skyline segments
+class SkylinePacker
+{
+public:
+    SkylinePacker() noexcept = default;
+    explicit SkylinePacker(const vk::Extent2D& extent);
+
+    SkylinePacker(const SkylinePacker&) = delete;
+    SkylinePacker& operator=(const SkylinePacker&) = delete;
+
+    SkylinePacker(SkylinePacker&&) noexcept = default;
+    SkylinePacker& operator=(SkylinePacker&&) noexcept = default;
+
+    ~SkylinePacker() noexcept = default;
+
+public:
+    // Top left corner of the placed rectangle, or nothing if it does not fit
+    std::optional<glm::uvec2> insert(const vk::Extent2D& size);
+
+    // Fraction of the area covered by the placed rectangles
+    float occupancy() const noexcept;
+
+private:
+    struct Segment {
+        uint32_t x;
+        uint32_t y;
+        uint32_t width;
+    };
+
+private:
+    vk::Extent2D m_extent;
+    // Sorted by x, covering the whole width
+    std::vector<Segment> m_skyline;
+    uint64_t m_usedArea = 0;
+};
+
+}   // namespace renderer
+
+#endif
@@ -0,0 +1,35 @@
+#include "SpecializationConstants.hpp"
+
+#include "core/Hash.hpp"
+
+// std
+#include <span>
+
+namespace renderer
+{
+
+vk::SpecializationInfo SpecializationConstants::info() const noexcept
+{
+    return vk::SpecializationInfo {.mapEntryCount = static_cast<uint32_t>(m_mapEntries.size()),
+                                   .pMapEntries = m_mapEntries.data(),
+                                   .dataSize = m_values.size() * sizeof(uint32_t),
+                                   .pData = m_values.data()};
+}
+
+uint64_t SpecializationConstants::hash(uint64_t seed) const noexcept
+{
+    seed = core::fnv1a64(std::as_bytes(std::span(m_ids)), seed);
+    return core::fnv1a64(std::as_bytes(std::span(m_values)), seed);
+}
+
+void SpecializationConstants::updateMapEntries()
+{
+    m_mapEntries.clear();
+    for (uint32_t i = 0; i < m_ids.size(); ++i) {
+        m_mapEntries.push_back({.constantID = m_ids[i],
+                                .offset = i * static_cast<uint32_t>(sizeof(uint32_t)),
+                                .size = sizeof(uint32_t)});
+    }
+}
+
+}   // namespace renderer
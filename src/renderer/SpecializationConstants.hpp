@@ -0,0 +1,72 @@
+#ifndef RENDERER_SPECIALIZATION_CONSTANTS_HPP
+#define RENDERER_SPECIALIZATION_CONSTANTS_HPP
+
+// libs
+#include <vulkan/vulkan.hpp>
+
+// std
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+
+namespace renderer
+{
+
+template <typename T>
+concept SpecializationConstantType =
+    std::is_same_v<T, bool> || std::is_same_v<T, int32_t> || std::is_same_v<T, uint32_t> || std::is_same_v<T, float>;
+
+// Values for the `layout(constant_id = N) const` declarations of a pipeline's shaders, shared by every stage.
+// Constants not declared by a stage are ignored by it. Every supported type is 32 bits wide in SPIR-V, bools
+// included
+class SpecializationConstants
+{
+public:
+    template <SpecializationConstantType T>
+    void set(uint32_t constantId, T value)
+    {
+        uint32_t bits;
+        if constexpr (std::is_same_v<T, bool>) {
+            bits = value ? vk::True : vk::False;
+        } else {
+            bits = std::bit_cast<uint32_t>(value);
+        }
+
+        // Sorted by id, so the order of the calls does not matter when comparing
+        auto it = std::ranges::lower_bound(m_ids, constantId);
+        auto index = it - m_ids.begin();
+        if (it != m_ids.end() && *it == constantId) {
+            m_values[static_cast<size_t>(index)] = bits;
+            return;
+        }
+        m_ids.insert(it, constantId);
+        m_values.insert(m_values.begin() + index, bits);
+        updateMapEntries();
+    }
+
+    bool empty() const noexcept { return m_ids.empty(); }
+
+    // Points into this object, which must outlive its use
+    vk::SpecializationInfo info() const noexcept;
+
+    uint64_t hash(uint64_t seed) const noexcept;
+
+    bool operator==(const SpecializationConstants& rhs) const noexcept
+    {
+        return m_ids == rhs.m_ids && m_values == rhs.m_values;
+    }
+
+private:
+    void updateMapEntries();
+
+private:
+    std::vector<uint32_t> m_ids;
+    std::vector<uint32_t> m_values;   // same order as m_ids
+    std::vector<vk::SpecializationMapEntry> m_mapEntries;
+};
+
+}   // namespace renderer
+
+#endif
@@ -0,0 +1,123 @@
+#include "SpriteBatch.hpp"
+
+// libs
+#include <glm/gtc/packing.hpp>
+
+// std
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <optional>
+#include <utility>
+
+namespace renderer
+{
+
+namespace
+{
+// Flips the sign bit, so negative layers order below the positive ones as unsigned integers
+uint64_t makeSpriteSortKey(int32_t layer, TextureHandle texture) noexcept
+{
+    return (uint64_t {static_cast<uint32_t>(layer) ^ 0x80000000u} << 32) | uint64_t {texture};
+}
+
+// Size of the whole texture if the sprite's UV rectangle covers its size on screen
+float textureScreenSize(const Sprite& sprite) noexcept
+{
+    glm::vec2 uvSize = glm::abs(glm::vec2(sprite.uvRect.z, sprite.uvRect.w));
+    glm::vec2 size = glm::abs(sprite.size);
+    float width = uvSize.x > 0.f ? size.x / uvSize.x : size.x;
+    float height = uvSize.y > 0.f ? size.y / uvSize.y : size.y;
+    return std::max(width, height);
+}
+}   // namespace
+
+void SpriteBatch::add(const Sprite& sprite)
+{
+    assert(sprite.texture.source == SpriteTexture::Source::eGlyphPage ||
+           sprite.texture.handle != INVALID_TEXTURE_HANDLE);
+    m_sortEntries.push_back({.key = makeSpriteSortKey(sprite.layer, sprite.texture.handle),
+                             .source = sprite.texture.source,
+                             .sprite = static_cast<uint32_t>(m_sprites.size())});
+    m_sprites.push_back(sprite);
+}
+
+void SpriteBatch::add(std::span<const Sprite> sprites)
+{
+    m_sprites.reserve(m_sprites.size() + sprites.size());
+    m_sortEntries.reserve(m_sortEntries.size() + sprites.size());
+    for (const auto& sprite : sprites) {
+        add(sprite);
+    }
+}
+
+void SpriteBatch::build()
+{
+    // Stable, the entries were added in submission order
+    std::ranges::stable_sort(m_sortEntries, {}, [](const SortEntry& entry) {
+        return std::pair(entry.key, entry.source);
+    });
+
+    m_instances.clear();
+    m_instances.reserve(m_sprites.size());
+    m_draws.clear();
+    for (const auto& entry : m_sortEntries) {
+        const Sprite& sprite = m_sprites[entry.sprite];
+        if (m_draws.empty() || m_draws.back().texture != sprite.texture) {
+            m_draws.push_back({.texture = sprite.texture,
+                               .firstInstance = static_cast<uint32_t>(m_instances.size()),
+                               .instanceCount = 0,
+                               .textureScreenSize = 0.f});
+        }
+
+        SpriteDraw& draw = m_draws.back();
+        ++draw.instanceCount;
+        draw.textureScreenSize = std::max(draw.textureScreenSize, textureScreenSize(sprite));
+        m_instances.push_back({.rect = glm::vec4(sprite.position, sprite.size),
+                               .uvRect = sprite.uvRect,
+                               .rotation = glm::vec2(std::cos(sprite.rotation), std::sin(sprite.rotation)),
+                               .color = glm::packUnorm4x8(sprite.color)});
+    }
+    m_stats = {.sprites = m_instances.size(), .draws = m_draws.size(), .descriptorSetBinds = 0};
+}
+
+void SpriteBatch::record(vk::CommandBuffer commandBuffer,
+                         vk::PipelineLayout layout,
+                         uint32_t textureSet,
+                         const std::function<vk::DescriptorSet(const SpriteTexture&)>& descriptor,
+                         vk::Buffer instanceBuffer,
+                         vk::DeviceSize instanceOffset)
+{
+    m_stats.descriptorSetBinds = 0;
+    if (m_draws.empty()) {
+        return;
+    }
+
+    commandBuffer.bindVertexBuffers(0, instanceBuffer, instanceOffset);
+
+    // Consecutive layers may draw with the same texture
+    std::optional<SpriteTexture> bound;
+    for (const auto& draw : m_draws) {
+        if (draw.texture != bound) {
+            commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics,
+                                             layout,
+                                             textureSet,
+                                             descriptor(draw.texture),
+                                             nullptr);
+            bound = draw.texture;
+            ++m_stats.descriptorSetBinds;
+        }
+        // A triangle strip over the quad's 4 corners
+        commandBuffer.draw(4, draw.instanceCount, 0, draw.firstInstance);
+    }
+}
+
+void SpriteBatch::clear() noexcept
+{
+    m_sprites.clear();
+    m_sortEntries.clear();
+    m_instances.clear();
+    m_draws.clear();
+}
+
+}   // namespace renderer
@@ -0,0 +1,121 @@
+#ifndef RENDERER_SPRITE_BATCH_HPP
+#define RENDERER_SPRITE_BATCH_HPP
+
+#include "TextureStreamer.hpp"
+#include "Types.hpp"
+
+// libs
+#include <glm/glm.hpp>
+#include <vulkan/vulkan.hpp>
+
+// std
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <span>
+#include <vector>
+
+namespace renderer
+{
+
+// Texture of a sprite, its handle is only unique within its source
+struct SpriteTexture {
+    enum class Source : uint8_t {
+        eStreamed,    // handle of the TextureStreamer
+        eAtlasPage,   // index of a TextureAtlas page
+        eGlyphPage,   // the page of the GlyphCache, the handle is unused
+    };
+
+    Source source = Source::eStreamed;
+    TextureHandle handle = INVALID_TEXTURE_HANDLE;
+
+    bool operator==(const SpriteTexture&) const noexcept = default;
+};
+
+// Screen space, in pixels from the top left corner, y pointing down
+struct Sprite {
+    glm::vec2 position;                                 // of the center
+    glm::vec2 size = glm::vec2(1.f);                    // negative to mirror
+    float rotation = 0.f;                               // radians around the center, clockwise on screen
+    glm::vec4 uvRect = glm::vec4(0.f, 0.f, 1.f, 1.f);   // min and size, e.g. of the sprite in an atlas
+    glm::vec4 color = glm::vec4(1.f);                   // multiplies the texture, straight alpha
+    SpriteTexture texture;
+    int32_t layer = 0;                                  // higher layers are drawn over lower ones
+};
+
+// A single instanced draw of consecutive sprites sharing a texture
+struct SpriteDraw {
+    SpriteTexture texture;
+    uint32_t firstInstance;
+    uint32_t instanceCount;
+    // Largest size in pixels the whole texture would cover, drawn at the scale of its sprites, for streaming
+    float textureScreenSize;
+};
+
+struct SpriteBatchStats {
+    size_t sprites = 0;
+    size_t draws = 0;
+    size_t descriptorSetBinds = 0;
+};
+
+// Collects a frame's sprites, then packs them into instances sorted by layer, and by texture within a layer, so only
+// texture changes split the draws. Sprites of a layer sharing a texture keep the order they were added in, but
+// overlapping sprites of different textures must be on different layers to be drawn in a given order
+class SpriteBatch
+{
+public:
+    SpriteBatch() noexcept = default;
+
+    SpriteBatch(const SpriteBatch&) = delete;
+    SpriteBatch& operator=(const SpriteBatch&) = delete;
+
+    SpriteBatch(SpriteBatch&&) noexcept = default;
+    SpriteBatch& operator=(SpriteBatch&&) noexcept = default;
+
+    ~SpriteBatch() noexcept = default;
+
+public:
+    void add(const Sprite& sprite);
+    void add(std::span<const Sprite> sprites);
+
+    // Sorts the sprites added since the last clear into instances and draws
+    void build();
+
+    // Of the last build, instances are indexed by SpriteDraw::firstInstance
+    std::span<const SpriteInstance> instances() const noexcept { return m_instances; }
+    std::span<const SpriteDraw> draws() const noexcept { return m_draws; }
+
+    // Within rendering, with the sprite pipeline bound and the instances uploaded to instanceBuffer at instanceOffset.
+    // Each draw binds the descriptor of its texture at textureSet, unless it is already bound
+    void record(vk::CommandBuffer commandBuffer,
+                vk::PipelineLayout layout,
+                uint32_t textureSet,
+                const std::function<vk::DescriptorSet(const SpriteTexture&)>& descriptor,
+                vk::Buffer instanceBuffer,
+                vk::DeviceSize instanceOffset);
+
+    // Drops the sprites, instances and draws, keeping their memory
+    void clear() noexcept;
+
+    bool empty() const noexcept { return m_sprites.empty(); }
+    // Of the last build, and the binds of the last record
+    const SpriteBatchStats& stats() const noexcept { return m_stats; }
+
+private:
+    struct SortEntry {
+        uint64_t key;   // layer, then texture handle
+        SpriteTexture::Source source;
+        uint32_t sprite;
+    };
+
+private:
+    std::vector<Sprite> m_sprites;
+    std::vector<SortEntry> m_sortEntries;
+    std::vector<SpriteInstance> m_instances;
+    std::vector<SpriteDraw> m_draws;
+    SpriteBatchStats m_stats;
+};
+
+}   // namespace renderer
+
+#endif
@@ -0,0 +1,146 @@
+#include "TextRenderer.hpp"
+
+#include "core/Logger.hpp"
+
+// std
+#include <cassert>
+#include <cmath>
+#include <optional>
+#include <utility>
+
+namespace renderer
+{
+
+namespace
+{
+// 256 glyphs of GlyphCache::CELL_SIZE
+constexpr uint32_t GLYPH_PAGE_SIZE = 1024;
+// Keeps the shaping of strings drawn intermittently, while strings changing every frame are forgotten soon
+constexpr size_t MAX_UNUSED_SHAPING_FRAMES = 60;
+constexpr char32_t REPLACEMENT_CHARACTER = 0xfffd;
+
+// Advances pos past the codepoint, invalid sequences decode to U+FFFD one byte at a time
+char32_t decodeUtf8(std::string_view string, size_t& pos) noexcept
+{
+    auto byte = [&string](size_t i) { return static_cast<uint8_t>(string[i]); };
+    uint8_t lead = byte(pos++);
+    if (lead < 0x80) {
+        return lead;
+    }
+
+    size_t continuations = lead >= 0xf0 ? 3 : lead >= 0xe0 ? 2 : lead >= 0xc0 ? 1 : 0;
+    if (continuations == 0 || lead >= 0xf8 || pos + continuations > string.size()) {
+        return REPLACEMENT_CHARACTER;
+    }
+    char32_t codepoint = lead & (0x3fu >> continuations);
+    for (size_t i = 0; i < continuations; ++i) {
+        if ((byte(pos + i) & 0xc0) != 0x80) {
+            return REPLACEMENT_CHARACTER;
+        }
+        codepoint = codepoint << 6 | (byte(pos + i) & 0x3fu);
+    }
+    pos += continuations;
+    return codepoint;
+}
+}   // namespace
+
+TextRenderer::TextRenderer(vk::Device device,
+                           VmaAllocator allocator,
+                           vk::Sampler sampler,
+                           vk::DescriptorSetLayout textureSetLayout)
+    : m_glyphCache(device, allocator, sampler, textureSetLayout, GLYPH_PAGE_SIZE)
+{}
+
+FontHandle TextRenderer::loadFont(const std::filesystem::path& path)
+{
+    std::string key = std::filesystem::weakly_canonical(path).string();
+    if (auto it = m_fontsByPath.find(key); it != m_fontsByPath.end()) {
+        return it->second;
+    }
+
+    auto handle = static_cast<FontHandle>(m_fonts.size());
+    m_fonts.push_back({.font = TrueTypeFont(path), .shapedTexts = {}});
+    m_fontsByPath.emplace(std::move(key), handle);
+    DEBUG_FMT("Loaded font {}\n", path.string());
+    return handle;
+}
+
+void TextRenderer::draw(const Text& text, SpriteBatch& batch, size_t frame)
+{
+    assert(text.font < m_fonts.size());
+    Font& font = m_fonts[text.font];
+    const ShapedText& shaped = shape(font, text.string, frame);
+
+    // Rotates the glyphs' offsets from the text position along with them
+    glm::vec2 axisX(std::cos(text.rotation), std::sin(text.rotation));
+    glm::vec2 axisY(-axisX.y, axisX.x);
+    for (const auto& shapedGlyph : shaped.glyphs) {
+        const CachedGlyph* glyph = m_glyphCache.find(font.font, text.font, shapedGlyph.glyph, frame);
+        if (!glyph) {
+            ++m_frameStats.droppedGlyphs;
+            continue;
+        }
+
+        glm::vec2 min = shapedGlyph.pen + glm::vec2(glyph->planeRect);
+        glm::vec2 size(glyph->planeRect.z, glyph->planeRect.w);
+        glm::vec2 center = (min + 0.5f * size) * text.size;
+        batch.add({.position = text.position + center.x * axisX + center.y * axisY,
+                   .size = size * text.size,
+                   .rotation = text.rotation,
+                   .uvRect = glyph->uvRect,
+                   .color = text.color,
+                   .texture = {.source = SpriteTexture::Source::eGlyphPage, .handle = 0},
+                   .layer = text.layer});
+        ++m_frameStats.glyphs;
+    }
+}
+
+void TextRenderer::update(vk::CommandBuffer commandBuffer, size_t frame, DeletionQueue& deletionQueue)
+{
+    m_glyphCache.update(commandBuffer, frame, deletionQueue);
+
+    for (auto& font : m_fonts) {
+        std::erase_if(font.shapedTexts, [frame](const auto& entry) {
+            return entry.second.lastUsedFrame + MAX_UNUSED_SHAPING_FRAMES < frame;
+        });
+    }
+    m_stats = std::exchange(m_frameStats, {});
+}
+
+const TextRenderer::ShapedText& TextRenderer::shape(Font& font, std::string_view string, size_t frame)
+{
+    if (auto it = font.shapedTexts.find(string); it != font.shapedTexts.end()) {
+        it->second.lastUsedFrame = frame;
+        return it->second;
+    }
+
+    ++m_frameStats.shapingCacheMisses;
+    const TrueTypeFont& ttf = font.font;
+    float emsPerUnit = 1.f / ttf.unitsPerEm();
+    float lineHeight = (ttf.ascender() - ttf.descender() + ttf.lineGap()) * emsPerUnit;
+
+    ShapedText shaped {.glyphs = {}, .lastUsedFrame = frame};
+    glm::vec2 pen(0.f);
+    std::optional<uint32_t> previous;
+    for (size_t pos = 0; pos < string.size();) {
+        char32_t codepoint = decodeUtf8(string, pos);
+        if (codepoint == U'\n') {
+            pen = glm::vec2(0.f, pen.y + lineHeight);
+            previous.reset();
+            continue;
+        }
+
+        uint32_t glyph = ttf.glyphIndex(codepoint);
+        if (previous) {
+            pen.x += ttf.kerning(*previous, glyph) * emsPerUnit;
+        }
+        if (ttf.hasOutline(glyph)) {
+            shaped.glyphs.push_back({.glyph = glyph, .pen = pen});
+        }
+        pen.x += ttf.advance(glyph) * emsPerUnit;
+        previous = glyph;
+    }
+    return font.shapedTexts.emplace(std::string(string), std::move(shaped)).first->second;
+}
+
+}   // namespace renderer
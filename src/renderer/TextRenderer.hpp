@@ -0,0 +1,119 @@
+#ifndef RENDERER_TEXT_RENDERER_HPP
+#define RENDERER_TEXT_RENDERER_HPP
+
+#include "GlyphCache.hpp"
+#include "SpriteBatch.hpp"
+#include "TrueTypeFont.hpp"
+
+// libs
+#include <glm/glm.hpp>
+#include <vk_mem_alloc.h>
+#include <vulkan/vulkan.hpp>
+
+// std
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace renderer
+{
+class DeletionQueue;
+
+using FontHandle = uint32_t;
+
+// Screen space, as Sprite
+struct Text {
+    std::string_view string;   // UTF-8, each newline starts a line below
+    FontHandle font = 0;
+    glm::vec2 position;        // of the start of the first baseline
+    float size = 16.f;         // of an em, in pixels
+    float rotation = 0.f;      // radians around position, clockwise on screen
+    glm::vec4 color = glm::vec4(1.f);
+    int32_t layer = 0;
+};
+
+struct TextStats {
+    size_t glyphs = 0;
+    size_t droppedGlyphs = 0;   // not drawn, the glyph cache was full of glyphs drawn by the same frame
+    size_t shapingCacheMisses = 0;
+};
+
+// Lays out strings as sprites of SDF glyphs. The shaping of each string, its glyphs and their positions, is cached
+// until the string is no longer drawn, so static labels only cost a hash lookup per string and per glyph. Shaping is
+// limited to the cmap, advances and kerning pairs of the font: no ligatures, nor right to left scripts
+class TextRenderer
+{
+public:
+    TextRenderer() noexcept = default;
+    // The glyphs are drawn with the eGlyphPage sprite texture, see descriptor
+    TextRenderer(vk::Device device,
+                 VmaAllocator allocator,
+                 vk::Sampler sampler,
+                 vk::DescriptorSetLayout textureSetLayout);
+
+    TextRenderer(const TextRenderer&) = delete;
+    TextRenderer& operator=(const TextRenderer&) = delete;
+
+    TextRenderer(TextRenderer&&) noexcept = default;
+    TextRenderer& operator=(TextRenderer&&) noexcept = default;
+
+    ~TextRenderer() noexcept = default;
+
+public:
+    // A .ttf file, loaded once per path
+    FontHandle loadFont(const std::filesystem::path& path);
+
+    // Adds a sprite per visible glyph to batch, which the given frame draws with an SDF shader
+    void draw(const Text& text, SpriteBatch& batch, size_t frame);
+
+    // Uploads the glyphs rasterized since the last update, and forgets the shaping of the strings not drawn for a
+    // while. Must be called outside of a rendering scope, before the text draws
+    void update(vk::CommandBuffer commandBuffer, size_t frame, DeletionQueue& deletionQueue);
+
+    vk::DescriptorSet descriptor() const noexcept { return m_glyphCache.descriptor(); }
+
+    // Of the text drawn before the last update
+    const TextStats& stats() const noexcept { return m_stats; }
+    const GlyphCacheStats& glyphCacheStats() const noexcept { return m_glyphCache.stats(); }
+
+private:
+    // In ems from the start of the first baseline, y pointing down
+    struct ShapedGlyph {
+        uint32_t glyph;
+        glm::vec2 pen;
+    };
+
+    struct ShapedText {
+        std::vector<ShapedGlyph> glyphs;   // only those with an outline
+        size_t lastUsedFrame;
+    };
+
+    // Looks strings up without copying them
+    struct StringHash {
+        using is_transparent = void;
+        size_t operator()(std::string_view string) const noexcept { return std::hash<std::string_view> {}(string); }
+    };
+
+    struct Font {
+        TrueTypeFont font;
+        std::unordered_map<std::string, ShapedText, StringHash, std::equal_to<>> shapedTexts;
+    };
+
+    const ShapedText& shape(Font& font, std::string_view string, size_t frame);
+
+private:
+    GlyphCache m_glyphCache;
+    std::vector<Font> m_fonts;
+    std::unordered_map<std::string, FontHandle> m_fontsByPath;   // by canonical path
+    TextStats m_frameStats;
+    TextStats m_stats;
+};
+
+}   // namespace renderer
+
+#endif
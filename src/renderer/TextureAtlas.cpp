@@ -0,0 +1,339 @@
+#include "TextureAtlas.hpp"
+
+#include "DeletionQueue.hpp"
+#include "Types.hpp"
+#include "Utils.hpp"
+#include "core/Logger.hpp"
+
+// std
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <optional>
+#include <stdexcept>
+#include <string>
+
+namespace renderer
+{
+
+namespace
+{
+constexpr uint32_t MAX_ATLAS_PAGES = 16;
+
+vk::ImageMemoryBarrier2 imageBarrier(vk::Image image,
+                                     vk::ImageLayout oldLayout,
+                                     vk::ImageLayout newLayout,
+                                     vk::PipelineStageFlags2 srcStage,
+                                     vk::AccessFlags2 srcAccess,
+                                     vk::PipelineStageFlags2 dstStage,
+                                     vk::AccessFlags2 dstAccess,
+                                     uint32_t levelCount) noexcept
+{
+    return vk::ImageMemoryBarrier2 {
+        .sType = vk::StructureType::eImageMemoryBarrier2,
+        .pNext = nullptr,
+        .srcStageMask = srcStage,
+        .srcAccessMask = srcAccess,
+        .dstStageMask = dstStage,
+        .dstAccessMask = dstAccess,
+        .oldLayout = oldLayout,
+        .newLayout = newLayout,
+        .srcQueueFamilyIndex = vk::QueueFamilyIgnored,
+        .dstQueueFamilyIndex = vk::QueueFamilyIgnored,
+        .image = image,
+        .subresourceRange = {.aspectMask = vk::ImageAspectFlagBits::eColor,
+                             .baseMipLevel = 0,
+                             .levelCount = levelCount,
+                             .baseArrayLayer = 0,
+                             .layerCount = 1}
+    };
+}
+
+void pipelineBarrier(vk::CommandBuffer commandBuffer, std::span<const vk::ImageMemoryBarrier2> barriers)
+{
+    vk::DependencyInfo dependencyInfo {.sType = vk::StructureType::eDependencyInfo,
+                                       .pNext = nullptr,
+                                       .dependencyFlags = {},
+                                       .memoryBarrierCount = 0,
+                                       .pMemoryBarriers = nullptr,
+                                       .bufferMemoryBarrierCount = 0,
+                                       .pBufferMemoryBarriers = nullptr,
+                                       .imageMemoryBarrierCount = static_cast<uint32_t>(barriers.size()),
+                                       .pImageMemoryBarriers = barriers.data()};
+
+    commandBuffer.pipelineBarrier2(dependencyInfo);
+}
+}   // namespace
+
+TextureAtlas::TextureAtlas(vk::Device device,
+                           VmaAllocator allocator,
+                           vk::Sampler sampler,
+                           vk::DescriptorSetLayout textureSetLayout,
+                           vk::Format format,
+                           uint32_t pageSize,
+                           uint32_t mipLevels)
+    : m_device(device)
+    , m_allocator(allocator)
+    , m_sampler(sampler)
+    , m_textureSetLayout(textureSetLayout)
+    , m_format(format)
+    , m_pageSize(pageSize)
+    , m_mipLevels(mipLevels)
+{
+    assert(mipLevels >= 1);
+    // The images are placed at multiples of the padding, which every mip must divide
+    assert(pageSize % padding() == 0);
+
+    vk::DescriptorPoolSize poolSizes[] {
+        {.type = vk::DescriptorType::eCombinedImageSampler, .descriptorCount = MAX_ATLAS_PAGES}
+    };
+
+    vk::DescriptorPoolCreateInfo poolCreateInfo {.sType = vk::StructureType::eDescriptorPoolCreateInfo,
+                                                 .pNext = nullptr,
+                                                 .flags = vk::DescriptorPoolCreateFlagBits::eFreeDescriptorSet,
+                                                 .maxSets = MAX_ATLAS_PAGES,
+                                                 .poolSizeCount = std::size(poolSizes),
+                                                 .pPoolSizes = poolSizes};
+
+    m_descriptorPool = m_device.createDescriptorPoolUnique(poolCreateInfo);
+    m_pages.reserve(MAX_ATLAS_PAGES);
+}
+
+AtlasRegion TextureAtlas::add(std::span<const uint8_t> pixels, const vk::Extent2D& extent)
+{
+    assert(pixels.size() == size_t {extent.width} * extent.height * 4);
+    const uint32_t padding = this->padding();
+    // Rounded up to the alignment, so every mip of the padded image covers whole texels
+    auto paddedSize = [padding](uint32_t size) { return (size + 3 * padding - 1) / padding * padding; };
+    vk::Extent2D paddedExtent {.width = paddedSize(extent.width), .height = paddedSize(extent.height)};
+    if (extent.width == 0 || extent.height == 0 || paddedExtent.width > m_pageSize ||
+        paddedExtent.height > m_pageSize) {
+        throw std::invalid_argument("an image of " + std::to_string(extent.width) + "x" +
+                                    std::to_string(extent.height) + " texels does not fit in an atlas page");
+    }
+
+    // First fit, the earlier pages are the fullest
+    std::optional<glm::uvec2> position;
+    uint32_t page = 0;
+    for (; page < m_pages.size(); ++page) {
+        position = m_pages[page].packer.insert(paddedExtent);
+        if (position) {
+            break;
+        }
+    }
+    if (!position) {
+        createPage();
+        position = m_pages.back().packer.insert(paddedExtent);
+        assert(position);
+    }
+
+    m_pendingUploads.push_back(buildUpload(pixels, extent, paddedExtent, *position, page));
+
+    glm::vec2 min = glm::vec2(*position) + static_cast<float>(padding);
+    glm::vec2 size(static_cast<float>(extent.width), static_cast<float>(extent.height));
+    return {.texture = {.source = SpriteTexture::Source::eAtlasPage, .handle = page},
+            .uvRect = glm::vec4(min, size) / static_cast<float>(m_pageSize)};
+}
+
+void TextureAtlas::update(vk::CommandBuffer commandBuffer, size_t frame, DeletionQueue& deletionQueue)
+{
+    if (m_pendingUploads.empty()) {
+        return;
+    }
+
+    size_t uploadSize = 0;
+    for (const auto& upload : m_pendingUploads) {
+        uploadSize += upload.pixels.size();
+    }
+    AllocatedBuffer stagingBuffer(m_allocator,
+                                  uploadSize,
+                                  vk::BufferUsageFlagBits::eTransferSrc,
+                                  VMA_ALLOCATION_CREATE_MAPPED_BIT |
+                                      VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT,
+                                  VMA_MEMORY_USAGE_AUTO);
+    auto* staging = static_cast<uint8_t*>(stagingBuffer.allocationInfo().pMappedData);
+
+    // Only the regions of the new images are written, the rest of the pages keeps its content
+    std::vector<std::vector<vk::BufferImageCopy>> pageRegions(m_pages.size());
+    size_t stagingOffset = 0;
+    for (const auto& upload : m_pendingUploads) {
+        std::memcpy(staging + stagingOffset, upload.pixels.data(), upload.pixels.size());
+        for (vk::BufferImageCopy region : upload.regions) {
+            region.bufferOffset += stagingOffset;
+            pageRegions[upload.page].push_back(region);
+        }
+        stagingOffset += upload.pixels.size();
+    }
+
+    // Waits for previous frames still sampling the pages
+    std::vector<vk::ImageMemoryBarrier2> barriers;
+    for (size_t page = 0; page < m_pages.size(); ++page) {
+        if (pageRegions[page].empty()) {
+            continue;
+        }
+        bool uploaded = m_pages[page].uploaded;
+        vk::ImageLayout oldLayout = uploaded ? vk::ImageLayout::eShaderReadOnlyOptimal : vk::ImageLayout::eUndefined;
+        barriers.push_back(imageBarrier(m_pages[page].image.image(),
+                                        oldLayout,
+                                        vk::ImageLayout::eTransferDstOptimal,
+                                        uploaded ? vk::PipelineStageFlagBits2::eFragmentShader
+                                                 : vk::PipelineStageFlagBits2::eNone,
+                                        {},
+                                        vk::PipelineStageFlagBits2::eTransfer,
+                                        vk::AccessFlagBits2::eTransferWrite,
+                                        m_mipLevels));
+    }
+    pipelineBarrier(commandBuffer, barriers);
+
+    for (size_t page = 0; page < m_pages.size(); ++page) {
+        if (!pageRegions[page].empty()) {
+            commandBuffer.copyBufferToImage(stagingBuffer.buffer(),
+                                            m_pages[page].image.image(),
+                                            vk::ImageLayout::eTransferDstOptimal,
+                                            pageRegions[page]);
+        }
+    }
+
+    for (auto& barrier : barriers) {
+        barrier.srcStageMask = vk::PipelineStageFlagBits2::eTransfer;
+        barrier.srcAccessMask = vk::AccessFlagBits2::eTransferWrite;
+        barrier.dstStageMask = vk::PipelineStageFlagBits2::eFragmentShader;
+        barrier.dstAccessMask = vk::AccessFlagBits2::eShaderSampledRead;
+        barrier.oldLayout = vk::ImageLayout::eTransferDstOptimal;
+        barrier.newLayout = vk::ImageLayout::eShaderReadOnlyOptimal;
+    }
+    pipelineBarrier(commandBuffer, barriers);
+
+    for (size_t page = 0; page < m_pages.size(); ++page) {
+        m_pages[page].uploaded = m_pages[page].uploaded || !pageRegions[page].empty();
+    }
+    TRACE_FMT("Uploaded {} atlas images, {} bytes\n", m_pendingUploads.size(), uploadSize);
+    deletionQueue.retire(frame, std::move(stagingBuffer));
+    m_pendingUploads.clear();
+}
+
+vk::DescriptorSet TextureAtlas::descriptor(uint32_t page) const noexcept
+{
+    assert(page < m_pages.size());
+    return *m_pages[page].descriptor;
+}
+
+void TextureAtlas::createPage()
+{
+    if (m_pages.size() >= MAX_ATLAS_PAGES) {
+        throw std::length_error("TextureAtlas: maximum number of pages reached");
+    }
+
+    Allocated2DImage image(m_allocator,
+                           m_format,
+                           {.width = m_pageSize, .height = m_pageSize},
+                           m_mipLevels,
+                           vk::ImageTiling::eOptimal,
+                           vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eSampled,
+                           0,
+                           VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE);
+
+    vk::ImageViewCreateInfo imageViewCreateInfo {
+        .sType = vk::StructureType::eImageViewCreateInfo,
+        .pNext = nullptr,
+        .flags = {},
+        .image = image.image(),
+        .viewType = vk::ImageViewType::e2D,
+        .format = m_format,
+        .components = {vk::ComponentSwizzle::eIdentity,
+                  vk::ComponentSwizzle::eIdentity,
+                  vk::ComponentSwizzle::eIdentity,
+                  vk::ComponentSwizzle::eIdentity},
+        .subresourceRange = {.aspectMask = vk::ImageAspectFlagBits::eColor,
+                  .baseMipLevel = 0,
+                  .levelCount = m_mipLevels,
+                  .baseArrayLayer = 0,
+                  .layerCount = 1}
+    };
+    auto imageView = m_device.createImageViewUnique(imageViewCreateInfo);
+
+    vk::DescriptorSetAllocateInfo allocateInfo {.sType = vk::StructureType::eDescriptorSetAllocateInfo,
+                                                .pNext = nullptr,
+                                                .descriptorPool = *m_descriptorPool,
+                                                .descriptorSetCount = 1,
+                                                .pSetLayouts = &m_textureSetLayout};
+    auto descriptor = std::move(m_device.allocateDescriptorSetsUnique(allocateInfo)[0]);
+
+    vk::DescriptorImageInfo imageInfo {.sampler = m_sampler,
+                                       .imageView = *imageView,
+                                       .imageLayout = vk::ImageLayout::eShaderReadOnlyOptimal};
+
+    vk::WriteDescriptorSet descriptorWrite {.sType = vk::StructureType::eWriteDescriptorSet,
+                                            .pNext = nullptr,
+                                            .dstSet = *descriptor,
+                                            .dstBinding = 0,
+                                            .dstArrayElement = 0,
+                                            .descriptorCount = 1,
+                                            .descriptorType = vk::DescriptorType::eCombinedImageSampler,
+                                            .pImageInfo = &imageInfo,
+                                            .pBufferInfo = nullptr,
+                                            .pTexelBufferView = nullptr};
+    m_device.updateDescriptorSets(descriptorWrite, nullptr);
+
+    m_pages.push_back({.image = std::move(image),
+                       .imageView = std::move(imageView),
+                       .descriptor = std::move(descriptor),
+                       .packer = SkylinePacker({.width = m_pageSize, .height = m_pageSize}),
+                       .uploaded = false});
+    DEBUG_FMT("Created atlas page {} ({}x{}, {} mips)\n", m_pages.size() - 1, m_pageSize, m_pageSize, m_mipLevels);
+}
+
+TextureAtlas::PendingUpload TextureAtlas::buildUpload(std::span<const uint8_t> pixels,
+                                                      const vk::Extent2D& extent,
+                                                      const vk::Extent2D& paddedExtent,
+                                                      const glm::uvec2& position,
+                                                      uint32_t page) const
+{
+    PendingUpload upload {.page = page, .pixels = {}, .regions = {}};
+
+    // Mip chain layout. The position and padded extent are multiples of 2^(mipLevels - 1), so they halve exactly
+    size_t totalSize = 0;
+    for (uint32_t mip = 0; mip < m_mipLevels; ++mip) {
+        vk::Extent2D levelExtent {.width = paddedExtent.width >> mip, .height = paddedExtent.height >> mip};
+        upload.regions.push_back({
+            .bufferOffset = totalSize,
+            .bufferRowLength = 0,
+            .bufferImageHeight = 0,
+            .imageSubresource = {.aspectMask = vk::ImageAspectFlagBits::eColor,
+                                 .mipLevel = mip,
+                                 .baseArrayLayer = 0,
+                                 .layerCount = 1},
+            .imageOffset = {.x = static_cast<int32_t>(position.x >> mip),
+                                 .y = static_cast<int32_t>(position.y >> mip),
+                                 .z = 0},
+            .imageExtent = {.width = levelExtent.width, .height = levelExtent.height, .depth = 1}
+        });
+        totalSize += size_t {levelExtent.width} * levelExtent.height * 4;
+    }
+    upload.pixels.resize(totalSize);
+
+    // The padding repeats the edge texels, as clamp to edge addressing would
+    const uint32_t padding = this->padding();
+    for (uint32_t y = 0; y < paddedExtent.height; ++y) {
+        uint32_t sourceY = std::min(y - std::min(y, padding), extent.height - 1);
+        for (uint32_t x = 0; x < paddedExtent.width; ++x) {
+            uint32_t sourceX = std::min(x - std::min(x, padding), extent.width - 1);
+            std::memcpy(&upload.pixels[(size_t {y} * paddedExtent.width + x) * 4],
+                        &pixels[(size_t {sourceY} * extent.width + sourceX) * 4],
+                        4);
+        }
+    }
+
+    for (uint32_t mip = 1; mip < m_mipLevels; ++mip) {
+        const auto& src = upload.regions[mip - 1];
+        const auto& dst = upload.regions[mip];
+        utils::downsampleRgba8(&upload.pixels[src.bufferOffset],
+                               {.width = src.imageExtent.width, .height = src.imageExtent.height},
+                               &upload.pixels[dst.bufferOffset],
+                               {.width = dst.imageExtent.width, .height = dst.imageExtent.height},
+                               utils::isSrgb(m_format));
+    }
+    return upload;
+}
+
+}   // namespace renderer
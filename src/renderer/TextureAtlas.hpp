@@ -0,0 +1,110 @@
+#ifndef RENDERER_TEXTURE_ATLAS_HPP
+#define RENDERER_TEXTURE_ATLAS_HPP
+
+#include "Image.hpp"
+#include "SkylinePacker.hpp"
+#include "SpriteBatch.hpp"
+
+// libs
+#include <glm/glm.hpp>
+#include <vk_mem_alloc.h>
+#include <vulkan/vulkan.hpp>
+
+// std
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace renderer
+{
+class DeletionQueue;
+
+struct AtlasRegion {
+    SpriteTexture texture;   // of its page, see TextureAtlas::descriptor
+    glm::vec4 uvRect;        // min and size, of the image without its padding
+};
+
+// Packs small images into large pages, so that sprites using any of them are drawn in a single batch. Images can be
+// added at any time, and are uploaded by the next update, which only copies the regions they occupy; a page is created
+// whenever an image fits in none of the previous ones.
+// The mips are generated on the CPU per image, so they never mix neighbouring images. Each image is surrounded by
+// copies of its edge texels and aligned to 2^(mipLevels - 1) texels, so its padding is at least a texel wide at the
+// coarsest mip, and bilinear filtering at its edges only reads its own texels
+class TextureAtlas
+{
+public:
+    TextureAtlas() noexcept = default;
+    TextureAtlas(vk::Device device,
+                 VmaAllocator allocator,
+                 vk::Sampler sampler,
+                 vk::DescriptorSetLayout textureSetLayout,
+                 vk::Format format,
+                 uint32_t pageSize,
+                 uint32_t mipLevels);
+
+    TextureAtlas(const TextureAtlas&) = delete;
+    TextureAtlas& operator=(const TextureAtlas&) = delete;
+
+    TextureAtlas(TextureAtlas&&) noexcept = default;
+    TextureAtlas& operator=(TextureAtlas&&) noexcept = default;
+
+    ~TextureAtlas() noexcept = default;
+
+public:
+    // RGBA8 texels, row major without padding, in the atlas format's color space. Throws if the padded image is larger
+    // than a page, or if every page is full and no more can be created
+    AtlasRegion add(std::span<const uint8_t> pixels, const vk::Extent2D& extent);
+
+    // Records the uploads of the images added since the last update. Must be called outside of a rendering scope,
+    // before any draw that uses them
+    void update(vk::CommandBuffer commandBuffer, size_t frame, DeletionQueue& deletionQueue);
+
+    // Of the page index of an AtlasRegion's texture. Written when the page is created, but only usable after the
+    // update uploading its first images
+    vk::DescriptorSet descriptor(uint32_t page) const noexcept;
+
+    size_t pageCount() const noexcept { return m_pages.size(); }
+    // Texels around each image
+    uint32_t padding() const noexcept { return 1u << (m_mipLevels - 1); }
+
+private:
+    struct Page {
+        Allocated2DImage image;
+        vk::UniqueImageView imageView;
+        vk::UniqueDescriptorSet descriptor;
+        SkylinePacker packer;
+        bool uploaded;   // its layout is eShaderReadOnlyOptimal, otherwise eUndefined
+    };
+
+    // Every mip of a padded image, finest first
+    struct PendingUpload {
+        uint32_t page;
+        std::vector<uint8_t> pixels;
+        std::vector<vk::BufferImageCopy> regions;   // offsets into pixels
+    };
+
+    void createPage();
+    // The padded image, extruding its edges, then its mips
+    PendingUpload buildUpload(std::span<const uint8_t> pixels,
+                              const vk::Extent2D& extent,
+                              const vk::Extent2D& paddedExtent,
+                              const glm::uvec2& position,
+                              uint32_t page) const;
+
+private:
+    vk::Device m_device;                          // not owned
+    VmaAllocator m_allocator = nullptr;           // not owned
+    vk::Sampler m_sampler;                        // not owned
+    vk::DescriptorSetLayout m_textureSetLayout;   // not owned
+    vk::Format m_format = vk::Format::eUndefined;
+    uint32_t m_pageSize = 0;
+    uint32_t m_mipLevels = 1;
+    vk::UniqueDescriptorPool m_descriptorPool;
+    std::vector<Page> m_pages;
+    std::vector<PendingUpload> m_pendingUploads;
+};
+
+}   // namespace renderer
+
+#endif
@@ -0,0 +1,560 @@
+#include "TextureStreamer.hpp"
+
+#include "DeletionQueue.hpp"
+#include "Types.hpp"
+#include "Utils.hpp"
+#include "core/File.hpp"
+#include "core/Logger.hpp"
+
+// libs
+#include <stb_image.h>
+
+// std
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <ios>
+#include <span>
+#include <stdexcept>
+
+namespace renderer
+{
+
+namespace
+{
+// Mips whose largest dimension is at most this size are always resident
+constexpr uint32_t RESIDENT_TAIL_SIZE = 64;
+// Textures not drawn for this many frames have their finer mips streamed out
+constexpr size_t FEEDBACK_TIMEOUT_FRAMES = 120;
+// Limits the CPU to GPU upload bandwidth used by streaming, to avoid hitching
+constexpr vk::DeviceSize MAX_UPLOAD_BYTES_PER_FRAME = 16 * 1024 * 1024;
+constexpr uint32_t MAX_TEXTURES = 256;
+// Each rebuild allocates a new descriptor set while the old one is still waiting in the deletion queue
+constexpr uint32_t DESCRIPTOR_SETS_PER_TEXTURE = 4;
+
+vk::ImageMemoryBarrier2 imageBarrier(vk::Image image,
+                                     vk::ImageLayout oldLayout,
+                                     vk::ImageLayout newLayout,
+                                     vk::PipelineStageFlags2 srcStage,
+                                     vk::AccessFlags2 srcAccess,
+                                     vk::PipelineStageFlags2 dstStage,
+                                     vk::AccessFlags2 dstAccess,
+                                     uint32_t levelCount) noexcept
+{
+    return vk::ImageMemoryBarrier2 {
+        .sType = vk::StructureType::eImageMemoryBarrier2,
+        .pNext = nullptr,
+        .srcStageMask = srcStage,
+        .srcAccessMask = srcAccess,
+        .dstStageMask = dstStage,
+        .dstAccessMask = dstAccess,
+        .oldLayout = oldLayout,
+        .newLayout = newLayout,
+        .srcQueueFamilyIndex = vk::QueueFamilyIgnored,
+        .dstQueueFamilyIndex = vk::QueueFamilyIgnored,
+        .image = image,
+        .subresourceRange = {.aspectMask = vk::ImageAspectFlagBits::eColor,
+                             .baseMipLevel = 0,
+                             .levelCount = levelCount,
+                             .baseArrayLayer = 0,
+                             .layerCount = 1}
+    };
+}
+
+void pipelineBarrier(vk::CommandBuffer commandBuffer, std::span<const vk::ImageMemoryBarrier2> barriers)
+{
+    vk::DependencyInfo dependencyInfo {.sType = vk::StructureType::eDependencyInfo,
+                                       .pNext = nullptr,
+                                       .dependencyFlags = {},
+                                       .memoryBarrierCount = 0,
+                                       .pMemoryBarriers = nullptr,
+                                       .bufferMemoryBarrierCount = 0,
+                                       .pBufferMemoryBarriers = nullptr,
+                                       .imageMemoryBarrierCount = static_cast<uint32_t>(barriers.size()),
+                                       .pImageMemoryBarriers = barriers.data()};
+
+    commandBuffer.pipelineBarrier2(dependencyInfo);
+}
+}   // namespace
+
+TextureStreamer::TextureStreamer(vk::Device device,
+                                 VmaAllocator allocator,
+                                 vk::Sampler sampler,
+                                 vk::DescriptorSetLayout textureSetLayout,
+                                 vk::DeviceSize memoryBudget)
+    : m_device(device)
+    , m_allocator(allocator)
+    , m_sampler(sampler)
+    , m_textureSetLayout(textureSetLayout)
+    , m_memoryBudget(memoryBudget)
+{
+    vk::DescriptorPoolSize poolSizes[] {
+        {.type = vk::DescriptorType::eCombinedImageSampler,
+         .descriptorCount = MAX_TEXTURES * DESCRIPTOR_SETS_PER_TEXTURE}
+    };
+
+    vk::DescriptorPoolCreateInfo poolCreateInfo {.sType = vk::StructureType::eDescriptorPoolCreateInfo,
+                                                 .pNext = nullptr,
+                                                 .flags = vk::DescriptorPoolCreateFlagBits::eFreeDescriptorSet,
+                                                 .maxSets = MAX_TEXTURES * DESCRIPTOR_SETS_PER_TEXTURE,
+                                                 .poolSizeCount = std::size(poolSizes),
+                                                 .pPoolSizes = poolSizes};
+
+    m_descriptorPool = m_device.createDescriptorPoolUnique(poolCreateInfo);
+    m_textures.reserve(MAX_TEXTURES);
+}
+
+TextureStreamer::DecodedTexture TextureStreamer::decode(const std::filesystem::path& path, vk::Format format)
+{
+    return decode(core::readFile(path), format, path);
+}
+
+TextureStreamer::DecodedTexture TextureStreamer::decode(std::span<const char> bytes,
+                                                        vk::Format format,
+                                                        const std::filesystem::path& path)
+{
+    int texWidth, texHeight, texChannels;
+    using unique_stbi_uc_t = std::unique_ptr<stbi_uc, decltype(&stbi_image_free)>;
+    unique_stbi_uc_t pixels(stbi_load_from_memory(reinterpret_cast<const stbi_uc*>(bytes.data()),
+                                                  static_cast<int>(bytes.size()),
+                                                  &texWidth,
+                                                  &texHeight,
+                                                  &texChannels,
+                                                  STBI_rgb_alpha),
+                            &stbi_image_free);
+
+    if (!pixels) {
+        throw std::ios_base::failure(std::string("Could not decode file " + path.string()));
+    }
+    assert(texWidth > 0);
+    assert(texHeight > 0);
+
+    DecodedTexture texture {};
+    texture.format = format;
+
+    // Mip chain layout
+    vk::Extent2D extent {.width = static_cast<uint32_t>(texWidth), .height = static_cast<uint32_t>(texHeight)};
+    size_t totalSize = 0;
+    while (true) {
+        size_t size = static_cast<size_t>(extent.width) * extent.height * 4;
+        texture.mips.push_back({.extent = extent, .offset = totalSize, .size = size});
+        totalSize += size;
+        if (extent.width == 1 && extent.height == 1) {
+            break;
+        }
+        extent = {.width = std::max(extent.width / 2, 1u), .height = std::max(extent.height / 2, 1u)};
+    }
+
+    texture.pixels.resize(totalSize);
+    std::memcpy(texture.pixels.data(), pixels.get(), texture.mips[0].size);
+    for (size_t i = 1; i < texture.mips.size(); ++i) {
+        const auto& src = texture.mips[i - 1];
+        const auto& dst = texture.mips[i];
+        utils::downsampleRgba8(&texture.pixels[src.offset],
+                               src.extent,
+                               &texture.pixels[dst.offset],
+                               dst.extent,
+                               utils::isSrgb(format));
+    }
+
+    auto mipCount = static_cast<uint32_t>(texture.mips.size());
+    texture.tailMip = mipCount - 1;
+    for (uint32_t i = 0; i < mipCount; ++i) {
+        const auto& e = texture.mips[i].extent;
+        if (std::max(e.width, e.height) <= RESIDENT_TAIL_SIZE) {
+            texture.tailMip = i;
+            break;
+        }
+    }
+
+    DEBUG_FMT("Decoded texture {} ({}x{}, {} mips, {} always resident)\n",
+              path.string(),
+              texWidth,
+              texHeight,
+              mipCount,
+              mipCount - texture.tailMip);
+    return texture;
+}
+
+TextureHandle TextureStreamer::add(DecodedTexture&& decoded)
+{
+    return addHandle(addTexture(std::move(decoded)));
+}
+
+TextureHandle TextureStreamer::share(TextureHandle handle)
+{
+    uint32_t index = m_handles[handle];
+    ++m_textures[index].handleCount;
+    return addHandle(index);
+}
+
+void TextureStreamer::remove(TextureHandle handle, size_t frame, DeletionQueue& deletionQueue)
+{
+    uint32_t index = m_handles[handle];
+    m_handles[handle] = NO_TEXTURE;
+    m_freeHandles.push_back(handle);
+
+    auto& texture = m_textures[index];
+    assert(texture.handleCount > 0);
+    if (--texture.handleCount > 0) {
+        return;
+    }
+
+    if (texture.image) {
+        deletionQueue.retire(frame, std::move(texture.descriptor));
+        deletionQueue.retire(frame, std::move(texture.imageView));
+        deletionQueue.retire(frame, std::move(texture.image));
+    }
+    m_residentBytes -= chainBytes(texture, texture.residentMip);
+    texture = StreamedTexture {};
+    m_freeTextures.push_back(index);
+}
+
+void TextureStreamer::reload(TextureHandle handle, DecodedTexture&& decoded, size_t frame, DeletionQueue& deletionQueue)
+{
+    uint32_t index = m_handles[handle];
+    if (m_textures[index].handleCount > 1) {
+        // The other handles were loaded from other files, which did not change
+        --m_textures[index].handleCount;
+        m_handles[handle] = addTexture(std::move(decoded));
+        return;
+    }
+
+    auto& texture = m_textures[index];
+    if (texture.image) {
+        deletionQueue.retire(frame, std::move(texture.descriptor));
+        deletionQueue.retire(frame, std::move(texture.imageView));
+        deletionQueue.retire(frame, std::move(texture.image));
+    }
+    m_residentBytes -= chainBytes(texture, texture.residentMip);
+
+    texture.format = decoded.format;
+    texture.pixels = std::move(decoded.pixels);
+    texture.mips = std::move(decoded.mips);
+    texture.tailMip = decoded.tailMip;
+    texture.residentMip = static_cast<uint32_t>(texture.mips.size());
+    texture.targetMip = texture.tailMip;
+    texture.requestedMip = texture.tailMip;
+}
+
+uint32_t TextureStreamer::addTexture(DecodedTexture&& decoded)
+{
+    if (m_freeTextures.empty() && m_textures.size() >= MAX_TEXTURES) {
+        throw std::length_error("TextureStreamer: maximum number of textures reached");
+    }
+
+    StreamedTexture texture {};
+    texture.format = decoded.format;
+    texture.pixels = std::move(decoded.pixels);
+    texture.mips = std::move(decoded.mips);
+    texture.tailMip = decoded.tailMip;
+    texture.residentMip = static_cast<uint32_t>(texture.mips.size());
+    texture.targetMip = texture.tailMip;
+    texture.requestedMip = texture.tailMip;
+    texture.requested = false;
+    texture.lastRequestFrame = 0;
+    texture.handleCount = 1;
+
+    if (m_freeTextures.empty()) {
+        m_textures.push_back(std::move(texture));
+        return static_cast<uint32_t>(m_textures.size() - 1);
+    }
+    uint32_t index = m_freeTextures.back();
+    m_freeTextures.pop_back();
+    m_textures[index] = std::move(texture);
+    return index;
+}
+
+TextureHandle TextureStreamer::addHandle(uint32_t texture)
+{
+    if (m_freeHandles.empty()) {
+        m_handles.push_back(texture);
+        return static_cast<TextureHandle>(m_handles.size() - 1);
+    }
+    TextureHandle handle = m_freeHandles.back();
+    m_freeHandles.pop_back();
+    m_handles[handle] = texture;
+    return handle;
+}
+
+void TextureStreamer::requestScreenSize(TextureHandle handle, float screenSizePixels) noexcept
+{
+    auto& texture = textureOf(handle);
+    const auto& extent = texture.mips[0].extent;
+    float textureSize = static_cast<float>(std::max(extent.width, extent.height));
+
+    uint32_t mip = texture.tailMip;
+    if (screenSizePixels > 0.f) {
+        float lod = std::floor(std::log2(textureSize / screenSizePixels));
+        mip = std::min(static_cast<uint32_t>(std::max(lod, 0.f)), texture.tailMip);
+    }
+
+    texture.requestedMip = std::min(texture.requestedMip, mip);
+    texture.requested = true;
+}
+
+vk::DeviceSize TextureStreamer::chainBytes(const StreamedTexture& texture, uint32_t mip) noexcept
+{
+    if (mip >= texture.mips.size()) {
+        return 0;
+    }
+    return texture.pixels.size() - texture.mips[mip].offset;
+}
+
+void TextureStreamer::applyBudget(size_t frame)
+{
+    vk::DeviceSize totalBytes = 0;
+    for (auto& texture : m_textures) {
+        if (texture.handleCount == 0) {
+            continue;
+        }
+        if (texture.requested) {
+            texture.targetMip = texture.requestedMip;
+            texture.lastRequestFrame = frame;
+        } else if (frame - texture.lastRequestFrame > FEEDBACK_TIMEOUT_FRAMES) {
+            texture.targetMip = texture.tailMip;
+        }
+        texture.requested = false;
+        texture.requestedMip = texture.tailMip;
+        totalBytes += chainBytes(texture, texture.targetMip);
+    }
+
+    // Over budget: drop one mip at a time from the least recently used textures, largest first
+    while (totalBytes > m_memoryBudget) {
+        StreamedTexture* victim = nullptr;
+        for (auto& texture : m_textures) {
+            if (texture.handleCount == 0 || texture.targetMip >= texture.tailMip) {
+                continue;
+            }
+            if (!victim || texture.lastRequestFrame < victim->lastRequestFrame ||
+                (texture.lastRequestFrame == victim->lastRequestFrame &&
+                 chainBytes(texture, texture.targetMip) > chainBytes(*victim, victim->targetMip))) {
+                victim = &texture;
+            }
+        }
+
+        if (!victim) {
+            // Only the resident tails are left
+            break;
+        }
+        totalBytes -= chainBytes(*victim, victim->targetMip) - chainBytes(*victim, victim->targetMip + 1);
+        ++victim->targetMip;
+    }
+}
+
+void TextureStreamer::update(vk::CommandBuffer commandBuffer, size_t frame, DeletionQueue& deletionQueue)
+{
+    applyBudget(frame);
+
+    // Stream outs first: they free memory and only need device copies
+    for (auto& texture : m_textures) {
+        if (texture.residentMip < texture.targetMip && texture.residentMip < texture.mips.size()) {
+            rebuild(texture, texture.targetMip, commandBuffer, frame, deletionQueue);
+        }
+    }
+
+    vk::DeviceSize uploadBudget = MAX_UPLOAD_BYTES_PER_FRAME;
+    for (auto& texture : m_textures) {
+        if (texture.residentMip <= texture.targetMip) {
+            continue;
+        }
+
+        // The first upload is only the tail, and ignores the upload budget as the texture can't be drawn without it
+        uint32_t newMip = texture.tailMip;
+        if (texture.residentMip < texture.mips.size()) {
+            newMip = texture.targetMip;
+            while (newMip < texture.residentMip &&
+                   chainBytes(texture, newMip) - chainBytes(texture, texture.residentMip) > uploadBudget) {
+                ++newMip;
+            }
+            if (newMip == texture.residentMip) {
+                continue;
+            }
+        }
+
+        uploadBudget -= std::min(uploadBudget, chainBytes(texture, newMip) - chainBytes(texture, texture.residentMip));
+        rebuild(texture, newMip, commandBuffer, frame, deletionQueue);
+    }
+}
+
+void TextureStreamer::rebuild(StreamedTexture& texture,
+                              uint32_t newMip,
+                              vk::CommandBuffer commandBuffer,
+                              size_t frame,
+                              DeletionQueue& deletionQueue)
+{
+    const auto mipCount = static_cast<uint32_t>(texture.mips.size());
+    const uint32_t levelCount = mipCount - newMip;
+    const bool hasOldImage = texture.image != nullptr;
+    // Levels [newMip, uploadEnd) come from the CPU, [max(newMip, residentMip), mipCount) from the old image
+    const uint32_t uploadEnd = std::min(texture.residentMip, mipCount);
+    const uint32_t copyBegin = std::max(newMip, texture.residentMip);
+
+    auto image = std::make_shared<const Allocated2DImage>(m_allocator,
+                                                          texture.format,
+                                                          texture.mips[newMip].extent,
+                                                          levelCount,
+                                                          vk::ImageTiling::eOptimal,
+                                                          vk::ImageUsageFlagBits::eTransferSrc |
+                                                              vk::ImageUsageFlagBits::eTransferDst |
+                                                              vk::ImageUsageFlagBits::eSampled,
+                                                          0,
+                                                          VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE);
+
+    // Prepare layouts
+    {
+        std::vector<vk::ImageMemoryBarrier2> barriers;
+        barriers.push_back(imageBarrier(image->image(),
+                                        vk::ImageLayout::eUndefined,
+                                        vk::ImageLayout::eTransferDstOptimal,
+                                        vk::PipelineStageFlagBits2::eTopOfPipe,
+                                        {},
+                                        vk::PipelineStageFlagBits2::eTransfer,
+                                        vk::AccessFlagBits2::eTransferWrite,
+                                        levelCount));
+        if (hasOldImage) {
+            // Waits for previous frames still sampling from it
+            barriers.push_back(imageBarrier(texture.image->image(),
+                                            vk::ImageLayout::eShaderReadOnlyOptimal,
+                                            vk::ImageLayout::eTransferSrcOptimal,
+                                            vk::PipelineStageFlagBits2::eFragmentShader,
+                                            vk::AccessFlagBits2::eShaderRead,
+                                            vk::PipelineStageFlagBits2::eTransfer,
+                                            vk::AccessFlagBits2::eTransferRead,
+                                            texture.image->mipLevels()));
+        }
+        pipelineBarrier(commandBuffer, barriers);
+    }
+
+    // Upload the new levels, contiguous in texture.pixels
+    if (newMip < uploadEnd) {
+        const size_t uploadOffset = texture.mips[newMip].offset;
+        const size_t uploadSize = texture.mips[uploadEnd - 1].offset + texture.mips[uploadEnd - 1].size - uploadOffset;
+
+        AllocatedBuffer stagingBuffer(m_allocator,
+                                      uploadSize,
+                                      vk::BufferUsageFlagBits::eTransferSrc,
+                                      VMA_ALLOCATION_CREATE_MAPPED_BIT |
+                                          VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT,
+                                      VMA_MEMORY_USAGE_AUTO);
+        std::memcpy(stagingBuffer.allocationInfo().pMappedData, &texture.pixels[uploadOffset], uploadSize);
+
+        std::vector<vk::BufferImageCopy> regions;
+        for (uint32_t mip = newMip; mip < uploadEnd; ++mip) {
+            const auto& level = texture.mips[mip];
+            regions.push_back({
+                .bufferOffset = level.offset - uploadOffset,
+                .bufferRowLength = 0,
+                .bufferImageHeight = 0,
+                .imageSubresource = {.aspectMask = vk::ImageAspectFlagBits::eColor,
+                                     .mipLevel = mip - newMip,
+                                     .baseArrayLayer = 0,
+                                     .layerCount = 1},
+                .imageOffset = {.x = 0, .y = 0, .z = 0},
+                .imageExtent = {.width = level.extent.width, .height = level.extent.height, .depth = 1}
+            });
+        }
+        commandBuffer.copyBufferToImage(stagingBuffer.buffer(),
+                                        image->image(),
+                                        vk::ImageLayout::eTransferDstOptimal,
+                                        regions);
+        deletionQueue.retire(frame, std::move(stagingBuffer));
+    }
+
+    // Copy the levels that are already on the device
+    if (hasOldImage && copyBegin < mipCount) {
+        std::vector<vk::ImageCopy> regions;
+        for (uint32_t mip = copyBegin; mip < mipCount; ++mip) {
+            const auto& level = texture.mips[mip];
+            regions.push_back({
+                .srcSubresource = {.aspectMask = vk::ImageAspectFlagBits::eColor,
+                                   .mipLevel = mip - texture.residentMip,
+                                   .baseArrayLayer = 0,
+                                   .layerCount = 1},
+                .srcOffset = {.x = 0, .y = 0, .z = 0},
+                .dstSubresource = {.aspectMask = vk::ImageAspectFlagBits::eColor,
+                                   .mipLevel = mip - newMip,
+                                   .baseArrayLayer = 0,
+                                   .layerCount = 1},
+                .dstOffset = {.x = 0, .y = 0, .z = 0},
+                .extent = {.width = level.extent.width, .height = level.extent.height, .depth = 1}
+            });
+        }
+        commandBuffer.copyImage(texture.image->image(),
+                                vk::ImageLayout::eTransferSrcOptimal,
+                                image->image(),
+                                vk::ImageLayout::eTransferDstOptimal,
+                                regions);
+    }
+
+    vk::ImageMemoryBarrier2 readBarrier = imageBarrier(image->image(),
+                                                       vk::ImageLayout::eTransferDstOptimal,
+                                                       vk::ImageLayout::eShaderReadOnlyOptimal,
+                                                       vk::PipelineStageFlagBits2::eTransfer,
+                                                       vk::AccessFlagBits2::eTransferWrite,
+                                                       vk::PipelineStageFlagBits2::eFragmentShader,
+                                                       vk::AccessFlagBits2::eShaderRead,
+                                                       levelCount);
+    pipelineBarrier(commandBuffer, {&readBarrier, 1});
+
+    // New view and descriptor, the old ones may still be in use by frames in flight
+    vk::ImageViewCreateInfo imageViewCreateInfo {
+        .sType = vk::StructureType::eImageViewCreateInfo,
+        .pNext = nullptr,
+        .flags = {},
+        .image = image->image(),
+        .viewType = vk::ImageViewType::e2D,
+        .format = texture.format,
+        .components = {vk::ComponentSwizzle::eIdentity,
+                  vk::ComponentSwizzle::eIdentity,
+                  vk::ComponentSwizzle::eIdentity,
+                  vk::ComponentSwizzle::eIdentity},
+        .subresourceRange = {.aspectMask = vk::ImageAspectFlagBits::eColor,
+                  .baseMipLevel = 0,
+                  .levelCount = levelCount,
+                  .baseArrayLayer = 0,
+                  .layerCount = 1}
+    };
+    auto imageView = m_device.createImageViewUnique(imageViewCreateInfo);
+
+    vk::DescriptorSetAllocateInfo allocateInfo {.sType = vk::StructureType::eDescriptorSetAllocateInfo,
+                                                .pNext = nullptr,
+                                                .descriptorPool = *m_descriptorPool,
+                                                .descriptorSetCount = 1,
+                                                .pSetLayouts = &m_textureSetLayout};
+    auto descriptor = std::move(m_device.allocateDescriptorSetsUnique(allocateInfo)[0]);
+
+    vk::DescriptorImageInfo imageInfo {.sampler = m_sampler,
+                                       .imageView = *imageView,
+                                       .imageLayout = vk::ImageLayout::eShaderReadOnlyOptimal};
+
+    vk::WriteDescriptorSet descriptorWrite {.sType = vk::StructureType::eWriteDescriptorSet,
+                                            .pNext = nullptr,
+                                            .dstSet = *descriptor,
+                                            .dstBinding = 0,
+                                            .dstArrayElement = 0,
+                                            .descriptorCount = 1,
+                                            .descriptorType = vk::DescriptorType::eCombinedImageSampler,
+                                            .pImageInfo = &imageInfo,
+                                            .pBufferInfo = nullptr,
+                                            .pTexelBufferView = nullptr};
+    m_device.updateDescriptorSets(descriptorWrite, nullptr);
+
+    if (hasOldImage) {
+        deletionQueue.retire(frame, std::move(texture.descriptor));
+        deletionQueue.retire(frame, std::move(texture.imageView));
+        deletionQueue.retire(frame, std::move(texture.image));
+    }
+
+    m_residentBytes -= chainBytes(texture, texture.residentMip);
+    m_residentBytes += chainBytes(texture, newMip);
+    TRACE_FMT("Texture residency changed from mip {} to mip {}\n", texture.residentMip, newMip);
+
+    texture.image = std::move(image);
+    texture.imageView = std::move(imageView);
+    texture.descriptor = std::move(descriptor);
+    texture.residentMip = newMip;
+}
+
+}   // namespace renderer
@@ -0,0 +1,148 @@
+#ifndef RENDERER_TEXTURE_STREAMER_HPP
+#define RENDERER_TEXTURE_STREAMER_HPP
+
+#include "Image.hpp"
+
+// libs
+#include <vk_mem_alloc.h>
+#include <vulkan/vulkan.hpp>
+
+// std
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <limits>
+#include <memory>
+#include <span>
+#include <vector>
+
+namespace renderer
+{
+class DeletionQueue;
+
+using TextureHandle = uint32_t;
+inline constexpr TextureHandle INVALID_TEXTURE_HANDLE = std::numeric_limits<TextureHandle>::max();
+
+// Keeps only the coarse mips of each texture resident on the device, and streams finer mips in and out according
+// to the screen size reported by the rendering code, within a device memory budget.
+// Residency changes are done by allocating a new image with the desired mip chain, copying the mips already on the
+// device and uploading the missing ones. The old image is retired to the DeletionQueue.
+// Several handles may share a texture, so identical content loaded under different names is only streamed once. Which
+// loads are identical is left to the caller, see AssetManager.
+class TextureStreamer
+{
+public:
+    TextureStreamer() noexcept = default;
+    TextureStreamer(vk::Device device,
+                    VmaAllocator allocator,
+                    vk::Sampler sampler,
+                    vk::DescriptorSetLayout textureSetLayout,
+                    vk::DeviceSize memoryBudget);
+
+    TextureStreamer(const TextureStreamer&) = delete;
+    TextureStreamer& operator=(const TextureStreamer&) = delete;
+
+    TextureStreamer(TextureStreamer&&) noexcept = default;
+    TextureStreamer& operator=(TextureStreamer&&) noexcept = default;
+
+    ~TextureStreamer() noexcept = default;
+
+public:
+    struct MipLevel {
+        vk::Extent2D extent;
+        size_t offset;   // in bytes, inside DecodedTexture::pixels
+        size_t size;
+    };
+
+    struct DecodedTexture {
+        vk::Format format;
+        std::vector<uint8_t> pixels;   // every mip level, RGBA8, finest first
+        std::vector<MipLevel> mips;
+        uint32_t tailMip;   // the mips [tailMip, mips.size()) are always resident
+    };
+
+    // Decodes the image and builds its mip chain on the CPU. Touches no state, so it can run on any thread
+    static DecodedTexture decode(const std::filesystem::path& path, vk::Format format);
+    // Same, from the encoded file content. path is only used for logging
+    static DecodedTexture decode(std::span<const char> bytes, vk::Format format, const std::filesystem::path& path);
+
+    // Nothing is uploaded until the next update
+    TextureHandle add(DecodedTexture&& decoded);
+    // A new handle on the texture of an existing one
+    TextureHandle share(TextureHandle handle);
+    // The handle may be returned again by the next add or share. The texture is retired once no handle uses it
+    void remove(TextureHandle handle, size_t frame, DeletionQueue& deletionQueue);
+
+    // Replaces the content of the handle's texture, the handle and its users are unchanged. A texture shared with
+    // other handles keeps its content for them, and the handle gets a texture of its own. Otherwise the device image
+    // is retired and uploaded again on the next update, starting from the tail like a new texture
+    void reload(TextureHandle handle, DecodedTexture&& decoded, size_t frame, DeletionQueue& deletionQueue);
+
+    // Rendering feedback: the texture was drawn covering roughly screenSizePixels pixels on its largest axis.
+    // Can be called multiple times per frame, the finest requirement is kept.
+    void requestScreenSize(TextureHandle handle, float screenSizePixels) noexcept;
+
+    // Records the residency changes for this frame. Must be called outside of a rendering scope, before any draw
+    // that uses the descriptors.
+    void update(vk::CommandBuffer commandBuffer, size_t frame, DeletionQueue& deletionQueue);
+
+    // Null until the first update after the texture is loaded
+    vk::DescriptorSet descriptor(TextureHandle handle) const noexcept { return *textureOf(handle).descriptor; }
+
+    vk::Format format(TextureHandle handle) const noexcept { return textureOf(handle).format; }
+    uint32_t residentMip(TextureHandle handle) const noexcept { return textureOf(handle).residentMip; }
+    // Of the whole mip chain, as kept on the CPU
+    vk::DeviceSize size(TextureHandle handle) const noexcept { return textureOf(handle).pixels.size(); }
+    vk::DeviceSize residentBytes() const noexcept { return m_residentBytes; }
+
+private:
+    struct StreamedTexture {
+        vk::Format format;
+        std::vector<uint8_t> pixels;   // every mip level, RGBA8, finest first
+        std::vector<MipLevel> mips;
+        uint32_t tailMip;        // the mips [tailMip, mips.size()) are always resident
+        uint32_t residentMip;    // finest mip on the device, mips.size() if nothing was uploaded yet
+        uint32_t targetMip;      // finest mip wanted by the feedback, after the budget is applied
+        uint32_t requestedMip;   // finest mip requested since the last update
+        bool requested;
+        size_t lastRequestFrame;
+        std::shared_ptr<const Allocated2DImage> image;
+        vk::UniqueImageView imageView;
+        vk::UniqueDescriptorSet descriptor;
+        uint32_t handleCount;   // 0 for a free slot
+    };
+
+    static constexpr uint32_t NO_TEXTURE = std::numeric_limits<uint32_t>::max();
+
+    static vk::DeviceSize chainBytes(const StreamedTexture& texture, uint32_t mip) noexcept;
+
+    const StreamedTexture& textureOf(TextureHandle handle) const noexcept { return m_textures[m_handles[handle]]; }
+    StreamedTexture& textureOf(TextureHandle handle) noexcept { return m_textures[m_handles[handle]]; }
+    // Index of a new texture in m_textures
+    uint32_t addTexture(DecodedTexture&& decoded);
+    TextureHandle addHandle(uint32_t texture);
+
+    void applyBudget(size_t frame);
+    void rebuild(StreamedTexture& texture,
+                 uint32_t newMip,
+                 vk::CommandBuffer commandBuffer,
+                 size_t frame,
+                 DeletionQueue& deletionQueue);
+
+private:
+    vk::Device m_device;                          // not owned
+    VmaAllocator m_allocator = nullptr;           // not owned
+    vk::Sampler m_sampler;                        // not owned
+    vk::DescriptorSetLayout m_textureSetLayout;   // not owned
+    vk::UniqueDescriptorPool m_descriptorPool;
+    vk::DeviceSize m_memoryBudget = 0;
+    vk::DeviceSize m_residentBytes = 0;
+    std::vector<StreamedTexture> m_textures;
+    std::vector<uint32_t> m_freeTextures;
+    std::vector<uint32_t> m_handles;   // index in m_textures per handle, NO_TEXTURE if free
+    std::vector<TextureHandle> m_freeHandles;
+};
+
+}   // namespace renderer
+
+#endif
@@ -0,0 +1,488 @@
+#include "TrueTypeFont.hpp"
+
+#include "core/File.hpp"
+
+// std
+#include <algorithm>
+#include <format>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <string_view>
+
+namespace renderer
+{
+
+namespace
+{
+constexpr uint32_t SFNT_VERSION_TRUETYPE = 0x00010000;
+constexpr uint32_t SFNT_VERSION_APPLE = 0x74727565;   // "true"
+constexpr size_t TABLE_DIRECTORY_SIZE = 12;
+constexpr size_t TABLE_RECORD_SIZE = 16;
+constexpr size_t GLYPH_HEADER_SIZE = 10;
+constexpr size_t MAX_COMPOSITE_DEPTH = 8;
+
+// Simple glyph flags
+constexpr uint8_t ON_CURVE_POINT = 0x01;
+constexpr uint8_t X_SHORT_VECTOR = 0x02;
+constexpr uint8_t Y_SHORT_VECTOR = 0x04;
+constexpr uint8_t REPEAT_FLAG = 0x08;
+constexpr uint8_t X_IS_SAME_OR_POSITIVE = 0x10;
+constexpr uint8_t Y_IS_SAME_OR_POSITIVE = 0x20;
+
+// Composite glyph flags
+constexpr uint16_t ARG_1_AND_2_ARE_WORDS = 0x0001;
+constexpr uint16_t ARGS_ARE_XY_VALUES = 0x0002;
+constexpr uint16_t WE_HAVE_A_SCALE = 0x0008;
+constexpr uint16_t MORE_COMPONENTS = 0x0020;
+constexpr uint16_t WE_HAVE_AN_X_AND_Y_SCALE = 0x0040;
+constexpr uint16_t WE_HAVE_A_TWO_BY_TWO = 0x0080;
+
+// kern subtable coverage
+constexpr uint16_t KERN_HORIZONTAL = 0x0001;
+constexpr uint16_t KERN_MINIMUM = 0x0002;
+constexpr uint16_t KERN_CROSS_STREAM = 0x0004;
+constexpr size_t KERN_PAIR_SIZE = 6;
+
+[[noreturn]] void fail(std::string_view reason)
+{
+    throw std::runtime_error(std::format("Invalid TrueType font: {}", reason));
+}
+
+// Big endian, bounds checked
+void checkRange(std::span<const char> bytes, size_t offset, size_t size)
+{
+    if (offset > bytes.size() || size > bytes.size() - offset) {
+        fail("read out of bounds");
+    }
+}
+
+uint8_t readU8(std::span<const char> bytes, size_t offset)
+{
+    checkRange(bytes, offset, 1);
+    return static_cast<uint8_t>(bytes[offset]);
+}
+
+uint16_t readU16(std::span<const char> bytes, size_t offset)
+{
+    checkRange(bytes, offset, 2);
+    return static_cast<uint16_t>(static_cast<uint8_t>(bytes[offset]) << 8 | static_cast<uint8_t>(bytes[offset + 1]));
+}
+
+int16_t readI16(std::span<const char> bytes, size_t offset)
+{
+    return static_cast<int16_t>(readU16(bytes, offset));
+}
+
+uint32_t readU32(std::span<const char> bytes, size_t offset)
+{
+    return uint32_t {readU16(bytes, offset)} << 16 | readU16(bytes, offset + 2);
+}
+
+// 2.14 fixed point
+float readF2Dot14(std::span<const char> bytes, size_t offset)
+{
+    return static_cast<float>(readI16(bytes, offset)) / 16384.f;
+}
+
+std::optional<size_t> findTable(std::span<const char> bytes, std::string_view tag)
+{
+    uint16_t numTables = readU16(bytes, 4);
+    for (size_t i = 0; i < numTables; ++i) {
+        size_t record = TABLE_DIRECTORY_SIZE + i * TABLE_RECORD_SIZE;
+        checkRange(bytes, record, TABLE_RECORD_SIZE);
+        if (std::string_view(bytes.data() + record, 4) == tag) {
+            uint32_t offset = readU32(bytes, record + 8);
+            checkRange(bytes, offset, readU32(bytes, record + 12));
+            return offset;
+        }
+    }
+    return std::nullopt;
+}
+
+size_t requireTable(std::span<const char> bytes, std::string_view tag)
+{
+    std::optional<size_t> offset = findTable(bytes, tag);
+    if (!offset) {
+        fail(std::format("missing {} table", tag));
+    }
+    return *offset;
+}
+
+GlyphCurve line(const glm::vec2& from, const glm::vec2& to) noexcept
+{
+    return {.p0 = from, .p1 = (from + to) * 0.5f, .p2 = to};
+}
+
+// TrueType contours alternate on curve points and off curve control points, with an implied on curve point between
+// two consecutive control points
+void appendContour(std::span<const glm::vec2> points,
+                   std::span<const uint8_t> onCurve,
+                   std::vector<GlyphCurve>& curves)
+{
+    size_t count = points.size();
+    if (count < 2) {
+        return;
+    }
+
+    // Starts at an on curve point, or between the first two control points if there is none
+    size_t first = 0;
+    while (first < count && !onCurve[first]) {
+        ++first;
+    }
+    glm::vec2 start = first < count ? points[first] : (points[0] + points[1]) * 0.5f;
+    first = first < count ? first : 0;
+
+    glm::vec2 current = start;
+    std::optional<glm::vec2> control;
+    for (size_t i = 1; i <= count; ++i) {
+        size_t index = (first + i) % count;
+        const glm::vec2& point = points[index];
+        if (onCurve[index]) {
+            curves.push_back(control ? GlyphCurve {.p0 = current, .p1 = *control, .p2 = point} : line(current, point));
+            current = point;
+            control.reset();
+        } else {
+            if (control) {
+                glm::vec2 middle = (*control + point) * 0.5f;
+                curves.push_back({.p0 = current, .p1 = *control, .p2 = middle});
+                current = middle;
+            }
+            control = point;
+        }
+    }
+    if (control) {
+        curves.push_back({.p0 = current, .p1 = *control, .p2 = start});
+    } else if (current != start) {
+        curves.push_back(line(current, start));
+    }
+}
+}   // namespace
+
+TrueTypeFont::TrueTypeFont(const std::filesystem::path& path)
+    : m_data(core::readFile(path))
+{
+    std::span<const char> bytes = m_data;
+    checkRange(bytes, 0, TABLE_DIRECTORY_SIZE);
+    uint32_t version = readU32(bytes, 0);
+    if (version != SFNT_VERSION_TRUETYPE && version != SFNT_VERSION_APPLE) {
+        fail("not a TrueType outline font");
+    }
+
+    size_t head = requireTable(bytes, "head");
+    size_t hhea = requireTable(bytes, "hhea");
+    size_t maxp = requireTable(bytes, "maxp");
+    size_t cmap = requireTable(bytes, "cmap");
+    m_hmtx = requireTable(bytes, "hmtx");
+    m_loca = requireTable(bytes, "loca");
+    m_glyf = requireTable(bytes, "glyf");
+
+    m_unitsPerEm = static_cast<float>(readU16(bytes, head + 18));
+    if (m_unitsPerEm == 0.f) {
+        fail("zero units per em");
+    }
+    m_longLoca = readI16(bytes, head + 50) != 0;
+    m_numGlyphs = readU16(bytes, maxp + 4);
+    m_ascender = static_cast<float>(readI16(bytes, hhea + 4));
+    m_descender = static_cast<float>(readI16(bytes, hhea + 6));
+    m_lineGap = static_cast<float>(readI16(bytes, hhea + 8));
+    m_numHMetrics = readU16(bytes, hhea + 34);
+    if (m_numGlyphs == 0 || m_numHMetrics == 0) {
+        fail("no glyphs");
+    }
+    checkRange(bytes, m_hmtx, size_t {m_numHMetrics} * 4);
+    checkRange(bytes, m_loca, (size_t {m_numGlyphs} + 1) * (m_longLoca ? 4 : 2));
+
+    // Prefers the full Unicode range over the basic multilingual plane
+    int bestScore = 0;
+    uint16_t numSubtables = readU16(bytes, cmap + 2);
+    for (size_t i = 0; i < numSubtables; ++i) {
+        size_t record = cmap + 4 + i * 8;
+        uint16_t platform = readU16(bytes, record);
+        uint16_t encoding = readU16(bytes, record + 2);
+        size_t subtable = cmap + readU32(bytes, record + 4);
+        uint16_t format = readU16(bytes, subtable);
+        bool unicode = platform == 0 || (platform == 3 && (encoding == 1 || encoding == 10));
+        int score = !unicode ? 0 : format == 12 ? 2 : format == 4 ? 1 : 0;
+        if (score > bestScore) {
+            bestScore = score;
+            m_cmap = subtable;
+            m_cmapFormat = format;
+        }
+    }
+    if (bestScore == 0) {
+        fail("no Unicode character map of format 4 or 12");
+    }
+
+    // Optional, fonts may only kern through GPOS
+    if (std::optional<size_t> kern = findTable(bytes, "kern"); kern && readU16(bytes, *kern) == 0) {
+        uint16_t numKernTables = readU16(bytes, *kern + 2);
+        size_t subtable = *kern + 4;
+        for (size_t i = 0; i < numKernTables; ++i) {
+            uint16_t length = readU16(bytes, subtable + 2);
+            uint16_t coverage = readU16(bytes, subtable + 4);
+            if ((coverage >> 8) == 0 && (coverage & (KERN_HORIZONTAL | KERN_MINIMUM | KERN_CROSS_STREAM)) ==
+                                            KERN_HORIZONTAL) {
+                m_kernPairCount = readU16(bytes, subtable + 6);
+                m_kernPairs = subtable + 14;
+                checkRange(bytes, m_kernPairs, m_kernPairCount * KERN_PAIR_SIZE);
+                break;
+            }
+            subtable += length;
+        }
+    }
+}
+
+uint32_t TrueTypeFont::glyphIndex(char32_t codepoint) const
+{
+    std::span<const char> bytes = m_data;
+    uint32_t glyph = 0;
+    if (m_cmapFormat == 4) {
+        if (codepoint > 0xffff) {
+            return 0;
+        }
+        size_t segCount = readU16(bytes, m_cmap + 6) / 2;
+        size_t endCodes = m_cmap + 14;
+        size_t startCodes = endCodes + 2 * segCount + 2;
+        size_t idDeltas = startCodes + 2 * segCount;
+        size_t idRangeOffsets = idDeltas + 2 * segCount;
+
+        // First segment ending at or after the codepoint, the end codes are increasing
+        size_t low = 0;
+        size_t high = segCount;
+        while (low < high) {
+            size_t middle = (low + high) / 2;
+            if (readU16(bytes, endCodes + 2 * middle) < codepoint) {
+                low = middle + 1;
+            } else {
+                high = middle;
+            }
+        }
+        if (low == segCount || readU16(bytes, startCodes + 2 * low) > codepoint) {
+            return 0;
+        }
+
+        uint16_t start = readU16(bytes, startCodes + 2 * low);
+        uint16_t delta = readU16(bytes, idDeltas + 2 * low);
+        uint16_t rangeOffset = readU16(bytes, idRangeOffsets + 2 * low);
+        if (rangeOffset == 0) {
+            glyph = (codepoint + delta) & 0xffff;
+        } else {
+            // Relative to the range offset's own location
+            glyph = readU16(bytes, idRangeOffsets + 2 * low + rangeOffset + 2 * (codepoint - start));
+            glyph = glyph != 0 ? (glyph + delta) & 0xffff : 0;
+        }
+    } else {
+        uint32_t numGroups = readU32(bytes, m_cmap + 12);
+        size_t groups = m_cmap + 16;
+        size_t low = 0;
+        size_t high = numGroups;
+        while (low < high) {
+            size_t middle = (low + high) / 2;
+            if (readU32(bytes, groups + 12 * middle + 4) < codepoint) {
+                low = middle + 1;
+            } else {
+                high = middle;
+            }
+        }
+        if (low == numGroups) {
+            return 0;
+        }
+        uint32_t startCode = readU32(bytes, groups + 12 * low);
+        if (startCode > codepoint) {
+            return 0;
+        }
+        glyph = readU32(bytes, groups + 12 * low + 8) + (codepoint - startCode);
+    }
+    return glyph < m_numGlyphs ? glyph : 0;
+}
+
+float TrueTypeFont::advance(uint32_t glyph) const
+{
+    // The glyphs past the last metric share its advance
+    size_t metric = std::min(glyph, m_numHMetrics - 1);
+    return static_cast<float>(readU16(m_data, m_hmtx + 4 * metric));
+}
+
+float TrueTypeFont::kerning(uint32_t left, uint32_t right) const
+{
+    // The pairs are sorted by their glyphs as a 32 bits key
+    uint32_t key = left << 16 | right;
+    size_t low = 0;
+    size_t high = m_kernPairCount;
+    while (low < high) {
+        size_t middle = (low + high) / 2;
+        uint32_t pairKey = readU32(m_data, m_kernPairs + middle * KERN_PAIR_SIZE);
+        if (pairKey == key) {
+            return static_cast<float>(readI16(m_data, m_kernPairs + middle * KERN_PAIR_SIZE + 4));
+        }
+        if (pairKey < key) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    return 0.f;
+}
+
+bool TrueTypeFont::hasOutline(uint32_t glyph) const
+{
+    auto [offset, size] = glyphRange(glyph);
+    return size >= GLYPH_HEADER_SIZE && readI16(m_data, offset) != 0;
+}
+
+GlyphOutline TrueTypeFont::outline(uint32_t glyph) const
+{
+    GlyphOutline result;
+    auto [offset, size] = glyphRange(glyph);
+    if (size < GLYPH_HEADER_SIZE) {
+        return result;
+    }
+    result.min = glm::vec2(readI16(m_data, offset + 2), readI16(m_data, offset + 4));
+    result.max = glm::vec2(readI16(m_data, offset + 6), readI16(m_data, offset + 8));
+    appendOutline(glyph, glm::mat2(1.f), glm::vec2(0.f), 0, result.curves);
+    return result;
+}
+
+std::pair<size_t, size_t> TrueTypeFont::glyphRange(uint32_t glyph) const
+{
+    if (glyph >= m_numGlyphs) {
+        fail(std::format("glyph {} out of range", glyph));
+    }
+    size_t begin = m_longLoca ? readU32(m_data, m_loca + 4 * size_t {glyph})
+                              : size_t {readU16(m_data, m_loca + 2 * size_t {glyph})} * 2;
+    size_t end = m_longLoca ? readU32(m_data, m_loca + 4 * (size_t {glyph} + 1))
+                            : size_t {readU16(m_data, m_loca + 2 * (size_t {glyph} + 1))} * 2;
+    if (end < begin) {
+        fail("decreasing glyph offsets");
+    }
+    checkRange(m_data, m_glyf + begin, end - begin);
+    return {m_glyf + begin, end - begin};
+}
+
+void TrueTypeFont::appendOutline(uint32_t glyph,
+                                 const glm::mat2& linear,
+                                 const glm::vec2& offset,
+                                 size_t depth,
+                                 std::vector<GlyphCurve>& curves) const
+{
+    std::span<const char> bytes = m_data;
+    auto [start, size] = glyphRange(glyph);
+    if (size < GLYPH_HEADER_SIZE) {
+        return;
+    }
+
+    int16_t numberOfContours = readI16(bytes, start);
+    size_t p = start + GLYPH_HEADER_SIZE;
+    if (numberOfContours < 0) {
+        if (depth >= MAX_COMPOSITE_DEPTH) {
+            fail("composite glyphs nested too deeply");
+        }
+        uint16_t flags = MORE_COMPONENTS;
+        while (flags & MORE_COMPONENTS) {
+            flags = readU16(bytes, p);
+            uint16_t component = readU16(bytes, p + 2);
+            p += 4;
+
+            // Matching points instead of offsets are not supported, the component is then left in place
+            glm::vec2 componentOffset(0.f);
+            if (flags & ARG_1_AND_2_ARE_WORDS) {
+                if (flags & ARGS_ARE_XY_VALUES) {
+                    componentOffset = glm::vec2(readI16(bytes, p), readI16(bytes, p + 2));
+                }
+                p += 4;
+            } else {
+                if (flags & ARGS_ARE_XY_VALUES) {
+                    componentOffset = glm::vec2(static_cast<int8_t>(readU8(bytes, p)),
+                                                static_cast<int8_t>(readU8(bytes, p + 1)));
+                }
+                p += 2;
+            }
+
+            glm::mat2 componentLinear(1.f);
+            if (flags & WE_HAVE_A_SCALE) {
+                componentLinear = glm::mat2(readF2Dot14(bytes, p));
+                p += 2;
+            } else if (flags & WE_HAVE_AN_X_AND_Y_SCALE) {
+                componentLinear = glm::mat2(readF2Dot14(bytes, p), 0.f, 0.f, readF2Dot14(bytes, p + 2));
+                p += 4;
+            } else if (flags & WE_HAVE_A_TWO_BY_TWO) {
+                // Column major, as glm
+                componentLinear = glm::mat2(readF2Dot14(bytes, p),
+                                            readF2Dot14(bytes, p + 2),
+                                            readF2Dot14(bytes, p + 4),
+                                            readF2Dot14(bytes, p + 6));
+                p += 8;
+            }
+
+            appendOutline(
+                component, linear * componentLinear, linear * componentOffset + offset, depth + 1, curves);
+        }
+        return;
+    }
+
+    std::vector<uint16_t> endPoints(static_cast<size_t>(numberOfContours));
+    for (auto& endPoint : endPoints) {
+        endPoint = readU16(bytes, p);
+        p += 2;
+    }
+    if (endPoints.empty()) {
+        return;
+    }
+    size_t numPoints = size_t {endPoints.back()} + 1;
+    p += 2 + size_t {readU16(bytes, p)};   // skips the instructions
+
+    std::vector<uint8_t> flags;
+    flags.reserve(numPoints);
+    while (flags.size() < numPoints) {
+        uint8_t flag = readU8(bytes, p++);
+        size_t repeat = flag & REPEAT_FLAG ? size_t {readU8(bytes, p++)} : 0;
+        if (flags.size() + 1 + repeat > numPoints) {
+            fail("glyph flags overflow its points");
+        }
+        flags.insert(flags.end(), 1 + repeat, flag);
+    }
+
+    // Coordinates are deltas from the previous point, x then y
+    std::vector<glm::vec2> points(numPoints);
+    int32_t coordinate = 0;
+    for (size_t i = 0; i < numPoints; ++i) {
+        if (flags[i] & X_SHORT_VECTOR) {
+            int32_t delta = readU8(bytes, p++);
+            coordinate += flags[i] & X_IS_SAME_OR_POSITIVE ? delta : -delta;
+        } else if (!(flags[i] & X_IS_SAME_OR_POSITIVE)) {
+            coordinate += readI16(bytes, p);
+            p += 2;
+        }
+        points[i].x = static_cast<float>(coordinate);
+    }
+    coordinate = 0;
+    for (size_t i = 0; i < numPoints; ++i) {
+        if (flags[i] & Y_SHORT_VECTOR) {
+            int32_t delta = readU8(bytes, p++);
+            coordinate += flags[i] & Y_IS_SAME_OR_POSITIVE ? delta : -delta;
+        } else if (!(flags[i] & Y_IS_SAME_OR_POSITIVE)) {
+            coordinate += readI16(bytes, p);
+            p += 2;
+        }
+        points[i].y = static_cast<float>(coordinate);
+    }
+
+    std::vector<uint8_t> onCurve(numPoints);
+    for (size_t i = 0; i < numPoints; ++i) {
+        points[i] = linear * points[i] + offset;
+        onCurve[i] = (flags[i] & ON_CURVE_POINT) != 0;
+    }
+
+    size_t first = 0;
+    for (uint16_t endPoint : endPoints) {
+        if (endPoint < first || endPoint >= numPoints) {
+            fail("decreasing contour end points");
+        }
+        size_t count = size_t {endPoint} + 1 - first;
+        appendContour(std::span(points).subspan(first, count), std::span(onCurve).subspan(first, count), curves);
+        first = size_t {endPoint} + 1;
+    }
+}
+
+}   // namespace renderer
@@ -0,0 +1,93 @@
+#ifndef RENDERER_TRUE_TYPE_FONT_HPP
+#define RENDERER_TRUE_TYPE_FONT_HPP
+
+// libs
+#include <glm/glm.hpp>
+
+// std
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <utility>
+#include <vector>
+
+namespace renderer
+{
+
+// Quadratic Bezier curve, lines have their control point in the middle
+struct GlyphCurve {
+    glm::vec2 p0;
+    glm::vec2 p1;
+    glm::vec2 p2;
+};
+
+// In font units, y pointing up
+struct GlyphOutline {
+    std::vector<GlyphCurve> curves;   // closed contours, filled with the nonzero winding rule
+    glm::vec2 min = glm::vec2(0.f);
+    glm::vec2 max = glm::vec2(0.f);
+};
+
+// Parses the TrueType outlines of a .ttf file, with the cmap formats 4 and 12 and the kerning pairs of the kern table.
+// CFF outlines, font collections, hinting and GPOS are not supported. Reading is const and thread safe.
+// Malformed files throw std::runtime_error, missing files std::ios_base::failure.
+class TrueTypeFont
+{
+public:
+    TrueTypeFont() noexcept = default;
+    explicit TrueTypeFont(const std::filesystem::path& path);
+
+    TrueTypeFont(const TrueTypeFont&) = delete;
+    TrueTypeFont& operator=(const TrueTypeFont&) = delete;
+
+    TrueTypeFont(TrueTypeFont&&) noexcept = default;
+    TrueTypeFont& operator=(TrueTypeFont&&) noexcept = default;
+
+    ~TrueTypeFont() noexcept = default;
+
+public:
+    // 0, the missing glyph, if the font does not map the codepoint
+    uint32_t glyphIndex(char32_t codepoint) const;
+    // In font units
+    float advance(uint32_t glyph) const;
+    float kerning(uint32_t left, uint32_t right) const;
+
+    // False for glyphs without contours, e.g. spaces
+    bool hasOutline(uint32_t glyph) const;
+    GlyphOutline outline(uint32_t glyph) const;
+
+    float unitsPerEm() const noexcept { return m_unitsPerEm; }
+    float ascender() const noexcept { return m_ascender; }
+    float descender() const noexcept { return m_descender; }   // negative below the baseline
+    float lineGap() const noexcept { return m_lineGap; }
+
+private:
+    // Offset and size of a glyph's data in the glyf table
+    std::pair<size_t, size_t> glyphRange(uint32_t glyph) const;
+    void appendOutline(uint32_t glyph,
+                       const glm::mat2& linear,
+                       const glm::vec2& offset,
+                       size_t depth,
+                       std::vector<GlyphCurve>& curves) const;
+
+private:
+    std::vector<char> m_data;
+    size_t m_glyf = 0;
+    size_t m_loca = 0;
+    size_t m_hmtx = 0;
+    size_t m_cmap = 0;   // of the selected subtable
+    uint16_t m_cmapFormat = 0;
+    size_t m_kernPairs = 0;
+    size_t m_kernPairCount = 0;
+    uint32_t m_numGlyphs = 0;
+    uint32_t m_numHMetrics = 0;
+    bool m_longLoca = false;
+    float m_unitsPerEm = 0.f;
+    float m_ascender = 0.f;
+    float m_descender = 0.f;
+    float m_lineGap = 0.f;
+};
+
+}   // namespace renderer
+
+#endif
@@ -17,7 +17,7 @@ std::array<vk::VertexInputAttributeDescription, 3> Vertex::attributeDescriptions
     // pos
     attributeDescriptions[0] = {.location = 0,
                                 .binding = 0,
-                                .format = vk::Format::eR32G32Sfloat,
+                                .format = vk::Format::eR32G32B32Sfloat,
                                 .offset = offsetof(Vertex, pos)};
     // color
     attributeDescriptions[1] = {.location = 1,
@@ -34,6 +34,63 @@ std::array<vk::VertexInputAttributeDescription, 3> Vertex::attributeDescriptions
 }
 // End Vertex
 
+// Begin InstanceData
+vk::VertexInputBindingDescription InstanceData::bindingDescription() noexcept
+{
+    return vk::VertexInputBindingDescription {.binding = 1,
+                                              .stride = sizeof(InstanceData),
+                                              .inputRate = vk::VertexInputRate::eInstance};
+}
+
+std::array<vk::VertexInputAttributeDescription, 4> InstanceData::attributeDescriptions() noexcept
+{
+    std::array<vk::VertexInputAttributeDescription, 4> attributeDescriptions;
+    // model, a mat4 input takes a location per column
+    for (uint32_t column = 0; column < attributeDescriptions.size(); ++column) {
+        attributeDescriptions[column] = {.location = 3 + column,
+                                         .binding = 1,
+                                         .format = vk::Format::eR32G32B32A32Sfloat,
+                                         .offset = static_cast<uint32_t>(offsetof(InstanceData, model) +
+                                                                         column * sizeof(glm::vec4))};
+    }
+
+    return attributeDescriptions;
+}
+// End InstanceData
+
+// Begin SpriteInstance
+vk::VertexInputBindingDescription SpriteInstance::bindingDescription() noexcept
+{
+    return vk::VertexInputBindingDescription {.binding = 0,
+                                              .stride = sizeof(SpriteInstance),
+                                              .inputRate = vk::VertexInputRate::eInstance};
+}
+
+std::array<vk::VertexInputAttributeDescription, 4> SpriteInstance::attributeDescriptions() noexcept
+{
+    std::array<vk::VertexInputAttributeDescription, 4> attributeDescriptions;
+    attributeDescriptions[0] = {.location = 0,
+                                .binding = 0,
+                                .format = vk::Format::eR32G32B32A32Sfloat,
+                                .offset = offsetof(SpriteInstance, rect)};
+    attributeDescriptions[1] = {.location = 1,
+                                .binding = 0,
+                                .format = vk::Format::eR32G32B32A32Sfloat,
+                                .offset = offsetof(SpriteInstance, uvRect)};
+    attributeDescriptions[2] = {.location = 2,
+                                .binding = 0,
+                                .format = vk::Format::eR32G32Sfloat,
+                                .offset = offsetof(SpriteInstance, rotation)};
+    // Unpacked in the shader, so the reflected input matches
+    attributeDescriptions[3] = {.location = 3,
+                                .binding = 0,
+                                .format = vk::Format::eR32Uint,
+                                .offset = offsetof(SpriteInstance, color)};
+
+    return attributeDescriptions;
+}
+// End SpriteInstance
+
 // Begin AllocatedBuffer
 AllocatedBuffer::AllocatedBuffer(VmaAllocator allocator,
                                  vk::DeviceSize size,
@@ -102,9 +159,17 @@ VmaAllocationInfo AllocatedBuffer::allocationInfo() const noexcept
 // End AllocatedBuffer
 
 // Begin Mesh
-Mesh::Mesh(vk::Device device, VmaAllocator allocator, vk::DeviceSize vertexBufferSize, vk::DeviceSize indexBufferSize)
+Mesh::Mesh(vk::Device device,
+           VmaAllocator allocator,
+           vk::DeviceSize vertexBufferSize,
+           vk::DeviceSize indexBufferSize,
+           uint32_t id)
+    : m_id(id)
 {
     m_numIndices = indexBufferSize / sizeof(uint32_t);
+    m_lods = {
+        {.firstIndex = 0, .indexCount = m_numIndices, .error = 0.f}
+    };
 
     // Allocate device buffers
     m_vertexBuffer = AllocatedBuffer(allocator,
@@ -8,13 +8,16 @@
 
 // std
 #include <array>
+#include <cstddef>
 #include <cstdint>
+#include <utility>
+#include <vector>
 
 namespace renderer
 {
 
 struct alignas(16) Vertex {
-    glm::vec2 pos;
+    glm::vec3 pos;
     glm::vec3 color;
     glm::vec2 texCoord;
 
@@ -22,6 +25,26 @@ struct alignas(16) Vertex {
     static std::array<vk::VertexInputAttributeDescription, 3> attributeDescriptions() noexcept;
 };
 
+// Read once per instance from binding 1, at the locations following Vertex's
+struct InstanceData {
+    glm::mat4 model;
+
+    static vk::VertexInputBindingDescription bindingDescription() noexcept;
+    // One per column of model
+    static std::array<vk::VertexInputAttributeDescription, 4> attributeDescriptions() noexcept;
+};
+
+// Read once per sprite from binding 0, without a vertex buffer, the quad's corners come from the vertex index
+struct SpriteInstance {
+    glm::vec4 rect;       // center and size, in pixels
+    glm::vec4 uvRect;     // min and size
+    glm::vec2 rotation;   // cosine and sine
+    uint32_t color;       // RGBA8, straight alpha
+
+    static vk::VertexInputBindingDescription bindingDescription() noexcept;
+    static std::array<vk::VertexInputAttributeDescription, 4> attributeDescriptions() noexcept;
+};
+
 class AllocatedBuffer
 {
 public:
@@ -50,6 +73,31 @@ private:
     vk::Buffer m_buffer;
 };
 
+struct MeshLod {
+    uint32_t firstIndex;
+    uint32_t indexCount;
+    float error;   // simplification error relative to the mesh extent, 0 at full detail
+};
+
+struct MeshBounds {
+    glm::vec3 center = glm::vec3(0.f);
+    float radius = 0.f;
+    glm::vec3 boxMin = glm::vec3(0.f);
+    glm::vec3 boxMax = glm::vec3(0.f);
+};
+
+// Cluster of a mesh's triangles, contiguous in its index buffer, so it can be culled on its own
+struct Meshlet {
+    uint32_t firstIndex;
+    uint32_t indexCount;
+    glm::vec3 center;   // bounding sphere, model space
+    float radius;
+    // Every triangle faces away from viewers at p where dot(center - p, coneAxis) >= coneCutoff * |center - p| +
+    // radius. 1 when the normals are too spread out to ever cull the cluster
+    glm::vec3 coneAxis;
+    float coneCutoff;
+};
+
 class Mesh
 {
 public:
@@ -57,7 +105,12 @@ public:
     Mesh() noexcept = default;
     // Only allocates the buffers on the device. The buffers still have to be filled with a staging buffer.
     // TODO: improve this?
-    Mesh(vk::Device device, VmaAllocator allocator, vk::DeviceSize vertexBufferSize, vk::DeviceSize indexBufferSize);
+    // id tells meshes apart in the render queue sort keys, the Renderer numbers the meshes it creates
+    Mesh(vk::Device device,
+         VmaAllocator allocator,
+         vk::DeviceSize vertexBufferSize,
+         vk::DeviceSize indexBufferSize,
+         uint32_t id);
 
     Mesh(const Mesh&) = delete;
     Mesh& operator=(const Mesh&) = delete;
@@ -70,13 +123,30 @@ public:
 public:
     vk::Buffer vertexBuffer() const noexcept { return m_vertexBuffer.buffer(); }
     vk::Buffer indexBuffer() const noexcept { return m_indexBuffer.buffer(); }
+    // Every LOD included
     uint32_t numIndices() const noexcept { return m_numIndices; }
+    uint32_t id() const noexcept { return m_id; }
+
+    // Index ranges over the same vertices, finest first. A single full detail range until set
+    const std::vector<MeshLod>& lods() const noexcept { return m_lods; }
+    void setLods(std::vector<MeshLod> lods) noexcept { m_lods = std::move(lods); }
+
+    const MeshBounds& bounds() const noexcept { return m_bounds; }
+    void setBounds(const MeshBounds& bounds) noexcept { m_bounds = bounds; }
+
+    // Of the finest LOD, empty until set
+    const std::vector<Meshlet>& meshlets() const noexcept { return m_meshlets; }
+    void setMeshlets(std::vector<Meshlet> meshlets) noexcept { m_meshlets = std::move(meshlets); }
 
 private:
     AllocatedBuffer m_vertexBuffer;
     vk::DeviceAddress m_vertexBufferAddress;
     AllocatedBuffer m_indexBuffer;
     uint32_t m_numIndices;
+    uint32_t m_id = 0;
+    std::vector<MeshLod> m_lods;
+    MeshBounds m_bounds;
+    std::vector<Meshlet> m_meshlets;
 };
 
 struct TransferCommandData {
@@ -84,11 +154,26 @@ struct TransferCommandData {
 };
 
 struct UniformBufferObject {
-    glm::mat4 model;
     glm::mat4 view;
     glm::mat4 proj;
 };
 
+// Per-draw data of the simple shader, mirroring its push constant block
+struct DrawPushConstants {
+    glm::mat4 model;
+};
+
+// Mirrors the push constant block of the sprite shader
+struct SpritePushConstants {
+    glm::mat4 viewProj;   // pixels to clip space
+};
+
+// Mirrors the push constant block of the upscale shader
+struct UpscalePushConstants {
+    glm::vec2 uvScale;   // rendered region of the scene color target
+    glm::vec2 uvMax;
+};
+
 struct FrameCommandData {
     vk::UniqueCommandPool commandPool;
     vk::UniqueCommandBuffer commandBuffer;
@@ -100,7 +185,17 @@ struct FrameCommandData {
 struct FrameData {
     FrameCommandData commandData;
     AllocatedBuffer ubo;
+    // Host visible, rewritten every frame
+    AllocatedBuffer instanceBuffer;
+    size_t instanceCapacity = 0;
+    // Host visible, rewritten every frame
+    AllocatedBuffer spriteBuffer;
+    size_t spriteCapacity = 0;
     vk::DescriptorSet globalDescriptorSet;   // owned by the pool
+    // Rewritten with the frame's scene color when it is upscaled
+    vk::DescriptorSet upscaleDescriptorSet;   // owned by the pool
+    // Of the last frame recorded in this slot, for its GPU time
+    float renderScale = 1.f;
 };
 
 }   // namespace renderer
@@ -1,13 +1,40 @@
 #include "Utils.hpp"
 
+#include "core/File.hpp"
+
 // std
+#include <algorithm>
 #include <cassert>
 #include <cstdint>
-#include <fstream>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
 
 namespace renderer::utils
 {
 
+namespace
+{
+float srgbToLinear(uint8_t value) noexcept
+{
+    static const std::array<float, 256> table = [] {
+        std::array<float, 256> t;
+        for (size_t i = 0; i < t.size(); ++i) {
+            float c = static_cast<float>(i) / 255.f;
+            t[i] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+        }
+        return t;
+    }();
+    return table[value];
+}
+
+uint8_t linearToSrgb(float value) noexcept
+{
+    float c = value <= 0.0031308f ? value * 12.92f : 1.055f * std::pow(value, 1.f / 2.4f) - 0.055f;
+    return static_cast<uint8_t>(std::clamp(c * 255.f + 0.5f, 0.f, 255.f));
+}
+}   // namespace
+
 bool containsExtension(std::span<const char* const> extensionsList, const char* extensionName) noexcept
 {
     return std::ranges::find(extensionsList, extensionName) != extensionsList.end();
@@ -24,31 +51,155 @@ bool containsExtension(std::span<const vk::ExtensionProperties> extensionsProper
     return result != extensionsPropertiesList.end();
 }
 
-std::vector<char> readFile(const std::filesystem::path& path)
+std::vector<uint32_t> readSpirv(const std::filesystem::path& path)
 {
-    std::ifstream file;
-    file.exceptions(std::ifstream::badbit | std::ifstream::failbit);
-    file.open(path, std::ios::ate | std::ios::binary);
-
-    std::streampos fileSize = file.tellg();
-    std::vector<char> buffer(static_cast<size_t>(fileSize));
+    std::vector<char> bytes = core::readFile(path);
+    if (bytes.empty() || bytes.size() % sizeof(uint32_t) != 0) {
+        throw std::runtime_error(path.string() + " is not SPIR-V");
+    }
 
-    file.seekg(0);
-    file.read(buffer.data(), fileSize);
-    file.close();
-
-    return buffer;
+    std::vector<uint32_t> code(bytes.size() / sizeof(uint32_t));
+    std::memcpy(code.data(), bytes.data(), bytes.size());
+    return code;
 }
 
-vk::UniqueShaderModule createUniqueShaderModule(vk::Device device, std::span<const char> code)
+vk::UniqueShaderModule createUniqueShaderModule(vk::Device device, std::span<const uint32_t> code)
 {
     vk::ShaderModuleCreateInfo createInfo {.sType = vk::StructureType::eShaderModuleCreateInfo,
                                            .pNext = nullptr,
                                            .flags = {},
-                                           .codeSize = code.size(),
-                                           .pCode = reinterpret_cast<const uint32_t*>(code.data())};
+                                           .codeSize = code.size_bytes(),
+                                           .pCode = code.data()};
 
     return device.createShaderModuleUnique(createInfo);
 }
 
+glm::mat4 perspectiveReverseZ(float fovy, float aspect, float zNear) noexcept
+{
+    float focalLength = 1.f / glm::tan(fovy / 2.f);
+    glm::mat4 proj(0.f);
+    proj[0][0] = focalLength / aspect;
+    proj[1][1] = focalLength;
+    // z_clip = zNear and w_clip = -z_view, so depth = zNear / -z_view
+    proj[2][3] = -1.f;
+    proj[3][2] = zNear;
+    return proj;
+}
+
+bool hasStencilComponent(vk::Format format) noexcept
+{
+    switch (format) {
+        case vk::Format::eS8Uint:
+        case vk::Format::eD16UnormS8Uint:
+        case vk::Format::eD24UnormS8Uint:
+        case vk::Format::eD32SfloatS8Uint: return true;
+        default: return false;
+    }
+}
+
+bool isSrgb(vk::Format format) noexcept
+{
+    return format == vk::Format::eR8G8B8A8Srgb || format == vk::Format::eB8G8R8A8Srgb;
+}
+
+void downsampleRgba8(const uint8_t* src,
+                     const vk::Extent2D& srcExtent,
+                     uint8_t* dst,
+                     const vk::Extent2D& dstExtent,
+                     bool srgb) noexcept
+{
+    for (uint32_t y = 0; y < dstExtent.height; ++y) {
+        uint32_t y0 = std::min(2 * y, srcExtent.height - 1);
+        uint32_t y1 = std::min(2 * y + 1, srcExtent.height - 1);
+        for (uint32_t x = 0; x < dstExtent.width; ++x) {
+            uint32_t x0 = std::min(2 * x, srcExtent.width - 1);
+            uint32_t x1 = std::min(2 * x + 1, srcExtent.width - 1);
+            const uint8_t* texels[] = {&src[(y0 * srcExtent.width + x0) * 4],
+                                       &src[(y0 * srcExtent.width + x1) * 4],
+                                       &src[(y1 * srcExtent.width + x0) * 4],
+                                       &src[(y1 * srcExtent.width + x1) * 4]};
+            uint8_t* out = &dst[(y * dstExtent.width + x) * 4];
+            for (uint32_t c = 0; c < 4; ++c) {
+                // alpha is always linear
+                if (srgb && c < 3) {
+                    float sum = 0.f;
+                    for (const uint8_t* t : texels) {
+                        sum += srgbToLinear(t[c]);
+                    }
+                    out[c] = linearToSrgb(sum * 0.25f);
+                } else {
+                    uint32_t sum = 0;
+                    for (const uint8_t* t : texels) {
+                        sum += t[c];
+                    }
+                    out[c] = static_cast<uint8_t>((sum + 2) / 4);
+                }
+            }
+        }
+    }
+}
+
+vk::Format findDepthFormat(vk::PhysicalDevice physicalDevice)
+{
+    // Devices must support at least one of them
+    constexpr vk::Format candidates[] = {vk::Format::eD32Sfloat, vk::Format::eD32SfloatS8Uint};
+    for (vk::Format format : candidates) {
+        vk::FormatProperties properties = physicalDevice.getFormatProperties(format);
+        if (properties.optimalTilingFeatures & vk::FormatFeatureFlagBits::eDepthStencilAttachment) {
+            return format;
+        }
+    }
+    throw std::runtime_error("no floating point depth format is supported");
+}
+
+std::array<glm::vec4, 5> frustumPlanes(const glm::mat4& viewProj) noexcept
+{
+    // Gribb-Hartmann, from -w <= x, y <= w and z <= w in clip space. glm is column major, so rows are transposed
+    glm::mat4 rows = glm::transpose(viewProj);
+    std::array<glm::vec4, 5> planes = {rows[3] + rows[0], rows[3] - rows[0], rows[3] + rows[1], rows[3] - rows[1],
+                                       rows[3] - rows[2]};
+    for (auto& plane : planes) {
+        plane /= glm::length(glm::vec3(plane));
+    }
+    return planes;
+}
+
+MeshBounds transformBounds(const MeshBounds& bounds, const glm::mat4& transform) noexcept
+{
+    MeshBounds transformed;
+    transformed.center = glm::vec3(transform * glm::vec4(bounds.center, 1.f));
+    float scale = glm::sqrt(glm::max(glm::max(glm::dot(glm::vec3(transform[0]), glm::vec3(transform[0])),
+                                              glm::dot(glm::vec3(transform[1]), glm::vec3(transform[1]))),
+                                     glm::dot(glm::vec3(transform[2]), glm::vec3(transform[2]))));
+    transformed.radius = bounds.radius * scale;
+
+    // Arvo's method, each axis of the box takes the extreme contributions of each column
+    transformed.boxMin = glm::vec3(transform[3]);
+    transformed.boxMax = glm::vec3(transform[3]);
+    for (int column = 0; column < 3; ++column) {
+        glm::vec3 a = glm::vec3(transform[column]) * bounds.boxMin[column];
+        glm::vec3 b = glm::vec3(transform[column]) * bounds.boxMax[column];
+        transformed.boxMin += glm::min(a, b);
+        transformed.boxMax += glm::max(a, b);
+    }
+    return transformed;
+}
+
+float projectedSphereDiameter(const glm::mat4& modelView,
+                              const glm::mat4& proj,
+                              const glm::vec3& center,
+                              float radius,
+                              float viewportHeight) noexcept
+{
+    glm::vec3 viewCenter = glm::vec3(modelView * glm::vec4(center, 1.f));
+    float viewRadius = radius * glm::length(glm::vec3(modelView[0]));
+    // Right handed view space, looking at -z
+    float distance = -viewCenter.z;
+    if (distance <= viewRadius) {
+        // Intersects the camera plane, covers the whole viewport
+        return viewportHeight;
+    }
+    return viewRadius * glm::abs(proj[1][1]) / distance * viewportHeight;
+}
+
 }   // namespace renderer::utils
@@ -1,10 +1,15 @@
 #ifndef RENDERER_UTILS_HPP
 #define RENDERER_UTILS_HPP
 
+#include "Types.hpp"
+
 // libs
+#include <glm/glm.hpp>
 #include <vulkan/vulkan.hpp>
 
 // std
+#include <array>
+#include <cstdint>
 #include <filesystem>
 #include <span>
 #include <vector>
@@ -17,10 +22,46 @@ bool containsExtension(std::span<const char* const> extensionsList, const char*
 bool containsExtension(std::span<const vk::ExtensionProperties> extensionsPropertiesList,
                        const char* extensionName) noexcept;
 
-std::vector<char> readFile(const std::filesystem::path& path);
+// Throws if the size of the file is not a multiple of 4 bytes
+std::vector<uint32_t> readSpirv(const std::filesystem::path& path);
+
+vk::UniqueShaderModule createUniqueShaderModule(vk::Device device, std::span<const uint32_t> code);
+
+// Right handed, with depth 1 at the near plane and 0 at infinity. Meant for a floating point depth buffer cleared to 0
+// and compared with greater, as the exponent spreads the precision evenly with distance. Flip [1][1] for Vulkan's y
+glm::mat4 perspectiveReverseZ(float fovy, float aspect, float zNear) noexcept;
+
+bool hasStencilComponent(vk::Format format) noexcept;
+
+// Of the 8 bit RGBA formats
+bool isSrgb(vk::Format format) noexcept;
+
+// 2x2 box filter of RGBA8 pixels, averaging the color in linear space if srgb, alpha always being linear. Odd
+// dimensions clamp the last row / column
+void downsampleRgba8(const uint8_t* src,
+                     const vk::Extent2D& srcExtent,
+                     uint8_t* dst,
+                     const vk::Extent2D& dstExtent,
+                     bool srgb) noexcept;
+
+// Floating point depth format for reverse-Z, where floating point keeps the precision uniform with distance. Throws if
+// none is supported
+vk::Format findDepthFormat(vk::PhysicalDevice physicalDevice);
+
+// Normalized planes of the frustum of viewProj, facing inwards: left, right, bottom, top and near. Meant for
+// perspectiveReverseZ, whose far plane is at infinity and left out
+std::array<glm::vec4, 5> frustumPlanes(const glm::mat4& viewProj) noexcept;
+
+// Bounds of the transformed volumes: the sphere grows with the largest scale, the box is the box around the
+// transformed box
+MeshBounds transformBounds(const MeshBounds& bounds, const glm::mat4& transform) noexcept;
 
-// code must be uint32_t alligned in allocation
-vk::UniqueShaderModule createUniqueShaderModule(vk::Device device, std::span<const char> code);
+// Approximate on-screen diameter, in pixels, of a sphere given in model space. modelView must not scale non-uniformly
+float projectedSphereDiameter(const glm::mat4& modelView,
+                              const glm::mat4& proj,
+                              const glm::vec3& center,
+                              float radius,
+                              float viewportHeight) noexcept;
 
 }   // namespace renderer::utils
 
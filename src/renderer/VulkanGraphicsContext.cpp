@@ -67,6 +67,23 @@ bool isValidationLayerSupported() noexcept
     return supportsValidationLayers;
 }
 
+bool supportsExtendedDynamicState3(vk::PhysicalDevice physicalDevice)
+{
+    auto availableExtensions = physicalDevice.enumerateDeviceExtensionProperties();
+    if (!utils::containsExtension(availableExtensions, VK_EXT_EXTENDED_DYNAMIC_STATE_3_EXTENSION_NAME)) {
+        return false;
+    }
+
+    vk::PhysicalDeviceExtendedDynamicState3FeaturesEXT supportedFeatures {};
+    vk::PhysicalDeviceFeatures2 chain {};
+    chain.pNext = &supportedFeatures;
+    physicalDevice.getFeatures2(&chain);
+
+    return supportedFeatures.extendedDynamicState3PolygonMode &&
+           supportedFeatures.extendedDynamicState3ColorBlendEnable &&
+           supportedFeatures.extendedDynamicState3ColorBlendEquation;
+}
+
 }   // namespace
 
 VulkanGraphicsContextCreateInfo::VulkanGraphicsContextCreateInfo() noexcept
@@ -80,6 +97,7 @@ VulkanGraphicsContextCreateInfo::VulkanGraphicsContextCreateInfo() noexcept
     , requiredDevice11Features(nullptr)
     , requiredDevice12Features(nullptr)
     , requiredDevice13Features(nullptr)
+    , enableExtendedDynamicState3IfSupported(false)
 {}
 
 VulkanGraphicsContext::VulkanGraphicsContext(const VulkanGraphicsContextCreateInfo& createInfo)
@@ -140,7 +158,8 @@ VulkanGraphicsContext::VulkanGraphicsContext(const VulkanGraphicsContextCreateIn
                         createInfo.requiredDevice10Features,
                         createInfo.requiredDevice11Features,
                         createInfo.requiredDevice12Features,
-                        createInfo.requiredDevice13Features);
+                        createInfo.requiredDevice13Features,
+                        createInfo.enableExtendedDynamicState3IfSupported);
 
     createAllocator(createInfo.vulkanApiVersion,
                     createInfo.requiredDevice12Features && createInfo.requiredDevice12Features->bufferDeviceAddress);
@@ -324,7 +343,8 @@ void VulkanGraphicsContext::createLogicalDevice(std::span<const char* const> req
                                                 vk::PhysicalDeviceFeatures* requiredDevice10Features,
                                                 vk::PhysicalDeviceVulkan11Features* requiredDevice11Features,
                                                 vk::PhysicalDeviceVulkan12Features* requiredDevice12Features,
-                                                vk::PhysicalDeviceVulkan13Features* requiredDevice13Features)
+                                                vk::PhysicalDeviceVulkan13Features* requiredDevice13Features,
+                                                bool enableExtendedDynamicState3IfSupported)
 {
     std::vector<uint32_t> uniqueQueueFamiliesIndices {m_queueFamiliesIndices.graphicsFamilyIndex,
                                                       m_queueFamiliesIndices.presentFamilyIndex,
@@ -379,6 +399,21 @@ void VulkanGraphicsContext::createLogicalDevice(std::span<const char* const> req
         deviceCreateInfoPNext = requiredDevice13Features;
     }
 
+    // Optional, only enabled on the chosen device
+    std::vector<const char*> deviceExtensions(requiredDeviceExtensions.begin(), requiredDeviceExtensions.end());
+    vk::PhysicalDeviceExtendedDynamicState3FeaturesEXT extendedDynamicState3Features {};
+    m_extendedDynamicState3 = enableExtendedDynamicState3IfSupported && supportsExtendedDynamicState3(m_physicalDevice);
+    if (m_extendedDynamicState3) {
+        extendedDynamicState3Features.extendedDynamicState3PolygonMode = vk::True;
+        extendedDynamicState3Features.extendedDynamicState3ColorBlendEnable = vk::True;
+        extendedDynamicState3Features.extendedDynamicState3ColorBlendEquation = vk::True;
+        // Emplace in the front of the chain
+        extendedDynamicState3Features.pNext = deviceCreateInfoPNext;
+        deviceCreateInfoPNext = &extendedDynamicState3Features;
+        deviceExtensions.push_back(VK_EXT_EXTENDED_DYNAMIC_STATE_3_EXTENSION_NAME);
+        DEBUG("Extended dynamic state 3 supported, enabling it\n");
+    }
+
     vk::DeviceCreateInfo deviceCreateInfo {.sType = vk::StructureType::eDeviceCreateInfo,
                                            .pNext = deviceCreateInfoPNext,
                                            .flags = {},
@@ -386,9 +421,8 @@ void VulkanGraphicsContext::createLogicalDevice(std::span<const char* const> req
                                            .pQueueCreateInfos = queueCreateInfos.data(),
                                            .enabledLayerCount = 0,
                                            .ppEnabledLayerNames = nullptr,
-                                           .enabledExtensionCount =
-                                               static_cast<uint32_t>(requiredDeviceExtensions.size()),
-                                           .ppEnabledExtensionNames = requiredDeviceExtensions.data(),
+                                           .enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size()),
+                                           .ppEnabledExtensionNames = deviceExtensions.data(),
                                            .pEnabledFeatures = requiredDevice10Features};
 
     m_device = m_physicalDevice.createDeviceUnique(deviceCreateInfo);
@@ -30,6 +30,8 @@ struct VulkanGraphicsContextCreateInfo {
     vk::PhysicalDeviceVulkan11Features* requiredDevice11Features;
     vk::PhysicalDeviceVulkan12Features* requiredDevice12Features;
     vk::PhysicalDeviceVulkan13Features* requiredDevice13Features;
+    // Dynamic polygon mode and blending, see supportsExtendedDynamicState3
+    bool enableExtendedDynamicState3IfSupported;
 };
 
 class VulkanGraphicsContext
@@ -60,6 +62,10 @@ public:
 
     VmaAllocator allocator() const noexcept { return m_allocator.get(); }
 
+    // VK_EXT_extended_dynamic_state3 enabled, with at least dynamic polygon mode, color blend enable and color blend
+    // equation
+    bool supportsExtendedDynamicState3() const noexcept { return m_extendedDynamicState3; }
+
     vk::SwapchainKHR swapchain() const noexcept { return *m_swapchain; }
     vk::Image swapchainImage(uint32_t imageIndex) const noexcept { return m_swapchainImages[imageIndex]; }
     vk::ImageView swapchainImageView(uint32_t imageIndex) const noexcept { return *m_swapchainImageViews[imageIndex]; }
@@ -106,7 +112,8 @@ private:
                              vk::PhysicalDeviceFeatures* requiredDevice10Features,
                              vk::PhysicalDeviceVulkan11Features* requiredDevice11Features,
                              vk::PhysicalDeviceVulkan12Features* requiredDevice12Features,
-                             vk::PhysicalDeviceVulkan13Features* requiredDevice13Features);
+                             vk::PhysicalDeviceVulkan13Features* requiredDevice13Features,
+                             bool enableExtendedDynamicState3IfSupported);
 
     void createAllocator(uint32_t vulkanApiVersion, bool useBufferDeviceAddressFeature);
 
@@ -120,6 +127,7 @@ private:
     vk::PhysicalDevice m_physicalDevice;
     QueueFamiliesIndices m_queueFamiliesIndices;
     vk::UniqueDevice m_device;
+    bool m_extendedDynamicState3 = false;
     Queues m_queues;
     core::UniqueVmaAllocator m_allocator;
     vk::PresentModeKHR m_currentSwapchainPresentMode;